@@ -0,0 +1,266 @@
+#include <source/cpu_features.hpp>
+#include <source/cpuid.hpp>
+#include <source/cpuinfo.hpp>
+#include <source/spd.hpp>
+#include <source/spd_view.hpp>
+#include <util/file.hpp>
+#include <util/spsc_ring.hpp>
+#include <util/writer.hpp>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+#include <span>
+#include <tuple>
+#include <cstdlib>
+
+namespace hwctrl::bench {
+	// samples per measurement, each sample times a batch of calls sized to take about SAMPLE_NS
+	static constexpr size_t SAMPLES = 100;
+	static constexpr double SAMPLE_NS = 1e6;
+
+	struct input {
+		std::string name{};
+		std::vector<char> bytes{};
+	};
+
+	template <typename T>
+	static void do_not_optimize(const T& value) noexcept {
+		asm volatile("" : : "g"(&value) : "memory");
+	}
+
+	// prints one json object per line so runs can be diffed and collected by scripts
+	template <typename F>
+	static void measure(std::string_view benchmark, std::string_view input_name, size_t bytes, std::string_view filter, F&& func) noexcept {
+		if (!filter.empty() && benchmark.find(filter) == std::string_view::npos) {
+			return;
+		}
+		using clock = std::chrono::steady_clock;
+		auto time_batch = [&](uint64_t calls) noexcept {
+			auto start = clock::now();
+			for (uint64_t i = 0; i < calls; i++) {
+				func();
+			}
+			return std::chrono::duration<double, std::nano>(clock::now() - start).count();
+		};
+		// calibrate the batch size, this also warms caches and branch predictors
+		uint64_t batch = 1;
+		while (time_batch(batch) < SAMPLE_NS / 10 && batch < (1u << 30u)) {
+			batch *= 2;
+		}
+		batch = std::max<uint64_t>(1, static_cast<uint64_t>(static_cast<double>(batch) * SAMPLE_NS / std::max(time_batch(batch), 1.0)));
+		std::vector<double> per_call_ns(SAMPLES);
+		double total_ns = 0;
+		for (auto& sample : per_call_ns) {
+			double batch_ns = time_batch(batch);
+			total_ns += batch_ns;
+			sample = batch_ns / static_cast<double>(batch);
+		}
+		std::sort(per_call_ns.begin(), per_call_ns.end());
+		uint64_t calls = batch * SAMPLES;
+		double ns_per_call = total_ns / static_cast<double>(calls);
+		std::cout << std::fixed << std::setprecision(1)
+			<< "{\"benchmark\":\"" << benchmark
+			<< "\",\"input\":\"" << input_name
+			<< "\",\"bytes\":" << bytes
+			<< ",\"calls\":" << calls
+			<< ",\"ns_per_call\":" << ns_per_call
+			<< ",\"min_ns\":" << per_call_ns.front()
+			<< ",\"median_ns\":" << per_call_ns[SAMPLES / 2]
+			<< ",\"p99_ns\":" << per_call_ns[SAMPLES * 99 / 100]
+			<< ",\"mb_per_s\":" << static_cast<double>(bytes) * 1e3 / ns_per_call
+			<< "}" << std::endl;
+	}
+
+	// generates a /proc/cpuinfo in the layout of an x86 linux host with the given topology
+	[[nodiscard]] static std::string synthetic_cpuinfo(uint32_t packages, uint32_t cores_per_package, uint32_t threads_per_core) noexcept {
+		static constexpr std::string_view FLAGS = "fpu vme de pse tsc msr pae mce cx8 apic sep mtrr pge mca cmov pat pse36 clflush mmx fxsr sse sse2 ht syscall nx mmxext fxsr_opt pdpe1gb rdtscp lm constant_tsc rep_good nopl nonstop_tsc cpuid extd_apicid aperfmperf pni pclmulqdq monitor ssse3 fma cx16 sse4_1 sse4_2 x2apic movbe popcnt aes xsave avx f16c rdrand lahf_lm cmp_legacy svm extapic cr8_legacy abm sse4a misalignsse 3dnowprefetch osvw ibs skinit wdt tce topoext perfctr_core perfctr_nb bpext perfctr_llc mwaitx cpb cat_l3 cdp_l3 hw_pstate ssbd mba ibrs ibpb stibp vmmcall fsgsbase bmi1 avx2 smep bmi2 erms invpcid cqm rdt_a rdseed adx smap clflushopt clwb sha_ni xsaveopt xsavec xgetbv1 xsaves cqm_llc cqm_occup_llc cqm_mbm_total cqm_mbm_local clzero irperf xsaveerptr rdpru wbnoinvd amd_ppin arat npt lbrv svm_lock nrip_save tsc_scale vmcb_clean flushbyasid decodeassists pausefilter pfthreshold v_vmsave_vmload vgif v_spec_ctrl umip pku ospke vaes vpclmulqdq rdpid overflow_recov succor smca";
+		uint32_t logical_cpus = packages * cores_per_package * threads_per_core;
+		std::string str;
+		str.reserve(logical_cpus * 1600u);
+		for (uint32_t id = 0; id < logical_cpus; id++) {
+			uint32_t thread = id / (packages * cores_per_package);
+			uint32_t package = (id % (packages * cores_per_package)) / cores_per_package;
+			uint32_t core = id % cores_per_package;
+			str += "processor\t: " + std::to_string(id) + "\n";
+			str += "vendor_id\t: AuthenticAMD\n";
+			str += "cpu family\t: 25\n";
+			str += "model\t\t: 1\n";
+			str += "model name\t: AMD EPYC 7763 64-Core Processor\n";
+			str += "stepping\t: 1\n";
+			str += "microcode\t: 0xa001143\n";
+			str += "cpu MHz\t\t: " + std::to_string(1500 + (id * 37) % 1900) + ".123\n";
+			str += "cache size\t: 512 KB\n";
+			str += "physical id\t: " + std::to_string(package) + "\n";
+			str += "siblings\t: " + std::to_string(cores_per_package * threads_per_core) + "\n";
+			str += "core id\t\t: " + std::to_string(core) + "\n";
+			str += "cpu cores\t: " + std::to_string(cores_per_package) + "\n";
+			str += "apicid\t\t: " + std::to_string(package * 128 + core * 2 + thread) + "\n";
+			str += "initial apicid\t: " + std::to_string(package * 128 + core * 2 + thread) + "\n";
+			str += "fpu\t\t: yes\n";
+			str += "fpu_exception\t: yes\n";
+			str += "cpuid level\t: 16\n";
+			str += "wp\t\t: yes\n";
+			str += "flags\t\t: ";
+			str += FLAGS;
+			str += "\n";
+			str += "bugs\t\t: sysret_ss_attrs spectre_v1 spectre_v2 spec_store_bypass\n";
+			str += "bogomips\t: 4890.81\n";
+			str += "TLB size\t: 2560 4K pages\n";
+			str += "clflush size\t: 64\n";
+			str += "cache_alignment\t: 64\n";
+			str += "address sizes\t: 48 bits physical, 48 bits virtual\n";
+			str += "power management: ts ttp tm hwpstate cpb eff_freq_ro [13] [14]\n\n";
+		}
+		return str;
+	}
+
+	[[nodiscard]] static std::vector<input> read_inputs(const std::filesystem::path& dir) noexcept {
+		std::vector<input> inputs{};
+		std::error_code ec;
+		for (auto it = std::filesystem::directory_iterator(dir, ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+			auto file_result = util::file::read_binary_file(it->path());
+			if (const auto* err_ptr = std::get_if<hwctrl_error>(&file_result)) {
+				std::cerr << err_ptr->message << std::endl;
+				exit(EXIT_FAILURE);
+			}
+			inputs.push_back({it->path().filename().string(), std::move(std::get<std::vector<char>>(file_result))});
+		}
+		std::sort(inputs.begin(), inputs.end(), [](const input& a, const input& b) noexcept {
+			return a.name < b.name;
+		});
+		return inputs;
+	}
+
+	static void bench_spd(const input& in, std::string_view filter) noexcept {
+		std::span<const unsigned char> data{reinterpret_cast<const unsigned char*>(in.bytes.data()), in.bytes.size()};
+		auto parsed = source::parse_spd(data);
+		if (const auto* err_ptr = std::get_if<hwctrl_error>(&parsed)) {
+			std::cerr << in.name << ": " << err_ptr->message << std::endl;
+			exit(EXIT_FAILURE);
+		}
+		const auto& spd_parsed = std::get<source::spd>(parsed);
+		measure("parse_spd", in.name, data.size(), filter, [&]() noexcept {
+			do_not_optimize(source::parse_spd(data));
+		});
+		measure("spd_view_fields", in.name, data.size(), filter, [&]() noexcept {
+			auto view = source::make_spd_view(data);
+			if (const auto* view_ptr = std::get_if<source::spd_view>(&view)) {
+				do_not_optimize(view_ptr->serial_number());
+				do_not_optimize(view_ptr->tCL_min());
+				do_not_optimize(view_ptr->clock_max());
+			}
+		});
+		// parse_xmp_20 is internal, xmp_profile decodes the same layout through the public view
+		if (auto view = source::make_spd_view(data); std::holds_alternative<source::spd_view>(view) && std::get<source::spd_view>(view).has_xmp_20()) {
+			const auto& spd_view = std::get<source::spd_view>(view);
+			measure("parse_xmp_20", in.name, data.size(), filter, [&]() noexcept {
+				do_not_optimize(spd_view.xmp_profile(0));
+				do_not_optimize(spd_view.xmp_profile(1));
+			});
+		}
+		measure("spd_string", in.name, data.size(), filter, [&]() noexcept {
+			do_not_optimize(source::spd_string(spd_parsed, true));
+		});
+		// reuses the output buffer like a long running collector would
+		std::string json{};
+		measure("write_spd_json", in.name, data.size(), filter, [&]() noexcept {
+			json.clear();
+			util::writer out{json, util::output_format::JSON};
+			source::write_spd(out, spd_parsed, true);
+			do_not_optimize(json.size());
+		});
+	}
+
+	static void bench_cpuinfo(const input& in, std::string_view filter) noexcept {
+		std::string_view str{in.bytes.data(), in.bytes.size()};
+		auto parsed = source::parse_cpuinfo(str);
+		if (const auto* err_ptr = std::get_if<hwctrl_error>(&parsed)) {
+			std::cerr << in.name << ": " << err_ptr->message << std::endl;
+			exit(EXIT_FAILURE);
+		}
+		const auto& ci = std::get<source::cpuinfo>(parsed);
+		measure("parse_cpuinfo", in.name, str.size(), filter, [&]() noexcept {
+			do_not_optimize(source::parse_cpuinfo(str));
+		});
+		measure("cpuinfo_string", in.name, str.size(), filter, [&]() noexcept {
+			do_not_optimize(source::cpuinfo_string(ci));
+		});
+		std::string json{};
+		measure("write_cpuinfo_json", in.name, str.size(), filter, [&]() noexcept {
+			json.clear();
+			util::writer out{json, util::output_format::JSON};
+			source::write_cpuinfo(out, ci);
+			do_not_optimize(json.size());
+		});
+	}
+
+	// feature decoding from a flags line against executing cpuid directly
+	static void bench_cpu_features(const input& in, std::string_view filter) noexcept {
+		std::string_view str{in.bytes.data(), in.bytes.size()};
+		auto start = str.find("\nflags");
+		if (start == std::string_view::npos) {
+			return;
+		}
+		auto flags = str.substr(start + 1, str.find('\n', start + 1) - start - 1);
+		flags = flags.substr(flags.find(':') + 1);
+		measure("parse_cpu_flags", in.name, flags.size(), filter, [&]() noexcept {
+			do_not_optimize(source::parse_cpu_flags(flags));
+		});
+	}
+
+	static void bench_cpuid(std::string_view filter) noexcept {
+		measure("read_cpuid_features", "host", 0, filter, []() noexcept {
+			do_not_optimize(source::read_cpuid_features());
+		});
+	}
+
+	// one monitor freq record (timestamp + one frequency per cpu) through the ring on a single thread
+	static void bench_spsc_ring(std::string_view filter) noexcept {
+		for (size_t cpus : {8u, 64u, 512u}) {
+			util::spsc_ring<uint64_t> ring((cpus + 1) * 1024);
+			std::vector<uint64_t> record(cpus + 1, 2'400'000);
+			measure("spsc_ring_record", std::to_string(cpus) + "cpu", record.size() * sizeof(uint64_t), filter, [&]() noexcept {
+				do_not_optimize(ring.try_push(record));
+				do_not_optimize(ring.try_pop(record));
+			});
+		}
+	}
+} // namespace hwctrl::bench
+
+int main(int argc, char* argv[]) {
+	using namespace hwctrl::bench;
+
+	// hwctrl-bench [dumps directory] [benchmark name filter]
+	std::filesystem::path dumps = argc > 1 ? argv[1] : "dumps";
+	std::string_view filter = argc > 2 ? argv[2] : "";
+
+	for (const auto& in : read_inputs(dumps / "spd")) {
+		bench_spd(in, filter);
+	}
+
+	auto cpuinfo_inputs = read_inputs(dumps / "cpuinfo");
+	// the only recorded sample is a 1 cpu vm, no larger host was available to dump
+	// the 8 to 512 cpu inputs are synthesized until recorded dumps of those sizes land in dumps/cpuinfo
+	for (auto [packages, cores_per_package, threads_per_core] : {std::tuple{1u, 4u, 2u}, {1u, 32u, 2u}, {2u, 64u, 2u}, {4u, 64u, 2u}}) {
+		auto str = synthetic_cpuinfo(packages, cores_per_package, threads_per_core);
+		cpuinfo_inputs.push_back({"synthetic-" + std::to_string(packages * cores_per_package * threads_per_core) + "cpu", {str.begin(), str.end()}});
+	}
+	for (const auto& in : cpuinfo_inputs) {
+		bench_cpuinfo(in, filter);
+	}
+
+	if (!cpuinfo_inputs.empty()) {
+		bench_cpu_features(cpuinfo_inputs.front(), filter);
+	}
+	bench_cpuid(filter);
+
+	bench_spsc_ring(filter);
+
+	return EXIT_SUCCESS;
+}
@@ -1,6 +1,30 @@
 #include <source/spd.hpp>
+#include <source/spd_batch.hpp>
 #include <source/cpuinfo.hpp>
+#include <source/cpuid.hpp>
+#include <source/topology.hpp>
+#include <source/cache.hpp>
+#include <source/numa.hpp>
+#include <source/dimm_map.hpp>
+#include <source/cpufreq.hpp>
+#include <source/msr.hpp>
+#include <source/interrupts.hpp>
+#include <probe/membw.hpp>
+#include <probe/memlat.hpp>
+#include <probe/c2c.hpp>
+#include <control/cpufreq.hpp>
+#include <control/cpuidle.hpp>
+#include <control/irq.hpp>
+#include <control/journal.hpp>
+#include <control/placement.hpp>
+#include <control/hugepages.hpp>
+#include <control/profile.hpp>
+#include <util/affinity.hpp>
 #include <util/file.hpp>
+#include <util/snapshot.hpp>
+#include <util/sysfs.hpp>
+#include <util/thread_pool.hpp>
+#include <util/writer.hpp>
 #if defined(__GNUG__)
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wshadow"
@@ -20,6 +44,14 @@
 #include <string>
 #include <type_traits>
 #include <filesystem>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace hwctrl::exe {
 	template <typename T>
@@ -58,59 +90,1255 @@ namespace hwctrl::exe {
 		return (compare_name<commands, commands...>(command_string) | ...).command_optional;
 	}
 
+	[[nodiscard]] inline util::output_format get_output_format(const std::string& format) noexcept {
+		auto format_opt = util::parse_output_format(format);
+		if (format_opt == std::nullopt) {
+			std::cerr << "error - unknown output format \"" << format << "\", expected text, json or cbor" << std::endl;
+			exit(EXIT_FAILURE);
+		}
+		return format_opt.value();
+	}
+
+	// sysfs topology, or the cpuinfo one where sysfs has none
+	[[nodiscard]] inline source::cpu_topology get_topology(const std::filesystem::path& sysfs_root) noexcept {
+		auto topology_result = source::read_topology(sysfs_root);
+		if (auto* topology_ptr = std::get_if<source::cpu_topology>(&topology_result)) {
+			return std::move(*topology_ptr);
+		}
+		std::vector<char> buffer{};
+		auto read_result = source::read_cpuinfo(buffer);
+		if (const auto* err_ptr = std::get_if<hwctrl_error>(&read_result)) {
+			std::cerr << err_ptr->message << std::endl;
+			exit(EXIT_FAILURE);
+		}
+		auto cpuinfo_result = source::parse_cpuinfo(std::get<std::string_view>(read_result));
+		if (const auto* err_ptr = std::get_if<hwctrl_error>(&cpuinfo_result)) {
+			std::cerr << err_ptr->message << std::endl;
+			exit(EXIT_FAILURE);
+		}
+		return source::make_topology(std::get<source::cpuinfo>(cpuinfo_result));
+	}
+
+	// cpus selected by a cpu set expression such as "package:0" or "smt:pid:1234"
+	[[nodiscard]] inline std::vector<uint32_t> get_cpu_set(const source::cpu_topology& topology, const std::string& expression) noexcept {
+		auto cpus_result = source::resolve_cpu_set(topology, expression);
+		if (const auto* err_ptr = std::get_if<hwctrl_error>(&cpus_result)) {
+			std::cerr << err_ptr->message << std::endl;
+			exit(EXIT_FAILURE);
+		}
+		return std::move(std::get<std::vector<uint32_t>>(cpus_result));
+	}
+
+	// saves attributes before they change, values from an earlier run are kept so rollback returns to the state before the first one
+	inline void extend_journal(const std::filesystem::path& journal, const std::vector<control::attribute_value>& attributes) noexcept {
+		std::vector<control::attribute_value> previous{};
+		if (util::file::exists(journal)) {
+			auto journal_result = control::read_journal(journal);
+			if (const auto* err_ptr = std::get_if<hwctrl_error>(&journal_result)) {
+				std::cerr << err_ptr->message << std::endl;
+				exit(EXIT_FAILURE);
+			}
+			previous = std::move(std::get<std::vector<control::attribute_value>>(journal_result));
+		}
+		if (auto err = control::save_journal(journal, control::merge_journal(std::move(previous), attributes))) {
+			std::cerr << err->message << std::endl;
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	inline void rollback_journal(util::writer& out, const std::filesystem::path& journal, size_t threads) noexcept {
+		auto journal_result = control::read_journal(journal);
+		if (const auto* err_ptr = std::get_if<hwctrl_error>(&journal_result)) {
+			std::cerr << err_ptr->message << std::endl;
+			exit(EXIT_FAILURE);
+		}
+		util::thread_pool pool(threads);
+		auto result = control::restore_journal(std::get<std::vector<control::attribute_value>>(journal_result), pool);
+		control::write_restore_result(out, result);
+		if (!result.errors.empty()) {
+			std::cerr << result.errors.front().message << std::endl;
+			exit(EXIT_FAILURE);
+		}
+		// a completed rollback starts the next change from a fresh journal
+		std::error_code ec;
+		std::filesystem::remove(journal, ec);
+	}
+
+	// set from the SIGINT/SIGTERM handler of long running commands
+	inline std::atomic<bool> stop_requested{false};
+
+	inline void request_stop(int) noexcept {
+		stop_requested.store(true);
+	}
+
+	// everything after "--", the command line of "hwctrl run"
+	inline std::vector<std::string> trailing_args{};
+
 	namespace cmd {
 		struct spd {
 			static constexpr auto NAME = "spd";
 			std::filesystem::path path{};
 			bool serial = false;
+			bool batch = false;
+			size_t threads = std::thread::hardware_concurrency();
+			std::string format = "text";
 
 			void setup_cli(lyra::cli_parser& parser) noexcept {
-				parser |= lyra::arg(path, "path to spd binary file").required();
+				parser |= lyra::arg(path, "path to spd binary file, or directory/glob with --batch").required();
 				parser |= lyra::opt(serial)["--serial"].optional();
+				parser |= lyra::opt(batch)["--batch"]("audit every dump in a directory tree or glob").optional();
+				parser |= lyra::opt(threads, "threads")["--threads"]("worker threads for --batch").optional();
+				parser |= lyra::opt(format, "format")["--format"]("output format: text, json or cbor").optional();
+			}
+
+			void execute_batch() noexcept {
+				util::writer out(STDOUT_FILENO, get_output_format(format));
+				util::thread_pool pool(threads);
+				auto result = source::audit_spd_files(path.string(), pool, [&out](const source::spd_batch_record& record) noexcept {
+					source::write_spd_batch_record(out, record);
+				});
+				if (const auto* err_ptr = std::get_if<hwctrl_error>(&result)) {
+					std::cerr << err_ptr->message << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				source::write_spd_batch_summary(out, std::get<source::spd_batch_summary>(result));
 			}
 
 			void execute() noexcept {
-				auto file_result = util::file::read_binary_file(path);
+				auto output_format = get_output_format(format);
+				if (batch) {
+					execute_batch();
+					return;
+				}
+				// dumps are mapped, live eeproms under /sys are read
+				auto file_result = util::file::map_or_read_file(path);
 				if (const auto* err_ptr = std::get_if<hwctrl_error>(&file_result)) {
 					std::cerr << err_ptr->message << std::endl;
 					exit(EXIT_FAILURE);
 				}
-				auto& file_contents = std::get<std::vector<char>>(file_result);
-				
-				auto spd_parsed = source::parse_spd(reinterpret_cast<unsigned char*>(file_contents.data()), static_cast<uint32_t>(file_contents.size()));
+				const auto& file_contents = std::get<util::file::mapped_file>(file_result);
+
+				auto spd_parsed = source::parse_spd(file_contents.data());
 				if (const auto* err = std::get_if<hwctrl_error>(&spd_parsed)) {
 					std::cerr << err->message << std::endl;
 					exit(EXIT_FAILURE);
 				}
-				
-				std::cout << "===spd info===" << std::endl;
-				std::cout << spd_string(std::get<source::spd>(spd_parsed), serial) << std::endl;
+
+				util::writer out(STDOUT_FILENO, output_format);
+				source::write_spd(out, std::get<source::spd>(spd_parsed), serial);
+			}
+		};
+
+		struct monitor {
+			static constexpr auto NAME = "monitor";
+			std::string source{};
+			uint32_t interval_ms = 100;
+			double duration_s = 0;
+			std::filesystem::path output{};
+			std::filesystem::path sysfs_root = "/sys";
+			std::filesystem::path msr_root = "/dev/cpu";
+			uint32_t msr_stride = 1;
+			size_t buffer_ticks = 1024;
+			std::string format = "text";
+
+			void setup_cli(lyra::cli_parser& parser) noexcept {
+				parser |= lyra::arg(source, "what to monitor (freq, aperf)").required();
+				parser |= lyra::opt(interval_ms, "ms")["--interval"]("sampling interval in milliseconds, at least 1").optional();
+				parser |= lyra::opt(duration_s, "seconds")["--duration"]("stop after this many seconds, 0 runs until interrupted").optional();
+				parser |= lyra::opt(output, "path")["--output"]("write samples to a file instead of stdout").optional();
+				parser |= lyra::opt(sysfs_root, "path")["--sysfs-root"]("root of the sysfs tree").optional();
+				parser |= lyra::opt(msr_root, "path")["--msr-root"]("directory holding N/msr for aperf").optional();
+				parser |= lyra::opt(msr_stride, "bytes")["--msr-stride"]("file offset per msr register, 8 for fake uint64_t array files").optional();
+				parser |= lyra::opt(buffer_ticks, "samples")["--buffer"]("samples buffered while the writer catches up").optional();
+				parser |= lyra::opt(format, "format")["--format"]("output format: text, json or cbor").optional();
+			}
+
+			// samples counters and open files of the running system, none of it is in a snapshot
+			[[nodiscard]] bool needs_live_system() const noexcept {
+				return true;
+			}
+
+			void execute_freq(util::writer& out) noexcept {
+				auto sampler_result = source::open_cpufreq_sampler(sysfs_root);
+				if (const auto* err_ptr = std::get_if<hwctrl_error>(&sampler_result)) {
+					std::cerr << err_ptr->message << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				source::cpufreq_monitor_options options{};
+				options.interval = std::chrono::milliseconds{interval_ms};
+				options.duration = std::chrono::microseconds{static_cast<int64_t>(duration_s * 1e6)};
+				options.buffer_ticks = buffer_ticks;
+				auto stats = source::monitor_cpufreq(std::get<source::cpufreq_sampler>(sampler_result), options, out, stop_requested);
+				if (stats.dropped_ticks != 0 || stats.missed_ticks != 0) {
+					std::cerr << "warning - dropped " << stats.dropped_ticks << " and missed " << stats.missed_ticks << " of " << stats.ticks + stats.dropped_ticks + stats.missed_ticks << " samples" << std::endl;
+				}
+			}
+
+			// effective frequency from aperf/mperf deltas over every interval
+			void execute_aperf(util::writer& out) noexcept {
+				auto topology_result = source::read_topology(sysfs_root);
+				if (const auto* err_ptr = std::get_if<hwctrl_error>(&topology_result)) {
+					std::cerr << err_ptr->message << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				auto sampler_result = source::open_msr_sampler(std::get<source::cpu_topology>(topology_result), msr_root, msr_stride);
+				if (const auto* err_ptr = std::get_if<hwctrl_error>(&sampler_result)) {
+					std::cerr << err_ptr->message << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				const auto& sampler = std::get<source::msr_sampler>(sampler_result);
+				std::vector<source::msr_counters> before(sampler.cpus().size());
+				std::vector<source::msr_counters> after(sampler.cpus().size());
+				auto start = std::chrono::steady_clock::now();
+				auto before_time = start;
+				sampler.read(before);
+				while (!stop_requested.load()) {
+					std::this_thread::sleep_until(before_time + std::chrono::milliseconds{interval_ms});
+					auto after_time = std::chrono::steady_clock::now();
+					sampler.read(after);
+					source::write_effective_frequency(out, source::compute_effective_frequency(sampler.cpus(), before, after, after_time - before_time));
+					std::swap(before, after);
+					before_time = after_time;
+					if (duration_s > 0 && std::chrono::duration<double>(after_time - start).count() >= duration_s) {
+						break;
+					}
+				}
+			}
+
+			void execute() noexcept {
+				if (source != "freq" && source != "aperf") {
+					std::cerr << "error - unknown monitor \"" << source << "\", expected freq or aperf" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				if (interval_ms == 0) {
+					std::cerr << "error - interval must be at least 1 ms" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				auto output_format = get_output_format(format);
+				util::file::unique_fd output_fd{};
+				if (!output.empty()) {
+					output_fd = util::file::unique_fd{::open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)};
+					if (!output_fd.valid()) {
+						std::cerr << "error - failed to open \"" << output.string() << "\"" << std::endl;
+						exit(EXIT_FAILURE);
+					}
+				}
+				std::signal(SIGINT, request_stop);
+				std::signal(SIGTERM, request_stop);
+				util::writer out(output_fd.valid() ? output_fd.get() : STDOUT_FILENO, output_format);
+				if (source == "aperf") {
+					execute_aperf(out);
+				} else {
+					execute_freq(out);
+				}
+				if (out.failed()) {
+					std::cerr << "error - failed to write samples" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+			}
+		};
+
+		struct numa {
+			static constexpr auto NAME = "numa";
+			std::filesystem::path sysfs_root = "/sys";
+			std::string format = "text";
+
+			void setup_cli(lyra::cli_parser& parser) noexcept {
+				parser |= lyra::opt(sysfs_root, "path")["--sysfs-root"]("root of the sysfs tree").optional();
+				parser |= lyra::opt(format, "format")["--format"]("output format: text, json or cbor").optional();
+			}
+
+			void execute() noexcept {
+				util::writer out(STDOUT_FILENO, get_output_format(format));
+				auto numa_result = source::read_numa_topology(sysfs_root);
+				if (const auto* err_ptr = std::get_if<hwctrl_error>(&numa_result)) {
+					std::cerr << err_ptr->message << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				const auto& numa_topology = std::get<source::numa_topology>(numa_result);
+				// topology - fall back to cpuinfo when sysfs has no cpu topology
+				auto topology_result = source::read_topology(sysfs_root);
+				if (auto* topology_ptr = std::get_if<source::cpu_topology>(&topology_result)) {
+					source::write_numa_topology(out, numa_topology, *topology_ptr);
+					return;
+				}
+				std::vector<char> buffer{};
+				auto read_result = source::read_cpuinfo(buffer);
+				if (const auto* err_ptr = std::get_if<hwctrl_error>(&read_result)) {
+					std::cerr << err_ptr->message << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				auto cpuinfo_result = source::parse_cpuinfo(std::get<std::string_view>(read_result));
+				if (const auto* err_ptr = std::get_if<hwctrl_error>(&cpuinfo_result)) {
+					std::cerr << err_ptr->message << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				auto topology = source::link_numa_topology(source::make_topology(std::get<source::cpuinfo>(cpuinfo_result)), numa_topology);
+				source::write_numa_topology(out, numa_topology, topology);
+			}
+		};
+
+		struct memory {
+			static constexpr auto NAME = "memory";
+			std::filesystem::path sysfs_root = "/sys";
+			std::filesystem::path dmi = "/sys/firmware/dmi/tables/DMI";
+			bool check = false;
+			std::string format = "text";
+
+			void setup_cli(lyra::cli_parser& parser) noexcept {
+				parser |= lyra::opt(sysfs_root, "path")["--sysfs-root"]("root of the sysfs tree").optional();
+				parser |= lyra::opt(dmi, "path")["--dmi"]("raw smbios table").optional();
+				parser |= lyra::opt(check)["--check"]("only check configured speeds, fail when a dimm runs below its xmp or jedec speed").optional();
+				parser |= lyra::opt(format, "format")["--format"]("output format: text, json or cbor").optional();
+			}
+
+			void execute() noexcept {
+				util::writer out(STDOUT_FILENO, get_output_format(format));
+				auto dimms = source::read_dimms(sysfs_root, dmi);
+				if (dimms.empty()) {
+					std::cerr << "error - no dimms found in smbios, edac or spd" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				if (check) {
+					auto misconfigured = source::write_dimm_speed_checks(out, dimms);
+					out.flush();
+					if (misconfigured != 0) {
+						exit(EXIT_FAILURE);
+					}
+					return;
+				}
+				source::write_dimms(out, dimms);
+				static_cast<void>(source::write_dimm_speed_checks(out, dimms));
+				source::write_memory_bandwidth(out, source::compute_memory_bandwidth(dimms));
+			}
+		};
+
+		struct membench {
+			static constexpr auto NAME = "membench";
+			std::string mode{};
+			std::string threads{};
+			size_t size_mib = 256;
+			uint32_t repetitions = 10;
+			std::string simd{};
+			std::string stores = "both";
+			size_t min_kib = 4;
+			size_t max_mib = 1024;
+			uint32_t steps = 4;
+			uint64_t accesses = uint64_t{1} << 22u;
+			std::string pages = "small";
+			uint32_t cpu = UINT32_MAX;
+			std::filesystem::path spd_path{};
+			std::filesystem::path sysfs_root = "/sys";
+			std::filesystem::path dmi = "/sys/firmware/dmi/tables/DMI";
+			std::string format = "text";
+
+			void setup_cli(lyra::cli_parser& parser) noexcept {
+				parser |= lyra::arg(mode, "what to measure (bandwidth, latency)").required();
+				parser |= lyra::opt(threads, "list")["--threads"]("thread counts to run, e.g. 1,8,16 (default 1, one package, all cores, all cpus)").optional();
+				parser |= lyra::opt(size_mib, "MiB")["--size"]("size of each array, use at least 4x the last level cache").optional();
+				parser |= lyra::opt(repetitions, "count")["--repetitions"]("timed runs per kernel, the fastest is reported").optional();
+				parser |= lyra::opt(simd, "level")["--simd"]("scalar, avx2 or avx512 (default widest supported)").optional();
+				parser |= lyra::opt(stores, "mode")["--stores"]("regular, nt or both").optional();
+				parser |= lyra::opt(min_kib, "KiB")["--min"]("smallest latency working set").optional();
+				parser |= lyra::opt(max_mib, "MiB")["--max"]("largest latency working set").optional();
+				parser |= lyra::opt(steps, "count")["--steps"]("latency working sets per doubling").optional();
+				parser |= lyra::opt(accesses, "count")["--accesses"]("loads per latency working set").optional();
+				parser |= lyra::opt(pages, "mode")["--pages"]("small, thp or hugetlb pages for the latency chain").optional();
+				parser |= lyra::opt(cpu, "id")["--cpu"]("cpu to measure latency on (default first allowed cpu)").optional();
+				parser |= lyra::opt(spd_path, "path")["--spd"]("spd dump for the dram timings instead of the ee1004 eeproms").optional();
+				parser |= lyra::opt(sysfs_root, "path")["--sysfs-root"]("root of the sysfs tree").optional();
+				parser |= lyra::opt(dmi, "path")["--dmi"]("raw smbios table for the theoretical peak").optional();
+				parser |= lyra::opt(format, "format")["--format"]("output format: text, json or cbor").optional();
+			}
+
+			// 1, one package, all cores, all cpus
+			[[nodiscard]] static std::vector<uint32_t> default_thread_counts(const source::cpu_topology& topology, size_t cpu_count) noexcept {
+				std::vector<uint32_t> counts{1};
+				uint32_t package_cores = 0;
+				if (topology.packages.size() != 0) {
+					auto package = topology.packages.group(0);
+					for (uint32_t cpu : package) {
+						if (topology.smt_siblings(cpu).empty() || topology.smt_siblings(cpu).front() == cpu) {
+							package_cores++;
+						}
+					}
+				}
+				counts.push_back(package_cores);
+				counts.push_back(static_cast<uint32_t>(topology.cores.size()));
+				counts.push_back(static_cast<uint32_t>(cpu_count));
+				std::sort(counts.begin(), counts.end());
+				counts.erase(std::unique(counts.begin(), counts.end()), counts.end());
+				counts.erase(std::remove_if(counts.begin(), counts.end(), [&](uint32_t count) noexcept {
+					return count == 0 || count > cpu_count;
+				}), counts.end());
+				return counts;
+			}
+
+			// measures the memory of the machine it runs on
+			[[nodiscard]] bool needs_live_system() const noexcept {
+				return true;
+			}
+
+			void execute_bandwidth(util::writer& out) noexcept {
+				probe::membw_options options{};
+				options.array_bytes = size_mib << 20u;
+				options.repetitions = repetitions;
+				options.simd = probe::detect_simd();
+				if (!simd.empty()) {
+					auto simd_result = probe::parse_simd_level(simd);
+					if (const auto* err_ptr = std::get_if<hwctrl_error>(&simd_result)) {
+						std::cerr << err_ptr->message << std::endl;
+						exit(EXIT_FAILURE);
+					}
+					options.simd = std::get<probe::simd_level>(simd_result);
+				}
+				if (stores == "regular") {
+					options.stores = probe::store_mode::REGULAR;
+				} else if (stores == "nt") {
+					options.stores = probe::store_mode::NON_TEMPORAL;
+				} else if (stores == "both") {
+					options.stores = probe::store_mode::BOTH;
+				} else {
+					std::cerr << "error - unknown store mode \"" << stores << "\", expected regular, nt or both" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+
+				auto topology = get_topology(sysfs_root);
+				auto cpus = source::spread_cpus(topology);
+				std::vector<uint32_t> thread_counts{};
+				if (threads.empty()) {
+					thread_counts = default_thread_counts(topology, cpus.size());
+				} else {
+					auto list_result = util::sysfs::parse_id_list(threads);
+					if (const auto* err_ptr = std::get_if<hwctrl_error>(&list_result)) {
+						std::cerr << err_ptr->message << std::endl;
+						exit(EXIT_FAILURE);
+					}
+					thread_counts = std::get<std::vector<uint32_t>>(list_result);
+				}
+
+				// theoretical peak of the populated channels, unknown without smbios, edac or spd access
+				auto dimms = source::read_dimms(sysfs_root, dmi);
+				auto bandwidth = source::compute_memory_bandwidth(dimms);
+				out.begin_object();
+				out.field("simd", probe::simd_level_string(options.simd));
+				out.field("array_bytes", options.array_bytes);
+				out.field("repetitions", options.repetitions);
+				out.field("peak_gb_per_second", bandwidth.peak_bytes_per_second / 1e9);
+				out.end_object();
+				for (auto count : thread_counts) {
+					if (count == 0 || count > cpus.size()) {
+						std::cerr << "error - cannot run " << count << " threads on " << cpus.size() << " cpus" << std::endl;
+						exit(EXIT_FAILURE);
+					}
+					auto result = probe::run_membw({cpus.data(), count}, options);
+					if (const auto* err_ptr = std::get_if<hwctrl_error>(&result)) {
+						std::cerr << err_ptr->message << std::endl;
+						exit(EXIT_FAILURE);
+					}
+					for (const auto& entry : std::get<std::vector<probe::membw_result>>(result)) {
+						probe::write_membw_result(out, entry, bandwidth.peak_bytes_per_second);
+					}
+					out.flush();
+				}
+			}
+
+			// spd of the --spd dump or of the first dimm with a readable eeprom
+			[[nodiscard]] std::optional<source::spd> read_timing_spd() const noexcept {
+				if (spd_path.empty()) {
+					for (auto& entry : source::read_dimms(sysfs_root, dmi)) {
+						if (entry.spd != std::nullopt) {
+							return std::move(entry.spd);
+						}
+					}
+					return std::nullopt;
+				}
+				auto file_result = util::file::map_or_read_file(spd_path);
+				if (const auto* err_ptr = std::get_if<hwctrl_error>(&file_result)) {
+					std::cerr << err_ptr->message << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				auto spd_result = source::parse_spd(std::get<util::file::mapped_file>(file_result).data());
+				if (const auto* err_ptr = std::get_if<hwctrl_error>(&spd_result)) {
+					std::cerr << err_ptr->message << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				return std::get<source::spd>(spd_result);
+			}
+
+			void execute_latency(util::writer& out) noexcept {
+				probe::memlat_options options{};
+				options.min_bytes = min_kib << 10u;
+				options.max_bytes = max_mib << 20u;
+				options.steps_per_octave = steps;
+				options.accesses = accesses;
+				auto pages_result = probe::parse_page_mode(pages);
+				if (const auto* err_ptr = std::get_if<hwctrl_error>(&pages_result)) {
+					std::cerr << err_ptr->message << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				options.pages = std::get<probe::page_mode>(pages_result);
+
+				if (cpu == UINT32_MAX) {
+					auto cpus_result = util::affinity::current_thread_cpus();
+					if (const auto* err_ptr = std::get_if<hwctrl_error>(&cpus_result)) {
+						std::cerr << err_ptr->message << std::endl;
+						exit(EXIT_FAILURE);
+					}
+					cpu = std::get<std::vector<uint32_t>>(cpus_result).front();
+				}
+				if (auto err = util::affinity::pin_current_thread({&cpu, 1}); err != std::nullopt) {
+					std::cerr << err->message << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				// data cache sizes seen by cpu to name the boundaries
+				std::vector<uint64_t> cache_bytes{};
+				auto cache_result = source::read_cache_topology(sysfs_root);
+				if (const auto* caches_ptr = std::get_if<source::cache_topology>(&cache_result)) {
+					options.line_size = caches_ptr->line_size();
+					for (uint32_t level = 1; level <= caches_ptr->max_level(); level++) {
+						const auto* cache = caches_ptr->find(cpu, level);
+						cache_bytes.push_back(cache == nullptr ? 0 : cache->size_bytes);
+					}
+				}
+				auto spd_opt = read_timing_spd();
+
+				out.begin_object();
+				out.field("cpu", cpu);
+				out.field("pages", probe::page_mode_string(options.pages));
+				out.field("line_size", options.line_size);
+				out.end_object();
+				auto points_result = probe::run_memlat(options);
+				if (const auto* err_ptr = std::get_if<hwctrl_error>(&points_result)) {
+					std::cerr << err_ptr->message << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				const auto& points = std::get<std::vector<probe::memlat_point>>(points_result);
+				for (const auto& point : points) {
+					probe::write_memlat_point(out, point);
+				}
+				auto boundaries = probe::detect_latency_boundaries(points, cache_bytes);
+				auto dram = spd_opt == std::nullopt ? std::vector<probe::dram_latency>{} : probe::dram_latency_from_spd(spd_opt.value());
+				probe::write_latency_summary(out, boundaries, dram);
+			}
+
+			void execute() noexcept {
+				util::writer out(STDOUT_FILENO, get_output_format(format));
+				if (mode == "bandwidth") {
+					execute_bandwidth(out);
+				} else if (mode == "latency") {
+					execute_latency(out);
+				} else {
+					std::cerr << "error - unknown membench mode \"" << mode << "\", expected bandwidth or latency" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+			}
+		};
+
+		struct bench {
+			static constexpr auto NAME = "bench";
+			std::string mode{};
+			std::string cpus = "all";
+			uint32_t round_trips = 5000;
+			uint32_t repetitions = 3;
+			size_t max_pairs = 4096;
+			std::filesystem::path sysfs_root = "/sys";
+			std::string format = "text";
+
+			void setup_cli(lyra::cli_parser& parser) noexcept {
+				parser |= lyra::arg(mode, "what to measure (c2c)").required();
+				parser |= lyra::opt(cpus, "set")["--cpus"]("cpus to include, e.g. 0-7,64-71 or package:0 (default all)").optional();
+				parser |= lyra::opt(round_trips, "count")["--round-trips"]("cache line handoffs per timed run").optional();
+				parser |= lyra::opt(repetitions, "count")["--repetitions"]("timed runs per pair, the fastest is reported").optional();
+				parser |= lyra::opt(max_pairs, "count")["--max-pairs"]("measure a fixed random sample of this many pairs on large machines, 0 for all").optional();
+				parser |= lyra::opt(sysfs_root, "path")["--sysfs-root"]("root of the sysfs tree").optional();
+				parser |= lyra::opt(format, "format")["--format"]("output format: text, json or cbor").optional();
+			}
+
+			// measures the machine it runs on
+			[[nodiscard]] bool needs_live_system() const noexcept {
+				return true;
+			}
+
+			void execute_c2c(util::writer& out) noexcept {
+				auto topology = get_topology(sysfs_root);
+				auto cache_result = source::read_cache_topology(sysfs_root);
+				source::cache_topology caches{};
+				if (auto* caches_ptr = std::get_if<source::cache_topology>(&cache_result)) {
+					caches = std::move(*caches_ptr);
+				}
+				auto cpu_list = get_cpu_set(topology, cpus);
+				probe::c2c_options options{};
+				options.round_trips = round_trips;
+				options.repetitions = repetitions;
+				options.max_pairs = max_pairs;
+				auto matrix_result = probe::run_c2c(cpu_list, options);
+				if (const auto* err_ptr = std::get_if<hwctrl_error>(&matrix_result)) {
+					std::cerr << err_ptr->message << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				const auto& matrix = std::get<probe::c2c_matrix>(matrix_result);
+				probe::write_c2c_matrix(out, matrix);
+				probe::write_c2c_summary(out, probe::summarize_c2c(matrix, topology, caches));
+			}
+
+			void execute() noexcept {
+				util::writer out(STDOUT_FILENO, get_output_format(format));
+				if (mode == "c2c") {
+					execute_c2c(out);
+				} else {
+					std::cerr << "error - unknown bench mode \"" << mode << "\", expected c2c" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+			}
+		};
+
+		struct cpufreq {
+			static constexpr auto NAME = "cpufreq";
+			std::string mode{};
+			std::string cpus = "all";
+			std::string governor{};
+			std::string min{};
+			std::string max{};
+			std::string epp{};
+			std::filesystem::path sysfs_root = "/sys";
+			// /run is cleared on reboot, like the settings it restores
+			std::filesystem::path journal = "/run/hwctrl/cpufreq.journal";
+			size_t threads = std::thread::hardware_concurrency();
+			std::string format = "text";
+
+			void setup_cli(lyra::cli_parser& parser) noexcept {
+				parser |= lyra::arg(mode, "show, set or rollback").required();
+				parser |= lyra::opt(cpus, "set")["--cpus"]("cpus to change, e.g. 0-7, package:1, node:0 or smt:pid:1234 (default all)").optional();
+				parser |= lyra::opt(governor, "name")["--governor"]("scaling governor, e.g. performance or powersave").optional();
+				parser |= lyra::opt(min, "freq")["--min"]("minimum frequency: khz, 2.4ghz, 800mhz, min or max").optional();
+				parser |= lyra::opt(max, "freq")["--max"]("maximum frequency: khz, 2.4ghz, 800mhz, min or max").optional();
+				parser |= lyra::opt(epp, "preference")["--epp"]("energy performance preference, e.g. performance or balance_power").optional();
+				parser |= lyra::opt(sysfs_root, "path")["--sysfs-root"]("root of the sysfs tree").optional();
+				parser |= lyra::opt(journal, "path")["--journal"]("file holding the values to roll back to").optional();
+				parser |= lyra::opt(threads, "threads")["--threads"]("policies written in parallel").optional();
+				parser |= lyra::opt(format, "format")["--format"]("output format: text, json or cbor").optional();
+			}
+
+			[[nodiscard]] control::cpufreq_settings get_settings() const noexcept {
+				control::cpufreq_settings settings{};
+				if (!governor.empty()) {
+					settings.governor = governor;
+				}
+				for (auto [str, setting] : {std::pair{&min, &settings.min}, {&max, &settings.max}}) {
+					if (str->empty()) {
+						continue;
+					}
+					auto frequency = control::parse_frequency(*str);
+					if (const auto* err_ptr = std::get_if<hwctrl_error>(&frequency)) {
+						std::cerr << err_ptr->message << std::endl;
+						exit(EXIT_FAILURE);
+					}
+					*setting = std::get<control::frequency_setting>(frequency);
+				}
+				if (!epp.empty()) {
+					settings.epp = epp;
+				}
+				if (!settings.governor.has_value() && !settings.min.has_value() && !settings.max.has_value() && !settings.epp.has_value()) {
+					std::cerr << "error - nothing to set, pass --governor, --min, --max or --epp" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				return settings;
+			}
+
+			void execute_set(util::writer& out, const std::vector<control::cpufreq_policy>& policies) noexcept {
+				auto settings = get_settings();
+				if (auto err = control::validate_cpufreq_settings(policies, settings)) {
+					std::cerr << err->message << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				extend_journal(journal, control::cpufreq_journal(policies));
+				util::thread_pool pool(threads);
+				auto results = control::apply_cpufreq(policies, settings, pool);
+				control::write_cpufreq_apply_results(out, results);
+				for (const auto& result : results) {
+					if (result.error.has_value()) {
+						std::cerr << result.error->message << std::endl;
+						std::cerr << "error - not every policy was changed, \"hwctrl cpufreq rollback\" restores the previous values" << std::endl;
+						exit(EXIT_FAILURE);
+					}
+				}
+			}
+
+			// set and rollback write sysfs
+			[[nodiscard]] bool needs_live_system() const noexcept {
+				return mode != "show";
+			}
+
+			void execute() noexcept {
+				util::writer out(STDOUT_FILENO, get_output_format(format));
+				if (mode == "rollback") {
+					rollback_journal(out, journal, threads);
+					return;
+				}
+				if (mode != "show" && mode != "set") {
+					std::cerr << "error - unknown cpufreq mode \"" << mode << "\", expected show, set or rollback" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				auto topology = get_topology(sysfs_root);
+				auto policies_result = control::read_cpufreq_policies(sysfs_root, get_cpu_set(topology, cpus));
+				if (const auto* err_ptr = std::get_if<hwctrl_error>(&policies_result)) {
+					std::cerr << err_ptr->message << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				const auto& policies = std::get<std::vector<control::cpufreq_policy>>(policies_result);
+				if (mode == "show") {
+					control::write_cpufreq_policies(out, policies);
+				} else {
+					execute_set(out, policies);
+				}
+			}
+		};
+
+		struct cpuidle {
+			static constexpr auto NAME = "cpuidle";
+			std::string mode{};
+			std::string cpus = "all";
+			int64_t max_latency_us = -1;
+			double duration_s = 0;
+			std::filesystem::path sysfs_root = "/sys";
+			std::filesystem::path pm_qos = "/dev/cpu_dma_latency";
+			std::filesystem::path journal = "/run/hwctrl/cpuidle.journal";
+			size_t threads = std::thread::hardware_concurrency();
+			std::string format = "text";
+
+			void setup_cli(lyra::cli_parser& parser) noexcept {
+				parser |= lyra::arg(mode, "show, limit, hold or rollback").required();
+				parser |= lyra::opt(cpus, "set")["--cpus"]("cpus to show or limit, e.g. 0-7, package:1 or smt:pid:1234 (default all)").optional();
+				parser |= lyra::opt(max_latency_us, "us")["--max-latency"]("highest exit latency allowed, deeper states are disabled (limit) or avoided system wide (hold)").optional();
+				parser |= lyra::opt(duration_s, "seconds")["--duration"]("release the hold after this many seconds, 0 holds until interrupted").optional();
+				parser |= lyra::opt(sysfs_root, "path")["--sysfs-root"]("root of the sysfs tree").optional();
+				parser |= lyra::opt(pm_qos, "path")["--pm-qos"]("pm qos device for hold").optional();
+				parser |= lyra::opt(journal, "path")["--journal"]("file holding the values to roll back to").optional();
+				parser |= lyra::opt(threads, "threads")["--threads"]("cpus written in parallel").optional();
+				parser |= lyra::opt(format, "format")["--format"]("output format: text, json or cbor").optional();
+			}
+
+			[[nodiscard]] uint64_t get_max_latency() const noexcept {
+				if (max_latency_us < 0) {
+					std::cerr << "error - " << mode << " needs --max-latency" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				return static_cast<uint64_t>(max_latency_us);
+			}
+
+			// pm qos applies to every cpu, the request lasts while the file stays open
+			void execute_hold(util::writer& out) noexcept {
+				auto latency = get_max_latency();
+				if (latency > INT32_MAX) {
+					std::cerr << "error - --max-latency is too large for pm qos" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				auto hold_result = control::hold_pm_qos_latency(pm_qos, static_cast<int32_t>(latency));
+				if (const auto* err_ptr = std::get_if<hwctrl_error>(&hold_result)) {
+					std::cerr << err_ptr->message << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				const auto& hold = std::get<control::pm_qos_hold>(hold_result);
+				std::signal(SIGINT, request_stop);
+				std::signal(SIGTERM, request_stop);
+				out.begin_object();
+				out.field("requested_latency_us", latency);
+				if (auto effective = hold.effective_latency_us(); std::holds_alternative<int32_t>(effective)) {
+					out.field("effective_latency_us", std::get<int32_t>(effective));
+				}
+				out.end_object();
+				out.flush();
+				auto start = std::chrono::steady_clock::now();
+				while (!stop_requested.load()) {
+					if (duration_s > 0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= duration_s) {
+						break;
+					}
+					std::this_thread::sleep_for(std::chrono::milliseconds{100});
+				}
+			}
+
+			// limit, hold and rollback change idle states
+			[[nodiscard]] bool needs_live_system() const noexcept {
+				return mode != "show";
+			}
+
+			void execute() noexcept {
+				util::writer out(STDOUT_FILENO, get_output_format(format));
+				if (mode == "rollback") {
+					rollback_journal(out, journal, threads);
+					return;
+				}
+				if (mode == "hold") {
+					execute_hold(out);
+					return;
+				}
+				if (mode != "show" && mode != "limit") {
+					std::cerr << "error - unknown cpuidle mode \"" << mode << "\", expected show, limit, hold or rollback" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				auto topology = get_topology(sysfs_root);
+				auto states_result = control::read_cpuidle_states(sysfs_root, get_cpu_set(topology, cpus));
+				if (const auto* err_ptr = std::get_if<hwctrl_error>(&states_result)) {
+					std::cerr << err_ptr->message << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				const auto& states = std::get<std::vector<control::cpu_idle_states>>(states_result);
+				if (mode == "show") {
+					control::write_cpuidle_states(out, states);
+					return;
+				}
+				auto latency = get_max_latency();
+				extend_journal(journal, control::cpuidle_journal(sysfs_root, states, latency));
+				util::thread_pool pool(threads);
+				auto results = control::limit_cpuidle(sysfs_root, states, latency, pool);
+				control::write_cpuidle_limit_results(out, results);
+				for (const auto& result : results) {
+					if (result.error.has_value()) {
+						std::cerr << result.error->message << std::endl;
+						std::cerr << "error - not every state was disabled, \"hwctrl cpuidle rollback\" restores the previous values" << std::endl;
+						exit(EXIT_FAILURE);
+					}
+				}
+			}
+		};
+
+		struct irq {
+			static constexpr auto NAME = "irq";
+			std::string mode{};
+			std::string match{};
+			std::string cpus = "all";
+			std::string isolated{};
+			std::filesystem::path proc_root = "/proc";
+			std::filesystem::path sysfs_root = "/sys";
+			std::filesystem::path journal = "/run/hwctrl/irq.journal";
+			size_t threads = std::thread::hardware_concurrency();
+			std::string format = "text";
+
+			void setup_cli(lyra::cli_parser& parser) noexcept {
+				parser |= lyra::arg(mode, "plan, apply or rollback").required();
+				parser |= lyra::opt(match, "names")["--match"]("only irqs whose handler names contain one of these comma separated strings, e.g. eth0,mlx5").optional();
+				parser |= lyra::opt(cpus, "set")["--cpus"]("cpus irqs may go to, e.g. package:0 or node:1 (default all)").optional();
+				parser |= lyra::opt(isolated, "set")["--isolated"]("cpus to keep free of irqs with their smt siblings, added to the kernel isolcpus").optional();
+				parser |= lyra::opt(proc_root, "path")["--proc-root"]("root of the procfs tree").optional();
+				parser |= lyra::opt(sysfs_root, "path")["--sysfs-root"]("root of the sysfs tree").optional();
+				parser |= lyra::opt(journal, "path")["--journal"]("file holding the affinities to roll back to").optional();
+				parser |= lyra::opt(threads, "threads")["--threads"]("irqs written in parallel").optional();
+				parser |= lyra::opt(format, "format")["--format"]("output format: text, json or cbor").optional();
+			}
+
+			// apply and rollback move irqs
+			[[nodiscard]] bool needs_live_system() const noexcept {
+				return mode != "plan";
+			}
+
+			void execute() noexcept {
+				util::writer out(STDOUT_FILENO, get_output_format(format));
+				if (mode == "rollback") {
+					rollback_journal(out, journal, threads);
+					return;
+				}
+				if (mode != "plan" && mode != "apply") {
+					std::cerr << "error - unknown irq mode \"" << mode << "\", expected plan, apply or rollback" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				auto interrupts_result = source::read_interrupts(proc_root);
+				if (const auto* err_ptr = std::get_if<hwctrl_error>(&interrupts_result)) {
+					std::cerr << err_ptr->message << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				auto irqs = control::read_irqs(proc_root, std::get<source::interrupts>(interrupts_result), match);
+				if (irqs.empty()) {
+					std::cerr << "error - no device irqs" << (match.empty() ? "" : " match \"" + match + "\"") << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				auto topology = get_topology(sysfs_root);
+				control::irq_plan_options options{};
+				options.cpus = get_cpu_set(topology, cpus);
+				options.isolated = control::read_isolated_cpus(sysfs_root);
+				if (!isolated.empty()) {
+					auto extra = get_cpu_set(topology, isolated);
+					options.isolated.insert(options.isolated.end(), extra.begin(), extra.end());
+				}
+				auto plan_result = control::plan_irqs(topology, irqs, options);
+				if (const auto* err_ptr = std::get_if<hwctrl_error>(&plan_result)) {
+					std::cerr << err_ptr->message << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				const auto& plan = std::get<std::vector<control::irq_assignment>>(plan_result);
+				control::write_irq_plan(out, plan);
+				if (mode == "plan") {
+					return;
+				}
+				extend_journal(journal, control::irq_journal(proc_root, plan));
+				util::thread_pool pool(threads);
+				auto results = control::apply_irq_plan(proc_root, plan, pool);
+				control::write_irq_apply_results(out, results);
+				size_t managed = 0;
+				bool failed = false;
+				for (const auto& result : results) {
+					if (result.managed) {
+						managed++;
+					}
+					if (result.error.has_value()) {
+						std::cerr << result.error->message << std::endl;
+						failed = true;
+					}
+				}
+				if (managed != 0) {
+					std::cerr << "warning - " << managed << " kernel managed irqs kept their affinity" << std::endl;
+				}
+				if (failed) {
+					std::cerr << "error - not every irq was moved, \"hwctrl irq rollback\" restores the previous affinities" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+			}
+		};
+
+		struct hugepages {
+			static constexpr auto NAME = "hugepages";
+			std::string mode{};
+			std::string size = "2m";
+			std::string per_node{};
+			int64_t pages = -1;
+			std::string cpus = "all";
+			bool compact = false;
+			std::filesystem::path sysfs_root = "/sys";
+			std::filesystem::path journal = "/run/hwctrl/hugepages.journal";
+			size_t threads = std::thread::hardware_concurrency();
+			std::string format = "text";
+
+			void setup_cli(lyra::cli_parser& parser) noexcept {
+				parser |= lyra::arg(mode, "show, set or rollback").required();
+				parser |= lyra::opt(size, "size")["--size"]("page size of the pool to set, 2m or 1g (default 2m)").optional();
+				parser |= lyra::opt(per_node, "size")["--per-node"]("memory to reserve on every node, e.g. 16g, rounded up to whole pages").optional();
+				parser |= lyra::opt(pages, "pages")["--pages"]("pages to reserve on every node instead of --per-node").optional();
+				parser |= lyra::opt(cpus, "set")["--cpus"]("reserve on the nodes of these cpus, e.g. pid:1234 (default all)").optional();
+				parser |= lyra::opt(compact)["--compact"]("compact a node and retry once when it cannot reserve every page").optional();
+				parser |= lyra::opt(sysfs_root, "path")["--sysfs-root"]("root of the sysfs tree").optional();
+				parser |= lyra::opt(journal, "path")["--journal"]("file holding the pool sizes to roll back to").optional();
+				parser |= lyra::opt(threads, "threads")["--threads"]("nodes reserved in parallel").optional();
+				parser |= lyra::opt(format, "format")["--format"]("output format: text, json or cbor").optional();
+			}
+
+			// set and rollback resize the pools
+			[[nodiscard]] bool needs_live_system() const noexcept {
+				return mode != "show";
+			}
+
+			void execute() noexcept {
+				util::writer out(STDOUT_FILENO, get_output_format(format));
+				if (mode == "rollback") {
+					rollback_journal(out, journal, threads);
+					return;
+				}
+				if (mode != "show" && mode != "set") {
+					std::cerr << "error - unknown hugepages mode \"" << mode << "\", expected show, set or rollback" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				auto state_result = control::read_hugepages(sysfs_root);
+				if (const auto* err_ptr = std::get_if<hwctrl_error>(&state_result)) {
+					std::cerr << err_ptr->message << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				const auto& state = std::get<control::hugepage_state>(state_result);
+				if (mode == "show") {
+					control::write_hugepages(out, state);
+					return;
+				}
+				auto page_size = control::parse_byte_size(size);
+				if (const auto* err_ptr = std::get_if<hwctrl_error>(&page_size)) {
+					std::cerr << err_ptr->message << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				auto page_kib = std::get<uint64_t>(page_size) >> 10u;
+				if (per_node.empty() == (pages < 0)) {
+					std::cerr << "error - set needs either --per-node or --pages" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				uint64_t page_count = static_cast<uint64_t>(pages);
+				if (!per_node.empty()) {
+					auto bytes = control::parse_byte_size(per_node);
+					if (const auto* err_ptr = std::get_if<hwctrl_error>(&bytes)) {
+						std::cerr << err_ptr->message << std::endl;
+						exit(EXIT_FAILURE);
+					}
+					auto page_bytes = page_kib << 10u;
+					page_count = (std::get<uint64_t>(bytes) + page_bytes - 1) / page_bytes;
+				}
+				auto topology = get_topology(sysfs_root);
+				auto nodes = control::placement_nodes(topology, get_cpu_set(topology, cpus));
+				if (nodes.empty()) {
+					std::cerr << "error - the cpus of \"" << cpus << "\" have no numa nodes" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				extend_journal(journal, control::hugepage_journal(sysfs_root, state, nodes, page_kib));
+				util::thread_pool pool(threads);
+				auto results = control::set_hugepages(sysfs_root, state, nodes, page_kib, page_count, compact, pool);
+				control::write_hugepage_set_results(out, results);
+				bool failed = false;
+				for (const auto& result : results) {
+					if (result.error.has_value()) {
+						std::cerr << result.error->message << std::endl;
+						failed = true;
+					}
+				}
+				if (failed) {
+					if (page_kib >= (1u << 20u)) {
+						std::cerr << "warning - 1 GB pages rarely fit into the memory of a running system, reserve them at boot with hugepagesz=1G hugepages=N" << std::endl;
+					}
+					std::cerr << "error - not every pool was reserved, \"hwctrl hugepages rollback\" restores the previous sizes" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+			}
+		};
+
+		struct run {
+			static constexpr auto NAME = "run";
+			std::string policy = "compact";
+			size_t count = 1;
+			std::string cpus = "all";
+			std::string mempolicy = "none";
+			bool dry_run = false;
+			std::filesystem::path sysfs_root = "/sys";
+			std::string format = "text";
+
+			void setup_cli(lyra::cli_parser& parser) noexcept {
+				parser |= lyra::opt(policy, "policy")["--policy"]("compact, spread, one-per-core or one-per-l3 (default compact)").optional();
+				parser |= lyra::opt(count, "count")["-n"]["--count"]("number of cpus to run on").optional();
+				parser |= lyra::opt(cpus, "set")["--cpus"]("cpus to choose from, e.g. package:0 or node:1 (default all)").optional();
+				parser |= lyra::opt(mempolicy, "mempolicy")["--mempolicy"]("none, bind, interleave or preferred over the nodes of the chosen cpus").optional();
+				parser |= lyra::opt(dry_run)["--dry-run"]("print the placement without running the command").optional();
+				parser |= lyra::opt(sysfs_root, "path")["--sysfs-root"]("root of the sysfs tree").optional();
+				parser |= lyra::opt(format, "format")["--format"]("output format: text, json or cbor").optional();
+			}
+
+			// placement is computed from the topology, but the command runs here
+			[[nodiscard]] bool needs_live_system() const noexcept {
+				return !dry_run;
+			}
+
+			void execute() noexcept {
+				auto policy_opt = control::parse_placement_policy(policy);
+				if (!policy_opt.has_value()) {
+					std::cerr << "error - unknown placement policy \"" << policy << "\", expected compact, spread, one-per-core or one-per-l3" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				std::optional<util::affinity::memory_policy> memory_policy{};
+				if (mempolicy == "bind") {
+					memory_policy = util::affinity::memory_policy::BIND;
+				} else if (mempolicy == "interleave") {
+					memory_policy = util::affinity::memory_policy::INTERLEAVE;
+				} else if (mempolicy == "preferred") {
+					memory_policy = util::affinity::memory_policy::PREFERRED;
+				} else if (mempolicy != "none") {
+					std::cerr << "error - unknown memory policy \"" << mempolicy << "\", expected none, bind, interleave or preferred" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				if (trailing_args.empty() && !dry_run) {
+					std::cerr << "error - no command to run, pass it after \"--\"" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				auto topology = get_topology(sysfs_root);
+				auto allowed = get_cpu_set(topology, cpus);
+				// caches only matter for one-per-l3, which reports their absence itself
+				auto cache_result = source::read_cache_topology(sysfs_root);
+				source::cache_topology caches{};
+				if (auto* caches_ptr = std::get_if<source::cache_topology>(&cache_result)) {
+					caches = std::move(*caches_ptr);
+				}
+				auto place_result = control::place_cpus(topology, caches, *policy_opt, count, allowed);
+				if (const auto* err_ptr = std::get_if<hwctrl_error>(&place_result)) {
+					std::cerr << err_ptr->message << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				const auto& placement = std::get<std::vector<uint32_t>>(place_result);
+				auto nodes = control::placement_nodes(topology, placement);
+				{
+					// stdout belongs to the command, the placement goes to stderr unless nothing runs
+					util::writer out(dry_run ? STDOUT_FILENO : STDERR_FILENO, get_output_format(format));
+					control::write_placement(out, *policy_opt, placement, nodes);
+				}
+				if (dry_run) {
+					return;
+				}
+				if (memory_policy.has_value()) {
+					if (auto err = util::affinity::set_memory_policy(*memory_policy, nodes); err.has_value()) {
+						std::cerr << err->message << std::endl;
+						exit(EXIT_FAILURE);
+					}
+				}
+				if (auto err = util::affinity::set_process_affinity(0, placement); err.has_value()) {
+					std::cerr << err->message << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				std::vector<char*> args{};
+				for (auto& arg : trailing_args) {
+					args.push_back(arg.data());
+				}
+				args.push_back(nullptr);
+				::execvp(args.front(), args.data());
+				std::cerr << "error - could not run \"" << trailing_args.front() << "\": " << std::strerror(errno) << std::endl;
+				exit(EXIT_FAILURE);
+			}
+		};
+
+		struct profile {
+			static constexpr auto NAME = "profile";
+			std::string mode{};
+			std::filesystem::path path{};
+			std::filesystem::path sysfs_root = "/sys";
+			std::filesystem::path proc_root = "/proc";
+			std::filesystem::path journal = "/run/hwctrl/profile.journal";
+			size_t threads = std::thread::hardware_concurrency();
+			std::string format = "text";
+
+			void setup_cli(lyra::cli_parser& parser) noexcept {
+				parser |= lyra::arg(mode, "apply, diff or rollback").required();
+				parser |= lyra::arg(path, "profile").optional();
+				parser |= lyra::opt(sysfs_root, "path")["--sysfs-root"]("root of the sysfs tree").optional();
+				parser |= lyra::opt(proc_root, "path")["--proc-root"]("root of the procfs tree").optional();
+				parser |= lyra::opt(journal, "path")["--journal"]("file holding the values to roll back to").optional();
+				parser |= lyra::opt(threads, "threads")["--threads"]("attributes written in parallel").optional();
+				parser |= lyra::opt(format, "format")["--format"]("output format: text, json or cbor").optional();
+			}
+
+			// apply and rollback write sysfs
+			[[nodiscard]] bool needs_live_system() const noexcept {
+				return mode != "diff";
+			}
+
+			void execute() noexcept {
+				util::writer out(STDOUT_FILENO, get_output_format(format));
+				if (mode == "rollback") {
+					rollback_journal(out, journal, threads);
+					return;
+				}
+				if (mode != "apply" && mode != "diff") {
+					std::cerr << "error - unknown profile mode \"" << mode << "\", expected apply, diff or rollback" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				if (path.empty()) {
+					std::cerr << "error - " << mode << " needs a profile file" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				auto entries = control::read_profile(path);
+				if (const auto* err_ptr = std::get_if<hwctrl_error>(&entries)) {
+					std::cerr << err_ptr->message << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				auto topology = get_topology(sysfs_root);
+				auto settings_result = control::resolve_profile(std::get<std::vector<control::profile_entry>>(entries), topology, {sysfs_root, proc_root});
+				if (const auto* err_ptr = std::get_if<hwctrl_error>(&settings_result)) {
+					std::cerr << err_ptr->message << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				const auto& settings = std::get<std::vector<control::profile_setting>>(settings_result);
+				auto changes = control::diff_profile(settings);
+				control::write_profile_diff(out, changes, settings.size());
+				if (mode == "diff" || changes.empty()) {
+					return;
+				}
+				auto previous_result = control::profile_journal(changes);
+				if (const auto* err_ptr = std::get_if<hwctrl_error>(&previous_result)) {
+					std::cerr << err_ptr->message << std::endl;
+					std::cerr << "error - the profile was not applied, an attribute whose current value is unknown could not be rolled back" << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				const auto& previous = std::get<std::vector<control::attribute_value>>(previous_result);
+				extend_journal(journal, previous);
+				util::thread_pool pool(threads);
+				auto result = control::apply_profile(changes, pool);
+				control::write_profile_apply_result(out, result);
+				for (const auto& refused : result.refused) {
+					std::cerr << "warning - " << refused.message << std::endl;
+				}
+				if (result.mismatches.empty()) {
+					return;
+				}
+				for (const auto& mismatch : result.mismatches) {
+					std::cerr << mismatch.message << std::endl;
+				}
+				// all or nothing, undo the attributes this apply changed
+				auto restored = control::restore_journal(previous, pool);
+				control::write_restore_result(out, restored);
+				for (const auto& error : restored.errors) {
+					std::cerr << error.message << std::endl;
+				}
+				std::cerr << "error - the profile did not apply" << (restored.errors.empty() ? ", every changed attribute was restored" : " and not every attribute could be restored, \"hwctrl profile rollback\" retries") << std::endl;
+				exit(EXIT_FAILURE);
+			}
+		};
+
+		struct snapshot {
+			static constexpr auto NAME = "snapshot";
+			std::filesystem::path path{};
+			std::string format = "text";
+
+			void setup_cli(lyra::cli_parser& parser) noexcept {
+				parser |= lyra::arg(path, "archive").required();
+				parser |= lyra::opt(format, "format")["--format"]("output format: text, json or cbor").optional();
+			}
+
+			void execute() noexcept {
+				util::writer out(STDOUT_FILENO, get_output_format(format));
+				auto archive_result = util::snapshot::open_archive(path);
+				if (const auto* err_ptr = std::get_if<hwctrl_error>(&archive_result)) {
+					std::cerr << err_ptr->message << std::endl;
+					exit(EXIT_FAILURE);
+				}
+				util::snapshot::write_archive_entries(out, std::get<util::snapshot::archive>(archive_result));
 			}
 		};
 
 		struct debug {
 			static constexpr auto NAME = "debug";
 			bool serial = false;
+			std::string format = "text";
 
 			void setup_cli([[maybe_unused]] lyra::cli_parser& parser) noexcept {
 				parser |= lyra::opt(serial)["--serial"].optional();
+				parser |= lyra::opt(format, "format")["--format"]("output format: text, json or cbor").optional();
 			}
 
 			void execute() {
+				util::writer out(STDOUT_FILENO, get_output_format(format));
 				{
 					// cpuinfo
-					auto read_result = source::read_cpuinfo();
+					std::vector<char> buffer{};
+					auto read_result = source::read_cpuinfo(buffer);
 					if (const auto* err_ptr = std::get_if<hwctrl_error>(&read_result)) {
 						std::cerr << err_ptr->message << std::endl;
 						exit(EXIT_FAILURE);
 					}
-					auto result = source::parse_cpuinfo(std::get<std::string>(read_result));
+					auto result = source::parse_cpuinfo(std::get<std::string_view>(read_result));
 					if (const auto* err_ptr = std::get_if<hwctrl_error>(&result)) {
 						std::cerr << err_ptr->message << std::endl;
 						exit(EXIT_FAILURE);
 					}
-					std::cout << "===cpuinfo===" << std::endl;
-					std::cout << source::cpuinfo_string(std::get<source::cpuinfo>(result)) << std::endl;
+					source::write_cpuinfo(out, std::get<source::cpuinfo>(result));
+
+					// topology - fall back to cpuinfo when sysfs is not available
+					auto topology_result = source::read_topology();
+					auto topology = std::holds_alternative<source::cpu_topology>(topology_result)
+						? std::move(std::get<source::cpu_topology>(topology_result))
+						: source::make_topology(std::get<source::cpuinfo>(result));
+					source::write_cpu_topology(out, topology);
+
+					// caches are only known from sysfs
+					auto cache_result = source::read_cache_topology();
+					if (const auto* cache_ptr = std::get_if<source::cache_topology>(&cache_result)) {
+						source::write_cache_topology(out, *cache_ptr);
+					}
+
+					// cpuid of the cpu this runs on, compare against cpuinfo and sysfs
+					// a replay describes another machine, this cpu would not match it
+					if (util::snapshot::active_archive() == nullptr) {
+						auto cpuid_result = source::read_cpuid();
+						if (const auto* cpuid_ptr = std::get_if<source::cpuid_info>(&cpuid_result)) {
+							source::write_cpuid(out, *cpuid_ptr);
+						}
+					}
 				}
 				{
 					// spd
@@ -141,6 +1369,17 @@ int main(int argc, char* argv[]) {
 	bool version = false;
 	bool help = false;
 	std::string command_string;
+	std::filesystem::path record_path{};
+	std::filesystem::path replay_path{};
+
+	// lyra only sees the arguments before "--", the rest is the command of "hwctrl run"
+	for (int i = 1; i < argc; i++) {
+		if (std::string_view(argv[i]) == "--") {
+			trailing_args.assign(argv + i + 1, argv + argc);
+			argc = i;
+			break;
+		}
+	}
 
 	auto cli = lyra::cli_parser();
 	cli |= lyra::opt([&](bool flag) {
@@ -148,6 +1387,8 @@ int main(int argc, char* argv[]) {
 		return lyra::parser_result::ok(lyra::parser_result_type::short_circuit_all);
 	})["-v"]["--version"]("Show version info").optional();
 	cli |= lyra::help(help);
+	cli |= lyra::opt(record_path, "archive")["--record"]("save every /proc, /sys and eeprom file the command reads into a snapshot archive").optional();
+	cli |= lyra::opt(replay_path, "archive")["--replay"]("serve every file read from a snapshot archive instead of the running system").optional();
 	cli |= lyra::arg(command_string, "command");
 
 	auto result = cli.parse({argc, argv});
@@ -166,7 +1407,7 @@ int main(int argc, char* argv[]) {
 		return EXIT_FAILURE;
 	}
 
-	auto cmd_opt = match_command<cmd::spd, cmd::debug>(command_string);
+	auto cmd_opt = match_command<cmd::spd, cmd::monitor, cmd::numa, cmd::memory, cmd::membench, cmd::bench, cmd::cpufreq, cmd::cpuidle, cmd::irq, cmd::hugepages, cmd::run, cmd::profile, cmd::snapshot, cmd::debug>(command_string);
 
 	if (cmd_opt != std::nullopt) {
 		std::visit([&cli](auto&& arg) noexcept {
@@ -185,9 +1426,45 @@ int main(int argc, char* argv[]) {
 		return EXIT_FAILURE;
 	}
 
+	if (!replay_path.empty()) {
+		if (!record_path.empty()) {
+			std::cerr << "error - --record and --replay cannot be combined" << std::endl;
+			return EXIT_FAILURE;
+		}
+		// a replay only serves reads, commands that change or measure this machine would act on another one's files
+		bool live = std::visit([](const auto& arg) noexcept {
+			if constexpr (requires { arg.needs_live_system(); }) {
+				return arg.needs_live_system();
+			} else {
+				return false;
+			}
+		}, cmd_opt.value());
+		if (live) {
+			std::cerr << "error - \"" << command_string << "\" needs the running system and cannot be used with --replay" << std::endl;
+			return EXIT_FAILURE;
+		}
+		auto archive_result = hwctrl::util::snapshot::open_archive(replay_path);
+		if (auto* err_ptr = std::get_if<hwctrl::hwctrl_error>(&archive_result)) {
+			std::cerr << err_ptr->message << std::endl;
+			return EXIT_FAILURE;
+		}
+		hwctrl::util::snapshot::start_replay(std::move(std::get<hwctrl::util::snapshot::archive>(archive_result)));
+	}
+	if (!record_path.empty()) {
+		hwctrl::util::snapshot::start_recording();
+	}
+
 	std::visit([](auto&& arg) noexcept {
 		arg.execute();
 	}, cmd_opt.value());
 
+	// commands exit early on errors, only complete runs are saved
+	if (!record_path.empty()) {
+		if (auto err = hwctrl::util::snapshot::save_recording(record_path)) {
+			std::cerr << err->message << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,83 @@
+#pragma once
+#include "../basic_types.hpp"
+#include "../util/thread_pool.hpp"
+#include "../util/writer.hpp"
+#include "journal.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace hwctrl::control {
+	// one cpufreq policy, every cpu of a policy shares its settings
+	struct cpufreq_policy {
+		// defined out of line, inlining the member wise copies and destruction everywhere a policy is moved bloats the callers
+		cpufreq_policy() noexcept;
+		cpufreq_policy(const cpufreq_policy& other);
+		cpufreq_policy(cpufreq_policy&& other) noexcept;
+		cpufreq_policy& operator=(const cpufreq_policy& other);
+		cpufreq_policy& operator=(cpufreq_policy&& other) noexcept;
+		~cpufreq_policy() noexcept;
+
+		// the policy directory, cpuN/cpufreq resolves to policyM on real sysfs
+		std::filesystem::path path{};
+		std::vector<uint32_t> cpus{};
+		std::string driver{};
+		std::string governor{};
+		std::vector<std::string> available_governors{};
+		uint64_t min_khz = 0;
+		uint64_t max_khz = 0;
+		uint64_t hardware_min_khz = 0;
+		uint64_t hardware_max_khz = 0;
+		// empty when the driver has no energy_performance_preference (acpi-cpufreq)
+		std::string epp{};
+		std::vector<std::string> available_epps{};
+	};
+
+	// a frequency in khz or one of the hardware limits of the policy
+	struct frequency_setting {
+		enum setting_kind {
+			KHZ,
+			HARDWARE_MIN,
+			HARDWARE_MAX
+		};
+		setting_kind kind = KHZ;
+		uint64_t khz = 0;
+	};
+
+	// fields left empty are not touched
+	struct cpufreq_settings {
+		std::optional<std::string> governor{};
+		std::optional<frequency_setting> min{};
+		std::optional<frequency_setting> max{};
+		std::optional<std::string> epp{};
+	};
+
+	struct cpufreq_apply_result {
+		cpufreq_policy before{};
+		// read back after writing
+		cpufreq_policy after{};
+		// attributes that were written
+		std::vector<std::string> changed{};
+		std::optional<hwctrl_error> error{};
+	};
+
+	// reads the policies covering cpus, each policy once even when several of its cpus are given
+	[[nodiscard]] std::variant<std::vector<cpufreq_policy>, hwctrl_error> read_cpufreq_policies(const std::filesystem::path& sysfs_root, std::span<const uint32_t> cpus) noexcept;
+	// parses "min", "max", plain khz or a number with a khz, mhz or ghz suffix, e.g. 2.4ghz
+	[[nodiscard]] std::variant<frequency_setting, hwctrl_error> parse_frequency(std::string_view str) noexcept;
+	// the khz a setting stands for on policy
+	[[nodiscard]] uint64_t resolve_frequency(const cpufreq_policy& policy, const frequency_setting& setting) noexcept;
+	// checks settings against what every policy supports before anything is written
+	[[nodiscard]] std::optional<hwctrl_error> validate_cpufreq_settings(std::span<const cpufreq_policy> policies, const cpufreq_settings& settings) noexcept;
+	// the attributes apply_cpufreq may write, in the order a rollback has to restore them
+	[[nodiscard]] std::vector<attribute_value> cpufreq_journal(std::span<const cpufreq_policy> policies) noexcept;
+	// writes governor, min/max and epp of every policy in parallel, skips values that are already set and reads everything back
+	[[nodiscard]] std::vector<cpufreq_apply_result> apply_cpufreq(std::span<const cpufreq_policy> policies, const cpufreq_settings& settings, util::thread_pool& pool) noexcept;
+	void write_cpufreq_policies(util::writer& out, std::span<const cpufreq_policy> policies) noexcept;
+	void write_cpufreq_apply_results(util::writer& out, std::span<const cpufreq_apply_result> results) noexcept;
+} // namespace hwctrl::control
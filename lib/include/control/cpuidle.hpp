@@ -0,0 +1,65 @@
+#pragma once
+#include "../basic_types.hpp"
+#include "../util/file.hpp"
+#include "../util/thread_pool.hpp"
+#include "../util/writer.hpp"
+#include "journal.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace hwctrl::control {
+	struct cpuidle_state {
+		uint32_t index = 0;
+		std::string name{};
+		std::string description{};
+		// worst case exit latency and the minimum residency that pays for entering the state
+		uint64_t latency_us = 0;
+		uint64_t residency_us = 0;
+		// entries and total time spent in the state since boot
+		uint64_t usage = 0;
+		uint64_t time_us = 0;
+		// entries where the state turned out too deep or too shallow for the idle period
+		uint64_t above = 0;
+		uint64_t below = 0;
+		bool disabled = false;
+	};
+
+	struct cpu_idle_states {
+		uint32_t cpu = 0;
+		std::vector<cpuidle_state> states{};
+	};
+
+	struct cpuidle_limit_result {
+		uint32_t cpu = 0;
+		// state indices disabled by this call
+		std::vector<uint32_t> disabled{};
+		std::optional<hwctrl_error> error{};
+	};
+
+	// keeps /dev/cpu_dma_latency open, the pm qos request is dropped when the file is closed
+	class pm_qos_hold {
+		public:
+			explicit pm_qos_hold(util::file::unique_fd file) noexcept;
+
+			// the effective system wide limit in microseconds, the lowest of all open requests
+			[[nodiscard]] std::variant<int32_t, hwctrl_error> effective_latency_us() const noexcept;
+		private:
+			util::file::unique_fd fd;
+	};
+
+	// reads cpuN/cpuidle/state* of every cpu, cpus without cpuidle (no driver or idle=poll) have no states
+	[[nodiscard]] std::variant<std::vector<cpu_idle_states>, hwctrl_error> read_cpuidle_states(const std::filesystem::path& sysfs_root, std::span<const uint32_t> cpus) noexcept;
+	// the disable attribute of every enabled state with an exit latency above max_latency_us
+	[[nodiscard]] std::vector<attribute_value> cpuidle_journal(const std::filesystem::path& sysfs_root, std::span<const cpu_idle_states> cpus, uint64_t max_latency_us) noexcept;
+	// disables those states, one task per cpu, and reads the disable attributes back
+	[[nodiscard]] std::vector<cpuidle_limit_result> limit_cpuidle(const std::filesystem::path& sysfs_root, std::span<const cpu_idle_states> cpus, uint64_t max_latency_us, util::thread_pool& pool) noexcept;
+	// requests a system wide exit latency limit through pm qos for as long as the returned hold lives
+	[[nodiscard]] std::variant<pm_qos_hold, hwctrl_error> hold_pm_qos_latency(const std::filesystem::path& path, int32_t latency_us) noexcept;
+	void write_cpuidle_states(util::writer& out, std::span<const cpu_idle_states> cpus) noexcept;
+	void write_cpuidle_limit_results(util::writer& out, std::span<const cpuidle_limit_result> results) noexcept;
+} // namespace hwctrl::control
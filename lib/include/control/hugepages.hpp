@@ -0,0 +1,68 @@
+#pragma once
+#include "../basic_types.hpp"
+#include "../util/thread_pool.hpp"
+#include "../util/writer.hpp"
+#include "journal.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace hwctrl::control {
+	// one hugetlb pool, sysfs_root/devices/system/node/nodeN/hugepages/hugepages-<size>kB
+	struct hugepage_pool {
+		uint32_t node = 0;
+		uint64_t page_kib = 0;
+		// counts of pages, not bytes
+		uint64_t total = 0;
+		uint64_t free = 0;
+		// pages above total handed out through overcommit
+		uint64_t surplus = 0;
+	};
+
+	struct thp_status {
+		// false when the kernel has no transparent hugepage support
+		bool available = false;
+		// the selected value of each mode file, e.g. "madvise"
+		std::string enabled{};
+		std::string defrag{};
+		std::string shmem_enabled{};
+		uint64_t pmd_size_bytes = 0;
+	};
+
+	struct hugepage_state {
+		// sorted by node then page size
+		std::vector<hugepage_pool> pools{};
+		thp_status thp{};
+
+		[[nodiscard]] const hugepage_pool* find(uint32_t node, uint64_t page_kib) const noexcept;
+	};
+
+	struct hugepage_set_result {
+		uint32_t node = 0;
+		uint64_t page_kib = 0;
+		uint64_t previous = 0;
+		uint64_t requested = 0;
+		// what the kernel actually reserved, less than requested when the node is too fragmented
+		uint64_t allocated = 0;
+		// the node was compacted and the reservation retried
+		bool compacted = false;
+		std::optional<hwctrl_error> error{};
+	};
+
+	// sizes like "2m", "1GB", "512MiB" or "2048k" in bytes, plain numbers are bytes
+	[[nodiscard]] std::variant<uint64_t, hwctrl_error> parse_byte_size(std::string_view str) noexcept;
+	// the selected word of a mode file like "always [madvise] never"
+	[[nodiscard]] std::string_view selected_mode(std::string_view str) noexcept;
+	[[nodiscard]] std::variant<hugepage_state, hwctrl_error> read_hugepages(const std::filesystem::path& sysfs_root) noexcept;
+	// nr_hugepages of the pools of page_kib on nodes
+	[[nodiscard]] std::vector<attribute_value> hugepage_journal(const std::filesystem::path& sysfs_root, const hugepage_state& state, std::span<const uint32_t> nodes, uint64_t page_kib) noexcept;
+	// resizes the page_kib pool of every node to pages, one node per thread, compacting a node and retrying once on a shortfall when compact is set
+	[[nodiscard]] std::vector<hugepage_set_result> set_hugepages(const std::filesystem::path& sysfs_root, const hugepage_state& state, std::span<const uint32_t> nodes, uint64_t page_kib, uint64_t pages, bool compact, util::thread_pool& pool) noexcept;
+	void write_hugepages(util::writer& out, const hugepage_state& state) noexcept;
+	void write_hugepage_set_results(util::writer& out, std::span<const hugepage_set_result> results) noexcept;
+} // namespace hwctrl::control
@@ -0,0 +1,69 @@
+#pragma once
+#include "../basic_types.hpp"
+#include "../source/interrupts.hpp"
+#include "../source/topology.hpp"
+#include "../util/thread_pool.hpp"
+#include "../util/writer.hpp"
+#include "journal.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace hwctrl::control {
+	// a device irq with the state of /proc/irq/N
+	struct irq_info {
+		uint32_t irq = 0;
+		std::string actions{};
+		// numa node of the device, UNKNOWN_ID when the kernel reports -1
+		uint32_t node = source::cpu_topology::UNKNOWN_ID;
+		std::vector<uint32_t> affinity{};
+		// where the irq is actually delivered, a single cpu on x86
+		std::vector<uint32_t> effective_affinity{};
+		uint64_t count = 0;
+	};
+
+	struct irq_plan_options {
+		// cpus irqs may be placed on
+		std::vector<uint32_t> cpus{};
+		// cpus kept free of irqs together with their smt siblings
+		std::vector<uint32_t> isolated{};
+	};
+
+	struct irq_assignment {
+		uint32_t irq = 0;
+		std::string actions{};
+		uint32_t node = source::cpu_topology::UNKNOWN_ID;
+		std::vector<uint32_t> current{};
+		uint32_t cpu = 0;
+		// false when the device node has no usable cpus and the irq had to go remote
+		bool node_local = true;
+	};
+
+	struct irq_apply_result {
+		uint32_t irq = 0;
+		bool changed = false;
+		// kernel managed irqs (e.g. nvme queues) reject affinity changes with EIO and keep their placement
+		bool managed = false;
+		std::vector<uint32_t> effective_affinity{};
+		std::optional<hwctrl_error> error{};
+	};
+
+	// device irqs whose handler names contain one of the comma separated patterns, every device irq for an empty filter
+	[[nodiscard]] std::vector<irq_info> read_irqs(const std::filesystem::path& proc_root, const source::interrupts& interrupts, std::string_view filter) noexcept;
+	// kernel isolcpus from sysfs_root/devices/system/cpu/isolated, empty when not set
+	[[nodiscard]] std::vector<uint32_t> read_isolated_cpus(const std::filesystem::path& sysfs_root) noexcept;
+	// gives every irq its own physical core where possible, on the device's numa node, off isolated cores
+	// ties go to the core that comes first in spread_cpus order, so plans are deterministic and alternate packages
+	[[nodiscard]] std::variant<std::vector<irq_assignment>, hwctrl_error> plan_irqs(const source::cpu_topology& topology, std::span<const irq_info> irqs, const irq_plan_options& options) noexcept;
+	// smp_affinity_list of every irq the plan moves
+	[[nodiscard]] std::vector<attribute_value> irq_journal(const std::filesystem::path& proc_root, std::span<const irq_assignment> plan) noexcept;
+	// writes smp_affinity_list of every irq that is not on its planned cpu yet and reads the lists back
+	[[nodiscard]] std::vector<irq_apply_result> apply_irq_plan(const std::filesystem::path& proc_root, std::span<const irq_assignment> plan, util::thread_pool& pool) noexcept;
+	void write_irq_plan(util::writer& out, std::span<const irq_assignment> plan) noexcept;
+	void write_irq_apply_results(util::writer& out, std::span<const irq_apply_result> results) noexcept;
+} // namespace hwctrl::control
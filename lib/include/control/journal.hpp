@@ -0,0 +1,36 @@
+#pragma once
+#include "../basic_types.hpp"
+#include "../util/thread_pool.hpp"
+#include "../util/writer.hpp"
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace hwctrl::control {
+	// value of one sysfs or procfs attribute
+	struct attribute_value {
+		std::filesystem::path path{};
+		std::string value{};
+	};
+
+	struct restore_result {
+		size_t restored = 0;
+		// already held the saved value
+		size_t unchanged = 0;
+		std::vector<hwctrl_error> errors{};
+	};
+
+	// writes one "path\tvalue" line per attribute to a temporary file and renames it over path, so a crash never leaves half a journal
+	[[nodiscard]] std::optional<hwctrl_error> save_journal(const std::filesystem::path& path, std::span<const attribute_value> attributes) noexcept;
+	// keeps the values of journal and appends attributes it does not hold yet, so repeated changes still roll back to the first saved state
+	[[nodiscard]] std::vector<attribute_value> merge_journal(std::vector<attribute_value> journal, std::span<const attribute_value> attributes) noexcept;
+	[[nodiscard]] std::variant<std::vector<attribute_value>, hwctrl_error> read_journal(const std::filesystem::path& path) noexcept;
+	// writes back every attribute whose current value differs, attributes of one directory in journal order and directories in parallel
+	// writes that fail are retried once after the rest, kernel knobs often depend on each other (min and max frequency)
+	[[nodiscard]] restore_result restore_journal(std::span<const attribute_value> attributes, util::thread_pool& pool) noexcept;
+	void write_restore_result(util::writer& out, const restore_result& result) noexcept;
+} // namespace hwctrl::control
@@ -0,0 +1,33 @@
+#pragma once
+#include "../basic_types.hpp"
+#include "../source/cache.hpp"
+#include "../source/topology.hpp"
+#include "../util/writer.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace hwctrl::control {
+	enum class placement_policy {
+		// fill every smt thread of a core, then the next core of the same package
+		COMPACT,
+		// one thread per core alternating between packages, then the smt siblings
+		SPREAD,
+		// one thread per core, package by package, never two threads of a core
+		ONE_PER_CORE,
+		// one thread per last level cache domain, e.g. one per ccx
+		ONE_PER_L3
+	};
+
+	[[nodiscard]] std::optional<placement_policy> parse_placement_policy(std::string_view str) noexcept;
+	[[nodiscard]] std::string_view placement_policy_string(placement_policy policy) noexcept;
+	// picks count cpus out of allowed, caches are only needed for ONE_PER_L3
+	[[nodiscard]] std::variant<std::vector<uint32_t>, hwctrl_error> place_cpus(const source::cpu_topology& topology, const source::cache_topology& caches, placement_policy policy, size_t count, std::span<const uint32_t> allowed) noexcept;
+	// numa nodes of cpus, sorted
+	[[nodiscard]] std::vector<uint32_t> placement_nodes(const source::cpu_topology& topology, std::span<const uint32_t> cpus) noexcept;
+	void write_placement(util::writer& out, placement_policy policy, std::span<const uint32_t> cpus, std::span<const uint32_t> nodes) noexcept;
+} // namespace hwctrl::control
@@ -0,0 +1,79 @@
+#pragma once
+#include "../basic_types.hpp"
+#include "../source/topology.hpp"
+#include "../util/thread_pool.hpp"
+#include "../util/writer.hpp"
+#include "journal.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace hwctrl::control {
+	// one line of a profile: kind, target and key=value options, e.g. "cpufreq package:0 governor=performance max=max"
+	struct profile_entry {
+		uint32_t line = 0;
+		std::string kind{};
+		// cpu set, irq match or block device, empty for thp
+		std::string target{};
+		std::vector<std::pair<std::string, std::string>> options{};
+	};
+
+	// the value a profile line wants an attribute to hold
+	struct profile_setting {
+		uint32_t line = 0;
+		attribute_value desired{};
+		// the kernel may refuse the write and keep its own value (managed irqs), not an apply failure
+		bool best_effort = false;
+	};
+
+	struct profile_change {
+		uint32_t line = 0;
+		std::filesystem::path path{};
+		std::string current{};
+		std::string desired{};
+		bool best_effort = false;
+		// set when the current value could not be read, such a change cannot be rolled back and is never applied
+		std::optional<hwctrl_error> read_error{};
+	};
+
+	struct profile_roots {
+		std::filesystem::path sysfs = "/sys";
+		std::filesystem::path proc = "/proc";
+	};
+
+	struct profile_apply_result {
+		restore_result written{};
+		// changes the kernel did not take, read back after writing
+		std::vector<hwctrl_error> mismatches{};
+		// best effort changes the kernel refused
+		std::vector<hwctrl_error> refused{};
+	};
+
+	// '#' starts a comment, one entry per line:
+	//   cpufreq <cpus> governor=<name> min=<freq> max=<freq> epp=<name>
+	//   cpuidle <cpus> max-latency=<us>
+	//   irq <match|*> cpus=<cpus> isolated=<cpus>
+	//   block <device|prefix*> <queue attribute>=<value> ...
+	//   thp enabled=<mode> defrag=<mode> shmem_enabled=<mode>
+	//   hugepages <cpus> size=<page size> per-node=<size>|pages=<count>
+	[[nodiscard]] std::variant<std::vector<profile_entry>, hwctrl_error> parse_profile(std::string_view str) noexcept;
+	[[nodiscard]] std::variant<std::vector<profile_entry>, hwctrl_error> read_profile(const std::filesystem::path& path) noexcept;
+	// turns entries into attribute values against the current hardware, validating every value before anything is written
+	// two lines setting one attribute to different values are an error
+	[[nodiscard]] std::variant<std::vector<profile_setting>, hwctrl_error> resolve_profile(std::span<const profile_entry> entries, const source::cpu_topology& topology, const profile_roots& roots) noexcept;
+	// settings whose attribute holds a different value, mode files like "always [madvise] never" compare by the selected word
+	[[nodiscard]] std::vector<profile_change> diff_profile(std::span<const profile_setting> settings) noexcept;
+	// current values of the changed attributes, what a rollback writes back
+	// an error when a current value could not be read, nothing may be applied then
+	[[nodiscard]] std::variant<std::vector<attribute_value>, hwctrl_error> profile_journal(std::span<const profile_change> changes) noexcept;
+	// writes the changes per directory in parallel and reads every one back
+	[[nodiscard]] profile_apply_result apply_profile(std::span<const profile_change> changes, util::thread_pool& pool) noexcept;
+	void write_profile_diff(util::writer& out, std::span<const profile_change> changes, size_t settings) noexcept;
+	void write_profile_apply_result(util::writer& out, const profile_apply_result& result) noexcept;
+} // namespace hwctrl::control
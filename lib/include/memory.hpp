@@ -1,7 +1,38 @@
 #pragma once
+#include "source/spd.hpp"
 #include <cstdint>
+#include <optional>
+#include <string>
 
 namespace hwctrl {
+	// one memory slot, joined from smbios, edac and spd
 	struct dimm {
+		static constexpr uint32_t UNKNOWN_ID = UINT32_MAX;
+
+		// smbios device and bank locator, the edac label when there is no smbios
+		std::string locator{};
+		std::string bank_locator{};
+		uint32_t socket = UNKNOWN_ID;
+		uint32_t memory_controller = UNKNOWN_ID;
+		uint32_t channel = UNKNOWN_ID;
+		uint32_t slot = UNKNOWN_ID;
+		bool populated = false;
+		uint64_t size_bytes = 0;
+		uint8_t ranks = 0;
+		// primary bus width without ecc
+		uint16_t data_width_bits = 0;
+		// fastest jedec speed of the module (spd clock_max, else smbios speed) and the speed it runs at
+		uint32_t rated_mt = 0;
+		uint32_t configured_mt = 0;
+		// voltage the firmware configured, 0 when unknown
+		uint32_t configured_mv = 0;
+		std::string manufacturer{};
+		std::string part_number{};
+		std::string serial_number{};
+		// edac error counters, only valid with has_edac
+		bool has_edac = false;
+		uint64_t corrected_errors = 0;
+		uint64_t uncorrected_errors = 0;
+		std::optional<source::spd> spd{};
 	};
 } // namespace hwctrl
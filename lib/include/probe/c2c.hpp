@@ -0,0 +1,64 @@
+#pragma once
+#include "../basic_types.hpp"
+#include "../source/cache.hpp"
+#include "../source/topology.hpp"
+#include "../util/writer.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace hwctrl::probe {
+	// how two logical cpus are connected, from closest to farthest
+	enum class cpu_relation {
+		SMT_SIBLING,
+		// different cores sharing the last level cache
+		SAME_L3,
+		// same die, different last level caches (e.g. ccx)
+		CROSS_L3,
+		// same package, different dies
+		CROSS_DIE,
+		CROSS_SOCKET
+	};
+
+	struct c2c_options {
+		// cache line handoffs per timed run
+		uint32_t round_trips = 5000;
+		// timed runs per pair after one warm up run, the fastest is reported
+		uint32_t repetitions = 3;
+		// 0 measures every pair, otherwise a fixed random sample of this many pairs
+		size_t max_pairs = 0;
+	};
+
+	struct c2c_matrix {
+		std::vector<uint32_t> cpus{};
+		// round trip nanoseconds, row major over cpus, 0 on the diagonal and for pairs that were not sampled
+		std::vector<double> ns{};
+
+		[[nodiscard]] double at(size_t row, size_t column) const noexcept;
+	};
+
+	struct c2c_summary {
+		cpu_relation relation = cpu_relation::SMT_SIBLING;
+		size_t pairs = 0;
+		double min_ns = 0;
+		double median_ns = 0;
+		double max_ns = 0;
+	};
+
+	[[nodiscard]] std::string_view cpu_relation_string(cpu_relation relation) noexcept;
+	// caches may be empty, then cores of one die count as sharing the l3
+	[[nodiscard]] cpu_relation classify_cpu_pair(const source::cpu_topology& topology, const source::cache_topology& caches, uint32_t a, uint32_t b) noexcept;
+	// indices into cpus of the pairs to measure, every pair or a sample of max_pairs with a fixed seed
+	[[nodiscard]] std::vector<std::pair<uint32_t, uint32_t>> c2c_pairs(size_t cpu_count, size_t max_pairs) noexcept;
+	// bounces one cache line between two threads pinned to a and b and returns the fastest round trip
+	[[nodiscard]] std::variant<double, hwctrl_error> measure_c2c_round_trip(uint32_t a, uint32_t b, const c2c_options& options) noexcept;
+	[[nodiscard]] std::variant<c2c_matrix, hwctrl_error> run_c2c(std::span<const uint32_t> cpus, const c2c_options& options) noexcept;
+	// one summary per relation that has measured pairs
+	[[nodiscard]] std::vector<c2c_summary> summarize_c2c(const c2c_matrix& matrix, const source::cpu_topology& topology, const source::cache_topology& caches) noexcept;
+	void write_c2c_matrix(util::writer& out, const c2c_matrix& matrix) noexcept;
+	void write_c2c_summary(util::writer& out, std::span<const c2c_summary> summaries) noexcept;
+} // namespace hwctrl::probe
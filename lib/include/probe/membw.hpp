@@ -0,0 +1,72 @@
+#pragma once
+#include "../basic_types.hpp"
+#include "../util/writer.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace hwctrl::probe {
+	// stream kernels, a/b/c are arrays of doubles
+	enum class stream_kernel {
+		// c = a
+		COPY,
+		// b = s * c
+		SCALE,
+		// c = a + b
+		ADD,
+		// a = b + s * c
+		TRIAD
+	};
+
+	enum class simd_level {
+		SCALAR,
+		AVX2,
+		AVX512
+	};
+
+	enum class store_mode {
+		REGULAR,
+		// streaming stores that bypass the caches and skip the read for ownership
+		NON_TEMPORAL,
+		BOTH
+	};
+
+	struct membw_options {
+		// size of each of the three arrays, split between the threads
+		size_t array_bytes = size_t{256} << 20u;
+		// every kernel runs this often, the fastest run is reported
+		uint32_t repetitions = 10;
+		simd_level simd = simd_level::SCALAR;
+		store_mode stores = store_mode::BOTH;
+	};
+
+	struct membw_result {
+		stream_kernel kernel = stream_kernel::COPY;
+		simd_level simd = simd_level::SCALAR;
+		bool non_temporal = false;
+		uint32_t threads = 0;
+		// bytes read and written by one run, write allocate traffic is not counted (as in stream)
+		uint64_t bytes = 0;
+		double best_seconds = 0;
+		double average_seconds = 0;
+		double worst_seconds = 0;
+		double best_bytes_per_second = 0;
+	};
+
+	// widest vector level supported by the cpu and this build
+	[[nodiscard]] simd_level detect_simd() noexcept;
+	[[nodiscard]] bool simd_supported(simd_level simd) noexcept;
+	[[nodiscard]] std::string_view simd_level_string(simd_level simd) noexcept;
+	[[nodiscard]] std::variant<simd_level, hwctrl_error> parse_simd_level(std::string_view str) noexcept;
+	[[nodiscard]] std::string_view stream_kernel_string(stream_kernel kernel) noexcept;
+	// bytes moved per element by kernel, 16 for copy/scale and 24 for add/triad
+	[[nodiscard]] uint64_t stream_kernel_bytes(stream_kernel kernel) noexcept;
+
+	// runs every kernel with one thread pinned to each of cpus, each thread first touches its own slice
+	[[nodiscard]] std::variant<std::vector<membw_result>, hwctrl_error> run_membw(std::span<const uint32_t> cpus, const membw_options& options) noexcept;
+	// peak_bytes_per_second is the theoretical peak of the memory, 0 when unknown
+	void write_membw_result(util::writer& out, const membw_result& result, double peak_bytes_per_second) noexcept;
+} // namespace hwctrl::probe
@@ -0,0 +1,77 @@
+#pragma once
+#include "../basic_types.hpp"
+#include "../source/spd.hpp"
+#include "../util/writer.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace hwctrl::probe {
+	enum class page_mode {
+		SMALL,
+		// madvise(MADV_HUGEPAGE), backed by transparent huge pages where the kernel can find them
+		TRANSPARENT_HUGE,
+		// MAP_HUGETLB, needs 2 MiB pages reserved in the hugepages-2048kB pool (hwctrl hugepages set --size 2m)
+		HUGETLB
+	};
+
+	struct memlat_options {
+		size_t min_bytes = 4096;
+		size_t max_bytes = size_t{1} << 30u;
+		// working set sizes per doubling
+		uint32_t steps_per_octave = 4;
+		// loads per working set, raised to the number of lines so every line is visited
+		uint64_t accesses = uint64_t{1} << 22u;
+		// stride between chain elements, one cache line so the chain gets no help from spatial locality
+		size_t line_size = 64;
+		page_mode pages = page_mode::SMALL;
+	};
+
+	struct memlat_point {
+		size_t bytes = 0;
+		double ns_per_access = 0;
+	};
+
+	// a rise of the latency curve, usually the working set leaving a cache level
+	struct latency_boundary {
+		// last working set before the rise and the one where it levels off
+		size_t bytes = 0;
+		size_t end_bytes = 0;
+		double ns_before = 0;
+		double ns_after = 0;
+		// cache level whose size falls into the rise, 0 when none does (dram, tlb reach)
+		uint32_t cache_level = 0;
+		uint64_t cache_bytes = 0;
+	};
+
+	// dram access latency implied by the spd timings of one profile
+	struct dram_latency {
+		// "jedec", "xmp1" or "xmp2"
+		std::string_view profile{};
+		uint32_t mt = 0;
+		double tCL_ns = 0;
+		double tRCD_ns = 0;
+		double tRP_ns = 0;
+		// open row: tCL, closed row: tRCD + tCL, other row open: tRP + tRCD + tCL
+		double row_hit_ns = 0;
+		double row_miss_ns = 0;
+		double row_conflict_ns = 0;
+	};
+
+	[[nodiscard]] std::string_view page_mode_string(page_mode pages) noexcept;
+	[[nodiscard]] std::variant<page_mode, hwctrl_error> parse_page_mode(std::string_view str) noexcept;
+	// geometric working set sizes from min_bytes to max_bytes, multiples of line_size
+	[[nodiscard]] std::vector<size_t> memlat_sizes(const memlat_options& options) noexcept;
+	// chases a random cyclic chain through every working set on the calling thread
+	[[nodiscard]] std::variant<std::vector<memlat_point>, hwctrl_error> run_memlat(const memlat_options& options) noexcept;
+	// finds rises of more than 15% between consecutive points
+	// cache_bytes[n] is the size of the level n + 1 data cache seen by the measuring cpu
+	[[nodiscard]] std::vector<latency_boundary> detect_latency_boundaries(std::span<const memlat_point> points, std::span<const uint64_t> cache_bytes) noexcept;
+	// jedec timings and every enabled xmp profile, empty for ddr3
+	[[nodiscard]] std::vector<dram_latency> dram_latency_from_spd(const source::spd& spd_parsed) noexcept;
+	void write_memlat_point(util::writer& out, const memlat_point& point) noexcept;
+	void write_latency_summary(util::writer& out, std::span<const latency_boundary> boundaries, std::span<const dram_latency> dram) noexcept;
+} // namespace hwctrl::probe
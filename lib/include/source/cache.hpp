@@ -0,0 +1,63 @@
+#pragma once
+#include "../basic_types.hpp"
+#include "../util/writer.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace hwctrl::source {
+	struct cpu_cache {
+		static constexpr uint32_t UNKNOWN_ID = UINT32_MAX;
+
+		enum cache_type {
+			UNKNOWN_TYPE,
+			DATA,
+			INSTRUCTION,
+			UNIFIED
+		};
+
+		uint32_t level = 0;
+		cache_type type = UNKNOWN_TYPE;
+		// missing before linux 5.9
+		uint32_t id = UNKNOWN_ID;
+		uint64_t size_bytes = 0;
+		uint32_t line_size = 0;
+		// 0 for fully associative caches
+		uint32_t ways = 0;
+		uint32_t sets = 0;
+		// range of cache_topology::cpus sharing this cache
+		uint32_t cpu_offset = 0;
+		uint32_t cpu_count = 0;
+	};
+
+	// every distinct cache once, no matter how many cpus share it
+	struct cache_topology {
+		// sorted by level, type and first sharing cpu
+		std::vector<cpu_cache> caches{};
+		std::vector<uint32_t> cpus{};
+		// caches of logical cpu n are cache_indices[cpu_offsets[n], cpu_offsets[n + 1])
+		std::vector<uint32_t> cpu_offsets{};
+		std::vector<uint32_t> cache_indices{};
+
+		[[nodiscard]] std::span<const uint32_t> shared_cpus(size_t cache_index) const noexcept;
+		// indices into caches of every cache used by cpu
+		[[nodiscard]] std::span<const uint32_t> cpu_caches(uint32_t cpu) const noexcept;
+		// the data or unified cache at level used by cpu, nullptr if there is none
+		[[nodiscard]] const cpu_cache* find(uint32_t cpu, uint32_t level) const noexcept;
+		// indices of the data or unified caches at level, e.g. domains(3) lists the l3 domains
+		[[nodiscard]] std::vector<uint32_t> domains(uint32_t level) const noexcept;
+		[[nodiscard]] uint32_t max_level() const noexcept;
+		// largest coherency line size, 64 when no cache is known
+		[[nodiscard]] uint32_t line_size() const noexcept;
+	};
+
+	// reads sysfs_root/devices/system/cpu/cpu*/cache/index*, only the first cpu of a shared cache reads its details
+	[[nodiscard]] std::variant<cache_topology, hwctrl_error> read_cache_topology(const std::filesystem::path& sysfs_root = "/sys") noexcept;
+	// parses sysfs sizes like "48K" or "32M"
+	[[nodiscard]] std::variant<uint64_t, hwctrl_error> parse_cache_size(std::string_view str) noexcept;
+	[[nodiscard]] std::string_view cache_type_string(cpu_cache::cache_type type) noexcept;
+	void write_cache_topology(util::writer& out, const cache_topology& topology) noexcept;
+} // namespace hwctrl::source
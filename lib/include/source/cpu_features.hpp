@@ -0,0 +1,200 @@
+#pragma once
+#include "../basic_types.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string_view>
+
+namespace hwctrl::source {
+	// isa features used to pick kernels, named as in the /proc/cpuinfo flags line
+	enum class cpu_feature : uint8_t {
+		SSE2,
+		SSE3,
+		SSSE3,
+		SSE4_1,
+		SSE4_2,
+		POPCNT,
+		CX16,
+		MOVBE,
+		AES,
+		PCLMULQDQ,
+		AVX,
+		F16C,
+		FMA,
+		RDRAND,
+		X2APIC,
+		HYPERVISOR,
+		LZCNT,
+		BMI1,
+		BMI2,
+		AVX2,
+		ERMS,
+		FSRM,
+		HLE,
+		RTM,
+		ADX,
+		RDSEED,
+		SHA,
+		CLFLUSHOPT,
+		CLWB,
+		GFNI,
+		VAES,
+		VPCLMULQDQ,
+		AVX_VNNI,
+		AVX512F,
+		AVX512DQ,
+		AVX512CD,
+		AVX512BW,
+		AVX512VL,
+		AVX512IFMA,
+		AVX512VBMI,
+		AVX512_VBMI2,
+		AVX512_VNNI,
+		AVX512_BITALG,
+		AVX512_VPOPCNTDQ,
+		AVX512_BF16,
+		AVX512_FP16,
+		AMX_TILE,
+		AMX_INT8,
+		AMX_BF16,
+		CONSTANT_TSC,
+		APERFMPERF,
+		COUNT
+	};
+
+	inline constexpr size_t CPU_FEATURE_COUNT = static_cast<size_t>(cpu_feature::COUNT);
+
+	struct cpu_feature_entry {
+		cpu_feature feature = cpu_feature::COUNT;
+		std::string_view name{};
+	};
+
+	// in cpu_feature order, sized by its initializer so a missing or misplaced entry fails the checks in cpu_features.cpp
+	inline constexpr auto CPU_FEATURE_TABLE = std::to_array<cpu_feature_entry>({
+		{cpu_feature::SSE2, "sse2"},
+		{cpu_feature::SSE3, "pni"},
+		{cpu_feature::SSSE3, "ssse3"},
+		{cpu_feature::SSE4_1, "sse4_1"},
+		{cpu_feature::SSE4_2, "sse4_2"},
+		{cpu_feature::POPCNT, "popcnt"},
+		{cpu_feature::CX16, "cx16"},
+		{cpu_feature::MOVBE, "movbe"},
+		{cpu_feature::AES, "aes"},
+		{cpu_feature::PCLMULQDQ, "pclmulqdq"},
+		{cpu_feature::AVX, "avx"},
+		{cpu_feature::F16C, "f16c"},
+		{cpu_feature::FMA, "fma"},
+		{cpu_feature::RDRAND, "rdrand"},
+		{cpu_feature::X2APIC, "x2apic"},
+		{cpu_feature::HYPERVISOR, "hypervisor"},
+		{cpu_feature::LZCNT, "abm"},
+		{cpu_feature::BMI1, "bmi1"},
+		{cpu_feature::BMI2, "bmi2"},
+		{cpu_feature::AVX2, "avx2"},
+		{cpu_feature::ERMS, "erms"},
+		{cpu_feature::FSRM, "fsrm"},
+		{cpu_feature::HLE, "hle"},
+		{cpu_feature::RTM, "rtm"},
+		{cpu_feature::ADX, "adx"},
+		{cpu_feature::RDSEED, "rdseed"},
+		{cpu_feature::SHA, "sha_ni"},
+		{cpu_feature::CLFLUSHOPT, "clflushopt"},
+		{cpu_feature::CLWB, "clwb"},
+		{cpu_feature::GFNI, "gfni"},
+		{cpu_feature::VAES, "vaes"},
+		{cpu_feature::VPCLMULQDQ, "vpclmulqdq"},
+		{cpu_feature::AVX_VNNI, "avx_vnni"},
+		{cpu_feature::AVX512F, "avx512f"},
+		{cpu_feature::AVX512DQ, "avx512dq"},
+		{cpu_feature::AVX512CD, "avx512cd"},
+		{cpu_feature::AVX512BW, "avx512bw"},
+		{cpu_feature::AVX512VL, "avx512vl"},
+		{cpu_feature::AVX512IFMA, "avx512ifma"},
+		{cpu_feature::AVX512VBMI, "avx512vbmi"},
+		{cpu_feature::AVX512_VBMI2, "avx512_vbmi2"},
+		{cpu_feature::AVX512_VNNI, "avx512_vnni"},
+		{cpu_feature::AVX512_BITALG, "avx512_bitalg"},
+		{cpu_feature::AVX512_VPOPCNTDQ, "avx512_vpopcntdq"},
+		{cpu_feature::AVX512_BF16, "avx512_bf16"},
+		{cpu_feature::AVX512_FP16, "avx512_fp16"},
+		{cpu_feature::AMX_TILE, "amx_tile"},
+		{cpu_feature::AMX_INT8, "amx_int8"},
+		{cpu_feature::AMX_BF16, "amx_bf16"},
+		{cpu_feature::CONSTANT_TSC, "constant_tsc"},
+		{cpu_feature::APERFMPERF, "aperfmperf"}
+	});
+
+	// indexed by cpu_feature
+	inline constexpr auto CPU_FEATURE_NAMES = []() noexcept {
+		std::array<std::string_view, CPU_FEATURE_COUNT> names{};
+		for (size_t i = 0; i < CPU_FEATURE_COUNT && i < CPU_FEATURE_TABLE.size(); i++) {
+			names[i] = CPU_FEATURE_TABLE[i].name;
+		}
+		return names;
+	}();
+
+	// fixed size feature bitset, every operation is constexpr and O(1)
+	class cpu_feature_set {
+		public:
+			constexpr cpu_feature_set() noexcept = default;
+			constexpr cpu_feature_set(std::initializer_list<cpu_feature> features) noexcept {
+				for (auto feature : features) {
+					set(feature);
+				}
+			}
+
+			constexpr void set(cpu_feature feature, bool value = true) noexcept {
+				auto index = static_cast<size_t>(feature);
+				auto bit = uint64_t{1} << (index % 64);
+				words[index / 64] = value ? (words[index / 64] | bit) : (words[index / 64] & ~bit);
+			}
+
+			[[nodiscard]] constexpr bool has(cpu_feature feature) const noexcept {
+				auto index = static_cast<size_t>(feature);
+				return ((words[index / 64] >> (index % 64)) & 1u) != 0;
+			}
+
+			// true when every feature of other is present
+			[[nodiscard]] constexpr bool has_all(const cpu_feature_set& other) const noexcept {
+				for (size_t i = 0; i < WORD_COUNT; i++) {
+					if ((words[i] & other.words[i]) != other.words[i]) {
+						return false;
+					}
+				}
+				return true;
+			}
+
+			// features present in both, e.g. what every package of a mixed machine supports
+			[[nodiscard]] constexpr cpu_feature_set intersect(const cpu_feature_set& other) const noexcept {
+				cpu_feature_set result{};
+				for (size_t i = 0; i < WORD_COUNT; i++) {
+					result.words[i] = words[i] & other.words[i];
+				}
+				return result;
+			}
+
+			[[nodiscard]] constexpr bool empty() const noexcept {
+				for (auto word : words) {
+					if (word != 0) {
+						return false;
+					}
+				}
+				return true;
+			}
+
+			[[nodiscard]] constexpr bool operator==(const cpu_feature_set& other) const noexcept = default;
+		private:
+			static constexpr size_t WORD_COUNT = (CPU_FEATURE_COUNT + 63) / 64;
+			std::array<uint64_t, WORD_COUNT> words{};
+	};
+
+	[[nodiscard]] constexpr std::string_view cpu_feature_name(cpu_feature feature) noexcept {
+		return static_cast<size_t>(feature) < CPU_FEATURE_COUNT ? CPU_FEATURE_NAMES[static_cast<size_t>(feature)] : std::string_view{};
+	}
+
+	// looks up a cpuinfo flag name, cpu_feature::COUNT when it is not tracked
+	[[nodiscard]] cpu_feature find_cpu_feature(std::string_view name) noexcept;
+	// parses the space separated flags line of /proc/cpuinfo, unknown flags are ignored
+	[[nodiscard]] cpu_feature_set parse_cpu_flags(std::string_view flags) noexcept;
+} // namespace hwctrl::source
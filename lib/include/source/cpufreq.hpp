@@ -0,0 +1,47 @@
+#pragma once
+#include "../basic_types.hpp"
+#include "../util/file.hpp"
+#include "../util/writer.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <variant>
+#include <vector>
+
+namespace hwctrl::source {
+	// keeps scaling_cur_freq of every cpu open so one sample is a single pread per cpu
+	class cpufreq_sampler {
+		public:
+			cpufreq_sampler(std::vector<uint32_t> cpu_ids, std::vector<util::file::unique_fd> cpu_files) noexcept;
+
+			[[nodiscard]] const std::vector<uint32_t>& cpus() const noexcept;
+			// khz[i] is the current frequency of cpus()[i], 0 if it could not be read (e.g. cpu went offline)
+			void sample(std::span<uint64_t> khz) const noexcept;
+		private:
+			std::vector<uint32_t> ids;
+			std::vector<util::file::unique_fd> files;
+	};
+
+	struct cpufreq_monitor_options {
+		std::chrono::microseconds interval{std::chrono::milliseconds{100}};
+		// zero runs until stop is set
+		std::chrono::microseconds duration{0};
+		// ring buffer size in samples of all cpus, the writer thread may fall this far behind
+		size_t buffer_ticks = 1024;
+	};
+
+	struct cpufreq_monitor_stats {
+		size_t ticks = 0;
+		// the ring buffer was full, the writer thread could not keep up
+		size_t dropped_ticks = 0;
+		// the sampling thread woke up too late for a deadline
+		size_t missed_ticks = 0;
+	};
+
+	[[nodiscard]] std::variant<cpufreq_sampler, hwctrl_error> open_cpufreq_sampler(const std::filesystem::path& sysfs_root = "/sys") noexcept;
+	// samples on the calling thread at fixed deadlines and hands every sample to a writer thread through a lock free ring
+	// writes a header with the cpu ids, one object per sample and the stats at the end
+	[[nodiscard]] cpufreq_monitor_stats monitor_cpufreq(const cpufreq_sampler& sampler, const cpufreq_monitor_options& options, util::writer& out, const std::atomic<bool>& stop) noexcept;
+} // namespace hwctrl::source
@@ -0,0 +1,74 @@
+#pragma once
+#include "../basic_types.hpp"
+#include "../util/writer.hpp"
+#include "cache.hpp"
+#include "cpu_features.hpp"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace hwctrl::source {
+	struct cpuid_registers {
+		uint32_t eax = 0;
+		uint32_t ebx = 0;
+		uint32_t ecx = 0;
+		uint32_t edx = 0;
+	};
+
+	// one level of the extended topology leaf (0x1f, else 0xb)
+	struct cpuid_topology_level {
+		enum level_type {
+			INVALID,
+			SMT,
+			CORE,
+			MODULE,
+			TILE,
+			DIE
+		};
+		level_type type = INVALID;
+		// bits of the x2apic id below the next level
+		uint32_t shift = 0;
+		// logical processors at this level
+		uint32_t logical_count = 0;
+	};
+
+	// deterministic cache parameters, leaf 4 on intel and 0x8000001d on amd
+	struct cpuid_cache {
+		uint32_t level = 0;
+		cpu_cache::cache_type type = cpu_cache::UNKNOWN_TYPE;
+		uint64_t size_bytes = 0;
+		uint32_t line_size = 0;
+		// 0 for fully associative caches
+		uint32_t ways = 0;
+		uint32_t sets = 0;
+		// upper bound of logical processors sharing the cache
+		uint32_t max_sharing = 0;
+		bool inclusive = false;
+	};
+
+	// what cpuid reports for the calling cpu, no /proc or /sys access
+	struct cpuid_info {
+		std::string vendor_id{};
+		std::string brand{};
+		uint32_t family = 0;
+		uint32_t model = 0;
+		uint32_t stepping = 0;
+		// avx, avx-512 and amx are only set when the os saves their registers (xcr0)
+		cpu_feature_set features{};
+		std::vector<cpuid_cache> caches{};
+		std::vector<cpuid_topology_level> topology{};
+		uint32_t x2apic_id = 0;
+	};
+
+	// executes cpuid on the calling cpu, nullopt for leaves above the maximum or on other architectures
+	[[nodiscard]] std::optional<cpuid_registers> cpuid(uint32_t leaf, uint32_t subleaf = 0) noexcept;
+	// only the feature leaves, cheap enough for startup dispatch
+	[[nodiscard]] cpu_feature_set read_cpuid_features() noexcept;
+	// feature set of the calling process, read once and cached
+	[[nodiscard]] const cpu_feature_set& host_cpu_features() noexcept;
+	[[nodiscard]] std::variant<cpuid_info, hwctrl_error> read_cpuid() noexcept;
+	[[nodiscard]] std::string_view cpuid_topology_level_string(cpuid_topology_level::level_type type) noexcept;
+	void write_cpuid(util::writer& out, const cpuid_info& info) noexcept;
+} // namespace hwctrl::source
@@ -1,6 +1,9 @@
 #pragma once
 #include "../basic_types.hpp"
+#include "../util/writer.hpp"
+#include "cpu_features.hpp"
 #include <string>
+#include <string_view>
 #include <vector>
 #include <variant>
 
@@ -23,12 +26,17 @@ namespace hwctrl::source {
 			uint32_t family = 0;
 			uint32_t model = 0;
 			uint32_t physical_cores = 0;
+			// flags of the first processor of the package
+			cpu_feature_set features{};
 			std::vector<core> cores{};
 		};
 		std::vector<cpu> cpus{};
 	};
 
 	[[nodiscard]] std::variant<std::string, hwctrl_error> read_cpuinfo() noexcept;
-	[[nodiscard]] std::variant<cpuinfo, hwctrl_error> parse_cpuinfo(const std::string& str) noexcept;
+	// reads into a reusable buffer, the returned view points into buffer
+	[[nodiscard]] std::variant<std::string_view, hwctrl_error> read_cpuinfo(std::vector<char>& buffer) noexcept;
+	[[nodiscard]] std::variant<cpuinfo, hwctrl_error> parse_cpuinfo(std::string_view str) noexcept;
+	void write_cpuinfo(util::writer& out, const cpuinfo& ci) noexcept;
 	[[nodiscard]] std::string cpuinfo_string(const cpuinfo& ci) noexcept;
 } // namespace hwctrl::source
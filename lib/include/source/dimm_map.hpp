@@ -0,0 +1,98 @@
+#pragma once
+#include "../basic_types.hpp"
+#include "../memory.hpp"
+#include "../util/writer.hpp"
+#include "edac.hpp"
+#include "smbios.hpp"
+#include "spd.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hwctrl::source {
+	// an spd eeprom exposed by the ee1004 driver
+	struct spd_eeprom {
+		// i2c device name, e.g. 0-0050
+		std::string device{};
+		spd spd_parsed;
+	};
+
+	struct memory_channel {
+		uint32_t socket = dimm::UNKNOWN_ID;
+		uint32_t memory_controller = dimm::UNKNOWN_ID;
+		uint32_t channel = dimm::UNKNOWN_ID;
+		uint32_t slots = 0;
+		uint32_t populated_slots = 0;
+		uint64_t size_bytes = 0;
+		// slowest populated dimm, every dimm on a channel runs at the same speed
+		uint32_t mt = 0;
+		uint32_t width_bits = 0;
+		double peak_bytes_per_second = 0;
+	};
+
+	struct memory_socket {
+		uint32_t socket = dimm::UNKNOWN_ID;
+		uint32_t channels = 0;
+		uint32_t populated_channels = 0;
+		double peak_bytes_per_second = 0;
+		// every channel populated the same way at the fastest speed seen on the socket
+		double balanced_peak_bytes_per_second = 0;
+		std::vector<std::string> issues{};
+	};
+
+	struct memory_bandwidth {
+		std::vector<memory_channel> channels{};
+		std::vector<memory_socket> sockets{};
+		// populated dimms whose channel could not be determined
+		size_t unplaced_dimms = 0;
+		double peak_bytes_per_second = 0;
+	};
+
+	// configured speed of a dimm against what its spd says it can do
+	struct dimm_speed_check {
+		enum speed_status {
+			UNKNOWN_STATUS,
+			// no xmp profile, runs at the fastest jedec speed
+			RATED,
+			// runs at the fastest enabled xmp profile
+			XMP,
+			// has an xmp profile but runs at the jedec speed, e.g. after a bios reset
+			JEDEC_FALLBACK,
+			// faster than jedec but slower than the xmp profile
+			BELOW_XMP,
+			// slower than the fastest jedec speed
+			BELOW_RATED
+		};
+		speed_status status = UNKNOWN_STATUS;
+		uint32_t configured_mt = 0;
+		uint32_t jedec_mt = 0;
+		// fastest enabled xmp profile, 0 without xmp
+		uint32_t xmp_mt = 0;
+		uint32_t configured_mv = 0;
+		uint32_t xmp_mv = 0;
+	};
+
+	// reads sysfs_root/bus/i2c/drivers/ee1004/*/eeprom, unreadable or unparsable eeproms are skipped
+	[[nodiscard]] std::vector<spd_eeprom> read_spd_eeproms(const std::filesystem::path& sysfs_root = "/sys") noexcept;
+	// fills unknown socket/channel/slot of out from board locators like CPU0_DIMM_A1, P1-DIMMB2, ChannelA-DIMM0 or P0_Node0_Channel3_Dimm0
+	void parse_dimm_locator(std::string_view locator, dimm& out) noexcept;
+	// one dimm per smbios slot, matched to edac by label and to spd by serial number
+	// dimms the locators do not place on a socket take the index of their smbios memory array
+	// without smbios the edac dimms, and without either the spd eeproms are used
+	[[nodiscard]] std::vector<dimm> build_dimms(const smbios_tables& smbios, const std::vector<edac_dimm>& edac, const std::vector<spd_eeprom>& eeproms) noexcept;
+	// every source that cannot be read (no root, no driver) is skipped
+	[[nodiscard]] std::vector<dimm> read_dimms(const std::filesystem::path& sysfs_root = "/sys", const std::filesystem::path& dmi_path = "/sys/firmware/dmi/tables/DMI") noexcept;
+	// theoretical peak = MT/s * bus width per channel, summed per socket, and flags unbalanced population
+	[[nodiscard]] memory_bandwidth compute_memory_bandwidth(const std::vector<dimm>& dimms) noexcept;
+	// xmp needs the spd eeprom, without it the smbios maximum speed is the only reference
+	[[nodiscard]] dimm_speed_check check_dimm_speed(const dimm& entry) noexcept;
+	[[nodiscard]] std::string_view speed_status_string(dimm_speed_check::speed_status status) noexcept;
+	// true when the dimm runs slower than it could
+	[[nodiscard]] bool is_misconfigured(const dimm_speed_check& check) noexcept;
+	void write_dimms(util::writer& out, const std::vector<dimm>& dimms) noexcept;
+	// one record per populated dimm with its speed status, returns the number of misconfigured dimms
+	[[nodiscard]] size_t write_dimm_speed_checks(util::writer& out, const std::vector<dimm>& dimms) noexcept;
+	void write_memory_bandwidth(util::writer& out, const memory_bandwidth& bandwidth) noexcept;
+} // namespace hwctrl::source
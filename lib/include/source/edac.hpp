@@ -0,0 +1,34 @@
+#pragma once
+#include "../basic_types.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace hwctrl::source {
+	// a populated dimm (or rank) known to an edac memory controller driver
+	struct edac_dimm {
+		static constexpr uint32_t UNKNOWN_ID = UINT32_MAX;
+
+		uint32_t mc = 0;
+		uint32_t index = 0;
+		// set by firmware or the driver, e.g. "CPU_SrcID#0_MC#1_Chan#2_DIMM#0" or a board locator
+		std::string label{};
+		std::string mem_type{};
+		uint64_t size_bytes = 0;
+		uint64_t corrected_errors = 0;
+		uint64_t uncorrected_errors = 0;
+		// from dimm_location ("channel 0 slot 0", "csrow 0 channel 1"), then the label for fields it lacks, UNKNOWN_ID when absent
+		uint32_t socket = UNKNOWN_ID;
+		uint32_t channel = UNKNOWN_ID;
+		uint32_t slot = UNKNOWN_ID;
+		uint32_t csrow = UNKNOWN_ID;
+	};
+
+	// reads sysfs_root/devices/system/edac/mc/mc*/dimm*, empty without an edac driver
+	[[nodiscard]] std::variant<std::vector<edac_dimm>, hwctrl_error> read_edac_dimms(const std::filesystem::path& sysfs_root = "/sys") noexcept;
+	// fills socket/channel/slot/csrow from "name number" pairs (dimm_location) or "name#number" pairs (labels)
+	void parse_edac_location(std::string_view str, edac_dimm& dimm) noexcept;
+} // namespace hwctrl::source
@@ -0,0 +1,35 @@
+#pragma once
+#include "../basic_types.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace hwctrl::source {
+	// one line of /proc/interrupts
+	struct interrupt_line {
+		static constexpr uint32_t NOT_A_NUMBER = UINT32_MAX;
+
+		// "24" for device irqs, "LOC" or "NMI" for architecture interrupts
+		std::string name{};
+		uint32_t irq = NOT_A_NUMBER;
+		// one count per column of interrupts::cpus
+		std::vector<uint64_t> counts{};
+		// irq chip and hardware irq with trigger type, e.g. "IR-PCI-MSI" and "327680-edge"
+		std::string chip{};
+		std::string hwirq{};
+		// handler names, the device and queue for msi irqs, e.g. "eth0-TxRx-3", or the description of architecture interrupts
+		std::string actions{};
+	};
+
+	struct interrupts {
+		// cpu ids of the count columns, only cpus online when the file was read
+		std::vector<uint32_t> cpus{};
+		std::vector<interrupt_line> lines{};
+	};
+
+	[[nodiscard]] std::variant<interrupts, hwctrl_error> parse_interrupts(std::string_view str) noexcept;
+	[[nodiscard]] std::variant<interrupts, hwctrl_error> read_interrupts(const std::filesystem::path& proc_root = "/proc") noexcept;
+} // namespace hwctrl::source
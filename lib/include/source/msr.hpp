@@ -0,0 +1,64 @@
+#pragma once
+#include "../basic_types.hpp"
+#include "../util/file.hpp"
+#include "../util/writer.hpp"
+#include "topology.hpp"
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <variant>
+#include <vector>
+
+namespace hwctrl::source {
+	namespace msr {
+		static constexpr uint32_t IA32_TIME_STAMP_COUNTER = 0x10;
+		static constexpr uint32_t IA32_MPERF = 0xe7;
+		static constexpr uint32_t IA32_APERF = 0xe8;
+	} // namespace msr
+
+	struct msr_counters {
+		uint64_t aperf = 0;
+		uint64_t mperf = 0;
+		uint64_t tsc = 0;
+		// false if any of the registers could not be read
+		bool valid = false;
+	};
+
+	struct effective_frequency {
+		uint32_t cpu = 0;
+		// average frequency while not halted, tsc rate * aperf / mperf
+		double busy_mhz = 0;
+		// share of the interval spent in c0, mperf / tsc
+		double c0_residency = 0;
+		double tsc_mhz = 0;
+		bool valid = false;
+	};
+
+	// keeps msr_root/N/msr of every online cpu open
+	// one reader thread per package stays pinned to that package for the sampler's lifetime, so the rdmsr cross calls stay package local
+	class msr_sampler {
+		public:
+			msr_sampler(std::vector<uint32_t> cpu_ids, std::vector<util::file::unique_fd> cpu_files, std::vector<std::vector<size_t>> package_cpu_indices, uint32_t register_stride) noexcept;
+			msr_sampler(msr_sampler&&) noexcept;
+			msr_sampler& operator=(msr_sampler&&) = delete;
+			// stops and joins the readers
+			~msr_sampler() noexcept;
+
+			[[nodiscard]] const std::vector<uint32_t>& cpus() const noexcept;
+			// counters[i] belongs to cpus()[i], wakes every reader and blocks until all of them are done
+			void read(std::span<msr_counters> counters) const noexcept;
+		private:
+			struct reader_state;
+
+			// heap allocated so the readers keep a stable address when the sampler is moved
+			std::unique_ptr<reader_state> state;
+	};
+
+	// msr_root is /dev/cpu normally, any tree of N/msr files works
+	// register r is read at file offset r * register_stride - 1 for the msr device, 8 for fake files holding an array of uint64_t
+	[[nodiscard]] std::variant<msr_sampler, hwctrl_error> open_msr_sampler(const cpu_topology& topology, const std::filesystem::path& msr_root = "/dev/cpu", uint32_t register_stride = 1) noexcept;
+	[[nodiscard]] std::vector<effective_frequency> compute_effective_frequency(std::span<const uint32_t> cpus, std::span<const msr_counters> before, std::span<const msr_counters> after, std::chrono::nanoseconds elapsed) noexcept;
+	void write_effective_frequency(util::writer& out, std::span<const effective_frequency> frequencies) noexcept;
+} // namespace hwctrl::source
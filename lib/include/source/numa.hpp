@@ -0,0 +1,46 @@
+#pragma once
+#include "../basic_types.hpp"
+#include "../util/writer.hpp"
+#include "topology.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace hwctrl::source {
+	struct numa_node {
+		uint32_t id = 0;
+		// empty for memory only nodes
+		std::vector<uint32_t> cpus{};
+		uint64_t total_bytes = 0;
+		uint64_t free_bytes = 0;
+		uint64_t file_pages_bytes = 0;
+		// default size huge pages, counts not bytes
+		uint64_t hugepages_total = 0;
+		uint64_t hugepages_free = 0;
+	};
+
+	struct numa_topology {
+		static constexpr uint32_t UNKNOWN_DISTANCE = 0;
+
+		// sorted by id
+		std::vector<numa_node> nodes{};
+		// nodes.size() x nodes.size() row major by node index, 10 is local
+		std::vector<uint32_t> distances{};
+		// maps a node id to its index in nodes or cpu_topology::UNKNOWN_ID
+		std::vector<uint32_t> index_by_id{};
+
+		[[nodiscard]] const numa_node* find(uint32_t id) const noexcept;
+		// UNKNOWN_DISTANCE if either node is unknown or the kernel reported no distance
+		[[nodiscard]] uint32_t distance(uint32_t from_id, uint32_t to_id) const noexcept;
+	};
+
+	// reads sysfs_root/devices/system/node/node*/{cpulist,meminfo,distance}
+	[[nodiscard]] std::variant<numa_topology, hwctrl_error> read_numa_topology(const std::filesystem::path& sysfs_root = "/sys") noexcept;
+	// parses a per node meminfo ("Node 0 MemTotal: 16318412 kB") into node
+	void parse_node_meminfo(std::string_view str, numa_node& node) noexcept;
+	// sets numa_node_id of every cpu, for topologies built from cpuinfo which has no numa information
+	[[nodiscard]] cpu_topology link_numa_topology(const cpu_topology& topology, const numa_topology& numa) noexcept;
+	void write_numa_topology(util::writer& out, const numa_topology& numa, const cpu_topology& topology) noexcept;
+} // namespace hwctrl::source
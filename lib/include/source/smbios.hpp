@@ -0,0 +1,75 @@
+#pragma once
+#include "../basic_types.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace hwctrl::source {
+	// type 16 physical memory array, usually one per socket
+	struct smbios_memory_array {
+		// use of the array, only SYSTEM_MEMORY arrays hold dimms
+		static constexpr uint8_t SYSTEM_MEMORY = 0x03;
+
+		uint16_t handle = 0;
+		uint8_t location = 0;
+		uint8_t use = 0;
+		// 0x03 none, 0x05 single bit ecc, 0x06 multi bit ecc
+		uint8_t error_correction = 0;
+		uint64_t max_capacity_bytes = 0;
+		uint16_t device_count = 0;
+	};
+
+	// type 17 memory device, one per slot whether populated or not
+	struct smbios_memory_device {
+		// defined out of line, inlining the copies of five strings into every caller is not worth it
+		smbios_memory_device() noexcept;
+		smbios_memory_device(const smbios_memory_device& other);
+		smbios_memory_device(smbios_memory_device&& other) noexcept;
+		smbios_memory_device& operator=(const smbios_memory_device& other);
+		smbios_memory_device& operator=(smbios_memory_device&& other) noexcept;
+		~smbios_memory_device() noexcept;
+
+		uint16_t handle = 0;
+		uint16_t array_handle = 0;
+		std::string locator{};
+		std::string bank_locator{};
+		std::string manufacturer{};
+		std::string serial_number{};
+		std::string part_number{};
+		// 0 for an empty slot
+		uint64_t size_bytes = 0;
+		// 0x1a ddr4, 0x22 ddr5, 0x18 ddr3
+		uint8_t memory_type = 0;
+		uint16_t total_width_bits = 0;
+		uint16_t data_width_bits = 0;
+		// maximum speed of the device and speed the firmware configured, 0 when unknown
+		uint32_t speed_mt = 0;
+		uint32_t configured_speed_mt = 0;
+		// 0 when unknown
+		uint8_t ranks = 0;
+		// smbios 2.8 voltages, 0 when unknown
+		uint16_t minimum_mv = 0;
+		uint16_t maximum_mv = 0;
+		uint16_t configured_mv = 0;
+	};
+
+	struct smbios_tables {
+		smbios_tables() noexcept;
+		smbios_tables(const smbios_tables& other);
+		smbios_tables(smbios_tables&& other) noexcept;
+		smbios_tables& operator=(const smbios_tables& other);
+		smbios_tables& operator=(smbios_tables&& other) noexcept;
+		~smbios_tables() noexcept;
+
+		std::vector<smbios_memory_array> memory_arrays{};
+		std::vector<smbios_memory_device> memory_devices{};
+	};
+
+	// parses the raw structure table exported by the kernel (no entry point)
+	[[nodiscard]] std::variant<smbios_tables, hwctrl_error> parse_smbios(std::span<const unsigned char> table) noexcept;
+	// maps and parses the table, falling back to pread where mmap is not supported, readable by root only
+	[[nodiscard]] std::variant<smbios_tables, hwctrl_error> read_smbios(const std::filesystem::path& path = "/sys/firmware/dmi/tables/DMI") noexcept;
+} // namespace hwctrl::source
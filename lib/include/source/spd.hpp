@@ -1,8 +1,10 @@
 #pragma once
 #include "../basic_types.hpp"
+#include "../util/writer.hpp"
 #include <variant>
 #include <optional>
 #include <string>
+#include <span>
 
 namespace hwctrl::source {
 	struct ddr_module_manufacturer {
@@ -33,19 +35,19 @@ namespace hwctrl::source {
 		struct xmp_profile {
 			bool enable = false;
 			uint8_t dimms_per_channel = 0;
-			voltage dimm_voltage;
-			memory_clock clk;
-			memory_timing tCL;
-			memory_timing tRCD;
-			memory_timing tRP;
-			memory_timing tRAS;
-			memory_timing tRC;
-			memory_timing tRFC1;
-			memory_timing tRFC2;
-			memory_timing tRFC4;
-			memory_timing tFAW;
-			memory_timing tRRD_S;
-			memory_timing tRRD_L;
+			voltage dimm_voltage{};
+			memory_clock clk{};
+			memory_timing tCL{};
+			memory_timing tRCD{};
+			memory_timing tRP{};
+			memory_timing tRAS{};
+			memory_timing tRC{};
+			memory_timing tRFC1{};
+			memory_timing tRFC2{};
+			memory_timing tRFC4{};
+			memory_timing tFAW{};
+			memory_timing tRRD_S{};
+			memory_timing tRRD_L{};
 		};
 		xmp_profile profiles[2];
 	};
@@ -142,6 +144,8 @@ namespace hwctrl::source {
 	using spd = std::variant<spd_ddr4, spd_ddr3>;
 
 	[[nodiscard]] std::variant<spd, hwctrl_error> parse_spd(const unsigned char* data, uint32_t size) noexcept;
+	[[nodiscard]] std::variant<spd, hwctrl_error> parse_spd(std::span<const unsigned char> data) noexcept;
+	void write_spd(util::writer& out, const spd& spd_parsed, bool serial) noexcept;
 	[[nodiscard]] std::string spd_string(const spd& spd_parsed, bool serial) noexcept;
 	[[nodiscard]] std::string_view get_module_manufacturer_name_string(const ddr_module_manufacturer& module_manufacturer) noexcept;
 	[[nodiscard]] std::string_view get_dram_manufacturer_name_string(const ddr_dram_manufacturer& dram_manufacturer) noexcept;
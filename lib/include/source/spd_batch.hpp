@@ -0,0 +1,50 @@
+#pragma once
+#include "../basic_types.hpp"
+#include "../util/thread_pool.hpp"
+#include "../util/writer.hpp"
+#include "spd.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+
+namespace hwctrl::source {
+	// the fields of one spd dump needed for fleet inventory
+	struct spd_batch_record {
+		std::filesystem::path path{};
+		std::optional<hwctrl_error> error{};
+		std::string_view type{};
+		uint16_t clock_mt = 0;
+		// 0 without an enabled xmp profile
+		uint16_t xmp_clock_mt = 0;
+		ddr_module_manufacturer module_manufacturer{ddr_module_manufacturer::UNKNOWN, 0};
+		uint32_t serial_number = 0;
+		std::string part_number{};
+	};
+
+	struct spd_batch_summary {
+		size_t files = 0;
+		size_t failures = 0;
+		std::map<std::string_view, size_t> types{};
+		std::map<uint16_t, size_t> speeds{};
+		std::map<uint16_t, size_t> xmp_speeds{};
+		std::map<std::pair<ddr_module_manufacturer::ddr_module_manufacturer_name, uint16_t>, size_t> vendors{};
+
+		void add(const spd_batch_record& record) noexcept;
+		void merge(const spd_batch_summary& other) noexcept;
+	};
+
+	[[nodiscard]] spd_batch_record audit_spd_file(const std::filesystem::path& path) noexcept;
+	// audits every regular file below a directory, or every match of a glob pattern, on pool
+	// on_record is called once per file from the worker threads but never concurrently
+	[[nodiscard]] std::variant<spd_batch_summary, hwctrl_error> audit_spd_files(const std::string& dir_or_glob, util::thread_pool& pool, const std::function<void(const spd_batch_record&)>& on_record) noexcept;
+	void write_spd_batch_record(util::writer& out, const spd_batch_record& record) noexcept;
+	void write_spd_batch_summary(util::writer& out, const spd_batch_summary& summary) noexcept;
+	[[nodiscard]] std::string spd_batch_record_string(const spd_batch_record& record) noexcept;
+	[[nodiscard]] std::string spd_batch_summary_string(const spd_batch_summary& summary) noexcept;
+} // namespace hwctrl::source
@@ -0,0 +1,87 @@
+#pragma once
+#include "../basic_types.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// declarative description of spd byte layouts
+// a decoder is a set of constexpr field tables walked by the generic decode loops below
+// so ddr3, ddr5 and xmp layouts only need new tables, not new decoding code
+namespace hwctrl::source::spd_layout {
+	// value = (data[offset] & mask) >> shift
+	struct bits {
+		uint16_t offset = 0;
+		uint8_t mask = 0xff;
+		uint8_t shift = 0;
+	};
+
+	// mtb count = data[low] | ((data[high] & high_mask) << high_shift)
+	// time in picoseconds = mtb count * 125 + (int8_t)(data[ftb] & ftb_mask)
+	// fields without upper bits or ftb correction leave the mask at 0 so decoding does not branch
+	struct timing {
+		uint16_t low = 0;
+		uint16_t high = 0;
+		uint8_t high_mask = 0;
+		uint8_t high_shift = 0;
+		uint16_t ftb = 0;
+		uint8_t ftb_mask = 0;
+	};
+
+	template <typename S>
+	struct byte_field {
+		uint8_t S::* member;
+		bits layout;
+	};
+
+	template <typename S>
+	struct timing_field {
+		memory_timing S::* member;
+		timing layout;
+	};
+
+	[[nodiscard]] constexpr uint8_t decode_bits(const unsigned char* data, bits layout) noexcept {
+		return static_cast<uint8_t>((data[layout.offset] & layout.mask) >> layout.shift);
+	}
+
+	[[nodiscard]] constexpr uint16_t decode_u16(const unsigned char* data, uint16_t offset) noexcept {
+		return static_cast<uint16_t>(data[offset] | (data[offset + 1u] << 8u));
+	}
+
+	[[nodiscard]] constexpr uint32_t decode_u32(const unsigned char* data, uint16_t offset) noexcept {
+		return static_cast<uint32_t>(decode_u16(data, offset)) | (static_cast<uint32_t>(decode_u16(data, static_cast<uint16_t>(offset + 2u))) << 16u);
+	}
+
+	[[nodiscard]] constexpr memory_timing decode_timing(const unsigned char* data, timing layout) noexcept {
+		auto mtb = static_cast<uint16_t>(data[layout.low] | ((data[layout.high] & layout.high_mask) << layout.high_shift));
+		auto ftb = static_cast<uint8_t>(data[layout.ftb] & layout.ftb_mask);
+		return memory_timing{static_cast<uint32_t>(mtb * 125 + static_cast<int8_t>(ftb)), mtb, ftb};
+	}
+
+	// the field tables are template arguments so the loops are expanded at compile time
+	// and every field becomes a load with constant offsets and masks
+	template <const auto& fields, typename S>
+	constexpr void decode_byte_fields(S& out, const unsigned char* data) noexcept {
+		[&]<size_t ... i>(std::index_sequence<i...>) noexcept {
+			((out.*fields[i].member = decode_bits(data, fields[i].layout)), ...);
+		}(std::make_index_sequence<fields.size()>{});
+	}
+
+	template <const auto& fields, typename S>
+	constexpr void decode_timing_fields(S& out, const unsigned char* data) noexcept {
+		[&]<size_t ... i>(std::index_sequence<i...>) noexcept {
+			((out.*fields[i].member = decode_timing(data, fields[i].layout)), ...);
+		}(std::make_index_sequence<fields.size()>{});
+	}
+
+	// expands a sparse byte -> value list into a table indexed by the raw byte, unlisted bytes map to fallback
+	template <typename T, size_t N>
+	[[nodiscard]] constexpr std::array<T, 256> make_byte_table(const std::pair<uint8_t, T> (&entries)[N], T fallback = {}) noexcept {
+		std::array<T, 256> table{};
+		table.fill(fallback);
+		for (const auto& [byte, value] : entries) {
+			table[byte] = value;
+		}
+		return table;
+	}
+} // namespace hwctrl::source::spd_layout
@@ -0,0 +1,85 @@
+#pragma once
+#include "../basic_types.hpp"
+#include "spd.hpp"
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <variant>
+
+namespace hwctrl::source {
+	// view over the raw bytes of a ddr4 spd, e.g. a mapped eeprom dump
+	// every accessor decodes its field on demand so callers only pay for the fields they read
+	// the bytes are not copied and must outlive the view
+	class spd_view {
+		public:
+			// ddr4 spds are 512 bytes but some eeprom drivers only expose the first 256 byte page
+			static constexpr size_t MIN_SIZE = 256;
+			static constexpr size_t MANUFACTURING_SIZE = 384;
+
+			// unchecked - use make_spd_view for untrusted data
+			explicit spd_view(std::span<const unsigned char> data) noexcept;
+
+			[[nodiscard]] std::span<const unsigned char> bytes() const noexcept;
+
+			[[nodiscard]] uint8_t spd_revision_major() const noexcept;
+			[[nodiscard]] uint8_t spd_revision_minor() const noexcept;
+			[[nodiscard]] spd_ddr4::device_type_t device_type() const noexcept;
+			[[nodiscard]] uint8_t bank_groups() const noexcept;
+			[[nodiscard]] uint8_t internal_banks() const noexcept;
+			[[nodiscard]] uint8_t die_size_mb() const noexcept;
+			[[nodiscard]] std::optional<uint8_t> row_count() const noexcept;
+			[[nodiscard]] std::optional<uint8_t> column_count() const noexcept;
+			[[nodiscard]] std::optional<spd_ddr4::sdram_device_type_t> sdram_device_type() const noexcept;
+			[[nodiscard]] std::optional<uint16_t> tMAW_mul() const noexcept;
+			[[nodiscard]] std::optional<uint16_t> tRRMAC_thousands() const noexcept;
+			[[nodiscard]] std::optional<bool> endure_higher_vdd() const noexcept;
+			[[nodiscard]] uint8_t ranks() const noexcept;
+			[[nodiscard]] spd_ddr4::chip_size_t chip_size() const noexcept;
+			[[nodiscard]] std::optional<uint8_t> module_memory_bus_width_bits() const noexcept;
+			[[nodiscard]] bool module_thermal_sensor() const noexcept;
+			[[nodiscard]] memory_clock clock_min() const noexcept;
+			[[nodiscard]] memory_clock clock_max() const noexcept;
+			// index 0 is cas latency 7, same as spd_ddr4::cas_supported
+			[[nodiscard]] bool cas_supported(size_t index) const noexcept;
+			[[nodiscard]] memory_timing tCL_min() const noexcept;
+			[[nodiscard]] memory_timing tRCD_min() const noexcept;
+			[[nodiscard]] memory_timing tRP_min() const noexcept;
+			[[nodiscard]] memory_timing tRAS_min() const noexcept;
+			[[nodiscard]] memory_timing tRC_min() const noexcept;
+			[[nodiscard]] memory_timing tRFC1_min() const noexcept;
+			[[nodiscard]] memory_timing tRFC2_min() const noexcept;
+			[[nodiscard]] memory_timing tRFC4_min() const noexcept;
+			[[nodiscard]] memory_timing tFAW_min() const noexcept;
+			[[nodiscard]] memory_timing tRRD_S_min() const noexcept;
+			[[nodiscard]] memory_timing tRRD_L_min() const noexcept;
+			[[nodiscard]] memory_timing tCCD_L_min() const noexcept;
+			[[nodiscard]] uint8_t module_height() const noexcept;
+			[[nodiscard]] uint8_t module_max_thickness() const noexcept;
+			[[nodiscard]] uint8_t ref_raw_card_used() const noexcept;
+			// manufacturing fields are 0 or empty when only the first page is present
+			[[nodiscard]] bool has_manufacturing_data() const noexcept;
+			[[nodiscard]] ddr_module_manufacturer module_manufacturer() const noexcept;
+			[[nodiscard]] uint8_t module_manufacturing_location() const noexcept;
+			[[nodiscard]] uint16_t module_manufacturing_year() const noexcept;
+			[[nodiscard]] uint16_t module_manufacturing_week() const noexcept;
+			[[nodiscard]] uint32_t serial_number() const noexcept;
+			// points into the spd bytes, padded with spaces like the eeprom
+			[[nodiscard]] std::string_view part_number() const noexcept;
+			[[nodiscard]] uint8_t module_revision_code() const noexcept;
+			[[nodiscard]] ddr_dram_manufacturer dram_manufacturer() const noexcept;
+			[[nodiscard]] uint8_t dram_stepping() const noexcept;
+			[[nodiscard]] bool has_xmp_20() const noexcept;
+			// std::nullopt without xmp 2.0 data or for index > 1
+			[[nodiscard]] std::optional<xmp_20_data::xmp_profile> xmp_profile(size_t index) const noexcept;
+		private:
+			[[nodiscard]] uint8_t manufacturing_byte(size_t offset) const noexcept;
+
+			std::span<const unsigned char> data{};
+	};
+
+	// checks that data is a complete ddr4 spd that every accessor can decode
+	[[nodiscard]] std::variant<spd_view, hwctrl_error> make_spd_view(std::span<const unsigned char> data) noexcept;
+	// decodes every field of the view
+	[[nodiscard]] spd_ddr4 to_spd_ddr4(const spd_view& view) noexcept;
+} // namespace hwctrl::source
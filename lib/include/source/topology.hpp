@@ -0,0 +1,76 @@
+#pragma once
+#include "../basic_types.hpp"
+#include "../util/writer.hpp"
+#include "cpuinfo.hpp"
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+#include <filesystem>
+
+namespace hwctrl::source {
+	struct cpu_topology {
+		static constexpr uint32_t UNKNOWN_ID = UINT32_MAX;
+
+		struct logical_cpu {
+			bool online = false;
+			uint32_t package_id = UNKNOWN_ID;
+			uint32_t die_id = UNKNOWN_ID;
+			uint32_t core_id = UNKNOWN_ID;
+			uint32_t numa_node_id = UNKNOWN_ID;
+			// dense indices into dies and cores - die and core ids are only unique within a package
+			uint32_t die_index = UNKNOWN_ID;
+			uint32_t core_index = UNKNOWN_ID;
+		};
+
+		// logical cpus sharing an id, stored back to back with one offset per group
+		struct cpu_groups {
+			std::vector<uint32_t> ids{};
+			std::vector<uint32_t> offsets{};
+			std::vector<uint32_t> cpus{};
+			// maps an id to its group index or UNKNOWN_ID
+			std::vector<uint32_t> index_by_id{};
+
+			[[nodiscard]] size_t size() const noexcept;
+			[[nodiscard]] std::span<const uint32_t> group(size_t index) const noexcept;
+			[[nodiscard]] std::span<const uint32_t> find(uint32_t id) const noexcept;
+		};
+
+		// indexed by logical cpu id, offline or missing cpus have online = false
+		std::vector<logical_cpu> cpus{};
+		cpu_groups packages{};
+		cpu_groups dies{};
+		cpu_groups cores{};
+		cpu_groups numa_nodes{};
+
+		[[nodiscard]] uint32_t logical_cpu_count() const noexcept;
+		[[nodiscard]] bool online(uint32_t cpu) const noexcept;
+		// all logical cpus on the same core as cpu, including cpu
+		[[nodiscard]] std::span<const uint32_t> smt_siblings(uint32_t cpu) const noexcept;
+		// all logical cpus on the same die as cpu, including cpu
+		[[nodiscard]] std::span<const uint32_t> die_cpus(uint32_t cpu) const noexcept;
+		[[nodiscard]] std::span<const uint32_t> package_cpus(uint32_t package_id) const noexcept;
+		[[nodiscard]] std::span<const uint32_t> numa_node_cpus(uint32_t numa_node_id) const noexcept;
+	};
+
+	// builds the group tables from cpus, which must already hold package, die, core and numa node ids
+	[[nodiscard]] cpu_topology build_topology(std::vector<cpu_topology::logical_cpu> cpus) noexcept;
+	// die and numa node ids are not part of cpuinfo and stay unknown
+	[[nodiscard]] cpu_topology make_topology(const cpuinfo& ci) noexcept;
+	// reads sysfs_root/devices/system/cpu/cpu*/topology and sysfs_root/devices/system/node/node*/cpulist
+	[[nodiscard]] std::variant<cpu_topology, hwctrl_error> read_topology(const std::filesystem::path& sysfs_root = "/sys") noexcept;
+	// online cpus ordered to spread load: one cpu per core alternating between packages, then the smt siblings
+	// the first n entries are the placement for n threads
+	[[nodiscard]] std::vector<uint32_t> spread_cpus(const cpu_topology& topology) noexcept;
+	// resolves a cpu set expression to sorted online cpus, terms are joined with + (union) and ~ (difference):
+	//   all             every online cpu
+	//   0-3,8           cpu ids
+	//   package:0       cpus of packages, node:0-1 cpus of numa nodes
+	//   pid:1234        cpus a process may run on
+	//   smt:<term>      every smt sibling of the cpus of term, e.g. smt:pid:1234~pid:1234
+	[[nodiscard]] std::variant<std::vector<uint32_t>, hwctrl_error> resolve_cpu_set(const cpu_topology& topology, std::string_view expression) noexcept;
+	void write_cpu_topology(util::writer& out, const cpu_topology& topology) noexcept;
+	[[nodiscard]] std::string cpu_topology_string(const cpu_topology& topology) noexcept;
+} // namespace hwctrl::source
@@ -0,0 +1,32 @@
+#pragma once
+#include "../basic_types.hpp"
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <variant>
+#include <vector>
+#include <sys/types.h>
+
+namespace hwctrl::util::affinity {
+	enum class memory_policy {
+		// first touch on the node of the running cpu
+		DEFAULT,
+		// only the given nodes, fails allocations when they are full
+		BIND,
+		// pages round robin over the nodes
+		INTERLEAVE,
+		// the given nodes first, any node once they are full
+		PREFERRED
+	};
+
+	// restricts the calling thread to cpus, sized dynamically so ids above CPU_SETSIZE work
+	[[nodiscard]] std::optional<hwctrl_error> pin_current_thread(std::span<const uint32_t> cpus) noexcept;
+	// restricts a whole process (0 for the caller) to cpus
+	[[nodiscard]] std::optional<hwctrl_error> set_process_affinity(pid_t pid, std::span<const uint32_t> cpus) noexcept;
+	// cpus the calling thread may currently run on
+	[[nodiscard]] std::variant<std::vector<uint32_t>, hwctrl_error> current_thread_cpus() noexcept;
+	// cpus the main thread of a process may run on
+	[[nodiscard]] std::variant<std::vector<uint32_t>, hwctrl_error> process_cpus(pid_t pid) noexcept;
+	// numa memory policy of the calling thread, inherited by children and kept across exec
+	[[nodiscard]] std::optional<hwctrl_error> set_memory_policy(memory_policy policy, std::span<const uint32_t> nodes) noexcept;
+} // namespace hwctrl::util::affinity
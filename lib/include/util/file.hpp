@@ -1,10 +1,74 @@
 #pragma once
 #include "../basic_types.hpp"
+#include <functional>
+#include <optional>
 #include <variant>
 #include <vector>
+#include <span>
+#include <string>
+#include <string_view>
 #include <filesystem>
 
+// lookups by path (read_ram_file, map_file, list_directory, exists, resolve, is_directory, walk_files, glob) are recorded into or replayed from a snapshot when one is active, see snapshot.hpp
 namespace hwctrl::util::file {
+	// owning file descriptor, closed on destruction
+	class unique_fd {
+		public:
+			unique_fd() noexcept = default;
+			explicit unique_fd(int fd) noexcept;
+			unique_fd(const unique_fd&) = delete;
+			unique_fd(unique_fd&& other) noexcept;
+			unique_fd& operator=(const unique_fd&) = delete;
+			unique_fd& operator=(unique_fd&& other) noexcept;
+			~unique_fd() noexcept;
+
+			[[nodiscard]] int get() const noexcept;
+			[[nodiscard]] bool valid() const noexcept;
+		private:
+			int fd = -1;
+	};
+
+	// read only private mapping of a regular file, unmapped on destruction
+	class mapped_file {
+		public:
+			mapped_file() noexcept = default;
+			mapped_file(void* address, size_t size) noexcept;
+			mapped_file(const mapped_file&) = delete;
+			mapped_file(mapped_file&& other) noexcept;
+			mapped_file& operator=(const mapped_file&) = delete;
+			mapped_file& operator=(mapped_file&& other) noexcept;
+			~mapped_file() noexcept;
+
+			[[nodiscard]] std::span<const unsigned char> data() const noexcept;
+		private:
+			void* address = nullptr;
+			size_t size = 0;
+	};
+
+	[[nodiscard]] std::variant<unique_fd, hwctrl_error> open_file(const std::filesystem::path& path) noexcept;
+	// maps a regular file such as an spd dump or dmi table without copying it
+	[[nodiscard]] std::variant<mapped_file, hwctrl_error> map_file(const std::filesystem::path& path) noexcept;
+	// map_file, or a read only copy when the file does not support mmap (sysfs binary attributes like eeproms and the dmi table)
+	[[nodiscard]] std::variant<mapped_file, hwctrl_error> map_or_read_file(const std::filesystem::path& path) noexcept;
+	// reads a file whose size is not known up front (/proc, /sys) from offset 0 with pread
+	// the buffer is reused across calls and only grows when the file does not fit
+	// the returned view points into buffer
+	[[nodiscard]] std::variant<std::string_view, hwctrl_error> read_ram_file(const unique_fd& fd, std::vector<char>& buffer) noexcept;
+	[[nodiscard]] std::variant<std::string_view, hwctrl_error> read_ram_file(const std::filesystem::path& path, std::vector<char>& buffer) noexcept;
+
 	[[nodiscard]] std::variant<std::vector<char>, hwctrl_error> read_binary_file(const std::filesystem::path& path) noexcept;
 	[[nodiscard]] std::variant<std::string, hwctrl_error> read_ram_file(const std::filesystem::path& path) noexcept;
+	// sorted names of the entries of dir, empty when it cannot be read
+	[[nodiscard]] std::vector<std::string> list_directory(const std::filesystem::path& dir) noexcept;
+	// during a replay a path exists when it was recorded or its recorded parent directory lists it
+	[[nodiscard]] bool exists(const std::filesystem::path& path) noexcept;
+	// path with every symlink resolved like std::filesystem::canonical, nullopt when it does not exist
+	[[nodiscard]] std::optional<std::filesystem::path> resolve(const std::filesystem::path& path) noexcept;
+	// follows symlinks, during a replay a directory is one that was listed or has recorded files below it
+	[[nodiscard]] bool is_directory(const std::filesystem::path& path) noexcept;
+	// every regular file below dir, symlinked directories are not entered
+	// a replay only knows the files the recording read, which are all of them when it walked the same tree
+	[[nodiscard]] std::optional<hwctrl_error> walk_files(const std::filesystem::path& dir, const std::function<void(const std::filesystem::path&)>& on_file) noexcept;
+	// files matching a shell pattern as glob(3) finds them, directories are left out, an error for an invalid pattern
+	[[nodiscard]] std::variant<std::vector<std::filesystem::path>, hwctrl_error> glob(const std::string& pattern) noexcept;
 } // namespace hwctrl::util::file
@@ -0,0 +1,106 @@
+#pragma once
+#include "../basic_types.hpp"
+#include "file.hpp"
+#include "writer.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+// a snapshot archive holds the files, directory listings and symlink targets hwctrl read from /proc, /sys and eeproms
+// layout, all integers little endian:
+//   header
+//   block table, one {offset, compressed size, raw size} per block
+//   index, one {path offset, path size, block, offset in block, size, kind} per entry, sorted by path
+//   paths
+//   zlib compressed blocks of up to BLOCK_SIZE bytes holding the entries in index order
+// neighbouring sysfs files land in the same block, which compresses them together and lets a replay decompress a directory at once
+namespace hwctrl::util::snapshot {
+	enum class entry_kind : uint32_t {
+		FILE = 0,
+		// contents are the names of the entries, one per line
+		DIRECTORY = 1,
+		// contents are the path the link resolves to
+		LINK = 2
+	};
+
+	struct entry_info {
+		std::string path{};
+		entry_kind kind = entry_kind::FILE;
+		uint64_t size = 0;
+	};
+
+	// collects every read, shared by all threads
+	class recorder {
+		public:
+			recorder() noexcept = default;
+
+			void add_file(std::string path, std::string_view contents) noexcept;
+			void add_directory(std::string path, std::span<const std::string> names) noexcept;
+			void add_link(std::string path, std::string target) noexcept;
+			[[nodiscard]] std::optional<hwctrl_error> save(const std::filesystem::path& path) const noexcept;
+		private:
+			mutable std::mutex mutex{};
+			std::map<std::string, std::pair<entry_kind, std::string>> entries{};
+	};
+
+	// a mapped archive, blocks are decompressed on first use and kept
+	class archive {
+		public:
+			static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+			archive() noexcept = default;
+			archive(file::mapped_file file, size_t block_count, size_t entry_count) noexcept;
+
+			// the view stays valid as long as the archive
+			[[nodiscard]] std::variant<std::string_view, hwctrl_error> read_file(std::string_view path) const noexcept;
+			// names in a directory, empty when the directory was not recorded
+			[[nodiscard]] std::vector<std::string> list_directory(std::string_view path) const noexcept;
+			// the resolved path of a recorded symlink lookup
+			[[nodiscard]] std::optional<std::string> read_link(std::string_view path) const noexcept;
+			// kind of the entry recorded at path, nullopt when nothing was
+			[[nodiscard]] std::optional<entry_kind> kind_of(std::string_view path) const noexcept;
+			// recorded files anywhere below dir, sorted
+			[[nodiscard]] std::vector<std::string> files_under(std::string_view dir) const noexcept;
+			[[nodiscard]] std::vector<entry_info> entries() const noexcept;
+			[[nodiscard]] size_t archive_size() const noexcept;
+		private:
+			struct block_cache {
+				std::mutex mutex{};
+				std::vector<std::optional<std::string>> blocks{};
+			};
+
+			// index of the first entry not before path
+			[[nodiscard]] size_t lower_bound(std::string_view path) const noexcept;
+			[[nodiscard]] std::optional<size_t> find(std::string_view path, entry_kind kind) const noexcept;
+			[[nodiscard]] std::variant<std::string_view, hwctrl_error> contents(size_t index) const noexcept;
+
+			file::mapped_file file{};
+			size_t block_count = 0;
+			size_t entry_count = 0;
+			std::unique_ptr<block_cache> cache = std::make_unique<block_cache>();
+	};
+
+	// maps an archive and validates every table, so later reads only check what they decompress
+	[[nodiscard]] std::variant<archive, hwctrl_error> open_archive(const std::filesystem::path& path) noexcept;
+	// the key a path is recorded under, lexically normalized without a trailing slash
+	[[nodiscard]] std::string normalize_path(const std::filesystem::path& path) noexcept;
+
+	// process wide switches for util::file, set before the first read and not changed while other threads read
+	void start_recording() noexcept;
+	[[nodiscard]] std::optional<hwctrl_error> save_recording(const std::filesystem::path& path) noexcept;
+	void start_replay(archive replay_archive) noexcept;
+	[[nodiscard]] recorder* active_recorder() noexcept;
+	[[nodiscard]] const archive* active_archive() noexcept;
+	// an error while a replay is active, values computed from another machine's files must not be written to this one
+	[[nodiscard]] std::optional<hwctrl_error> check_replay_write(const std::filesystem::path& path) noexcept;
+
+	void write_archive_entries(util::writer& out, const archive& snapshot) noexcept;
+} // namespace hwctrl::util::snapshot
@@ -0,0 +1,80 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <type_traits>
+
+namespace hwctrl::util {
+	// bounded lock free ring buffer for exactly one producer thread and one consumer thread
+	// push and pop move a whole block or nothing, so fixed size records never tear
+	template <typename T> requires std::is_trivially_copyable_v<T>
+	class spsc_ring {
+		public:
+			// capacity is rounded up to a power of two
+			explicit spsc_ring(size_t min_capacity) noexcept : slots(std::bit_ceil(min_capacity < 2 ? size_t{2} : min_capacity)), mask(slots - 1), storage(std::make_unique<T[]>(slots)) {
+			}
+			spsc_ring(const spsc_ring&) = delete;
+			spsc_ring& operator=(const spsc_ring&) = delete;
+
+			// producer only, false when there is not enough free space for all of values
+			[[nodiscard]] bool try_push(std::span<const T> values) noexcept {
+				size_t head = write_index.load(std::memory_order_relaxed);
+				if (slots - (head - producer_read_cache) < values.size()) {
+					producer_read_cache = read_index.load(std::memory_order_acquire);
+					if (slots - (head - producer_read_cache) < values.size()) {
+						return false;
+					}
+				}
+				copy_in(head, values);
+				write_index.store(head + values.size(), std::memory_order_release);
+				return true;
+			}
+
+			// consumer only, false when fewer than values.size() elements are available
+			[[nodiscard]] bool try_pop(std::span<T> values) noexcept {
+				size_t tail = read_index.load(std::memory_order_relaxed);
+				if (consumer_write_cache - tail < values.size()) {
+					consumer_write_cache = write_index.load(std::memory_order_acquire);
+					if (consumer_write_cache - tail < values.size()) {
+						return false;
+					}
+				}
+				copy_out(tail, values);
+				read_index.store(tail + values.size(), std::memory_order_release);
+				return true;
+			}
+
+			[[nodiscard]] size_t capacity() const noexcept {
+				return slots;
+			}
+		private:
+			void copy_in(size_t index, std::span<const T> values) noexcept {
+				size_t offset = index & mask;
+				size_t first = std::min(values.size(), slots - offset);
+				std::memcpy(storage.get() + offset, values.data(), first * sizeof(T));
+				std::memcpy(storage.get(), values.data() + first, (values.size() - first) * sizeof(T));
+			}
+
+			void copy_out(size_t index, std::span<T> values) const noexcept {
+				size_t offset = index & mask;
+				size_t first = std::min(values.size(), slots - offset);
+				std::memcpy(values.data(), storage.get() + offset, first * sizeof(T));
+				std::memcpy(values.data() + first, storage.get(), (values.size() - first) * sizeof(T));
+			}
+
+			// indices grow without wrapping, slot = index & mask
+			// each side keeps its own line and a cached copy of the other side's index
+			static constexpr size_t CACHE_LINE = 64;
+			const size_t slots;
+			const size_t mask;
+			std::unique_ptr<T[]> storage;
+			alignas(CACHE_LINE) std::atomic<size_t> write_index{0};
+			size_t producer_read_cache = 0;
+			alignas(CACHE_LINE) std::atomic<size_t> read_index{0};
+			size_t consumer_write_cache = 0;
+	};
+} // namespace hwctrl::util
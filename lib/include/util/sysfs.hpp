@@ -0,0 +1,35 @@
+#pragma once
+#include "../basic_types.hpp"
+#include "file.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+#include <filesystem>
+#include <optional>
+
+namespace hwctrl::util::sysfs {
+	// reads a sysfs attribute holding a single unsigned integer
+	[[nodiscard]] std::variant<uint64_t, hwctrl_error> read_uint(const std::filesystem::path& path) noexcept;
+	// reads a sysfs attribute with the trailing newline removed
+	[[nodiscard]] std::variant<std::string, hwctrl_error> read_string(const std::filesystem::path& path) noexcept;
+	// writes value to a sysfs attribute with a single write, as the kernel expects
+	[[nodiscard]] std::optional<hwctrl_error> write_string(const std::filesystem::path& path, std::string_view value) noexcept;
+	// parses kernel cpu/node lists like "0-3,8,10-11" into sorted ids
+	[[nodiscard]] std::variant<std::vector<uint32_t>, hwctrl_error> parse_id_list(std::string_view str) noexcept;
+	[[nodiscard]] std::string id_list_string(const std::vector<uint32_t>& ids) noexcept;
+	// extracts 12 from "cpu12" for prefix "cpu"
+	[[nodiscard]] std::variant<uint32_t, hwctrl_error> parse_numbered_entry(std::string_view name, std::string_view prefix) noexcept;
+
+	// calls func(id, path) for every entry of dir named prefix followed by a number, e.g. cpu12 or node0
+	template <typename F>
+	void for_each_numbered_entry(const std::filesystem::path& dir, std::string_view prefix, F&& func) noexcept {
+		for (const auto& name : file::list_directory(dir)) {
+			auto id = parse_numbered_entry(name, prefix);
+			if (const auto* id_ptr = std::get_if<uint32_t>(&id)) {
+				func(*id_ptr, dir / name);
+			}
+		}
+	}
+} // namespace hwctrl::util::sysfs
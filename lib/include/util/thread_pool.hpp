@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hwctrl::util {
+	// fixed size pool with one task deque per worker
+	// workers run their own tasks newest first and steal the oldest tasks of other workers when idle
+	class thread_pool {
+		public:
+			explicit thread_pool(size_t thread_count = std::thread::hardware_concurrency()) noexcept;
+			thread_pool(const thread_pool&) = delete;
+			thread_pool& operator=(const thread_pool&) = delete;
+			// finishes all queued tasks before joining
+			~thread_pool() noexcept;
+
+			// tasks submitted from a worker go to that worker's deque, others are spread round robin
+			void submit(std::function<void()> task) noexcept;
+			// blocks until every submitted task has finished
+			void wait() noexcept;
+			[[nodiscard]] size_t size() const noexcept;
+			// index of the calling worker in [0, size()), size() when called from outside the pool
+			[[nodiscard]] size_t worker_index() const noexcept;
+		private:
+			struct worker_queue {
+				std::mutex mutex{};
+				std::deque<std::function<void()>> tasks{};
+			};
+
+			[[nodiscard]] bool try_pop(size_t index, std::function<void()>& task) noexcept;
+			void run(size_t index) noexcept;
+
+			std::vector<std::unique_ptr<worker_queue>> queues;
+			std::vector<std::thread> workers;
+			std::mutex state_mutex;
+			std::condition_variable work_available;
+			std::condition_variable all_done;
+			size_t queued = 0;
+			size_t unfinished = 0;
+			size_t next_queue = 0;
+			bool stop = false;
+	};
+} // namespace hwctrl::util
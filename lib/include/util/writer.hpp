@@ -0,0 +1,122 @@
+#pragma once
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hwctrl::util {
+	enum class output_format {
+		TEXT,
+		JSON,
+		CBOR
+	};
+
+	[[nodiscard]] std::optional<output_format> parse_output_format(std::string_view str) noexcept;
+
+	// streams structured output without building intermediate strings
+	// numbers are formatted with to_chars straight into one reusable buffer that is written to the fd when full
+	// text - one "key = value" line per field, nested objects indented by a tab
+	// json - one json value per line for every top level object or array (json lines)
+	// cbor - a sequence of cbor items (rfc 8742) using indefinite length maps and arrays
+	class writer {
+		public:
+			writer(int fd, output_format format) noexcept;
+			// appends to out instead of writing to a file descriptor
+			writer(std::string& out, output_format format) noexcept;
+			writer(const writer&) = delete;
+			writer& operator=(const writer&) = delete;
+			~writer() noexcept;
+
+			// keys are ignored for top level values and array elements
+			// keys are written verbatim and must be plain identifiers, string values are escaped
+			// invalid utf-8 in string values becomes U+FFFD in json and turns the value into a byte string in cbor
+			// containers nested deeper than MAX_DEPTH are dropped together with everything written into them
+			void begin_object(std::string_view key = {}) noexcept;
+			void end_object() noexcept;
+			void begin_array(std::string_view key = {}) noexcept;
+			void end_array() noexcept;
+
+			void field(std::string_view key, std::string_view value) noexcept;
+			void field(std::string_view key, const char* value) noexcept;
+			template <typename T> requires std::integral<T> || std::floating_point<T>
+			void field(std::string_view key, T value) noexcept {
+				if (overflow_depth != 0) {
+					return;
+				}
+				write_key(key);
+				if constexpr (std::same_as<T, bool>) {
+					write_bool(value);
+				} else if constexpr (std::floating_point<T>) {
+					write_double(static_cast<double>(value));
+				} else if constexpr (std::signed_integral<T>) {
+					write_int(static_cast<int64_t>(value));
+				} else {
+					write_uint(static_cast<uint64_t>(value));
+				}
+				end_value();
+			}
+
+			// array elements
+			template <typename T>
+			void value(T v) noexcept {
+				field({}, v);
+			}
+
+			void flush() noexcept;
+			// by default every completed top level value is written out, streaming callers can batch them instead
+			void flush_each_value(bool enable) noexcept;
+			[[nodiscard]] output_format format() const noexcept;
+			// set once a write to the fd failed, later output is dropped
+			[[nodiscard]] bool failed() const noexcept;
+		private:
+			struct frame {
+				bool array = false;
+				bool first = true;
+			};
+			static constexpr size_t MAX_DEPTH = 32;
+			static constexpr size_t FLUSH_SIZE = 64 * 1024;
+			// covers a full spd or a small cpuinfo without regrowing
+			static constexpr size_t STRING_RESERVE_SIZE = 2048;
+
+			void write_key(std::string_view key) noexcept;
+			void end_value() noexcept;
+			void begin_container(std::string_view key, bool array) noexcept;
+			void end_container() noexcept;
+			void write_string(std::string_view str) noexcept;
+			void write_uint(uint64_t value) noexcept;
+			void write_int(int64_t value) noexcept;
+			void write_double(double value) noexcept;
+			void write_bool(bool value) noexcept;
+			void write_cbor_head(uint8_t major, uint64_t value) noexcept;
+			void write_indent() noexcept;
+			void put(std::string_view str) noexcept {
+				if (out != nullptr) {
+					out->append(str);
+				} else {
+					buffer.insert(buffer.end(), str.begin(), str.end());
+				}
+			}
+
+			void put(char c) noexcept {
+				if (out != nullptr) {
+					out->push_back(c);
+				} else {
+					buffer.push_back(c);
+				}
+			}
+
+			int fd = -1;
+			std::string* out = nullptr;
+			output_format output;
+			std::vector<char> buffer;
+			std::array<frame, MAX_DEPTH> frames;
+			size_t depth = 0;
+			// begins past MAX_DEPTH, their ends are matched before any frame is popped
+			size_t overflow_depth = 0;
+			bool write_failed = false;
+			bool flush_values = true;
+	};
+} // namespace hwctrl::util
@@ -0,0 +1,361 @@
+#include <control/cpufreq.hpp>
+#include <util/file.hpp>
+#include <util/sysfs.hpp>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <map>
+
+namespace hwctrl::control {
+	cpufreq_policy::cpufreq_policy() noexcept = default;
+	cpufreq_policy::cpufreq_policy(const cpufreq_policy& other) = default;
+	cpufreq_policy::cpufreq_policy(cpufreq_policy&& other) noexcept = default;
+	cpufreq_policy& cpufreq_policy::operator=(const cpufreq_policy& other) = default;
+	cpufreq_policy& cpufreq_policy::operator=(cpufreq_policy&& other) noexcept = default;
+	cpufreq_policy::~cpufreq_policy() noexcept = default;
+
+	[[nodiscard]] static std::vector<std::string> split_words(std::string_view str) noexcept {
+		std::vector<std::string> words{};
+		while (!str.empty()) {
+			auto start = str.find_first_not_of(' ');
+			if (start == std::string_view::npos) {
+				break;
+			}
+			str.remove_prefix(start);
+			auto end = str.find(' ');
+			words.emplace_back(str.substr(0, end));
+			str.remove_prefix(end == std::string_view::npos ? str.size() : end);
+		}
+		return words;
+	}
+
+	[[nodiscard]] static std::variant<cpufreq_policy, hwctrl_error> read_cpufreq_policy(const std::filesystem::path& path) noexcept {
+		cpufreq_policy policy{};
+		policy.path = path;
+		auto governor = util::sysfs::read_string(path / "scaling_governor");
+		if (auto* err_ptr = std::get_if<hwctrl_error>(&governor)) {
+			return std::move(*err_ptr);
+		}
+		policy.governor = std::move(std::get<std::string>(governor));
+		for (auto [name, member] : {std::pair{"scaling_min_freq", &cpufreq_policy::min_khz}, {"scaling_max_freq", &cpufreq_policy::max_khz}}) {
+			auto value = util::sysfs::read_uint(path / name);
+			if (auto* err_ptr = std::get_if<hwctrl_error>(&value)) {
+				return std::move(*err_ptr);
+			}
+			policy.*member = std::get<uint64_t>(value);
+		}
+		// optional attributes, not every driver has them
+		if (auto value = util::sysfs::read_uint(path / "cpuinfo_min_freq"); std::holds_alternative<uint64_t>(value)) {
+			policy.hardware_min_khz = std::get<uint64_t>(value);
+		}
+		if (auto value = util::sysfs::read_uint(path / "cpuinfo_max_freq"); std::holds_alternative<uint64_t>(value)) {
+			policy.hardware_max_khz = std::get<uint64_t>(value);
+		}
+		if (auto value = util::sysfs::read_string(path / "scaling_driver"); std::holds_alternative<std::string>(value)) {
+			policy.driver = std::move(std::get<std::string>(value));
+		}
+		if (auto value = util::sysfs::read_string(path / "scaling_available_governors"); std::holds_alternative<std::string>(value)) {
+			policy.available_governors = split_words(std::get<std::string>(value));
+		}
+		if (auto value = util::sysfs::read_string(path / "energy_performance_preference"); std::holds_alternative<std::string>(value)) {
+			policy.epp = std::move(std::get<std::string>(value));
+		}
+		if (auto value = util::sysfs::read_string(path / "energy_performance_available_preferences"); std::holds_alternative<std::string>(value)) {
+			policy.available_epps = split_words(std::get<std::string>(value));
+		}
+		// affected_cpus is space separated, unlike the cpulist files
+		if (auto value = util::sysfs::read_string(path / "affected_cpus"); std::holds_alternative<std::string>(value)) {
+			for (const auto& word : split_words(std::get<std::string>(value))) {
+				uint32_t cpu = 0;
+				auto [ptr, ec] = std::from_chars(word.data(), word.data() + word.size(), cpu);
+				if (ec == std::errc{}) {
+					policy.cpus.push_back(cpu);
+				}
+			}
+		}
+		return policy;
+	}
+
+	[[nodiscard]] std::variant<std::vector<cpufreq_policy>, hwctrl_error> read_cpufreq_policies(const std::filesystem::path& sysfs_root, std::span<const uint32_t> cpus) noexcept {
+		// policy directory to the selected cpus it covers
+		std::map<std::filesystem::path, std::vector<uint32_t>> policy_cpus{};
+		for (auto cpu : cpus) {
+			auto path = sysfs_root / "devices/system/cpu" / ("cpu" + std::to_string(cpu)) / "cpufreq";
+			// cpuN/cpufreq links to the shared policyM directory
+			auto canonical = util::file::resolve(path);
+			if (!canonical.has_value()) {
+				return hwctrl_error{"error - cpu " + std::to_string(cpu) + " has no cpufreq policy at \"" + path.string() + "\""};
+			}
+			policy_cpus[*canonical].push_back(cpu);
+		}
+		std::vector<cpufreq_policy> policies{};
+		for (auto& [path, selected] : policy_cpus) {
+			auto policy = read_cpufreq_policy(path);
+			if (auto* err_ptr = std::get_if<hwctrl_error>(&policy)) {
+				return std::move(*err_ptr);
+			}
+			auto& entry = std::get<cpufreq_policy>(policy);
+			if (entry.cpus.empty()) {
+				entry.cpus = std::move(selected);
+			}
+			policies.push_back(std::move(entry));
+		}
+		std::sort(policies.begin(), policies.end(), [](const cpufreq_policy& a, const cpufreq_policy& b) noexcept {
+			return a.cpus.front() < b.cpus.front();
+		});
+		return policies;
+	}
+
+	[[nodiscard]] std::variant<frequency_setting, hwctrl_error> parse_frequency(std::string_view str) noexcept {
+		if (str == "min") {
+			return frequency_setting{frequency_setting::HARDWARE_MIN, 0};
+		}
+		if (str == "max") {
+			return frequency_setting{frequency_setting::HARDWARE_MAX, 0};
+		}
+		double value = 0;
+		auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+		if (ec != std::errc{} || value <= 0) {
+			return hwctrl_error{"error - invalid frequency \"" + std::string(str) + "\""};
+		}
+		std::string unit{ptr, str.data() + str.size()};
+		std::transform(unit.begin(), unit.end(), unit.begin(), [](char c) noexcept {
+			return static_cast<char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+		});
+		double multiplier = 0;
+		if (unit.empty() || unit == "khz") {
+			multiplier = 1;
+		} else if (unit == "mhz") {
+			multiplier = 1e3;
+		} else if (unit == "ghz") {
+			multiplier = 1e6;
+		} else {
+			return hwctrl_error{"error - unknown frequency unit in \"" + std::string(str) + "\", expected khz, mhz or ghz"};
+		}
+		return frequency_setting{frequency_setting::KHZ, static_cast<uint64_t>(std::llround(value * multiplier))};
+	}
+
+	[[nodiscard]] uint64_t resolve_frequency(const cpufreq_policy& policy, const frequency_setting& setting) noexcept {
+		switch (setting.kind) {
+			case frequency_setting::HARDWARE_MIN:
+				return policy.hardware_min_khz;
+			case frequency_setting::HARDWARE_MAX:
+				return policy.hardware_max_khz;
+			case frequency_setting::KHZ:
+				//[[fallthrough]]
+			default:
+				return setting.khz;
+		}
+	}
+
+	[[nodiscard]] static std::string policy_name(const cpufreq_policy& policy) noexcept {
+		return policy.path.filename().string() + " (cpus " + util::sysfs::id_list_string(policy.cpus) + ")";
+	}
+
+	[[nodiscard]] std::optional<hwctrl_error> validate_cpufreq_settings(std::span<const cpufreq_policy> policies, const cpufreq_settings& settings) noexcept {
+		for (const auto& policy : policies) {
+			if (settings.governor.has_value() && !policy.available_governors.empty()
+				&& std::find(policy.available_governors.begin(), policy.available_governors.end(), settings.governor.value()) == policy.available_governors.end()) {
+				return hwctrl_error{"error - governor \"" + settings.governor.value() + "\" is not available for " + policy_name(policy)};
+			}
+			uint64_t min_khz = settings.min.has_value() ? resolve_frequency(policy, settings.min.value()) : policy.min_khz;
+			uint64_t max_khz = settings.max.has_value() ? resolve_frequency(policy, settings.max.value()) : policy.max_khz;
+			if ((settings.min.has_value() && min_khz == 0) || (settings.max.has_value() && max_khz == 0)) {
+				return hwctrl_error{"error - " + policy_name(policy) + " reports no hardware frequency limits"};
+			}
+			for (auto khz : {min_khz, max_khz}) {
+				if (policy.hardware_max_khz != 0 && (khz < policy.hardware_min_khz || khz > policy.hardware_max_khz)) {
+					return hwctrl_error{"error - " + std::to_string(khz) + " khz is outside " + std::to_string(policy.hardware_min_khz) + "-" + std::to_string(policy.hardware_max_khz) + " khz of " + policy_name(policy)};
+				}
+			}
+			if (min_khz > max_khz) {
+				return hwctrl_error{"error - minimum " + std::to_string(min_khz) + " khz is above maximum " + std::to_string(max_khz) + " khz for " + policy_name(policy)};
+			}
+			if (settings.epp.has_value()) {
+				const auto& epp = settings.epp.value();
+				if (policy.epp.empty()) {
+					return hwctrl_error{"error - " + policy_name(policy) + " has no energy_performance_preference (driver " + policy.driver + ")"};
+				}
+				uint32_t raw = 0;
+				auto [ptr, ec] = std::from_chars(epp.data(), epp.data() + epp.size(), raw);
+				bool numeric = ec == std::errc{} && ptr == epp.data() + epp.size() && raw <= 255;
+				if (!numeric && !policy.available_epps.empty() && std::find(policy.available_epps.begin(), policy.available_epps.end(), epp) == policy.available_epps.end()) {
+					return hwctrl_error{"error - energy performance preference \"" + epp + "\" is not available for " + policy_name(policy)};
+				}
+				// intel_pstate pins epp while the performance governor is active and rejects writes with EBUSY
+				const auto& governor = settings.governor.has_value() ? settings.governor.value() : policy.governor;
+				if (policy.driver == "intel_pstate" && governor == "performance" && epp != "performance") {
+					return hwctrl_error{"error - intel_pstate only accepts epp \"performance\" under the performance governor, use --governor powersave for " + policy_name(policy)};
+				}
+			}
+		}
+		return std::nullopt;
+	}
+
+	[[nodiscard]] std::vector<attribute_value> cpufreq_journal(std::span<const cpufreq_policy> policies) noexcept {
+		std::vector<attribute_value> attributes{};
+		for (const auto& policy : policies) {
+			// governor first, switching it resets epp on intel_pstate
+			attributes.push_back({policy.path / "scaling_governor", policy.governor});
+			attributes.push_back({policy.path / "scaling_min_freq", std::to_string(policy.min_khz)});
+			attributes.push_back({policy.path / "scaling_max_freq", std::to_string(policy.max_khz)});
+			if (!policy.epp.empty()) {
+				attributes.push_back({policy.path / "energy_performance_preference", policy.epp});
+			}
+		}
+		return attributes;
+	}
+
+	[[nodiscard]] static std::optional<hwctrl_error> write_attribute(cpufreq_apply_result& result, std::string_view name, const std::string& value) noexcept {
+		if (auto err = util::sysfs::write_string(result.before.path / name, value)) {
+			return err;
+		}
+		result.changed.emplace_back(name);
+		return std::nullopt;
+	}
+
+	[[nodiscard]] static std::optional<hwctrl_error> apply_policy(cpufreq_apply_result& result, const cpufreq_settings& settings) noexcept {
+		const auto& policy = result.before;
+		if (settings.governor.has_value() && settings.governor.value() != policy.governor) {
+			if (auto err = write_attribute(result, "scaling_governor", settings.governor.value())) {
+				return err;
+			}
+		}
+		uint64_t min_khz = settings.min.has_value() ? resolve_frequency(policy, settings.min.value()) : policy.min_khz;
+		uint64_t max_khz = settings.max.has_value() ? resolve_frequency(policy, settings.max.value()) : policy.max_khz;
+		auto write_min = [&]() noexcept -> std::optional<hwctrl_error> {
+			return min_khz != policy.min_khz ? write_attribute(result, "scaling_min_freq", std::to_string(min_khz)) : std::nullopt;
+		};
+		auto write_max = [&]() noexcept -> std::optional<hwctrl_error> {
+			return max_khz != policy.max_khz ? write_attribute(result, "scaling_max_freq", std::to_string(max_khz)) : std::nullopt;
+		};
+		// a new minimum above the old maximum needs the maximum raised first
+		if (min_khz > policy.max_khz) {
+			if (auto err = write_max()) {
+				return err;
+			}
+			if (auto err = write_min()) {
+				return err;
+			}
+		} else {
+			if (auto err = write_min()) {
+				return err;
+			}
+			if (auto err = write_max()) {
+				return err;
+			}
+		}
+		if (settings.epp.has_value()) {
+			// re-read, a governor switch may have changed it
+			auto current = util::sysfs::read_string(policy.path / "energy_performance_preference");
+			const auto* current_ptr = std::get_if<std::string>(&current);
+			if (current_ptr == nullptr || *current_ptr != settings.epp.value()) {
+				if (auto err = write_attribute(result, "energy_performance_preference", settings.epp.value())) {
+					return err;
+				}
+			}
+		}
+
+		auto after = read_cpufreq_policy(policy.path);
+		if (auto* err_ptr = std::get_if<hwctrl_error>(&after)) {
+			return std::move(*err_ptr);
+		}
+		result.after = std::move(std::get<cpufreq_policy>(after));
+		result.after.cpus = policy.cpus;
+		auto mismatch = [&](std::string_view name, const std::string& actual, const std::string& expected) noexcept {
+			return hwctrl_error{"error - " + std::string(name) + " of " + policy_name(policy) + " reads \"" + actual + "\" instead of \"" + expected + "\""};
+		};
+		if (settings.governor.has_value() && result.after.governor != settings.governor.value()) {
+			return mismatch("scaling_governor", result.after.governor, settings.governor.value());
+		}
+		// the kernel clamps to limits from thermal or platform qos without failing the write
+		if (result.after.min_khz != min_khz) {
+			return mismatch("scaling_min_freq", std::to_string(result.after.min_khz), std::to_string(min_khz));
+		}
+		if (result.after.max_khz != max_khz) {
+			return mismatch("scaling_max_freq", std::to_string(result.after.max_khz), std::to_string(max_khz));
+		}
+		if (settings.epp.has_value() && result.after.epp != settings.epp.value()) {
+			return mismatch("energy_performance_preference", result.after.epp, settings.epp.value());
+		}
+		return std::nullopt;
+	}
+
+	[[nodiscard]] std::vector<cpufreq_apply_result> apply_cpufreq(std::span<const cpufreq_policy> policies, const cpufreq_settings& settings, util::thread_pool& pool) noexcept {
+		std::vector<cpufreq_apply_result> results(policies.size());
+		for (size_t i = 0; i < policies.size(); i++) {
+			results[i].before = policies[i];
+			results[i].after = policies[i];
+			pool.submit([&result = results[i], &settings]() noexcept {
+				result.error = apply_policy(result, settings);
+			});
+		}
+		pool.wait();
+		return results;
+	}
+
+	static void write_policy_fields(util::writer& out, const cpufreq_policy& policy) noexcept {
+		out.field("governor", policy.governor);
+		out.field("min_khz", policy.min_khz);
+		out.field("max_khz", policy.max_khz);
+		if (!policy.epp.empty()) {
+			out.field("epp", policy.epp);
+		}
+	}
+
+	void write_cpufreq_policies(util::writer& out, std::span<const cpufreq_policy> policies) noexcept {
+		out.begin_object();
+		out.begin_array("policies");
+		for (const auto& policy : policies) {
+			out.begin_object();
+			out.field("policy", policy.path.filename().string());
+			out.field("cpus", util::sysfs::id_list_string(policy.cpus));
+			out.field("driver", policy.driver);
+			write_policy_fields(out, policy);
+			out.field("hardware_min_khz", policy.hardware_min_khz);
+			out.field("hardware_max_khz", policy.hardware_max_khz);
+			out.begin_array("available_governors");
+			for (const auto& governor : policy.available_governors) {
+				out.value(governor);
+			}
+			out.end_array();
+			if (!policy.available_epps.empty()) {
+				out.begin_array("available_epps");
+				for (const auto& epp : policy.available_epps) {
+					out.value(epp);
+				}
+				out.end_array();
+			}
+			out.end_object();
+		}
+		out.end_array();
+		out.end_object();
+	}
+
+	void write_cpufreq_apply_results(util::writer& out, std::span<const cpufreq_apply_result> results) noexcept {
+		out.begin_object();
+		out.begin_array("policies");
+		for (const auto& result : results) {
+			out.begin_object();
+			out.field("policy", result.before.path.filename().string());
+			out.field("cpus", util::sysfs::id_list_string(result.before.cpus));
+			out.begin_object("before");
+			write_policy_fields(out, result.before);
+			out.end_object();
+			out.begin_object("after");
+			write_policy_fields(out, result.after);
+			out.end_object();
+			out.begin_array("changed");
+			for (const auto& name : result.changed) {
+				out.value(name);
+			}
+			out.end_array();
+			if (result.error.has_value()) {
+				out.field("error", result.error->message);
+			}
+			out.end_object();
+		}
+		out.end_array();
+		out.end_object();
+	}
+} // namespace hwctrl::control
@@ -0,0 +1,179 @@
+#include <control/cpuidle.hpp>
+#include <util/snapshot.hpp>
+#include <util/sysfs.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace hwctrl::control {
+	pm_qos_hold::pm_qos_hold(util::file::unique_fd file) noexcept : fd(std::move(file)) {
+	}
+
+	[[nodiscard]] std::variant<int32_t, hwctrl_error> pm_qos_hold::effective_latency_us() const noexcept {
+		int32_t value = 0;
+		if (::pread(fd.get(), &value, sizeof(value), 0) != static_cast<ssize_t>(sizeof(value))) {
+			return hwctrl_error{"error - could not read the pm qos latency: " + std::string(std::strerror(errno))};
+		}
+		return value;
+	}
+
+	[[nodiscard]] static std::filesystem::path cpuidle_path(const std::filesystem::path& sysfs_root, uint32_t cpu) noexcept {
+		return sysfs_root / "devices/system/cpu" / ("cpu" + std::to_string(cpu)) / "cpuidle";
+	}
+
+	[[nodiscard]] static std::filesystem::path disable_path(const std::filesystem::path& sysfs_root, uint32_t cpu, uint32_t state) noexcept {
+		return cpuidle_path(sysfs_root, cpu) / ("state" + std::to_string(state)) / "disable";
+	}
+
+	[[nodiscard]] std::variant<std::vector<cpu_idle_states>, hwctrl_error> read_cpuidle_states(const std::filesystem::path& sysfs_root, std::span<const uint32_t> cpus) noexcept {
+		std::vector<cpu_idle_states> result{};
+		result.reserve(cpus.size());
+		for (auto cpu : cpus) {
+			cpu_idle_states entry{};
+			entry.cpu = cpu;
+			std::optional<hwctrl_error> error{};
+			util::sysfs::for_each_numbered_entry(cpuidle_path(sysfs_root, cpu), "state", [&](uint32_t index, const std::filesystem::path& path) noexcept {
+				cpuidle_state state{};
+				state.index = index;
+				auto name = util::sysfs::read_string(path / "name");
+				auto latency = util::sysfs::read_uint(path / "latency");
+				auto residency = util::sysfs::read_uint(path / "residency");
+				if (!std::holds_alternative<std::string>(name) || !std::holds_alternative<uint64_t>(latency) || !std::holds_alternative<uint64_t>(residency)) {
+					error = hwctrl_error{"error - incomplete cpuidle state \"" + path.string() + "\""};
+					return;
+				}
+				state.name = std::move(std::get<std::string>(name));
+				state.latency_us = std::get<uint64_t>(latency);
+				state.residency_us = std::get<uint64_t>(residency);
+				if (auto description = util::sysfs::read_string(path / "desc"); std::holds_alternative<std::string>(description)) {
+					state.description = std::move(std::get<std::string>(description));
+				}
+				// the counters are optional, above and below only exist since linux 5.0
+				for (auto [file, member] : {std::pair{"usage", &cpuidle_state::usage}, {"time", &cpuidle_state::time_us}, {"above", &cpuidle_state::above}, {"below", &cpuidle_state::below}}) {
+					if (auto value = util::sysfs::read_uint(path / file); std::holds_alternative<uint64_t>(value)) {
+						state.*member = std::get<uint64_t>(value);
+					}
+				}
+				if (auto disable = util::sysfs::read_uint(path / "disable"); std::holds_alternative<uint64_t>(disable)) {
+					state.disabled = std::get<uint64_t>(disable) != 0;
+				}
+				entry.states.push_back(std::move(state));
+			});
+			if (error != std::nullopt) {
+				return std::move(error.value());
+			}
+			std::sort(entry.states.begin(), entry.states.end(), [](const cpuidle_state& a, const cpuidle_state& b) noexcept {
+				return a.index < b.index;
+			});
+			result.push_back(std::move(entry));
+		}
+		return result;
+	}
+
+	[[nodiscard]] std::vector<attribute_value> cpuidle_journal(const std::filesystem::path& sysfs_root, std::span<const cpu_idle_states> cpus, uint64_t max_latency_us) noexcept {
+		std::vector<attribute_value> attributes{};
+		for (const auto& cpu : cpus) {
+			for (const auto& state : cpu.states) {
+				if (state.latency_us > max_latency_us && !state.disabled) {
+					attributes.push_back({disable_path(sysfs_root, cpu.cpu, state.index), "0"});
+				}
+			}
+		}
+		return attributes;
+	}
+
+	[[nodiscard]] static std::optional<hwctrl_error> limit_cpu(const std::filesystem::path& sysfs_root, const cpu_idle_states& cpu, uint64_t max_latency_us, cpuidle_limit_result& result) noexcept {
+		for (const auto& state : cpu.states) {
+			if (state.latency_us <= max_latency_us || state.disabled) {
+				continue;
+			}
+			auto path = disable_path(sysfs_root, cpu.cpu, state.index);
+			if (auto err = util::sysfs::write_string(path, "1")) {
+				return err;
+			}
+			auto disable = util::sysfs::read_uint(path);
+			if (!std::holds_alternative<uint64_t>(disable) || std::get<uint64_t>(disable) == 0) {
+				return hwctrl_error{"error - state " + state.name + " of cpu " + std::to_string(cpu.cpu) + " is still enabled after writing \"" + path.string() + "\""};
+			}
+			result.disabled.push_back(state.index);
+		}
+		return std::nullopt;
+	}
+
+	[[nodiscard]] std::vector<cpuidle_limit_result> limit_cpuidle(const std::filesystem::path& sysfs_root, std::span<const cpu_idle_states> cpus, uint64_t max_latency_us, util::thread_pool& pool) noexcept {
+		std::vector<cpuidle_limit_result> results(cpus.size());
+		for (size_t i = 0; i < cpus.size(); i++) {
+			results[i].cpu = cpus[i].cpu;
+			pool.submit([&sysfs_root, &cpu = cpus[i], max_latency_us, &result = results[i]]() noexcept {
+				result.error = limit_cpu(sysfs_root, cpu, max_latency_us, result);
+			});
+		}
+		pool.wait();
+		return results;
+	}
+
+	[[nodiscard]] std::variant<pm_qos_hold, hwctrl_error> hold_pm_qos_latency(const std::filesystem::path& path, int32_t latency_us) noexcept {
+		if (auto err = util::snapshot::check_replay_write(path)) {
+			return std::move(*err);
+		}
+		util::file::unique_fd fd{::open(path.c_str(), O_RDWR | O_CLOEXEC)};
+		if (!fd.valid()) {
+			return hwctrl_error{"error - could not open \"" + path.string() + "\": " + std::string(std::strerror(errno))};
+		}
+		// the kernel takes the value as a binary s32
+		if (::write(fd.get(), &latency_us, sizeof(latency_us)) != static_cast<ssize_t>(sizeof(latency_us))) {
+			return hwctrl_error{"error - could not request " + std::to_string(latency_us) + " us from \"" + path.string() + "\": " + std::string(std::strerror(errno))};
+		}
+		return pm_qos_hold{std::move(fd)};
+	}
+
+	void write_cpuidle_states(util::writer& out, std::span<const cpu_idle_states> cpus) noexcept {
+		out.begin_object();
+		out.begin_array("cpus");
+		for (const auto& cpu : cpus) {
+			out.begin_object();
+			out.field("cpu", cpu.cpu);
+			out.begin_array("states");
+			for (const auto& state : cpu.states) {
+				out.begin_object();
+				out.field("index", state.index);
+				out.field("name", state.name);
+				out.field("description", state.description);
+				out.field("latency_us", state.latency_us);
+				out.field("residency_us", state.residency_us);
+				out.field("usage", state.usage);
+				out.field("time_us", state.time_us);
+				out.field("above", state.above);
+				out.field("below", state.below);
+				out.field("disabled", state.disabled);
+				out.end_object();
+			}
+			out.end_array();
+			out.end_object();
+		}
+		out.end_array();
+		out.end_object();
+	}
+
+	void write_cpuidle_limit_results(util::writer& out, std::span<const cpuidle_limit_result> results) noexcept {
+		out.begin_object();
+		out.begin_array("cpus");
+		for (const auto& result : results) {
+			out.begin_object();
+			out.field("cpu", result.cpu);
+			out.begin_array("disabled_states");
+			for (auto index : result.disabled) {
+				out.value(index);
+			}
+			out.end_array();
+			if (result.error.has_value()) {
+				out.field("error", result.error->message);
+			}
+			out.end_object();
+		}
+		out.end_array();
+		out.end_object();
+	}
+} // namespace hwctrl::control
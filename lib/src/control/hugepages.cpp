@@ -0,0 +1,246 @@
+#include <control/hugepages.hpp>
+#include <util/sysfs.hpp>
+#include <algorithm>
+#include <charconv>
+#include <tuple>
+
+namespace hwctrl::control {
+	[[nodiscard]] const hugepage_pool* hugepage_state::find(uint32_t node, uint64_t page_kib) const noexcept {
+		for (const auto& pool : pools) {
+			if (pool.node == node && pool.page_kib == page_kib) {
+				return &pool;
+			}
+		}
+		return nullptr;
+	}
+
+	[[nodiscard]] std::variant<uint64_t, hwctrl_error> parse_byte_size(std::string_view str) noexcept {
+		uint64_t value = 0;
+		auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+		if (ec != std::errc{} || value == 0) {
+			return hwctrl_error{"error - invalid size \"" + std::string(str) + "\""};
+		}
+		std::string unit{ptr, str.data() + str.size()};
+		std::transform(unit.begin(), unit.end(), unit.begin(), [](char c) noexcept {
+			return static_cast<char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+		});
+		// page sizes are powers of two, so every unit is binary
+		uint32_t shift = 0;
+		if (unit.empty() || unit == "b") {
+			shift = 0;
+		} else if (unit == "k" || unit == "kb" || unit == "kib") {
+			shift = 10;
+		} else if (unit == "m" || unit == "mb" || unit == "mib") {
+			shift = 20;
+		} else if (unit == "g" || unit == "gb" || unit == "gib") {
+			shift = 30;
+		} else if (unit == "t" || unit == "tb" || unit == "tib") {
+			shift = 40;
+		} else {
+			return hwctrl_error{"error - unknown size unit in \"" + std::string(str) + "\", expected k, m, g or t"};
+		}
+		if (value > (UINT64_MAX >> shift)) {
+			return hwctrl_error{"error - size \"" + std::string(str) + "\" is too large"};
+		}
+		return value << shift;
+	}
+
+	[[nodiscard]] std::string_view selected_mode(std::string_view str) noexcept {
+		auto begin = str.find('[');
+		auto end = str.find(']', begin);
+		if (begin == std::string_view::npos || end == std::string_view::npos) {
+			return str;
+		}
+		return str.substr(begin + 1, end - begin - 1);
+	}
+
+	[[nodiscard]] static std::filesystem::path pool_path(const std::filesystem::path& sysfs_root, uint32_t node, uint64_t page_kib) noexcept {
+		return sysfs_root / "devices/system/node" / ("node" + std::to_string(node)) / "hugepages" / ("hugepages-" + std::to_string(page_kib) + "kB");
+	}
+
+	// extracts 2048 from "hugepages-2048kB"
+	[[nodiscard]] static std::optional<uint64_t> parse_pool_name(std::string_view name) noexcept {
+		constexpr std::string_view PREFIX = "hugepages-";
+		constexpr std::string_view SUFFIX = "kB";
+		if (name.size() <= PREFIX.size() + SUFFIX.size() || name.substr(0, PREFIX.size()) != PREFIX || name.substr(name.size() - SUFFIX.size()) != SUFFIX) {
+			return std::nullopt;
+		}
+		uint64_t page_kib = 0;
+		const auto* end = name.data() + name.size() - SUFFIX.size();
+		auto [ptr, ec] = std::from_chars(name.data() + PREFIX.size(), end, page_kib);
+		if (ec != std::errc{} || ptr != end) {
+			return std::nullopt;
+		}
+		return page_kib;
+	}
+
+	[[nodiscard]] static thp_status read_thp_status(const std::filesystem::path& sysfs_root) noexcept {
+		auto dir = sysfs_root / "kernel/mm/transparent_hugepage";
+		thp_status thp{};
+		for (auto [file, member] : {std::pair{"enabled", &thp_status::enabled}, {"defrag", &thp_status::defrag}, {"shmem_enabled", &thp_status::shmem_enabled}}) {
+			if (auto value = util::sysfs::read_string(dir / file); std::holds_alternative<std::string>(value)) {
+				thp.*member = std::string(selected_mode(std::get<std::string>(value)));
+				thp.available = true;
+			}
+		}
+		if (auto size = util::sysfs::read_uint(dir / "hpage_pmd_size"); std::holds_alternative<uint64_t>(size)) {
+			thp.pmd_size_bytes = std::get<uint64_t>(size);
+		}
+		return thp;
+	}
+
+	[[nodiscard]] std::variant<hugepage_state, hwctrl_error> read_hugepages(const std::filesystem::path& sysfs_root) noexcept {
+		hugepage_state state{};
+		std::optional<hwctrl_error> error{};
+		util::sysfs::for_each_numbered_entry(sysfs_root / "devices/system/node", "node", [&](uint32_t node, const std::filesystem::path& node_path) noexcept {
+			for (const auto& name : util::file::list_directory(node_path / "hugepages")) {
+				auto page_kib = parse_pool_name(name);
+				if (!page_kib.has_value()) {
+					continue;
+				}
+				hugepage_pool pool{};
+				pool.node = node;
+				pool.page_kib = *page_kib;
+				auto pool_dir = node_path / "hugepages" / name;
+				auto total = util::sysfs::read_uint(pool_dir / "nr_hugepages");
+				auto free = util::sysfs::read_uint(pool_dir / "free_hugepages");
+				if (!std::holds_alternative<uint64_t>(total) || !std::holds_alternative<uint64_t>(free)) {
+					error = hwctrl_error{"error - incomplete hugepage pool \"" + pool_dir.string() + "\""};
+					return;
+				}
+				pool.total = std::get<uint64_t>(total);
+				pool.free = std::get<uint64_t>(free);
+				if (auto surplus = util::sysfs::read_uint(pool_dir / "surplus_hugepages"); std::holds_alternative<uint64_t>(surplus)) {
+					pool.surplus = std::get<uint64_t>(surplus);
+				}
+				state.pools.push_back(pool);
+			}
+		});
+		if (error != std::nullopt) {
+			return std::move(error.value());
+		}
+		if (state.pools.empty()) {
+			return hwctrl_error{"error - no hugepage pools in \"" + (sysfs_root / "devices/system/node").string() + "\", the kernel needs numa and hugetlbfs support"};
+		}
+		std::sort(state.pools.begin(), state.pools.end(), [](const hugepage_pool& a, const hugepage_pool& b) noexcept {
+			return std::tie(a.node, a.page_kib) < std::tie(b.node, b.page_kib);
+		});
+		state.thp = read_thp_status(sysfs_root);
+		return state;
+	}
+
+	[[nodiscard]] std::vector<attribute_value> hugepage_journal(const std::filesystem::path& sysfs_root, const hugepage_state& state, std::span<const uint32_t> nodes, uint64_t page_kib) noexcept {
+		std::vector<attribute_value> attributes{};
+		for (auto node : nodes) {
+			if (const auto* pool = state.find(node, page_kib); pool != nullptr) {
+				attributes.push_back({pool_path(sysfs_root, node, page_kib) / "nr_hugepages", std::to_string(pool->total)});
+			}
+		}
+		return attributes;
+	}
+
+	[[nodiscard]] static std::optional<hwctrl_error> resize_pool(const std::filesystem::path& path, uint64_t pages, uint64_t& allocated) noexcept {
+		if (auto err = util::sysfs::write_string(path, std::to_string(pages))) {
+			return err;
+		}
+		// the write succeeds with whatever the kernel managed to allocate, only the read back tells
+		auto total = util::sysfs::read_uint(path);
+		if (const auto* err_ptr = std::get_if<hwctrl_error>(&total)) {
+			return *err_ptr;
+		}
+		allocated = std::get<uint64_t>(total);
+		return std::nullopt;
+	}
+
+	static void set_node(const std::filesystem::path& sysfs_root, uint64_t pages, bool compact, hugepage_set_result& result) noexcept {
+		auto path = pool_path(sysfs_root, result.node, result.page_kib) / "nr_hugepages";
+		if ((result.error = resize_pool(path, pages, result.allocated))) {
+			return;
+		}
+		if (result.allocated < pages && compact) {
+			// free blocks are too scattered for a contiguous page, defragment the node and try once more
+			auto compact_path = sysfs_root / "devices/system/node" / ("node" + std::to_string(result.node)) / "compact";
+			if (!util::sysfs::write_string(compact_path, "1").has_value()) {
+				result.compacted = true;
+				if ((result.error = resize_pool(path, pages, result.allocated))) {
+					return;
+				}
+			}
+		}
+		if (result.allocated < pages) {
+			result.error = hwctrl_error{"error - node " + std::to_string(result.node) + " reserved " + std::to_string(result.allocated) + " of " + std::to_string(pages) + " " + std::to_string(result.page_kib) + " kB pages, the rest of its memory is in use or too fragmented"};
+		}
+	}
+
+	[[nodiscard]] std::vector<hugepage_set_result> set_hugepages(const std::filesystem::path& sysfs_root, const hugepage_state& state, std::span<const uint32_t> nodes, uint64_t page_kib, uint64_t pages, bool compact, util::thread_pool& pool) noexcept {
+		std::vector<hugepage_set_result> results(nodes.size());
+		for (size_t i = 0; i < nodes.size(); i++) {
+			auto& result = results[i];
+			result.node = nodes[i];
+			result.page_kib = page_kib;
+			result.requested = pages;
+			const auto* current = state.find(nodes[i], page_kib);
+			if (current == nullptr) {
+				result.error = hwctrl_error{"error - node " + std::to_string(nodes[i]) + " has no " + std::to_string(page_kib) + " kB hugepage pool"};
+				continue;
+			}
+			result.previous = current->total;
+			result.allocated = current->total;
+			if (current->total == pages) {
+				continue;
+			}
+			pool.submit([&sysfs_root, pages, compact, &result]() noexcept {
+				set_node(sysfs_root, pages, compact, result);
+			});
+		}
+		pool.wait();
+		return results;
+	}
+
+	void write_hugepages(util::writer& out, const hugepage_state& state) noexcept {
+		out.begin_object();
+		out.begin_array("pools");
+		for (const auto& pool : state.pools) {
+			out.begin_object();
+			out.field("node", pool.node);
+			out.field("page_kib", pool.page_kib);
+			out.field("total", pool.total);
+			out.field("free", pool.free);
+			out.field("surplus", pool.surplus);
+			out.field("total_bytes", pool.total * pool.page_kib << 10u);
+			out.end_object();
+		}
+		out.end_array();
+		out.begin_object("thp");
+		out.field("available", state.thp.available);
+		if (state.thp.available) {
+			out.field("enabled", state.thp.enabled);
+			out.field("defrag", state.thp.defrag);
+			out.field("shmem_enabled", state.thp.shmem_enabled);
+			out.field("pmd_size_bytes", state.thp.pmd_size_bytes);
+		}
+		out.end_object();
+		out.end_object();
+	}
+
+	void write_hugepage_set_results(util::writer& out, std::span<const hugepage_set_result> results) noexcept {
+		out.begin_object();
+		out.begin_array("pools");
+		for (const auto& result : results) {
+			out.begin_object();
+			out.field("node", result.node);
+			out.field("page_kib", result.page_kib);
+			out.field("previous", result.previous);
+			out.field("requested", result.requested);
+			out.field("allocated", result.allocated);
+			out.field("shortfall", result.requested > result.allocated ? result.requested - result.allocated : uint64_t{0});
+			out.field("compacted", result.compacted);
+			if (result.error.has_value()) {
+				out.field("error", result.error->message);
+			}
+			out.end_object();
+		}
+		out.end_array();
+		out.end_object();
+	}
+} // namespace hwctrl::control
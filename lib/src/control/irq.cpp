@@ -0,0 +1,253 @@
+#include <control/irq.hpp>
+#include <util/file.hpp>
+#include <util/snapshot.hpp>
+#include <util/sysfs.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace hwctrl::control {
+	[[nodiscard]] static std::filesystem::path irq_path(const std::filesystem::path& proc_root, uint32_t irq) noexcept {
+		return proc_root / "irq" / std::to_string(irq);
+	}
+
+	[[nodiscard]] static std::vector<uint32_t> read_id_list(const std::filesystem::path& path) noexcept {
+		auto str = util::sysfs::read_string(path);
+		if (!std::holds_alternative<std::string>(str)) {
+			return {};
+		}
+		auto ids = util::sysfs::parse_id_list(std::get<std::string>(str));
+		return std::holds_alternative<std::vector<uint32_t>>(ids) ? std::move(std::get<std::vector<uint32_t>>(ids)) : std::vector<uint32_t>{};
+	}
+
+	[[nodiscard]] static bool matches_filter(std::string_view actions, std::string_view filter) noexcept {
+		if (filter.empty()) {
+			return true;
+		}
+		while (true) {
+			auto end = filter.find(',');
+			auto pattern = filter.substr(0, end);
+			if (!pattern.empty() && actions.find(pattern) != std::string_view::npos) {
+				return true;
+			}
+			if (end == std::string_view::npos) {
+				return false;
+			}
+			filter.remove_prefix(end + 1);
+		}
+	}
+
+	[[nodiscard]] std::vector<irq_info> read_irqs(const std::filesystem::path& proc_root, const source::interrupts& interrupts, std::string_view filter) noexcept {
+		std::vector<irq_info> irqs{};
+		for (const auto& line : interrupts.lines) {
+			// irqs without a handler have nothing to place
+			if (line.irq == source::interrupt_line::NOT_A_NUMBER || line.actions.empty() || !matches_filter(line.actions, filter)) {
+				continue;
+			}
+			auto path = irq_path(proc_root, line.irq);
+			irq_info info{};
+			info.irq = line.irq;
+			info.actions = line.actions;
+			info.affinity = read_id_list(path / "smp_affinity_list");
+			if (info.affinity.empty()) {
+				// freed since /proc/interrupts was read
+				continue;
+			}
+			info.effective_affinity = read_id_list(path / "effective_affinity_list");
+			// -1 for devices without numa affinity does not parse and stays unknown
+			if (auto node = util::sysfs::read_uint(path / "node"); std::holds_alternative<uint64_t>(node)) {
+				info.node = static_cast<uint32_t>(std::get<uint64_t>(node));
+			}
+			for (auto count : line.counts) {
+				info.count += count;
+			}
+			irqs.push_back(std::move(info));
+		}
+		return irqs;
+	}
+
+	[[nodiscard]] std::vector<uint32_t> read_isolated_cpus(const std::filesystem::path& sysfs_root) noexcept {
+		return read_id_list(sysfs_root / "devices/system/cpu/isolated");
+	}
+
+	[[nodiscard]] std::variant<std::vector<irq_assignment>, hwctrl_error> plan_irqs(const source::cpu_topology& topology, std::span<const irq_info> irqs, const irq_plan_options& options) noexcept {
+		std::vector<bool> excluded(topology.cpus.size(), false);
+		for (auto cpu : options.isolated) {
+			if (cpu >= excluded.size()) {
+				continue;
+			}
+			excluded[cpu] = true;
+			for (auto sibling : topology.smt_siblings(cpu)) {
+				excluded[sibling] = true;
+			}
+		}
+		std::vector<size_t> position(topology.cpus.size(), SIZE_MAX);
+		auto order = source::spread_cpus(topology);
+		for (size_t i = 0; i < order.size(); i++) {
+			position[order[i]] = i;
+		}
+
+		// physical cores with at least one usable cpu
+		struct core_slot {
+			std::vector<uint32_t> cpus{};
+			uint32_t node = source::cpu_topology::UNKNOWN_ID;
+			size_t position = SIZE_MAX;
+			size_t load = 0;
+		};
+		std::vector<core_slot> cores{};
+		std::map<uint64_t, size_t> core_by_key{};
+		for (auto cpu : options.cpus) {
+			if (!topology.online(cpu) || excluded[cpu]) {
+				continue;
+			}
+			const auto& entry = topology.cpus[cpu];
+			// cpus without core information are cores of their own
+			uint64_t key = entry.core_index != source::cpu_topology::UNKNOWN_ID ? entry.core_index : (uint64_t{1} << 32u) + cpu;
+			auto [it, inserted] = core_by_key.try_emplace(key, cores.size());
+			if (inserted) {
+				cores.emplace_back();
+				cores.back().node = entry.numa_node_id;
+			}
+			auto& core = cores[it->second];
+			core.cpus.push_back(cpu);
+			core.position = std::min(core.position, position[cpu]);
+		}
+		if (cores.empty()) {
+			return hwctrl_error{"error - no cpus left for irqs after removing isolated cores and their smt siblings"};
+		}
+
+		std::vector<size_t> cpu_load(topology.cpus.size(), 0);
+		std::vector<irq_assignment> plan{};
+		plan.reserve(irqs.size());
+		for (const auto& irq : irqs) {
+			bool local_cores = irq.node != source::cpu_topology::UNKNOWN_ID && std::any_of(cores.begin(), cores.end(), [&](const core_slot& core) noexcept {
+				return core.node == irq.node;
+			});
+			core_slot* best = nullptr;
+			for (auto& core : cores) {
+				if (local_cores && core.node != irq.node) {
+					continue;
+				}
+				if (best == nullptr || std::tie(core.load, core.position) < std::tie(best->load, best->position)) {
+					best = &core;
+				}
+			}
+			// the least loaded thread of the core, the first in spread order on a tie
+			uint32_t cpu = best->cpus.front();
+			for (auto candidate : best->cpus) {
+				if (std::tie(cpu_load[candidate], position[candidate]) < std::tie(cpu_load[cpu], position[cpu])) {
+					cpu = candidate;
+				}
+			}
+			best->load++;
+			cpu_load[cpu]++;
+			irq_assignment assignment{};
+			assignment.irq = irq.irq;
+			assignment.actions = irq.actions;
+			assignment.node = irq.node;
+			assignment.current = irq.affinity;
+			assignment.cpu = cpu;
+			assignment.node_local = irq.node == source::cpu_topology::UNKNOWN_ID || best->node == irq.node;
+			plan.push_back(std::move(assignment));
+		}
+		return plan;
+	}
+
+	[[nodiscard]] static bool in_place(const irq_assignment& assignment) noexcept {
+		return assignment.current.size() == 1 && assignment.current.front() == assignment.cpu;
+	}
+
+	[[nodiscard]] std::vector<attribute_value> irq_journal(const std::filesystem::path& proc_root, std::span<const irq_assignment> plan) noexcept {
+		std::vector<attribute_value> attributes{};
+		for (const auto& assignment : plan) {
+			if (!in_place(assignment)) {
+				attributes.push_back({irq_path(proc_root, assignment.irq) / "smp_affinity_list", util::sysfs::id_list_string(assignment.current)});
+			}
+		}
+		return attributes;
+	}
+
+	static void apply_assignment(const std::filesystem::path& proc_root, const irq_assignment& assignment, irq_apply_result& result) noexcept {
+		auto path = irq_path(proc_root, assignment.irq);
+		if (!in_place(assignment)) {
+			if ((result.error = util::snapshot::check_replay_write(path / "smp_affinity_list"))) {
+				return;
+			}
+			// written directly instead of through util::sysfs to tell managed irqs (EIO) from failures
+			util::file::unique_fd fd{::open((path / "smp_affinity_list").c_str(), O_WRONLY | O_TRUNC | O_CLOEXEC)};
+			auto value = std::to_string(assignment.cpu);
+			if (!fd.valid()) {
+				result.error = hwctrl_error{"error - could not open smp_affinity_list of irq " + std::to_string(assignment.irq) + ": " + std::string(std::strerror(errno))};
+				return;
+			}
+			if (::write(fd.get(), value.data(), value.size()) != static_cast<ssize_t>(value.size())) {
+				if (errno == EIO) {
+					result.managed = true;
+				} else {
+					result.error = hwctrl_error{"error - could not move irq " + std::to_string(assignment.irq) + " to cpu " + value + ": " + std::string(std::strerror(errno))};
+				}
+			} else {
+				result.changed = true;
+			}
+		}
+		result.effective_affinity = read_id_list(path / "effective_affinity_list");
+		if (result.changed) {
+			auto affinity = read_id_list(path / "smp_affinity_list");
+			if (affinity.size() != 1 || affinity.front() != assignment.cpu) {
+				result.error = hwctrl_error{"error - irq " + std::to_string(assignment.irq) + " has affinity \"" + util::sysfs::id_list_string(affinity) + "\" instead of cpu " + std::to_string(assignment.cpu)};
+			}
+		}
+	}
+
+	[[nodiscard]] std::vector<irq_apply_result> apply_irq_plan(const std::filesystem::path& proc_root, std::span<const irq_assignment> plan, util::thread_pool& pool) noexcept {
+		std::vector<irq_apply_result> results(plan.size());
+		for (size_t i = 0; i < plan.size(); i++) {
+			results[i].irq = plan[i].irq;
+			pool.submit([&proc_root, &assignment = plan[i], &result = results[i]]() noexcept {
+				apply_assignment(proc_root, assignment, result);
+			});
+		}
+		pool.wait();
+		return results;
+	}
+
+	void write_irq_plan(util::writer& out, std::span<const irq_assignment> plan) noexcept {
+		out.begin_object();
+		out.begin_array("irqs");
+		for (const auto& assignment : plan) {
+			out.begin_object();
+			out.field("irq", assignment.irq);
+			out.field("actions", assignment.actions);
+			if (assignment.node != source::cpu_topology::UNKNOWN_ID) {
+				out.field("node", assignment.node);
+			}
+			out.field("current", util::sysfs::id_list_string(assignment.current));
+			out.field("cpu", assignment.cpu);
+			out.field("node_local", assignment.node_local);
+			out.end_object();
+		}
+		out.end_array();
+		out.end_object();
+	}
+
+	void write_irq_apply_results(util::writer& out, std::span<const irq_apply_result> results) noexcept {
+		out.begin_object();
+		out.begin_array("irqs");
+		for (const auto& result : results) {
+			out.begin_object();
+			out.field("irq", result.irq);
+			out.field("changed", result.changed);
+			out.field("managed", result.managed);
+			out.field("effective", util::sysfs::id_list_string(result.effective_affinity));
+			if (result.error.has_value()) {
+				out.field("error", result.error->message);
+			}
+			out.end_object();
+		}
+		out.end_array();
+		out.end_object();
+	}
+} // namespace hwctrl::control
@@ -0,0 +1,158 @@
+#include <control/journal.hpp>
+#include <util/file.hpp>
+#include <util/snapshot.hpp>
+#include <util/sysfs.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <set>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace hwctrl::control {
+	[[nodiscard]] std::optional<hwctrl_error> save_journal(const std::filesystem::path& path, std::span<const attribute_value> attributes) noexcept {
+		std::string contents{};
+		for (const auto& attribute : attributes) {
+			const auto& path_str = attribute.path.native();
+			if (path_str.find_first_of("\t\n") != std::string::npos || attribute.value.find_first_of("\t\n") != std::string::npos) {
+				return hwctrl_error{"error - cannot journal \"" + attribute.path.string() + "\", it contains a tab or newline"};
+			}
+			contents += path_str;
+			contents += '\t';
+			contents += attribute.value;
+			contents += '\n';
+		}
+		// a journal of values read from a snapshot describes another machine
+		if (auto err = util::snapshot::check_replay_write(path)) {
+			return err;
+		}
+		std::error_code ec;
+		if (path.has_parent_path()) {
+			std::filesystem::create_directories(path.parent_path(), ec);
+		}
+		auto temporary = path;
+		temporary += ".tmp";
+		util::file::unique_fd fd{::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600)};
+		if (!fd.valid()) {
+			return hwctrl_error{"error - could not create \"" + temporary.string() + "\": " + std::string(std::strerror(errno))};
+		}
+		size_t written = 0;
+		while (written < contents.size()) {
+			ssize_t count = ::write(fd.get(), contents.data() + written, contents.size() - written);
+			if (count < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				return hwctrl_error{"error - could not write \"" + temporary.string() + "\": " + std::string(std::strerror(errno))};
+			}
+			written += static_cast<size_t>(count);
+		}
+		if (::fsync(fd.get()) != 0 || ::rename(temporary.c_str(), path.c_str()) != 0) {
+			return hwctrl_error{"error - could not replace \"" + path.string() + "\": " + std::string(std::strerror(errno))};
+		}
+		return std::nullopt;
+	}
+
+	[[nodiscard]] std::variant<std::vector<attribute_value>, hwctrl_error> read_journal(const std::filesystem::path& path) noexcept {
+		auto file_result = util::file::read_ram_file(path);
+		if (auto* err_ptr = std::get_if<hwctrl_error>(&file_result)) {
+			return std::move(*err_ptr);
+		}
+		std::string_view contents = std::get<std::string>(file_result);
+		std::vector<attribute_value> attributes{};
+		size_t line_number = 0;
+		while (!contents.empty()) {
+			line_number++;
+			auto end = contents.find('\n');
+			auto line = contents.substr(0, end);
+			contents.remove_prefix(end == std::string_view::npos ? contents.size() : end + 1);
+			if (line.empty()) {
+				continue;
+			}
+			auto tab = line.find('\t');
+			if (tab == std::string_view::npos || tab == 0) {
+				return hwctrl_error{"error - malformed line " + std::to_string(line_number) + " in journal \"" + path.string() + "\""};
+			}
+			attributes.push_back({std::filesystem::path{line.substr(0, tab)}, std::string{line.substr(tab + 1)}});
+		}
+		return attributes;
+	}
+
+	[[nodiscard]] std::vector<attribute_value> merge_journal(std::vector<attribute_value> journal, std::span<const attribute_value> attributes) noexcept {
+		std::set<std::filesystem::path> known{};
+		for (const auto& attribute : journal) {
+			known.insert(attribute.path);
+		}
+		for (const auto& attribute : attributes) {
+			if (known.insert(attribute.path).second) {
+				journal.push_back(attribute);
+			}
+		}
+		return journal;
+	}
+
+	// writes the saved value unless the attribute already holds it, true when it was written
+	[[nodiscard]] static std::variant<bool, hwctrl_error> restore_attribute(const attribute_value& attribute) noexcept {
+		auto current = util::sysfs::read_string(attribute.path);
+		if (const auto* value_ptr = std::get_if<std::string>(&current); value_ptr != nullptr && *value_ptr == attribute.value) {
+			return false;
+		}
+		if (auto err = util::sysfs::write_string(attribute.path, attribute.value)) {
+			return std::move(err.value());
+		}
+		return true;
+	}
+
+	[[nodiscard]] restore_result restore_journal(std::span<const attribute_value> attributes, util::thread_pool& pool) noexcept {
+		// indices per directory, a directory is one device or policy whose knobs are written in order
+		std::map<std::filesystem::path, std::vector<size_t>> directories{};
+		for (size_t i = 0; i < attributes.size(); i++) {
+			directories[attributes[i].path.parent_path()].push_back(i);
+		}
+		restore_result result{};
+		std::vector<size_t> failed{};
+		std::mutex mutex{};
+		for (const auto& [directory, indices] : directories) {
+			pool.submit([&attributes, &indices, &result, &failed, &mutex]() noexcept {
+				for (auto index : indices) {
+					auto restored = restore_attribute(attributes[index]);
+					std::lock_guard lock(mutex);
+					if (std::holds_alternative<hwctrl_error>(restored)) {
+						failed.push_back(index);
+					} else if (std::get<bool>(restored)) {
+						result.restored++;
+					} else {
+						result.unchanged++;
+					}
+				}
+			});
+		}
+		pool.wait();
+		std::sort(failed.begin(), failed.end());
+		for (auto index : failed) {
+			auto restored = restore_attribute(attributes[index]);
+			if (auto* err_ptr = std::get_if<hwctrl_error>(&restored)) {
+				result.errors.push_back(std::move(*err_ptr));
+			} else if (std::get<bool>(restored)) {
+				result.restored++;
+			} else {
+				result.unchanged++;
+			}
+		}
+		return result;
+	}
+
+	void write_restore_result(util::writer& out, const restore_result& result) noexcept {
+		out.begin_object();
+		out.field("restored", result.restored);
+		out.field("unchanged", result.unchanged);
+		out.begin_array("errors");
+		for (const auto& error : result.errors) {
+			out.value(error.message);
+		}
+		out.end_array();
+		out.end_object();
+	}
+} // namespace hwctrl::control
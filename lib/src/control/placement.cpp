@@ -0,0 +1,156 @@
+#include <control/placement.hpp>
+#include <util/sysfs.hpp>
+#include <algorithm>
+#include <string>
+#include <tuple>
+
+namespace hwctrl::control {
+	[[nodiscard]] std::optional<placement_policy> parse_placement_policy(std::string_view str) noexcept {
+		if (str == "compact") {
+			return placement_policy::COMPACT;
+		} else if (str == "spread") {
+			return placement_policy::SPREAD;
+		} else if (str == "one-per-core") {
+			return placement_policy::ONE_PER_CORE;
+		} else if (str == "one-per-l3") {
+			return placement_policy::ONE_PER_L3;
+		}
+		return std::nullopt;
+	}
+
+	[[nodiscard]] std::string_view placement_policy_string(placement_policy policy) noexcept {
+		switch (policy) {
+			case placement_policy::SPREAD:
+				return "spread";
+			case placement_policy::ONE_PER_CORE:
+				return "one-per-core";
+			case placement_policy::ONE_PER_L3:
+				return "one-per-l3";
+			case placement_policy::COMPACT:
+				//[[fallthrough]]
+			default:
+				return "compact";
+		}
+	}
+
+	// allowed online cpus ordered package by package, core by core, threads of a core next to each other
+	[[nodiscard]] static std::vector<uint32_t> compact_order(const source::cpu_topology& topology, std::span<const uint32_t> allowed) noexcept {
+		std::vector<uint32_t> cpus{};
+		for (auto cpu : allowed) {
+			if (topology.online(cpu)) {
+				cpus.push_back(cpu);
+			}
+		}
+		std::sort(cpus.begin(), cpus.end(), [&](uint32_t a, uint32_t b) noexcept {
+			const auto& cpu_a = topology.cpus[a];
+			const auto& cpu_b = topology.cpus[b];
+			return std::tie(cpu_a.package_id, cpu_a.die_index, cpu_a.core_index, a) < std::tie(cpu_b.package_id, cpu_b.die_index, cpu_b.core_index, b);
+		});
+		return cpus;
+	}
+
+	// the first cpu of every core, cpus without core information count as cores
+	[[nodiscard]] static std::vector<uint32_t> first_thread_per_core(const source::cpu_topology& topology, std::span<const uint32_t> order) noexcept {
+		std::vector<bool> used(topology.cores.size(), false);
+		std::vector<uint32_t> cpus{};
+		for (auto cpu : order) {
+			auto core = topology.cpus[cpu].core_index;
+			if (core == source::cpu_topology::UNKNOWN_ID) {
+				cpus.push_back(cpu);
+			} else if (core < used.size() && !used[core]) {
+				used[core] = true;
+				cpus.push_back(cpu);
+			}
+		}
+		return cpus;
+	}
+
+	[[nodiscard]] std::variant<std::vector<uint32_t>, hwctrl_error> place_cpus(const source::cpu_topology& topology, const source::cache_topology& caches, placement_policy policy, size_t count, std::span<const uint32_t> allowed) noexcept {
+		if (count == 0) {
+			return hwctrl_error{"error - placement needs at least one cpu"};
+		}
+		auto compact = compact_order(topology, allowed);
+		std::vector<uint32_t> candidates{};
+		switch (policy) {
+			case placement_policy::SPREAD: {
+				std::vector<bool> is_allowed(topology.cpus.size(), false);
+				for (auto cpu : compact) {
+					is_allowed[cpu] = true;
+				}
+				for (auto cpu : source::spread_cpus(topology)) {
+					if (is_allowed[cpu]) {
+						candidates.push_back(cpu);
+					}
+				}
+				break;
+			}
+			case placement_policy::ONE_PER_CORE:
+				candidates = first_thread_per_core(topology, compact);
+				break;
+			case placement_policy::ONE_PER_L3: {
+				auto level = caches.max_level();
+				if (level == 0) {
+					return hwctrl_error{"error - one-per-l3 needs the cache topology from sysfs"};
+				}
+				// the first allowed cpu of every domain in compact order, domains in the order spread_cpus reaches them so packages alternate
+				std::vector<uint32_t> first_cpu(caches.caches.size(), source::cpu_topology::UNKNOWN_ID);
+				for (auto cpu : compact) {
+					const auto* cache = caches.find(cpu, level);
+					if (cache != nullptr && first_cpu[static_cast<size_t>(cache - caches.caches.data())] == source::cpu_topology::UNKNOWN_ID) {
+						first_cpu[static_cast<size_t>(cache - caches.caches.data())] = cpu;
+					}
+				}
+				std::vector<bool> taken(caches.caches.size(), false);
+				for (auto cpu : source::spread_cpus(topology)) {
+					const auto* cache = caches.find(cpu, level);
+					if (cache == nullptr) {
+						continue;
+					}
+					auto index = static_cast<size_t>(cache - caches.caches.data());
+					if (!taken[index] && first_cpu[index] != source::cpu_topology::UNKNOWN_ID) {
+						taken[index] = true;
+						candidates.push_back(first_cpu[index]);
+					}
+				}
+				break;
+			}
+			case placement_policy::COMPACT:
+				//[[fallthrough]]
+			default:
+				candidates = std::move(compact);
+		}
+		if (candidates.size() < count) {
+			return hwctrl_error{"error - " + std::string(placement_policy_string(policy)) + " has only " + std::to_string(candidates.size()) + " cpus to offer, " + std::to_string(count) + " requested"};
+		}
+		candidates.resize(count);
+		return candidates;
+	}
+
+	[[nodiscard]] std::vector<uint32_t> placement_nodes(const source::cpu_topology& topology, std::span<const uint32_t> cpus) noexcept {
+		std::vector<uint32_t> nodes{};
+		for (auto cpu : cpus) {
+			if (cpu < topology.cpus.size() && topology.cpus[cpu].numa_node_id != source::cpu_topology::UNKNOWN_ID) {
+				nodes.push_back(topology.cpus[cpu].numa_node_id);
+			}
+		}
+		std::sort(nodes.begin(), nodes.end());
+		nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+		return nodes;
+	}
+
+	void write_placement(util::writer& out, placement_policy policy, std::span<const uint32_t> cpus, std::span<const uint32_t> nodes) noexcept {
+		out.begin_object();
+		out.field("policy", placement_policy_string(policy));
+		// in order of preference, the first n are the placement for n threads
+		out.begin_array("cpus");
+		for (auto cpu : cpus) {
+			out.value(cpu);
+		}
+		out.end_array();
+		std::vector<uint32_t> sorted{cpus.begin(), cpus.end()};
+		std::sort(sorted.begin(), sorted.end());
+		out.field("cpu_list", util::sysfs::id_list_string(sorted));
+		out.field("nodes", util::sysfs::id_list_string({nodes.begin(), nodes.end()}));
+		out.end_object();
+	}
+} // namespace hwctrl::control
@@ -0,0 +1,457 @@
+#include <control/profile.hpp>
+#include <control/cpufreq.hpp>
+#include <control/cpuidle.hpp>
+#include <control/hugepages.hpp>
+#include <control/irq.hpp>
+#include <control/placement.hpp>
+#include <source/interrupts.hpp>
+#include <util/file.hpp>
+#include <util/sysfs.hpp>
+#include <algorithm>
+#include <charconv>
+#include <map>
+#include <optional>
+
+namespace hwctrl::control {
+	// "error - profile line 3: ..." from a message that may already start with "error - "
+	[[nodiscard]] static hwctrl_error line_error(uint32_t line, std::string_view message) noexcept {
+		constexpr std::string_view PREFIX = "error - ";
+		if (message.substr(0, PREFIX.size()) == PREFIX) {
+			message.remove_prefix(PREFIX.size());
+		}
+		return hwctrl_error{"error - profile line " + std::to_string(line) + ": " + std::string(message)};
+	}
+
+	[[nodiscard]] std::variant<std::vector<profile_entry>, hwctrl_error> parse_profile(std::string_view str) noexcept {
+		std::vector<profile_entry> entries{};
+		uint32_t line_number = 0;
+		while (!str.empty()) {
+			line_number++;
+			auto end = str.find('\n');
+			auto line = str.substr(0, end);
+			str.remove_prefix(end == std::string_view::npos ? str.size() : end + 1);
+			line = line.substr(0, line.find('#'));
+
+			profile_entry entry{};
+			entry.line = line_number;
+			while (true) {
+				auto begin = line.find_first_not_of(" \t\r");
+				if (begin == std::string_view::npos) {
+					break;
+				}
+				line.remove_prefix(begin);
+				auto token = line.substr(0, line.find_first_of(" \t\r"));
+				line.remove_prefix(token.size());
+				auto equals = token.find('=');
+				if (entry.kind.empty()) {
+					entry.kind = token;
+				} else if (equals != std::string_view::npos) {
+					if (equals == 0) {
+						return line_error(line_number, "option \"" + std::string(token) + "\" has no name");
+					}
+					entry.options.emplace_back(token.substr(0, equals), token.substr(equals + 1));
+				} else if (entry.target.empty() && entry.options.empty()) {
+					entry.target = token;
+				} else {
+					return line_error(line_number, "expected name=value instead of \"" + std::string(token) + "\"");
+				}
+			}
+			if (!entry.kind.empty()) {
+				entries.push_back(std::move(entry));
+			}
+		}
+		return entries;
+	}
+
+	[[nodiscard]] std::variant<std::vector<profile_entry>, hwctrl_error> read_profile(const std::filesystem::path& path) noexcept {
+		auto file_result = util::file::read_ram_file(path);
+		if (auto* err_ptr = std::get_if<hwctrl_error>(&file_result)) {
+			return std::move(*err_ptr);
+		}
+		return parse_profile(std::get<std::string>(file_result));
+	}
+
+	// the value to compare against a profile, the selected word of mode files
+	[[nodiscard]] static std::string normalize(std::string_view value) noexcept {
+		return std::string(value.find('[') != std::string_view::npos ? selected_mode(value) : value);
+	}
+
+	[[nodiscard]] static std::optional<uint64_t> parse_uint(std::string_view str) noexcept {
+		uint64_t value = 0;
+		auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+		if (ec != std::errc{} || ptr != str.data() + str.size()) {
+			return std::nullopt;
+		}
+		return value;
+	}
+
+	[[nodiscard]] static std::variant<std::vector<uint32_t>, hwctrl_error> entry_cpus(const profile_entry& entry, const source::cpu_topology& topology, std::string_view expression) noexcept {
+		auto cpus = source::resolve_cpu_set(topology, expression);
+		if (const auto* err_ptr = std::get_if<hwctrl_error>(&cpus)) {
+			return line_error(entry.line, err_ptr->message);
+		}
+		return cpus;
+	}
+
+	[[nodiscard]] static std::optional<hwctrl_error> resolve_cpufreq(const profile_entry& entry, const source::cpu_topology& topology, const profile_roots& roots, std::vector<profile_setting>& settings) noexcept {
+		cpufreq_settings cpufreq{};
+		for (const auto& [key, value] : entry.options) {
+			if (key == "governor") {
+				cpufreq.governor = value;
+			} else if (key == "epp") {
+				cpufreq.epp = value;
+			} else if (key == "min" || key == "max") {
+				auto frequency = parse_frequency(value);
+				if (const auto* err_ptr = std::get_if<hwctrl_error>(&frequency)) {
+					return line_error(entry.line, err_ptr->message);
+				}
+				(key == "min" ? cpufreq.min : cpufreq.max) = std::get<frequency_setting>(frequency);
+			} else {
+				return line_error(entry.line, "unknown cpufreq option \"" + key + "\", expected governor, min, max or epp");
+			}
+		}
+		auto cpus = entry_cpus(entry, topology, entry.target);
+		if (auto* err_ptr = std::get_if<hwctrl_error>(&cpus)) {
+			return std::move(*err_ptr);
+		}
+		auto policies_result = read_cpufreq_policies(roots.sysfs, std::get<std::vector<uint32_t>>(cpus));
+		if (const auto* err_ptr = std::get_if<hwctrl_error>(&policies_result)) {
+			return line_error(entry.line, err_ptr->message);
+		}
+		const auto& policies = std::get<std::vector<cpufreq_policy>>(policies_result);
+		if (auto err = validate_cpufreq_settings(policies, cpufreq)) {
+			return line_error(entry.line, err->message);
+		}
+		for (const auto& policy : policies) {
+			// the order of cpufreq_journal, governor first
+			if (cpufreq.governor.has_value()) {
+				settings.push_back({entry.line, {policy.path / "scaling_governor", *cpufreq.governor}, false});
+			}
+			if (cpufreq.min.has_value()) {
+				settings.push_back({entry.line, {policy.path / "scaling_min_freq", std::to_string(resolve_frequency(policy, *cpufreq.min))}, false});
+			}
+			if (cpufreq.max.has_value()) {
+				settings.push_back({entry.line, {policy.path / "scaling_max_freq", std::to_string(resolve_frequency(policy, *cpufreq.max))}, false});
+			}
+			if (cpufreq.epp.has_value()) {
+				settings.push_back({entry.line, {policy.path / "energy_performance_preference", *cpufreq.epp}, false});
+			}
+		}
+		return std::nullopt;
+	}
+
+	[[nodiscard]] static std::optional<hwctrl_error> resolve_cpuidle(const profile_entry& entry, const source::cpu_topology& topology, const profile_roots& roots, std::vector<profile_setting>& settings) noexcept {
+		std::optional<uint64_t> max_latency_us{};
+		for (const auto& [key, value] : entry.options) {
+			if (key != "max-latency") {
+				return line_error(entry.line, "unknown cpuidle option \"" + key + "\", expected max-latency");
+			}
+			if (max_latency_us = parse_uint(value); !max_latency_us.has_value()) {
+				return line_error(entry.line, "invalid max-latency \"" + value + "\"");
+			}
+		}
+		if (!max_latency_us.has_value()) {
+			return line_error(entry.line, "cpuidle needs max-latency");
+		}
+		auto cpus = entry_cpus(entry, topology, entry.target);
+		if (auto* err_ptr = std::get_if<hwctrl_error>(&cpus)) {
+			return std::move(*err_ptr);
+		}
+		auto states_result = read_cpuidle_states(roots.sysfs, std::get<std::vector<uint32_t>>(cpus));
+		if (const auto* err_ptr = std::get_if<hwctrl_error>(&states_result)) {
+			return line_error(entry.line, err_ptr->message);
+		}
+		// the whole state of the cpus, states within the limit are enabled again
+		for (const auto& cpu : std::get<std::vector<cpu_idle_states>>(states_result)) {
+			auto cpuidle = roots.sysfs / "devices/system/cpu" / ("cpu" + std::to_string(cpu.cpu)) / "cpuidle";
+			for (const auto& state : cpu.states) {
+				settings.push_back({entry.line, {cpuidle / ("state" + std::to_string(state.index)) / "disable", state.latency_us > *max_latency_us ? "1" : "0"}, false});
+			}
+		}
+		return std::nullopt;
+	}
+
+	[[nodiscard]] static std::optional<hwctrl_error> resolve_irq(const profile_entry& entry, const source::cpu_topology& topology, const profile_roots& roots, std::vector<profile_setting>& settings) noexcept {
+		std::string cpus_expression = "all";
+		std::string isolated_expression{};
+		for (const auto& [key, value] : entry.options) {
+			if (key == "cpus") {
+				cpus_expression = value;
+			} else if (key == "isolated") {
+				isolated_expression = value;
+			} else {
+				return line_error(entry.line, "unknown irq option \"" + key + "\", expected cpus or isolated");
+			}
+		}
+		if (entry.target.empty()) {
+			return line_error(entry.line, "irq needs handler names to match or *");
+		}
+		irq_plan_options options{};
+		auto cpus = entry_cpus(entry, topology, cpus_expression);
+		if (auto* err_ptr = std::get_if<hwctrl_error>(&cpus)) {
+			return std::move(*err_ptr);
+		}
+		options.cpus = std::move(std::get<std::vector<uint32_t>>(cpus));
+		options.isolated = read_isolated_cpus(roots.sysfs);
+		if (!isolated_expression.empty()) {
+			auto isolated = entry_cpus(entry, topology, isolated_expression);
+			if (auto* err_ptr = std::get_if<hwctrl_error>(&isolated)) {
+				return std::move(*err_ptr);
+			}
+			const auto& extra = std::get<std::vector<uint32_t>>(isolated);
+			options.isolated.insert(options.isolated.end(), extra.begin(), extra.end());
+		}
+		auto interrupts = source::read_interrupts(roots.proc);
+		if (const auto* err_ptr = std::get_if<hwctrl_error>(&interrupts)) {
+			return line_error(entry.line, err_ptr->message);
+		}
+		// hosts without the device have nothing to place, the same profile serves the whole fleet
+		auto irqs = read_irqs(roots.proc, std::get<source::interrupts>(interrupts), entry.target == "*" ? std::string_view{} : std::string_view{entry.target});
+		if (irqs.empty()) {
+			return std::nullopt;
+		}
+		auto plan = plan_irqs(topology, irqs, options);
+		if (const auto* err_ptr = std::get_if<hwctrl_error>(&plan)) {
+			return line_error(entry.line, err_ptr->message);
+		}
+		for (const auto& assignment : std::get<std::vector<irq_assignment>>(plan)) {
+			settings.push_back({entry.line, {roots.proc / "irq" / std::to_string(assignment.irq) / "smp_affinity_list", std::to_string(assignment.cpu)}, true});
+		}
+		return std::nullopt;
+	}
+
+	// key=value options naming attributes of dir, e.g. queue/scheduler=none, checked against the choices of mode files
+	[[nodiscard]] static std::optional<hwctrl_error> resolve_attributes(const profile_entry& entry, const std::filesystem::path& dir, std::vector<profile_setting>& settings) noexcept {
+		for (const auto& [key, value] : entry.options) {
+			if (key.find_first_not_of("abcdefghijklmnopqrstuvwxyz0123456789_") != std::string::npos) {
+				return line_error(entry.line, "invalid attribute name \"" + key + "\"");
+			}
+			auto path = dir / key;
+			auto current = util::sysfs::read_string(path);
+			if (!std::holds_alternative<std::string>(current)) {
+				return line_error(entry.line, "no attribute \"" + path.string() + "\"");
+			}
+			const auto& choices = std::get<std::string>(current);
+			if (choices.find('[') != std::string::npos) {
+				bool found = false;
+				std::string_view words = choices;
+				while (!words.empty() && !found) {
+					auto word = words.substr(0, words.find(' '));
+					words.remove_prefix(std::min(words.size(), word.size() + 1));
+					if (word.size() > 2 && word.front() == '[' && word.back() == ']') {
+						word = word.substr(1, word.size() - 2);
+					}
+					found = word == value;
+				}
+				if (!found) {
+					return line_error(entry.line, "\"" + value + "\" is not one of \"" + choices + "\" for \"" + path.string() + "\"");
+				}
+			}
+			settings.push_back({entry.line, {std::move(path), value}, false});
+		}
+		return std::nullopt;
+	}
+
+	[[nodiscard]] static std::optional<hwctrl_error> resolve_block(const profile_entry& entry, const profile_roots& roots, std::vector<profile_setting>& settings) noexcept {
+		if (entry.target.empty() || entry.target.find('/') != std::string::npos) {
+			return line_error(entry.line, "block needs a device name or a prefix ending in *");
+		}
+		auto block = roots.sysfs / "block";
+		std::vector<std::string> devices{};
+		if (entry.target.back() == '*') {
+			std::string_view prefix{entry.target.data(), entry.target.size() - 1};
+			for (auto& name : util::file::list_directory(block)) {
+				if (name.compare(0, prefix.size(), prefix) == 0) {
+					devices.push_back(std::move(name));
+				}
+			}
+		} else {
+			if (!util::file::exists(block / entry.target)) {
+				return line_error(entry.line, "no block device \"" + entry.target + "\"");
+			}
+			devices.push_back(entry.target);
+		}
+		for (const auto& device : devices) {
+			if (auto err = resolve_attributes(entry, block / device / "queue", settings)) {
+				return err;
+			}
+		}
+		return std::nullopt;
+	}
+
+	[[nodiscard]] static std::optional<hwctrl_error> resolve_hugepages(const profile_entry& entry, const source::cpu_topology& topology, const profile_roots& roots, std::vector<profile_setting>& settings) noexcept {
+		uint64_t page_bytes = 2u << 20u;
+		std::optional<uint64_t> bytes{};
+		std::optional<uint64_t> pages{};
+		for (const auto& [key, value] : entry.options) {
+			if (key == "pages") {
+				if (pages = parse_uint(value); !pages.has_value()) {
+					return line_error(entry.line, "invalid page count \"" + value + "\"");
+				}
+				continue;
+			}
+			if (key != "size" && key != "per-node") {
+				return line_error(entry.line, "unknown hugepages option \"" + key + "\", expected size, per-node or pages");
+			}
+			auto size = parse_byte_size(value);
+			if (const auto* err_ptr = std::get_if<hwctrl_error>(&size)) {
+				return line_error(entry.line, err_ptr->message);
+			}
+			(key == "size" ? page_bytes : bytes.emplace()) = std::get<uint64_t>(size);
+		}
+		if (bytes.has_value() == pages.has_value()) {
+			return line_error(entry.line, "hugepages needs either per-node or pages");
+		}
+		auto cpus = entry_cpus(entry, topology, entry.target);
+		if (auto* err_ptr = std::get_if<hwctrl_error>(&cpus)) {
+			return std::move(*err_ptr);
+		}
+		auto nodes = placement_nodes(topology, std::get<std::vector<uint32_t>>(cpus));
+		auto state = read_hugepages(roots.sysfs);
+		if (const auto* err_ptr = std::get_if<hwctrl_error>(&state)) {
+			return line_error(entry.line, err_ptr->message);
+		}
+		auto page_kib = page_bytes >> 10u;
+		auto pools = hugepage_journal(roots.sysfs, std::get<hugepage_state>(state), nodes, page_kib);
+		if (nodes.empty() || pools.size() != nodes.size()) {
+			return line_error(entry.line, "not every node of \"" + entry.target + "\" has a " + std::to_string(page_kib) + " kB hugepage pool");
+		}
+		auto count = bytes.has_value() ? (*bytes + page_bytes - 1) / page_bytes : *pages;
+		for (auto& pool : pools) {
+			settings.push_back({entry.line, {std::move(pool.path), std::to_string(count)}, false});
+		}
+		return std::nullopt;
+	}
+
+	[[nodiscard]] std::variant<std::vector<profile_setting>, hwctrl_error> resolve_profile(std::span<const profile_entry> entries, const source::cpu_topology& topology, const profile_roots& roots) noexcept {
+		std::vector<profile_setting> settings{};
+		for (const auto& entry : entries) {
+			std::optional<hwctrl_error> error{};
+			if (entry.kind == "cpufreq") {
+				error = resolve_cpufreq(entry, topology, roots, settings);
+			} else if (entry.kind == "cpuidle") {
+				error = resolve_cpuidle(entry, topology, roots, settings);
+			} else if (entry.kind == "irq") {
+				error = resolve_irq(entry, topology, roots, settings);
+			} else if (entry.kind == "block") {
+				error = resolve_block(entry, roots, settings);
+			} else if (entry.kind == "thp") {
+				error = entry.target.empty() ? resolve_attributes(entry, roots.sysfs / "kernel/mm/transparent_hugepage", settings) : line_error(entry.line, "thp takes no target");
+			} else if (entry.kind == "hugepages") {
+				error = resolve_hugepages(entry, topology, roots, settings);
+			} else {
+				error = line_error(entry.line, "unknown kind \"" + entry.kind + "\", expected cpufreq, cpuidle, irq, block, thp or hugepages");
+			}
+			if (error.has_value()) {
+				return std::move(error.value());
+			}
+		}
+		// the first line setting an attribute keeps it, a second with the same value is dropped
+		std::map<std::filesystem::path, size_t> first{};
+		std::vector<profile_setting> unique{};
+		for (auto& setting : settings) {
+			auto [it, inserted] = first.try_emplace(setting.desired.path, unique.size());
+			if (inserted) {
+				unique.push_back(std::move(setting));
+				continue;
+			}
+			const auto& other = unique[it->second];
+			if (other.desired.value != setting.desired.value) {
+				return line_error(setting.line, "sets \"" + setting.desired.path.string() + "\" to \"" + setting.desired.value + "\", line " + std::to_string(other.line) + " sets it to \"" + other.desired.value + "\"");
+			}
+		}
+		return unique;
+	}
+
+	[[nodiscard]] std::vector<profile_change> diff_profile(std::span<const profile_setting> settings) noexcept {
+		std::vector<profile_change> changes{};
+		for (const auto& setting : settings) {
+			auto current = util::sysfs::read_string(setting.desired.path);
+			if (const auto* err_ptr = std::get_if<hwctrl_error>(&current)) {
+				changes.push_back({setting.line, setting.desired.path, {}, setting.desired.value, setting.best_effort, line_error(setting.line, err_ptr->message)});
+				continue;
+			}
+			auto value = normalize(std::get<std::string>(current));
+			if (value != setting.desired.value) {
+				changes.push_back({setting.line, setting.desired.path, std::move(value), setting.desired.value, setting.best_effort, std::nullopt});
+			}
+		}
+		return changes;
+	}
+
+	[[nodiscard]] std::variant<std::vector<attribute_value>, hwctrl_error> profile_journal(std::span<const profile_change> changes) noexcept {
+		std::vector<attribute_value> attributes{};
+		attributes.reserve(changes.size());
+		for (const auto& change : changes) {
+			// a rollback would write an empty value and stop halfway
+			if (change.read_error.has_value()) {
+				return *change.read_error;
+			}
+			attributes.push_back({change.path, change.current});
+		}
+		return attributes;
+	}
+
+	[[nodiscard]] profile_apply_result apply_profile(std::span<const profile_change> changes, util::thread_pool& pool) noexcept {
+		std::vector<attribute_value> required{};
+		std::vector<attribute_value> best_effort{};
+		for (const auto& change : changes) {
+			(change.best_effort ? best_effort : required).push_back({change.path, change.desired});
+		}
+		profile_apply_result result{};
+		result.written = restore_journal(required, pool);
+		// refused writes show up in the read back below, the write errors themselves are expected
+		auto optional = restore_journal(best_effort, pool);
+		result.written.restored += optional.restored;
+		result.written.unchanged += optional.unchanged;
+		for (const auto& change : changes) {
+			auto current = util::sysfs::read_string(change.path);
+			auto value = std::holds_alternative<std::string>(current) ? normalize(std::get<std::string>(current)) : std::string{};
+			if (value != change.desired) {
+				auto error = line_error(change.line, "\"" + change.path.string() + "\" holds \"" + value + "\" instead of \"" + change.desired + "\"");
+				(change.best_effort ? result.refused : result.mismatches).push_back(std::move(error));
+			}
+		}
+		return result;
+	}
+
+	void write_profile_diff(util::writer& out, std::span<const profile_change> changes, size_t settings) noexcept {
+		out.begin_object();
+		out.field("settings", settings);
+		out.field("unchanged", settings - changes.size());
+		out.begin_array("changes");
+		for (const auto& change : changes) {
+			out.begin_object();
+			out.field("line", change.line);
+			out.field("path", change.path.string());
+			out.field("current", change.current);
+			out.field("desired", change.desired);
+			if (change.read_error.has_value()) {
+				out.field("error", change.read_error->message);
+			}
+			out.end_object();
+		}
+		out.end_array();
+		out.end_object();
+	}
+
+	void write_profile_apply_result(util::writer& out, const profile_apply_result& result) noexcept {
+		out.begin_object();
+		out.field("written", result.written.restored);
+		out.field("unchanged", result.written.unchanged);
+		out.begin_array("errors");
+		for (const auto& error : result.written.errors) {
+			out.value(error.message);
+		}
+		for (const auto& error : result.mismatches) {
+			out.value(error.message);
+		}
+		out.end_array();
+		out.begin_array("refused");
+		for (const auto& error : result.refused) {
+			out.value(error.message);
+		}
+		out.end_array();
+		out.end_object();
+	}
+} // namespace hwctrl::control
@@ -0,0 +1,213 @@
+#include <probe/c2c.hpp>
+#include <util/affinity.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+
+namespace hwctrl::probe {
+	// the bounced line, alone on its cache line so nothing else moves with it
+	struct alignas(64) pingpong_line {
+		std::atomic<uint64_t> value{0};
+	};
+
+	static inline void cpu_relax() noexcept {
+#if defined(__x86_64__)
+		__builtin_ia32_pause();
+#endif
+	}
+
+	[[nodiscard]] double c2c_matrix::at(size_t row, size_t column) const noexcept {
+		return ns[row * cpus.size() + column];
+	}
+
+	[[nodiscard]] std::string_view cpu_relation_string(cpu_relation relation) noexcept {
+		switch (relation) {
+			case cpu_relation::SMT_SIBLING:
+				return "smt_sibling";
+			case cpu_relation::SAME_L3:
+				return "same_l3";
+			case cpu_relation::CROSS_L3:
+				return "cross_l3";
+			case cpu_relation::CROSS_DIE:
+				return "cross_die";
+			case cpu_relation::CROSS_SOCKET:
+				//[[fallthrough]]
+			default:
+				return "cross_socket";
+		}
+	}
+
+	[[nodiscard]] cpu_relation classify_cpu_pair(const source::cpu_topology& topology, const source::cache_topology& caches, uint32_t a, uint32_t b) noexcept {
+		if (a >= topology.cpus.size() || b >= topology.cpus.size()) {
+			return cpu_relation::CROSS_SOCKET;
+		}
+		const auto& cpu_a = topology.cpus[a];
+		const auto& cpu_b = topology.cpus[b];
+		if (cpu_a.package_id != cpu_b.package_id) {
+			return cpu_relation::CROSS_SOCKET;
+		}
+		if (cpu_a.core_index != source::cpu_topology::UNKNOWN_ID && cpu_a.core_index == cpu_b.core_index) {
+			return cpu_relation::SMT_SIBLING;
+		}
+		if (cpu_a.die_index != cpu_b.die_index) {
+			return cpu_relation::CROSS_DIE;
+		}
+		auto level = caches.max_level();
+		if (level == 0) {
+			return cpu_relation::SAME_L3;
+		}
+		const auto* cache_a = caches.find(a, level);
+		return cache_a != nullptr && cache_a == caches.find(b, level) ? cpu_relation::SAME_L3 : cpu_relation::CROSS_L3;
+	}
+
+	[[nodiscard]] std::vector<std::pair<uint32_t, uint32_t>> c2c_pairs(size_t cpu_count, size_t max_pairs) noexcept {
+		std::vector<std::pair<uint32_t, uint32_t>> pairs{};
+		for (uint32_t i = 0; i < cpu_count; i++) {
+			for (uint32_t j = i + 1; j < cpu_count; j++) {
+				pairs.emplace_back(i, j);
+			}
+		}
+		if (max_pairs != 0 && pairs.size() > max_pairs) {
+			// fixed seed so repeated runs sample the same pairs
+			std::mt19937_64 rng(0x2545f4914f6cdd1du);
+			std::shuffle(pairs.begin(), pairs.end(), rng);
+			pairs.resize(max_pairs);
+			std::sort(pairs.begin(), pairs.end());
+		}
+		return pairs;
+	}
+
+	[[nodiscard]] std::variant<double, hwctrl_error> measure_c2c_round_trip(uint32_t a, uint32_t b, const c2c_options& options) noexcept {
+		pingpong_line line{};
+		std::atomic<uint32_t> ready = 0;
+		std::optional<hwctrl_error> error_a{};
+		std::optional<hwctrl_error> error_b{};
+		auto round_trips = std::max(options.round_trips, uint32_t{1});
+		// the first run warms up caches and clocks
+		auto runs = std::max(options.repetitions, uint32_t{1}) + 1;
+		uint64_t total = uint64_t{round_trips} * runs;
+		double best = 0;
+
+		// b answers every odd value with the next even one
+		std::thread responder([&]() noexcept {
+			error_b = util::affinity::pin_current_thread({&b, 1});
+			ready.fetch_add(1);
+			for (uint64_t k = 0; k < total; k++) {
+				while (line.value.load(std::memory_order_acquire) != 2 * k + 1) {
+					cpu_relax();
+				}
+				line.value.store(2 * k + 2, std::memory_order_release);
+			}
+		});
+		std::thread initiator([&]() noexcept {
+			error_a = util::affinity::pin_current_thread({&a, 1});
+			ready.fetch_add(1);
+			while (ready.load() != 2) {
+				cpu_relax();
+			}
+			uint64_t k = 0;
+			for (uint32_t run = 0; run < runs; run++) {
+				auto start = std::chrono::steady_clock::now();
+				for (uint32_t i = 0; i < round_trips; i++, k++) {
+					line.value.store(2 * k + 1, std::memory_order_release);
+					while (line.value.load(std::memory_order_acquire) != 2 * k + 2) {
+						cpu_relax();
+					}
+				}
+				auto ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / round_trips;
+				if (run == 1 || (run > 1 && ns < best)) {
+					best = ns;
+				}
+			}
+		});
+		initiator.join();
+		responder.join();
+		if (error_a != std::nullopt) {
+			return std::move(error_a.value());
+		}
+		if (error_b != std::nullopt) {
+			return std::move(error_b.value());
+		}
+		return best;
+	}
+
+	[[nodiscard]] std::variant<c2c_matrix, hwctrl_error> run_c2c(std::span<const uint32_t> cpus, const c2c_options& options) noexcept {
+		if (cpus.size() < 2) {
+			return hwctrl_error{"error - core to core latency needs at least two cpus"};
+		}
+		c2c_matrix matrix{};
+		matrix.cpus.assign(cpus.begin(), cpus.end());
+		matrix.ns.assign(cpus.size() * cpus.size(), 0);
+		for (auto [i, j] : c2c_pairs(cpus.size(), options.max_pairs)) {
+			auto result = measure_c2c_round_trip(cpus[i], cpus[j], options);
+			if (auto* err_ptr = std::get_if<hwctrl_error>(&result)) {
+				return std::move(*err_ptr);
+			}
+			matrix.ns[i * cpus.size() + j] = std::get<double>(result);
+			matrix.ns[j * cpus.size() + i] = std::get<double>(result);
+		}
+		return matrix;
+	}
+
+	[[nodiscard]] std::vector<c2c_summary> summarize_c2c(const c2c_matrix& matrix, const source::cpu_topology& topology, const source::cache_topology& caches) noexcept {
+		constexpr cpu_relation RELATIONS[] = {cpu_relation::SMT_SIBLING, cpu_relation::SAME_L3, cpu_relation::CROSS_L3, cpu_relation::CROSS_DIE, cpu_relation::CROSS_SOCKET};
+		std::vector<std::vector<double>> samples(std::size(RELATIONS));
+		for (size_t i = 0; i < matrix.cpus.size(); i++) {
+			for (size_t j = i + 1; j < matrix.cpus.size(); j++) {
+				auto ns = matrix.at(i, j);
+				if (ns > 0) {
+					samples[static_cast<size_t>(classify_cpu_pair(topology, caches, matrix.cpus[i], matrix.cpus[j]))].push_back(ns);
+				}
+			}
+		}
+		std::vector<c2c_summary> summaries{};
+		for (size_t r = 0; r < std::size(RELATIONS); r++) {
+			auto& values = samples[r];
+			if (values.empty()) {
+				continue;
+			}
+			std::sort(values.begin(), values.end());
+			summaries.push_back({RELATIONS[r], values.size(), values.front(), values[values.size() / 2], values.back()});
+		}
+		return summaries;
+	}
+
+	void write_c2c_matrix(util::writer& out, const c2c_matrix& matrix) noexcept {
+		out.begin_object();
+		out.begin_array("cpus");
+		for (auto cpu : matrix.cpus) {
+			out.value(cpu);
+		}
+		out.end_array();
+		out.begin_array("round_trip_ns");
+		for (size_t i = 0; i < matrix.cpus.size(); i++) {
+			out.begin_array();
+			for (size_t j = 0; j < matrix.cpus.size(); j++) {
+				out.value(matrix.at(i, j));
+			}
+			out.end_array();
+		}
+		out.end_array();
+		out.end_object();
+	}
+
+	void write_c2c_summary(util::writer& out, std::span<const c2c_summary> summaries) noexcept {
+		out.begin_object();
+		out.begin_array("summary");
+		for (const auto& summary : summaries) {
+			out.begin_object();
+			out.field("relation", cpu_relation_string(summary.relation));
+			out.field("pairs", summary.pairs);
+			out.field("min_ns", summary.min_ns);
+			out.field("median_ns", summary.median_ns);
+			out.field("max_ns", summary.max_ns);
+			out.end_object();
+		}
+		out.end_array();
+		out.end_object();
+	}
+} // namespace hwctrl::probe
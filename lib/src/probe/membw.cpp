@@ -0,0 +1,347 @@
+#include <probe/membw.hpp>
+#include <source/cpuid.hpp>
+#include <util/affinity.hpp>
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace hwctrl::probe {
+	// elements per thread are a multiple of one avx-512 vector so the vector loops need no tail
+	static constexpr size_t ELEMENT_MULTIPLE = 8;
+	static constexpr size_t ARRAY_ALIGNMENT = 64;
+	static constexpr double SCALAR = 3.0;
+	static constexpr stream_kernel KERNELS[] = {stream_kernel::COPY, stream_kernel::SCALE, stream_kernel::ADD, stream_kernel::TRIAD};
+
+	using stream_function = void (*)(double* a, double* b, double* c, size_t n) noexcept;
+
+	template<stream_kernel KERNEL>
+	static void stream_scalar(double* __restrict a, double* __restrict b, double* __restrict c, size_t n) noexcept {
+		for (size_t i = 0; i < n; i++) {
+			if constexpr (KERNEL == stream_kernel::COPY) {
+				c[i] = a[i];
+			} else if constexpr (KERNEL == stream_kernel::SCALE) {
+				b[i] = SCALAR * c[i];
+			} else if constexpr (KERNEL == stream_kernel::ADD) {
+				c[i] = a[i] + b[i];
+			} else {
+				a[i] = b[i] + SCALAR * c[i];
+			}
+		}
+	}
+
+#if defined(__x86_64__)
+	template<stream_kernel KERNEL, bool NON_TEMPORAL>
+	__attribute__((target("avx2,fma"))) static void stream_avx2(double* __restrict a, double* __restrict b, double* __restrict c, size_t n) noexcept {
+		const auto scalar = _mm256_set1_pd(SCALAR);
+		for (size_t i = 0; i < n; i += 4) {
+			double* dst = nullptr;
+			__m256d value{};
+			if constexpr (KERNEL == stream_kernel::COPY) {
+				dst = c + i;
+				value = _mm256_load_pd(a + i);
+			} else if constexpr (KERNEL == stream_kernel::SCALE) {
+				dst = b + i;
+				value = _mm256_mul_pd(scalar, _mm256_load_pd(c + i));
+			} else if constexpr (KERNEL == stream_kernel::ADD) {
+				dst = c + i;
+				value = _mm256_add_pd(_mm256_load_pd(a + i), _mm256_load_pd(b + i));
+			} else {
+				dst = a + i;
+				value = _mm256_fmadd_pd(scalar, _mm256_load_pd(c + i), _mm256_load_pd(b + i));
+			}
+			if constexpr (NON_TEMPORAL) {
+				_mm256_stream_pd(dst, value);
+			} else {
+				_mm256_store_pd(dst, value);
+			}
+		}
+		if constexpr (NON_TEMPORAL) {
+			// streaming stores are weakly ordered, drain them before the run counts as done
+			_mm_sfence();
+		}
+	}
+
+	template<stream_kernel KERNEL, bool NON_TEMPORAL>
+	__attribute__((target("avx512f"))) static void stream_avx512(double* __restrict a, double* __restrict b, double* __restrict c, size_t n) noexcept {
+		const auto scalar = _mm512_set1_pd(SCALAR);
+		for (size_t i = 0; i < n; i += 8) {
+			double* dst = nullptr;
+			__m512d value{};
+			if constexpr (KERNEL == stream_kernel::COPY) {
+				dst = c + i;
+				value = _mm512_load_pd(a + i);
+			} else if constexpr (KERNEL == stream_kernel::SCALE) {
+				dst = b + i;
+				value = _mm512_mul_pd(scalar, _mm512_load_pd(c + i));
+			} else if constexpr (KERNEL == stream_kernel::ADD) {
+				dst = c + i;
+				value = _mm512_add_pd(_mm512_load_pd(a + i), _mm512_load_pd(b + i));
+			} else {
+				dst = a + i;
+				value = _mm512_fmadd_pd(scalar, _mm512_load_pd(c + i), _mm512_load_pd(b + i));
+			}
+			if constexpr (NON_TEMPORAL) {
+				_mm512_stream_pd(dst, value);
+			} else {
+				_mm512_store_pd(dst, value);
+			}
+		}
+		if constexpr (NON_TEMPORAL) {
+			_mm_sfence();
+		}
+	}
+#endif
+
+	template<stream_kernel KERNEL>
+	[[nodiscard]] static stream_function select_stream_function(simd_level simd, bool non_temporal) noexcept {
+		switch (simd) {
+#if defined(__x86_64__)
+			case simd_level::AVX512:
+				return non_temporal ? &stream_avx512<KERNEL, true> : &stream_avx512<KERNEL, false>;
+			case simd_level::AVX2:
+				return non_temporal ? &stream_avx2<KERNEL, true> : &stream_avx2<KERNEL, false>;
+#else
+			case simd_level::AVX512:
+				//[[fallthrough]]
+			case simd_level::AVX2:
+				//[[fallthrough]]
+#endif
+			case simd_level::SCALAR:
+				//[[fallthrough]]
+			default:
+				return &stream_scalar<KERNEL>;
+		}
+	}
+
+	[[nodiscard]] static stream_function select_stream_function(stream_kernel kernel, simd_level simd, bool non_temporal) noexcept {
+		switch (kernel) {
+			case stream_kernel::SCALE:
+				return select_stream_function<stream_kernel::SCALE>(simd, non_temporal);
+			case stream_kernel::ADD:
+				return select_stream_function<stream_kernel::ADD>(simd, non_temporal);
+			case stream_kernel::TRIAD:
+				return select_stream_function<stream_kernel::TRIAD>(simd, non_temporal);
+			case stream_kernel::COPY:
+				//[[fallthrough]]
+			default:
+				return select_stream_function<stream_kernel::COPY>(simd, non_temporal);
+		}
+	}
+
+	[[nodiscard]] bool simd_supported(simd_level simd) noexcept {
+		switch (simd) {
+#if defined(__x86_64__)
+			case simd_level::AVX512:
+				return source::host_cpu_features().has(source::cpu_feature::AVX512F);
+			case simd_level::AVX2:
+				return source::host_cpu_features().has_all({source::cpu_feature::AVX2, source::cpu_feature::FMA});
+#else
+			case simd_level::AVX512:
+				//[[fallthrough]]
+			case simd_level::AVX2:
+				return false;
+#endif
+			case simd_level::SCALAR:
+				//[[fallthrough]]
+			default:
+				return true;
+		}
+	}
+
+	[[nodiscard]] simd_level detect_simd() noexcept {
+		if (simd_supported(simd_level::AVX512)) {
+			return simd_level::AVX512;
+		}
+		if (simd_supported(simd_level::AVX2)) {
+			return simd_level::AVX2;
+		}
+		return simd_level::SCALAR;
+	}
+
+	[[nodiscard]] std::string_view simd_level_string(simd_level simd) noexcept {
+		switch (simd) {
+			case simd_level::AVX512:
+				return "avx512";
+			case simd_level::AVX2:
+				return "avx2";
+			case simd_level::SCALAR:
+				//[[fallthrough]]
+			default:
+				return "scalar";
+		}
+	}
+
+	[[nodiscard]] std::variant<simd_level, hwctrl_error> parse_simd_level(std::string_view str) noexcept {
+		for (auto simd : {simd_level::SCALAR, simd_level::AVX2, simd_level::AVX512}) {
+			if (str == simd_level_string(simd)) {
+				return simd;
+			}
+		}
+		return hwctrl_error{"error - unknown simd level " + std::string{str} + ", expected scalar, avx2 or avx512"};
+	}
+
+	[[nodiscard]] std::string_view stream_kernel_string(stream_kernel kernel) noexcept {
+		switch (kernel) {
+			case stream_kernel::SCALE:
+				return "scale";
+			case stream_kernel::ADD:
+				return "add";
+			case stream_kernel::TRIAD:
+				return "triad";
+			case stream_kernel::COPY:
+				//[[fallthrough]]
+			default:
+				return "copy";
+		}
+	}
+
+	[[nodiscard]] uint64_t stream_kernel_bytes(stream_kernel kernel) noexcept {
+		return kernel == stream_kernel::ADD || kernel == stream_kernel::TRIAD ? 3 * sizeof(double) : 2 * sizeof(double);
+	}
+
+	struct free_deleter {
+		void operator()(double* ptr) const noexcept {
+			std::free(ptr);
+		}
+	};
+
+	using aligned_array = std::unique_ptr<double[], free_deleter>;
+
+	[[nodiscard]] static aligned_array allocate_array(size_t n) noexcept {
+		return aligned_array{static_cast<double*>(std::aligned_alloc(ARRAY_ALIGNMENT, n * sizeof(double)))};
+	}
+
+	[[nodiscard]] std::variant<std::vector<membw_result>, hwctrl_error> run_membw(std::span<const uint32_t> cpus, const membw_options& options) noexcept {
+		if (cpus.empty()) {
+			return hwctrl_error{"error - no cpus to run the bandwidth test on"};
+		}
+		if (!simd_supported(options.simd)) {
+			return hwctrl_error{"error - " + std::string{simd_level_string(options.simd)} + " is not supported by this cpu"};
+		}
+		std::vector<bool> variants{};
+		if (options.stores != store_mode::NON_TEMPORAL) {
+			variants.push_back(false);
+		}
+		if (options.stores != store_mode::REGULAR) {
+			if (options.simd == simd_level::SCALAR) {
+				if (options.stores == store_mode::NON_TEMPORAL) {
+					return hwctrl_error{"error - non temporal stores need avx2 or avx512"};
+				}
+			} else {
+				variants.push_back(true);
+			}
+		}
+		auto threads = cpus.size();
+		auto elements = std::max(options.array_bytes / sizeof(double) / threads / ELEMENT_MULTIPLE, size_t{1}) * ELEMENT_MULTIPLE;
+		auto repetitions = std::max(options.repetitions, uint32_t{1});
+		// the first run of every kernel only warms up (page faults, frequency ramp) and is not counted
+		auto runs = repetitions + 1;
+
+		std::barrier sync(static_cast<std::ptrdiff_t>(threads + 1));
+		std::atomic<bool> failed = false;
+		std::vector<std::optional<hwctrl_error>> errors(threads);
+		std::vector<std::thread> workers{};
+		workers.reserve(threads);
+		for (size_t t = 0; t < threads; t++) {
+			workers.emplace_back([&, t]() noexcept {
+				auto cpu = cpus[t];
+				errors[t] = util::affinity::pin_current_thread({&cpu, 1});
+				aligned_array a = allocate_array(elements);
+				aligned_array b = allocate_array(elements);
+				aligned_array c = allocate_array(elements);
+				if (a == nullptr || b == nullptr || c == nullptr) {
+					errors[t] = hwctrl_error{"error - could not allocate " + std::to_string(3 * elements * sizeof(double)) + " bytes on cpu " + std::to_string(cpu)};
+				}
+				if (errors[t] != std::nullopt) {
+					failed = true;
+				} else {
+					// first touch from the pinned thread places the pages on its numa node
+					std::fill_n(a.get(), elements, 1.0);
+					std::fill_n(b.get(), elements, 2.0);
+					std::fill_n(c.get(), elements, 0.0);
+				}
+				sync.arrive_and_wait();
+				if (failed) {
+					return;
+				}
+				for (bool non_temporal : variants) {
+					for (auto kernel : KERNELS) {
+						auto function = select_stream_function(kernel, options.simd, non_temporal);
+						for (uint32_t run = 0; run < runs; run++) {
+							sync.arrive_and_wait();
+							function(a.get(), b.get(), c.get(), elements);
+							sync.arrive_and_wait();
+						}
+					}
+				}
+			});
+		}
+
+		std::vector<membw_result> results{};
+		sync.arrive_and_wait();
+		if (!failed) {
+			for (bool non_temporal : variants) {
+				for (auto kernel : KERNELS) {
+					membw_result result{};
+					result.kernel = kernel;
+					result.simd = options.simd;
+					result.non_temporal = non_temporal;
+					result.threads = static_cast<uint32_t>(threads);
+					result.bytes = stream_kernel_bytes(kernel) * elements * threads;
+					double total = 0;
+					for (uint32_t run = 0; run < runs; run++) {
+						sync.arrive_and_wait();
+						auto start = std::chrono::steady_clock::now();
+						sync.arrive_and_wait();
+						auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+						if (run == 0) {
+							continue;
+						}
+						result.best_seconds = run == 1 ? seconds : std::min(result.best_seconds, seconds);
+						result.worst_seconds = std::max(result.worst_seconds, seconds);
+						total += seconds;
+					}
+					result.average_seconds = total / repetitions;
+					result.best_bytes_per_second = result.best_seconds > 0 ? static_cast<double>(result.bytes) / result.best_seconds : 0;
+					results.push_back(result);
+				}
+			}
+		}
+		for (auto& worker : workers) {
+			worker.join();
+		}
+		for (auto& error : errors) {
+			if (error != std::nullopt) {
+				return std::move(error.value());
+			}
+		}
+		return results;
+	}
+
+	void write_membw_result(util::writer& out, const membw_result& result, double peak_bytes_per_second) noexcept {
+		out.begin_object();
+		out.field("kernel", stream_kernel_string(result.kernel));
+		out.field("simd", simd_level_string(result.simd));
+		out.field("non_temporal", result.non_temporal);
+		out.field("threads", result.threads);
+		out.field("bytes", result.bytes);
+		out.field("best_ns", static_cast<uint64_t>(result.best_seconds * 1e9));
+		out.field("average_ns", static_cast<uint64_t>(result.average_seconds * 1e9));
+		out.field("worst_ns", static_cast<uint64_t>(result.worst_seconds * 1e9));
+		out.field("best_gb_per_second", result.best_bytes_per_second / 1e9);
+		if (peak_bytes_per_second > 0) {
+			out.field("peak_gb_per_second", peak_bytes_per_second / 1e9);
+			out.field("fraction_of_peak", result.best_bytes_per_second / peak_bytes_per_second);
+		}
+		out.end_object();
+	}
+} // namespace hwctrl::probe
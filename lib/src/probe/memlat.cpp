@@ -0,0 +1,263 @@
+#include <probe/memlat.hpp>
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <string>
+#include <sys/mman.h>
+
+namespace hwctrl::probe {
+	static constexpr size_t HUGE_PAGE_SIZE = size_t{2} << 20u;
+	// loads per iteration of the chase loop
+	static constexpr uint64_t UNROLL = 16;
+	// a rise of more than this factor between consecutive points is part of a boundary
+	static constexpr double BOUNDARY_RATIO = 1.15;
+
+	// private anonymous read/write mapping, unmapped on destruction
+	class anonymous_mapping {
+		public:
+			anonymous_mapping(void* address_, size_t size_) noexcept : address(address_), size(size_) {}
+			anonymous_mapping(const anonymous_mapping&) = delete;
+			anonymous_mapping& operator=(const anonymous_mapping&) = delete;
+			~anonymous_mapping() noexcept {
+				if (address != MAP_FAILED) {
+					::munmap(address, size);
+				}
+			}
+
+			[[nodiscard]] bool valid() const noexcept {
+				return address != MAP_FAILED;
+			}
+
+			[[nodiscard]] unsigned char* data() const noexcept {
+				return static_cast<unsigned char*>(address);
+			}
+		private:
+			void* address = MAP_FAILED;
+			size_t size = 0;
+	};
+
+	[[nodiscard]] std::string_view page_mode_string(page_mode pages) noexcept {
+		switch (pages) {
+			case page_mode::TRANSPARENT_HUGE:
+				return "thp";
+			case page_mode::HUGETLB:
+				return "hugetlb";
+			case page_mode::SMALL:
+				//[[fallthrough]]
+			default:
+				return "small";
+		}
+	}
+
+	[[nodiscard]] std::variant<page_mode, hwctrl_error> parse_page_mode(std::string_view str) noexcept {
+		for (auto pages : {page_mode::SMALL, page_mode::TRANSPARENT_HUGE, page_mode::HUGETLB}) {
+			if (str == page_mode_string(pages)) {
+				return pages;
+			}
+		}
+		return hwctrl_error{"error - unknown page mode " + std::string{str} + ", expected small, thp or hugetlb"};
+	}
+
+	[[nodiscard]] std::vector<size_t> memlat_sizes(const memlat_options& options) noexcept {
+		std::vector<size_t> sizes{};
+		auto line_size = std::max(options.line_size, sizeof(void*));
+		auto steps = std::max(options.steps_per_octave, uint32_t{1});
+		auto min_bytes = std::max(options.min_bytes, line_size * 2);
+		for (uint32_t step = 0;; step++) {
+			auto bytes = static_cast<double>(min_bytes) * std::exp2(static_cast<double>(step) / steps);
+			auto rounded = static_cast<size_t>(bytes) / line_size * line_size;
+			if (rounded > options.max_bytes) {
+				break;
+			}
+			if (sizes.empty() || sizes.back() != rounded) {
+				sizes.push_back(rounded);
+			}
+		}
+		return sizes;
+	}
+
+	// links the first lines of buffer into one random cycle (sattolo), every line holds the address of the next
+	static void build_chain(unsigned char* buffer, size_t lines, size_t line_size, std::vector<uint32_t>& order, std::mt19937_64& rng) noexcept {
+		order.resize(lines);
+		std::iota(order.begin(), order.end(), uint32_t{0});
+		for (size_t i = lines - 1; i > 0; i--) {
+			std::uniform_int_distribution<size_t> pick(0, i - 1);
+			std::swap(order[i], order[pick(rng)]);
+		}
+		for (size_t i = 0; i < lines; i++) {
+			void* next = buffer + order[(i + 1) % lines] * line_size;
+			std::memcpy(buffer + order[i] * line_size, &next, sizeof(next));
+		}
+	}
+
+	// every load depends on the previous one, so the time per load is the latency
+	[[nodiscard]] static const void* chase(const void* start, uint64_t iterations) noexcept {
+		const void* p = start;
+		for (uint64_t i = 0; i < iterations; i++) {
+			for (uint64_t j = 0; j < UNROLL; j++) {
+				p = *static_cast<const void* const*>(p);
+			}
+		}
+		return p;
+	}
+
+	[[nodiscard]] std::variant<std::vector<memlat_point>, hwctrl_error> run_memlat(const memlat_options& options) noexcept {
+		auto sizes = memlat_sizes(options);
+		if (sizes.empty()) {
+			return hwctrl_error{"error - no working set sizes between " + std::to_string(options.min_bytes) + " and " + std::to_string(options.max_bytes) + " bytes"};
+		}
+		auto line_size = std::max(options.line_size, sizeof(void*));
+		// lines are numbered with uint32_t
+		if (sizes.back() / line_size > UINT32_MAX) {
+			return hwctrl_error{"error - working set of " + std::to_string(sizes.back()) + " bytes is too large"};
+		}
+		auto mapping_size = (sizes.back() + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+		int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+		if (options.pages == page_mode::HUGETLB) {
+			// without a size the kernel takes the default hugepage size, which is 1 GiB on some hosts and would fail for a 2 MiB multiple
+			flags |= MAP_HUGETLB | std::countr_zero(HUGE_PAGE_SIZE) << MAP_HUGE_SHIFT;
+		}
+		anonymous_mapping mapping(::mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, flags, -1, 0), mapping_size);
+		if (!mapping.valid()) {
+			return hwctrl_error{"error - could not map " + std::to_string(mapping_size) + " bytes" + (options.pages == page_mode::HUGETLB ? " of 2 MiB huge pages, reserve them with \"hwctrl hugepages set --size 2m\" or /sys/kernel/mm/hugepages/hugepages-2048kB/nr_hugepages" : "")};
+		}
+		if (options.pages == page_mode::TRANSPARENT_HUGE) {
+			::madvise(mapping.data(), mapping_size, MADV_HUGEPAGE);
+		}
+
+		// fixed seed so runs are comparable
+		std::mt19937_64 rng(0x9e3779b97f4a7c15u);
+		std::vector<uint32_t> order{};
+		std::vector<memlat_point> points{};
+		const void* sink = nullptr;
+		for (auto bytes : sizes) {
+			auto lines = bytes / line_size;
+			build_chain(mapping.data(), lines, line_size, order, rng);
+			auto iterations = (std::max<uint64_t>(options.accesses, lines) + UNROLL - 1) / UNROLL;
+			// one pass to load caches and tlb
+			sink = chase(mapping.data(), (lines + UNROLL - 1) / UNROLL);
+			auto start = std::chrono::steady_clock::now();
+			sink = chase(sink, iterations);
+			auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			points.push_back({bytes, seconds * 1e9 / static_cast<double>(iterations * UNROLL)});
+		}
+		// keep the chase from being optimized away
+		if (sink == nullptr) {
+			return hwctrl_error{"error - broken pointer chain"};
+		}
+		return points;
+	}
+
+	[[nodiscard]] std::vector<latency_boundary> detect_latency_boundaries(std::span<const memlat_point> points, std::span<const uint64_t> cache_bytes) noexcept {
+		std::vector<latency_boundary> boundaries{};
+		size_t i = 0;
+		while (i + 1 < points.size()) {
+			if (points[i + 1].ns_per_access <= points[i].ns_per_access * BOUNDARY_RATIO) {
+				i++;
+				continue;
+			}
+			// a boundary spans every consecutive rising step
+			size_t end = i + 1;
+			while (end + 1 < points.size() && points[end + 1].ns_per_access > points[end].ns_per_access * BOUNDARY_RATIO) {
+				end++;
+			}
+			latency_boundary boundary{};
+			boundary.bytes = points[i].bytes;
+			boundary.ns_before = points[i].ns_per_access;
+			boundary.ns_after = points[end].ns_per_access;
+			boundary.end_bytes = points[end].bytes;
+			// replacement and associativity start the rise before the cache is full, take the level nearest to its start
+			double best_distance = 0;
+			for (size_t level = 0; level < cache_bytes.size(); level++) {
+				if (cache_bytes[level] == 0 || cache_bytes[level] < boundary.bytes / 2 || cache_bytes[level] > boundary.end_bytes * 2) {
+					continue;
+				}
+				auto distance = std::abs(std::log2(static_cast<double>(cache_bytes[level]) / static_cast<double>(boundary.bytes)));
+				if (boundary.cache_level == 0 || distance < best_distance) {
+					boundary.cache_level = static_cast<uint32_t>(level + 1);
+					boundary.cache_bytes = cache_bytes[level];
+					best_distance = distance;
+				}
+			}
+			boundaries.push_back(boundary);
+			i = end;
+		}
+		return boundaries;
+	}
+
+	[[nodiscard]] static dram_latency make_dram_latency(std::string_view profile, uint32_t mt, const memory_timing& tCL, const memory_timing& tRCD, const memory_timing& tRP) noexcept {
+		dram_latency latency{};
+		latency.profile = profile;
+		latency.mt = mt;
+		latency.tCL_ns = tCL.timing_picoseconds / 1000.0;
+		latency.tRCD_ns = tRCD.timing_picoseconds / 1000.0;
+		latency.tRP_ns = tRP.timing_picoseconds / 1000.0;
+		latency.row_hit_ns = latency.tCL_ns;
+		latency.row_miss_ns = latency.tRCD_ns + latency.tCL_ns;
+		latency.row_conflict_ns = latency.tRP_ns + latency.tRCD_ns + latency.tCL_ns;
+		return latency;
+	}
+
+	[[nodiscard]] std::vector<dram_latency> dram_latency_from_spd(const source::spd& spd_parsed) noexcept {
+		std::vector<dram_latency> latencies{};
+		const auto* ddr4_ptr = std::get_if<source::spd_ddr4>(&spd_parsed);
+		if (ddr4_ptr == nullptr) {
+			return latencies;
+		}
+		latencies.push_back(make_dram_latency("jedec", ddr4_ptr->clock_max.clock_mt, ddr4_ptr->tCL_min, ddr4_ptr->tRCD_min, ddr4_ptr->tRP_min));
+		if (ddr4_ptr->xmp_data != std::nullopt) {
+			constexpr std::string_view PROFILE_NAMES[] = {"xmp1", "xmp2"};
+			for (size_t i = 0; i < std::size(PROFILE_NAMES); i++) {
+				const auto& profile = ddr4_ptr->xmp_data->profiles[i];
+				if (profile.enable) {
+					latencies.push_back(make_dram_latency(PROFILE_NAMES[i], profile.clk.clock_mt, profile.tCL, profile.tRCD, profile.tRP));
+				}
+			}
+		}
+		return latencies;
+	}
+
+	void write_memlat_point(util::writer& out, const memlat_point& point) noexcept {
+		out.begin_object();
+		out.field("bytes", point.bytes);
+		out.field("ns", point.ns_per_access);
+		out.end_object();
+	}
+
+	void write_latency_summary(util::writer& out, std::span<const latency_boundary> boundaries, std::span<const dram_latency> dram) noexcept {
+		out.begin_object();
+		out.begin_array("boundaries");
+		for (const auto& boundary : boundaries) {
+			out.begin_object();
+			out.field("bytes", boundary.bytes);
+			out.field("end_bytes", boundary.end_bytes);
+			out.field("ns_before", boundary.ns_before);
+			out.field("ns_after", boundary.ns_after);
+			if (boundary.cache_level != 0) {
+				out.field("cache_level", boundary.cache_level);
+				out.field("cache_bytes", boundary.cache_bytes);
+			}
+			out.end_object();
+		}
+		out.end_array();
+		out.begin_array("dram");
+		for (const auto& latency : dram) {
+			out.begin_object();
+			out.field("profile", latency.profile);
+			out.field("mt", latency.mt);
+			out.field("tCL_ns", latency.tCL_ns);
+			out.field("tRCD_ns", latency.tRCD_ns);
+			out.field("tRP_ns", latency.tRP_ns);
+			out.field("row_hit_ns", latency.row_hit_ns);
+			out.field("row_miss_ns", latency.row_miss_ns);
+			out.field("row_conflict_ns", latency.row_conflict_ns);
+			out.end_object();
+		}
+		out.end_array();
+		out.end_object();
+	}
+} // namespace hwctrl::probe
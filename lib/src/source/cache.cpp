@@ -0,0 +1,241 @@
+#include <source/cache.hpp>
+#include <util/sysfs.hpp>
+#include <algorithm>
+#include <charconv>
+#include <map>
+#include <optional>
+#include <string>
+#include <tuple>
+
+namespace hwctrl::source {
+	// a cache while reading, before the cpus are flattened
+	struct cache_entry {
+		cpu_cache cache{};
+		std::vector<uint32_t> cpus{};
+	};
+
+	[[nodiscard]] std::span<const uint32_t> cache_topology::shared_cpus(size_t cache_index) const noexcept {
+		if (cache_index >= caches.size()) {
+			return {};
+		}
+		return std::span<const uint32_t>{cpus}.subspan(caches[cache_index].cpu_offset, caches[cache_index].cpu_count);
+	}
+
+	[[nodiscard]] std::span<const uint32_t> cache_topology::cpu_caches(uint32_t cpu) const noexcept {
+		if (size_t{cpu} + 1 >= cpu_offsets.size()) {
+			return {};
+		}
+		return std::span<const uint32_t>{cache_indices}.subspan(cpu_offsets[cpu], cpu_offsets[cpu + 1] - cpu_offsets[cpu]);
+	}
+
+	[[nodiscard]] const cpu_cache* cache_topology::find(uint32_t cpu, uint32_t level) const noexcept {
+		for (auto index : cpu_caches(cpu)) {
+			const auto& cache = caches[index];
+			if (cache.level == level && cache.type != cpu_cache::INSTRUCTION) {
+				return &cache;
+			}
+		}
+		return nullptr;
+	}
+
+	[[nodiscard]] std::vector<uint32_t> cache_topology::domains(uint32_t level) const noexcept {
+		std::vector<uint32_t> indices{};
+		for (size_t index = 0; index < caches.size(); index++) {
+			if (caches[index].level == level && caches[index].type != cpu_cache::INSTRUCTION) {
+				indices.push_back(static_cast<uint32_t>(index));
+			}
+		}
+		return indices;
+	}
+
+	[[nodiscard]] uint32_t cache_topology::max_level() const noexcept {
+		uint32_t level = 0;
+		for (const auto& cache : caches) {
+			level = std::max(level, cache.level);
+		}
+		return level;
+	}
+
+	[[nodiscard]] uint32_t cache_topology::line_size() const noexcept {
+		uint32_t size = 0;
+		for (const auto& cache : caches) {
+			size = std::max(size, cache.line_size);
+		}
+		return size == 0 ? 64 : size;
+	}
+
+	[[nodiscard]] std::variant<uint64_t, hwctrl_error> parse_cache_size(std::string_view str) noexcept {
+		uint64_t value = 0;
+		auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+		if (ec != std::errc{}) {
+			return hwctrl_error{"error - invalid cache size \"" + std::string(str) + "\""};
+		}
+		auto suffix = str.substr(static_cast<size_t>(end - str.data()));
+		if (suffix.empty() || suffix.front() == '\n') {
+			return value;
+		}
+		switch (suffix.front()) {
+			case 'K':
+				return value << 10u;
+			case 'M':
+				return value << 20u;
+			case 'G':
+				return value << 30u;
+			default:
+				return hwctrl_error{"error - invalid cache size \"" + std::string(str) + "\""};
+		}
+	}
+
+	[[nodiscard]] std::string_view cache_type_string(cpu_cache::cache_type type) noexcept {
+		switch (type) {
+			case cpu_cache::DATA:
+				return "data";
+			case cpu_cache::INSTRUCTION:
+				return "instruction";
+			case cpu_cache::UNIFIED:
+				return "unified";
+			case cpu_cache::UNKNOWN_TYPE:
+				//[[fallthrough]]
+				return "unknown";
+			default:
+				return "unknown";
+		}
+	}
+
+	[[nodiscard]] static cpu_cache::cache_type parse_cache_type(std::string_view str) noexcept {
+		if (str == "Data") {
+			return cpu_cache::DATA;
+		} else if (str == "Instruction") {
+			return cpu_cache::INSTRUCTION;
+		} else if (str == "Unified") {
+			return cpu_cache::UNIFIED;
+		}
+		return cpu_cache::UNKNOWN_TYPE;
+	}
+
+	[[nodiscard]] static uint32_t read_cache_uint(const std::filesystem::path& path, uint32_t fallback) noexcept {
+		auto value = util::sysfs::read_uint(path);
+		return std::holds_alternative<uint64_t>(value) ? static_cast<uint32_t>(std::get<uint64_t>(value)) : fallback;
+	}
+
+	// reads the details of a cache, called once per distinct cache
+	static void read_cache_details(const std::filesystem::path& path, cpu_cache& cache) noexcept {
+		cache.id = read_cache_uint(path / "id", cpu_cache::UNKNOWN_ID);
+		cache.line_size = read_cache_uint(path / "coherency_line_size", 0);
+		cache.ways = read_cache_uint(path / "ways_of_associativity", 0);
+		cache.sets = read_cache_uint(path / "number_of_sets", 0);
+		auto size = util::sysfs::read_string(path / "size");
+		if (const auto* size_ptr = std::get_if<std::string>(&size)) {
+			auto size_bytes = parse_cache_size(*size_ptr);
+			if (const auto* bytes_ptr = std::get_if<uint64_t>(&size_bytes)) {
+				cache.size_bytes = *bytes_ptr;
+			}
+		}
+	}
+
+	[[nodiscard]] std::variant<cache_topology, hwctrl_error> read_cache_topology(const std::filesystem::path& sysfs_root) noexcept {
+		std::vector<std::pair<uint32_t, std::filesystem::path>> cpu_dirs{};
+		util::sysfs::for_each_numbered_entry(sysfs_root / "devices/system/cpu", "cpu", [&](uint32_t id, const std::filesystem::path& path) noexcept {
+			cpu_dirs.emplace_back(id, path);
+		});
+		// ascending so the first cpu of every shared cache is visited first
+		std::sort(cpu_dirs.begin(), cpu_dirs.end());
+
+		std::vector<cache_entry> entries{};
+		std::map<std::tuple<uint32_t, cpu_cache::cache_type, std::vector<uint32_t>>, size_t> entry_by_key{};
+		std::optional<hwctrl_error> error{};
+		for (const auto& [cpu, cpu_path] : cpu_dirs) {
+			util::sysfs::for_each_numbered_entry(cpu_path / "cache", "index", [&](uint32_t, const std::filesystem::path& path) noexcept {
+				auto level = util::sysfs::read_uint(path / "level");
+				auto type = util::sysfs::read_string(path / "type");
+				if (!std::holds_alternative<uint64_t>(level) || !std::holds_alternative<std::string>(type)) {
+					return;
+				}
+				std::vector<uint32_t> shared{};
+				auto shared_list = util::sysfs::read_string(path / "shared_cpu_list");
+				if (const auto* list_ptr = std::get_if<std::string>(&shared_list)) {
+					auto ids = util::sysfs::parse_id_list(*list_ptr);
+					if (auto* err_ptr = std::get_if<hwctrl_error>(&ids)) {
+						error = std::move(*err_ptr);
+						return;
+					}
+					shared = std::move(std::get<std::vector<uint32_t>>(ids));
+				}
+				// a cache always serves the cpu it is listed under
+				if (!std::binary_search(shared.begin(), shared.end(), cpu)) {
+					shared.insert(std::lower_bound(shared.begin(), shared.end(), cpu), cpu);
+				}
+				std::tuple key{static_cast<uint32_t>(std::get<uint64_t>(level)), parse_cache_type(std::get<std::string>(type)), std::move(shared)};
+				if (entry_by_key.contains(key)) {
+					return;
+				}
+				cache_entry entry{};
+				entry.cache.level = std::get<0>(key);
+				entry.cache.type = std::get<1>(key);
+				entry.cpus = std::get<2>(key);
+				read_cache_details(path, entry.cache);
+				entry_by_key.emplace(std::move(key), entries.size());
+				entries.push_back(std::move(entry));
+			});
+			if (error != std::nullopt) {
+				return std::move(error.value());
+			}
+		}
+		if (entries.empty()) {
+			return hwctrl_error{"error - no caches found in \"" + (sysfs_root / "devices/system/cpu").string() + "\""};
+		}
+
+		std::sort(entries.begin(), entries.end(), [](const cache_entry& a, const cache_entry& b) noexcept {
+			return std::tuple{a.cache.level, a.cache.type, a.cpus.front()} < std::tuple{b.cache.level, b.cache.type, b.cpus.front()};
+		});
+		cache_topology topology{};
+		uint32_t max_cpu = 0;
+		for (auto& entry : entries) {
+			entry.cache.cpu_offset = static_cast<uint32_t>(topology.cpus.size());
+			entry.cache.cpu_count = static_cast<uint32_t>(entry.cpus.size());
+			topology.cpus.insert(topology.cpus.end(), entry.cpus.begin(), entry.cpus.end());
+			topology.caches.push_back(entry.cache);
+			max_cpu = std::max(max_cpu, entry.cpus.back());
+		}
+		// counting sort of (cpu, cache) pairs, caches stay in table order for every cpu
+		std::vector<uint32_t> counts(size_t{max_cpu} + 1, 0);
+		for (auto cpu : topology.cpus) {
+			counts[cpu]++;
+		}
+		topology.cpu_offsets.assign(size_t{max_cpu} + 2, 0);
+		for (size_t cpu = 0; cpu <= max_cpu; cpu++) {
+			topology.cpu_offsets[cpu + 1] = topology.cpu_offsets[cpu] + counts[cpu];
+		}
+		topology.cache_indices.resize(topology.cpus.size());
+		std::vector<uint32_t> next(topology.cpu_offsets.begin(), topology.cpu_offsets.end() - 1);
+		for (size_t index = 0; index < topology.caches.size(); index++) {
+			for (auto cpu : topology.shared_cpus(index)) {
+				topology.cache_indices[next[cpu]++] = static_cast<uint32_t>(index);
+			}
+		}
+		return topology;
+	}
+
+	void write_cache_topology(util::writer& out, const cache_topology& topology) noexcept {
+		out.begin_object();
+		out.begin_array("caches");
+		for (size_t index = 0; index < topology.caches.size(); index++) {
+			const auto& cache = topology.caches[index];
+			auto cpus = topology.shared_cpus(index);
+			out.begin_object();
+			out.field("level", cache.level);
+			out.field("type", cache_type_string(cache.type));
+			if (cache.id != cpu_cache::UNKNOWN_ID) {
+				out.field("id", cache.id);
+			}
+			out.field("size_bytes", cache.size_bytes);
+			out.field("line_size", cache.line_size);
+			out.field("ways", cache.ways);
+			out.field("sets", cache.sets);
+			out.field("cpus", util::sysfs::id_list_string({cpus.begin(), cpus.end()}));
+			out.end_object();
+		}
+		out.end_array();
+		out.end_object();
+	}
+} // namespace hwctrl::source
@@ -0,0 +1,49 @@
+#include <source/cpu_features.hpp>
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace hwctrl::source {
+	// feature names sorted at compile time so a flag is found with a binary search instead of a scan
+	static constexpr auto SORTED_CPU_FEATURES = []() noexcept {
+		std::array<std::pair<std::string_view, cpu_feature>, CPU_FEATURE_COUNT> table{};
+		for (size_t i = 0; i < CPU_FEATURE_COUNT; i++) {
+			table[i] = {CPU_FEATURE_NAMES[i], static_cast<cpu_feature>(i)};
+		}
+		std::sort(table.begin(), table.end());
+		return table;
+	}();
+
+	static_assert(CPU_FEATURE_TABLE.size() == CPU_FEATURE_COUNT, "CPU_FEATURE_TABLE needs one entry per cpu_feature");
+	static_assert([]() noexcept {
+		for (size_t i = 0; i < CPU_FEATURE_TABLE.size(); i++) {
+			if (static_cast<size_t>(CPU_FEATURE_TABLE[i].feature) != i || CPU_FEATURE_TABLE[i].name.empty()) {
+				return false;
+			}
+		}
+		return true;
+	}(), "CPU_FEATURE_TABLE entries must be in cpu_feature order");
+
+	[[nodiscard]] cpu_feature find_cpu_feature(std::string_view name) noexcept {
+		auto it = std::lower_bound(SORTED_CPU_FEATURES.begin(), SORTED_CPU_FEATURES.end(), name, [](const auto& entry, std::string_view key) noexcept {
+			return entry.first < key;
+		});
+		return it != SORTED_CPU_FEATURES.end() && it->first == name ? it->second : cpu_feature::COUNT;
+	}
+
+	[[nodiscard]] cpu_feature_set parse_cpu_flags(std::string_view flags) noexcept {
+		cpu_feature_set features{};
+		const char* current = flags.data();
+		const char* const end = flags.data() + flags.size();
+		while (current != end) {
+			const auto* space = static_cast<const char*>(std::memchr(current, ' ', static_cast<size_t>(end - current)));
+			const char* flag_end = space != nullptr ? space : end;
+			auto feature = find_cpu_feature({current, static_cast<size_t>(flag_end - current)});
+			if (feature != cpu_feature::COUNT) {
+				features.set(feature);
+			}
+			current = space != nullptr ? space + 1 : end;
+		}
+		return features;
+	}
+} // namespace hwctrl::source
@@ -0,0 +1,155 @@
+#include <source/cpufreq.hpp>
+#include <util/spsc_ring.hpp>
+#include <util/sysfs.hpp>
+#include <algorithm>
+#include <charconv>
+#include <cerrno>
+#include <thread>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace hwctrl::source {
+	// how long the writer thread sleeps when the ring is empty
+	static constexpr std::chrono::milliseconds CPUFREQ_DRAIN_INTERVAL{10};
+
+	cpufreq_sampler::cpufreq_sampler(std::vector<uint32_t> cpu_ids, std::vector<util::file::unique_fd> cpu_files) noexcept : ids(std::move(cpu_ids)), files(std::move(cpu_files)) {
+	}
+
+	[[nodiscard]] const std::vector<uint32_t>& cpufreq_sampler::cpus() const noexcept {
+		return ids;
+	}
+
+	void cpufreq_sampler::sample(std::span<uint64_t> khz) const noexcept {
+		for (size_t i = 0; i < files.size() && i < khz.size(); i++) {
+			char buffer[32];
+			ssize_t count = ::pread(files[i].get(), buffer, sizeof(buffer), 0);
+			uint64_t value = 0;
+			if (count > 0) {
+				std::from_chars(buffer, buffer + count, value);
+			}
+			khz[i] = value;
+		}
+	}
+
+	[[nodiscard]] std::variant<cpufreq_sampler, hwctrl_error> open_cpufreq_sampler(const std::filesystem::path& sysfs_root) noexcept {
+		std::vector<std::pair<uint32_t, std::filesystem::path>> entries{};
+		util::sysfs::for_each_numbered_entry(sysfs_root / "devices/system/cpu", "cpu", [&](uint32_t id, const std::filesystem::path& path) noexcept {
+			entries.emplace_back(id, path / "cpufreq/scaling_cur_freq");
+		});
+		std::sort(entries.begin(), entries.end());
+		std::vector<uint32_t> ids{};
+		std::vector<util::file::unique_fd> files{};
+		for (const auto& [id, path] : entries) {
+			// offline cpus and cpus without a cpufreq driver have no scaling_cur_freq
+			util::file::unique_fd fd{::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+			if (fd.valid()) {
+				ids.push_back(id);
+				files.push_back(std::move(fd));
+			}
+		}
+		if (ids.empty()) {
+			return hwctrl_error{"error - no cpufreq scaling_cur_freq found below \"" + (sysfs_root / "devices/system/cpu").string() + "\""};
+		}
+		return cpufreq_sampler{std::move(ids), std::move(files)};
+	}
+
+	[[nodiscard]] static uint64_t monotonic_ns() noexcept {
+		timespec now{};
+		::clock_gettime(CLOCK_MONOTONIC, &now);
+		return static_cast<uint64_t>(now.tv_sec) * 1'000'000'000u + static_cast<uint64_t>(now.tv_nsec);
+	}
+
+	static void sleep_until_ns(uint64_t deadline) noexcept {
+		timespec time{static_cast<time_t>(deadline / 1'000'000'000u), static_cast<long>(deadline % 1'000'000'000u)};
+		// an interrupted sleep returns early so the caller notices stop
+		::clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &time, nullptr);
+	}
+
+	[[nodiscard]] cpufreq_monitor_stats monitor_cpufreq(const cpufreq_sampler& sampler, const cpufreq_monitor_options& options, util::writer& out, const std::atomic<bool>& stop) noexcept {
+		// one ring record is the timestamp followed by the frequency of every cpu
+		const size_t stride = sampler.cpus().size() + 1;
+		const auto interval_ns = static_cast<uint64_t>(std::max(options.interval, std::chrono::microseconds{1}).count()) * 1000u;
+		util::spsc_ring<uint64_t> ring(stride * std::max(options.buffer_ticks, size_t{1}));
+		std::atomic<bool> sampling_done{false};
+		cpufreq_monitor_stats stats{};
+
+		out.flush_each_value(false);
+		out.begin_object();
+		out.field("interval_us", options.interval.count());
+		out.begin_array("cpus");
+		for (auto cpu : sampler.cpus()) {
+			out.value(cpu);
+		}
+		out.end_array();
+		out.end_object();
+		out.flush();
+
+		std::thread drain([&]() noexcept {
+			std::vector<uint64_t> record(stride);
+			while (true) {
+				// checked before popping so records pushed before done was set are still drained
+				bool done = sampling_done.load(std::memory_order_acquire);
+				if (ring.try_pop(record)) {
+					out.begin_object();
+					out.field("time_ns", record[0]);
+					out.begin_array("khz");
+					for (size_t i = 1; i < stride; i++) {
+						out.value(record[i]);
+					}
+					out.end_array();
+					out.end_object();
+					continue;
+				}
+				out.flush();
+				if (done) {
+					break;
+				}
+				std::this_thread::sleep_for(CPUFREQ_DRAIN_INTERVAL);
+			}
+		});
+
+		std::vector<uint64_t> record(stride);
+		const uint64_t start = monotonic_ns();
+		const uint64_t end = options.duration.count() > 0 ? start + static_cast<uint64_t>(options.duration.count()) * 1000u : UINT64_MAX;
+		uint64_t deadline = start;
+		while (!stop.load(std::memory_order_relaxed)) {
+			uint64_t now = monotonic_ns();
+			if (now < deadline) {
+				// woken early by a signal
+				sleep_until_ns(deadline);
+				continue;
+			}
+			if (now >= end) {
+				break;
+			}
+			record[0] = now;
+			sampler.sample(std::span{record}.subspan(1));
+			if (ring.try_push(record)) {
+				stats.ticks++;
+			} else {
+				stats.dropped_ticks++;
+			}
+			deadline += interval_ns;
+			now = monotonic_ns();
+			if (now > deadline) {
+				// skip the deadlines that already passed instead of sampling in a burst
+				uint64_t missed = (now - deadline) / interval_ns + 1;
+				stats.missed_ticks += missed;
+				deadline += missed * interval_ns;
+			}
+			sleep_until_ns(deadline);
+		}
+		sampling_done.store(true, std::memory_order_release);
+		drain.join();
+
+		out.begin_object();
+		out.field("ticks", stats.ticks);
+		out.field("dropped_ticks", stats.dropped_ticks);
+		out.field("missed_ticks", stats.missed_ticks);
+		out.end_object();
+		out.flush();
+		out.flush_each_value(true);
+		return stats;
+	}
+} // namespace hwctrl::source
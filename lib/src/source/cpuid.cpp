@@ -0,0 +1,315 @@
+#include <source/cpuid.hpp>
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace hwctrl::source {
+	static constexpr uint32_t EXTENDED_LEAVES = 0x80000000u;
+	// leaves with a register bit per feature
+	struct cpuid_feature_bit {
+		uint32_t leaf = 0;
+		uint32_t subleaf = 0;
+		// 0 eax, 1 ebx, 2 ecx, 3 edx
+		uint8_t reg = 0;
+		uint8_t bit = 0;
+		cpu_feature feature = cpu_feature::COUNT;
+	};
+
+	static constexpr cpuid_feature_bit CPUID_FEATURE_BITS[] = {
+		{1, 0, 3, 26, cpu_feature::SSE2},
+		{1, 0, 2, 0, cpu_feature::SSE3},
+		{1, 0, 2, 1, cpu_feature::PCLMULQDQ},
+		{1, 0, 2, 9, cpu_feature::SSSE3},
+		{1, 0, 2, 12, cpu_feature::FMA},
+		{1, 0, 2, 13, cpu_feature::CX16},
+		{1, 0, 2, 19, cpu_feature::SSE4_1},
+		{1, 0, 2, 20, cpu_feature::SSE4_2},
+		{1, 0, 2, 21, cpu_feature::X2APIC},
+		{1, 0, 2, 22, cpu_feature::MOVBE},
+		{1, 0, 2, 23, cpu_feature::POPCNT},
+		{1, 0, 2, 25, cpu_feature::AES},
+		{1, 0, 2, 28, cpu_feature::AVX},
+		{1, 0, 2, 29, cpu_feature::F16C},
+		{1, 0, 2, 30, cpu_feature::RDRAND},
+		{1, 0, 2, 31, cpu_feature::HYPERVISOR},
+		{6, 0, 2, 0, cpu_feature::APERFMPERF},
+		{7, 0, 1, 3, cpu_feature::BMI1},
+		{7, 0, 1, 4, cpu_feature::HLE},
+		{7, 0, 1, 5, cpu_feature::AVX2},
+		{7, 0, 1, 8, cpu_feature::BMI2},
+		{7, 0, 1, 9, cpu_feature::ERMS},
+		{7, 0, 1, 11, cpu_feature::RTM},
+		{7, 0, 1, 16, cpu_feature::AVX512F},
+		{7, 0, 1, 17, cpu_feature::AVX512DQ},
+		{7, 0, 1, 18, cpu_feature::RDSEED},
+		{7, 0, 1, 19, cpu_feature::ADX},
+		{7, 0, 1, 21, cpu_feature::AVX512IFMA},
+		{7, 0, 1, 23, cpu_feature::CLFLUSHOPT},
+		{7, 0, 1, 24, cpu_feature::CLWB},
+		{7, 0, 1, 28, cpu_feature::AVX512CD},
+		{7, 0, 1, 29, cpu_feature::SHA},
+		{7, 0, 1, 30, cpu_feature::AVX512BW},
+		{7, 0, 1, 31, cpu_feature::AVX512VL},
+		{7, 0, 2, 1, cpu_feature::AVX512VBMI},
+		{7, 0, 2, 6, cpu_feature::AVX512_VBMI2},
+		{7, 0, 2, 8, cpu_feature::GFNI},
+		{7, 0, 2, 9, cpu_feature::VAES},
+		{7, 0, 2, 10, cpu_feature::VPCLMULQDQ},
+		{7, 0, 2, 11, cpu_feature::AVX512_VNNI},
+		{7, 0, 2, 12, cpu_feature::AVX512_BITALG},
+		{7, 0, 2, 14, cpu_feature::AVX512_VPOPCNTDQ},
+		{7, 0, 3, 4, cpu_feature::FSRM},
+		{7, 0, 3, 22, cpu_feature::AMX_BF16},
+		{7, 0, 3, 23, cpu_feature::AVX512_FP16},
+		{7, 0, 3, 24, cpu_feature::AMX_TILE},
+		{7, 0, 3, 25, cpu_feature::AMX_INT8},
+		{7, 1, 0, 4, cpu_feature::AVX_VNNI},
+		{7, 1, 0, 5, cpu_feature::AVX512_BF16},
+		{0x80000001u, 0, 2, 5, cpu_feature::LZCNT},
+		{0x80000007u, 0, 3, 8, cpu_feature::CONSTANT_TSC}
+	};
+
+	// xcr0 state components the os has to save before the registers may be used
+	static constexpr uint64_t XCR0_AVX = 0x6;
+	static constexpr uint64_t XCR0_AVX512 = 0xe6;
+	static constexpr uint64_t XCR0_AMX = 0x60000;
+
+	[[nodiscard]] std::optional<cpuid_registers> cpuid(uint32_t leaf, uint32_t subleaf) noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+		if (leaf > __get_cpuid_max(leaf & EXTENDED_LEAVES, nullptr)) {
+			return std::nullopt;
+		}
+		cpuid_registers regs{};
+		__cpuid_count(leaf, subleaf, regs.eax, regs.ebx, regs.ecx, regs.edx);
+		return regs;
+#else
+		static_cast<void>(leaf);
+		static_cast<void>(subleaf);
+		return std::nullopt;
+#endif
+	}
+
+	[[nodiscard]] static uint64_t read_xcr0() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+		// xgetbv faults unless the os enabled xsave
+		auto leaf1 = cpuid(1);
+		if (leaf1 == std::nullopt || (leaf1->ecx & (1u << 27u)) == 0) {
+			return 0;
+		}
+		uint32_t eax = 0;
+		uint32_t edx = 0;
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return eax | (uint64_t{edx} << 32u);
+#else
+		return 0;
+#endif
+	}
+
+	[[nodiscard]] static uint32_t register_value(const cpuid_registers& regs, uint8_t reg) noexcept {
+		switch (reg) {
+			case 0:
+				return regs.eax;
+			case 1:
+				return regs.ebx;
+			case 2:
+				return regs.ecx;
+			default:
+				return regs.edx;
+		}
+	}
+
+	[[nodiscard]] cpu_feature_set read_cpuid_features() noexcept {
+		cpu_feature_set features{};
+		// the table is grouped by leaf so each leaf runs once
+		std::optional<cpuid_registers> regs{};
+		uint32_t current_leaf = 0;
+		uint32_t current_subleaf = 0;
+		for (const auto& entry : CPUID_FEATURE_BITS) {
+			if (!regs.has_value() || entry.leaf != current_leaf || entry.subleaf != current_subleaf) {
+				regs = cpuid(entry.leaf, entry.subleaf);
+				current_leaf = entry.leaf;
+				current_subleaf = entry.subleaf;
+			}
+			if (regs != std::nullopt && ((register_value(regs.value(), entry.reg) >> entry.bit) & 1u) != 0) {
+				features.set(entry.feature);
+			}
+		}
+		// the cpu may support wide registers the kernel does not save, the cpuinfo flags are cleared the same way
+		auto xcr0 = read_xcr0();
+		if ((xcr0 & XCR0_AVX) != XCR0_AVX) {
+			for (auto feature : {cpu_feature::AVX, cpu_feature::AVX2, cpu_feature::FMA, cpu_feature::F16C, cpu_feature::AVX_VNNI, cpu_feature::VAES, cpu_feature::VPCLMULQDQ}) {
+				features.set(feature, false);
+			}
+		}
+		if ((xcr0 & XCR0_AVX512) != XCR0_AVX512) {
+			for (auto feature : {cpu_feature::AVX512F, cpu_feature::AVX512DQ, cpu_feature::AVX512CD, cpu_feature::AVX512BW, cpu_feature::AVX512VL, cpu_feature::AVX512IFMA, cpu_feature::AVX512VBMI, cpu_feature::AVX512_VBMI2, cpu_feature::AVX512_VNNI, cpu_feature::AVX512_BITALG, cpu_feature::AVX512_VPOPCNTDQ, cpu_feature::AVX512_BF16, cpu_feature::AVX512_FP16}) {
+				features.set(feature, false);
+			}
+		}
+		if ((xcr0 & XCR0_AMX) != XCR0_AMX) {
+			for (auto feature : {cpu_feature::AMX_TILE, cpu_feature::AMX_INT8, cpu_feature::AMX_BF16}) {
+				features.set(feature, false);
+			}
+		}
+		return features;
+	}
+
+	[[nodiscard]] const cpu_feature_set& host_cpu_features() noexcept {
+		static const cpu_feature_set features = read_cpuid_features();
+		return features;
+	}
+
+	static void append_register_string(std::string& str, uint32_t value) noexcept {
+		char bytes[4];
+		std::memcpy(bytes, &value, sizeof(bytes));
+		str.append(bytes, sizeof(bytes));
+	}
+
+	// leaf 4 and 0x8000001d share the layout, the subleaf walk ends at a null cache type
+	static void read_cpuid_caches(uint32_t leaf, std::vector<cpuid_cache>& caches) noexcept {
+		for (uint32_t subleaf = 0;; subleaf++) {
+			auto regs = cpuid(leaf, subleaf);
+			if (regs == std::nullopt || (regs->eax & 0x1fu) == 0) {
+				break;
+			}
+			cpuid_cache cache{};
+			switch (regs->eax & 0x1fu) {
+				case 1:
+					cache.type = cpu_cache::DATA;
+					break;
+				case 2:
+					cache.type = cpu_cache::INSTRUCTION;
+					break;
+				case 3:
+					cache.type = cpu_cache::UNIFIED;
+					break;
+				default:
+					cache.type = cpu_cache::UNKNOWN_TYPE;
+			}
+			cache.level = (regs->eax >> 5u) & 0x7u;
+			cache.max_sharing = ((regs->eax >> 14u) & 0xfffu) + 1;
+			cache.line_size = (regs->ebx & 0xfffu) + 1;
+			uint32_t partitions = ((regs->ebx >> 12u) & 0x3ffu) + 1;
+			uint32_t ways = ((regs->ebx >> 22u) & 0x3ffu) + 1;
+			cache.sets = regs->ecx + 1;
+			cache.size_bytes = uint64_t{ways} * partitions * cache.line_size * cache.sets;
+			cache.ways = (regs->eax & (1u << 9u)) != 0 ? 0 : ways;
+			cache.inclusive = (regs->edx & (1u << 1u)) != 0;
+			caches.push_back(cache);
+		}
+	}
+
+	[[nodiscard]] std::variant<cpuid_info, hwctrl_error> read_cpuid() noexcept {
+		auto leaf0 = cpuid(0);
+		if (leaf0 == std::nullopt) {
+			return hwctrl_error{"error - cpuid is not available on this architecture"};
+		}
+		cpuid_info info{};
+		append_register_string(info.vendor_id, leaf0->ebx);
+		append_register_string(info.vendor_id, leaf0->edx);
+		append_register_string(info.vendor_id, leaf0->ecx);
+
+		if (auto leaf1 = cpuid(1); leaf1 != std::nullopt) {
+			uint32_t base_family = (leaf1->eax >> 8u) & 0xfu;
+			uint32_t base_model = (leaf1->eax >> 4u) & 0xfu;
+			info.stepping = leaf1->eax & 0xfu;
+			info.family = base_family == 0xf ? base_family + ((leaf1->eax >> 20u) & 0xffu) : base_family;
+			info.model = base_family == 0x6 || base_family == 0xf ? (((leaf1->eax >> 16u) & 0xfu) << 4u) + base_model : base_model;
+		}
+		for (uint32_t leaf = 0x80000002u; leaf <= 0x80000004u; leaf++) {
+			if (auto regs = cpuid(leaf); regs != std::nullopt) {
+				for (auto value : {regs->eax, regs->ebx, regs->ecx, regs->edx}) {
+					append_register_string(info.brand, value);
+				}
+			}
+		}
+		// the brand string is null padded and often space padded in front
+		info.brand.erase(info.brand.find_last_not_of(std::string_view{"\0 ", 2}) + 1);
+		info.brand.erase(0, info.brand.find_first_not_of(' '));
+		info.features = read_cpuid_features();
+
+		// amd reports caches in 0x8000001d when topology extensions are present
+		auto ext1 = cpuid(0x80000001u);
+		bool topoext = ext1 != std::nullopt && (ext1->ecx & (1u << 22u)) != 0;
+		read_cpuid_caches(topoext && info.vendor_id != "GenuineIntel" ? 0x8000001du : 4, info.caches);
+
+		// 0x1f adds die and tile levels to 0xb
+		auto leaf1f = cpuid(0x1f);
+		uint32_t topology_leaf = leaf1f != std::nullopt && leaf1f->ebx != 0 ? 0x1f : 0xb;
+		for (uint32_t subleaf = 0;; subleaf++) {
+			auto regs = cpuid(topology_leaf, subleaf);
+			auto type = regs == std::nullopt ? 0 : (regs->ecx >> 8u) & 0xffu;
+			if (type == 0) {
+				break;
+			}
+			cpuid_topology_level level{};
+			level.type = type <= cpuid_topology_level::DIE ? static_cast<cpuid_topology_level::level_type>(type) : cpuid_topology_level::INVALID;
+			level.shift = regs->eax & 0x1fu;
+			level.logical_count = regs->ebx & 0xffffu;
+			info.topology.push_back(level);
+			info.x2apic_id = regs->edx;
+		}
+		return info;
+	}
+
+	[[nodiscard]] std::string_view cpuid_topology_level_string(cpuid_topology_level::level_type type) noexcept {
+		switch (type) {
+			case cpuid_topology_level::SMT:
+				return "smt";
+			case cpuid_topology_level::CORE:
+				return "core";
+			case cpuid_topology_level::MODULE:
+				return "module";
+			case cpuid_topology_level::TILE:
+				return "tile";
+			case cpuid_topology_level::DIE:
+				return "die";
+			case cpuid_topology_level::INVALID:
+				//[[fallthrough]]
+			default:
+				return "invalid";
+		}
+	}
+
+	void write_cpuid(util::writer& out, const cpuid_info& info) noexcept {
+		out.begin_object();
+		out.field("vendor", info.vendor_id);
+		out.field("brand", info.brand);
+		out.field("family", info.family);
+		out.field("model", info.model);
+		out.field("stepping", info.stepping);
+		out.begin_array("features");
+		for (size_t i = 0; i < CPU_FEATURE_COUNT; i++) {
+			if (info.features.has(static_cast<cpu_feature>(i))) {
+				out.value(CPU_FEATURE_NAMES[i]);
+			}
+		}
+		out.end_array();
+		out.begin_array("caches");
+		for (const auto& cache : info.caches) {
+			out.begin_object();
+			out.field("level", cache.level);
+			out.field("type", cache_type_string(cache.type));
+			out.field("size_bytes", cache.size_bytes);
+			out.field("line_size", cache.line_size);
+			out.field("ways", cache.ways);
+			out.field("sets", cache.sets);
+			out.field("max_sharing", cache.max_sharing);
+			out.field("inclusive", cache.inclusive);
+			out.end_object();
+		}
+		out.end_array();
+		out.begin_array("topology");
+		for (const auto& level : info.topology) {
+			out.begin_object();
+			out.field("type", cpuid_topology_level_string(level.type));
+			out.field("shift", level.shift);
+			out.field("logical_count", level.logical_count);
+			out.end_object();
+		}
+		out.end_array();
+		out.field("x2apic_id", info.x2apic_id);
+		out.end_object();
+	}
+} // namespace hwctrl::source
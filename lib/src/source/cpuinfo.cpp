@@ -1,170 +1,210 @@
 #include <source/cpuinfo.hpp>
 #include <util/file.hpp>
 #include <string_view>
-#include <memory>
-#include <iostream>
+#include <charconv>
+#include <cstring>
 
 namespace hwctrl::source {
-	[[nodiscard]] std::variant<std::string, hwctrl_error> read_cpuinfo() noexcept {
-		return util::file::read_ram_file("/proc/cpuinfo");
-	}
-
-	[[nodiscard]] std::variant<cpuinfo, hwctrl_error> parse_cpuinfo(const std::string& str) noexcept {
-		cpuinfo ci{};
-		std::vector<std::vector<std::pair<std::string_view, std::string_view>>> entries{};
-		entries.emplace_back();
-		entries.back().emplace_back();
-		enum {
-			KEY,
-			VALUE
-		} mode = KEY;
-		std::string_view::const_iterator last_non_space = nullptr;
-		for (const char* current = str.data(); current != std::addressof(*str.end()); current++) {
-			char c = *current;
-			if (c == '\n') {
-				if (mode == KEY) {
-					// add new section
-					entries.emplace_back();
-					// add new entry to new section
-					entries.back().emplace_back();
-				} else {
-					// add new entry to current section
-					auto& str_view = entries.back().back().second;
-					str_view = std::string_view{str_view.begin(), last_non_space + 1};
-					entries.back().emplace_back();
-					mode = KEY;
-				}
-			} else if (c == ':') {
-				// switch from key to value
-				mode = VALUE;
-				// remove trailing spaces from key
-				auto& str_view = entries.back().back().first;
-				str_view = std::string_view{str_view.begin(), last_non_space + 1};
-			} else {
-				if (c != ' ' && c != '\t') {
-					last_non_space = current;
-				}
-				if (mode == KEY) {
-					auto& str_view = entries.back().back().first;
-					if (str_view.data() == nullptr) {
-						// create string view for key
-						str_view = std::string_view{current, 1};
-					} else {
-						// add character to key string view
-						str_view = std::string_view{str_view.begin(), str_view.end() + 1};
-					}
-				} else {
-					auto& str_view = entries.back().back().second;
-					if (str_view.data() == nullptr) {
-						// create string view for value
-						str_view = std::string_view{current, 1};
-					} else {
-						// add character to value string view
-						str_view = std::string_view{str_view.begin(), str_view.end() + 1};
-					}
-				}
-			}
-		}
-		auto starts_with = [](std::string_view a, std::string_view b) noexcept {
-			if (a.size() < b.size()) {
-				return false;
-			}
-			return std::string_view{a.data(), b.size()} == b;
-		};
+	// values of a single processor block in /proc/cpuinfo
+	// strings are views into the input and only copied once a new cpu is added
+	struct cpuinfo_section {
+		bool has_processor = false;
 		uint32_t processor_id = 0;
-		std::string vendor_id;
+		std::string_view vendor_id{};
 		uint32_t cpu_family = 0;
 		uint32_t model = 0;
-		std::string model_name;
+		std::string_view model_name{};
 		double mhz = 0;
 		uint32_t physical_id = 0;
 		uint32_t core_id = 0;
-		for (const auto& entry : entries) {
-			for (const auto& [key, value] : entry) {
-				if (starts_with(key, "processor")) {
-					processor_id = static_cast<uint32_t>(std::atoi(value.data()));
-				} else if (starts_with(key, "vendor_id")) {
-					vendor_id = value;
-				} else if (starts_with(key, "cpu family")) {
-					cpu_family = static_cast<uint32_t>(std::atoi(value.data()));
-				} else if (starts_with(key, "model name")) {
-					model_name = value;
-				} else if (starts_with(key, "model")) {
-					model = static_cast<uint32_t>(std::atoi(value.data()));
-				} else if (starts_with(key, "cpu MHz")) {
-					mhz = std::stod(value.data());
-				} else if (starts_with(key, "physical id")) {
-					physical_id = static_cast<uint32_t>(std::atoi(value.data()));
-				} else if (starts_with(key, "core id")) {
-					core_id = static_cast<uint32_t>(std::atoi(value.data()));
+		std::string_view flags{};
+	};
+
+	[[nodiscard]] static constexpr bool is_cpuinfo_space(char c) noexcept {
+		return c == ' ' || c == '\t';
+	}
+
+	[[nodiscard]] static constexpr std::string_view trim_cpuinfo_value(std::string_view str) noexcept {
+		while (!str.empty() && is_cpuinfo_space(str.front())) {
+			str.remove_prefix(1);
+		}
+		while (!str.empty() && is_cpuinfo_space(str.back())) {
+			str.remove_suffix(1);
+		}
+		return str;
+	}
+
+	template <typename T>
+	[[nodiscard]] static T parse_cpuinfo_number(std::string_view str) noexcept {
+		// values are not null terminated - on failure the value stays 0 like atoi
+		T value{};
+		std::from_chars(str.data(), str.data() + str.size(), value);
+		return value;
+	}
+
+	static void parse_cpuinfo_entry(cpuinfo_section& section, std::string_view key, std::string_view value) noexcept {
+		// exact compares reject on size first so unused keys (bugs, ...) are skipped cheaply
+		if (key == "processor") {
+			section.has_processor = true;
+			section.processor_id = parse_cpuinfo_number<uint32_t>(value);
+		} else if (key == "vendor_id") {
+			section.vendor_id = value;
+		} else if (key == "cpu family") {
+			section.cpu_family = parse_cpuinfo_number<uint32_t>(value);
+		} else if (key == "model name") {
+			section.model_name = value;
+		} else if (key == "model") {
+			section.model = parse_cpuinfo_number<uint32_t>(value);
+		} else if (key == "cpu MHz") {
+			section.mhz = parse_cpuinfo_number<double>(value);
+		} else if (key == "physical id") {
+			section.physical_id = parse_cpuinfo_number<uint32_t>(value);
+		} else if (key == "core id") {
+			section.core_id = parse_cpuinfo_number<uint32_t>(value);
+		} else if (key == "flags") {
+			section.flags = value;
+		}
+	}
+
+	// ids above this are rejected so a corrupt file cannot make us allocate gigabytes of lookup table
+	static constexpr uint32_t MAX_CPUINFO_ID = 1u << 20u;
+
+	// maps physical and core ids to their position in ci.cpus / cpu.cores so each block is added in O(1)
+	struct cpuinfo_index {
+		std::vector<uint32_t> cpu_by_physical_id{};
+		// one table per entry of ci.cpus
+		std::vector<std::vector<uint32_t>> core_by_id{};
+	};
+
+	[[nodiscard]] static uint32_t& lookup_cpuinfo_index(std::vector<uint32_t>& table, uint32_t id) noexcept {
+		if (id >= table.size()) {
+			table.resize(id + 1u, UINT32_MAX);
+		}
+		return table[id];
+	}
+
+	[[nodiscard]] static bool add_cpuinfo_section(cpuinfo& ci, cpuinfo_index& index, const cpuinfo_section& section) noexcept {
+		if (section.physical_id >= MAX_CPUINFO_ID || section.core_id >= MAX_CPUINFO_ID) {
+			return false;
+		}
+		auto& cpu_index = lookup_cpuinfo_index(index.cpu_by_physical_id, section.physical_id);
+		if (cpu_index == UINT32_MAX) {
+			cpu_index = static_cast<uint32_t>(ci.cpus.size());
+			auto& c = ci.cpus.emplace_back();
+			c.physical_id = section.physical_id;
+			c.vendor_id = section.vendor_id;
+			c.family = section.cpu_family;
+			c.model = section.model;
+			c.name = section.model_name;
+			// flags repeat for every processor, they are only decoded once per package
+			c.features = parse_cpu_flags(section.flags);
+			index.core_by_id.emplace_back();
+		}
+		auto& cpu = ci.cpus[cpu_index];
+		auto& core_index = lookup_cpuinfo_index(index.core_by_id[cpu_index], section.core_id);
+		if (core_index == UINT32_MAX) {
+			core_index = static_cast<uint32_t>(cpu.cores.size());
+			cpu.cores.emplace_back().id = section.core_id;
+		}
+		auto& core = cpu.cores[core_index];
+		// at most a handful of smt threads per core
+		auto& proc = [&]() noexcept -> cpuinfo::processor& {
+			for (auto& p : core.processors) {
+				if (p.id == section.processor_id) {
+					return p;
 				}
 			}
-			auto& cpu = [&]()noexcept -> cpuinfo::cpu& {
-					for (auto& c : ci.cpus) {
-						if (c.physical_id == physical_id) {
-							return c;
-						}
-					}
-					return ci.cpus.emplace_back();
-			}();
-			cpu.physical_id = physical_id;
-			cpu.vendor_id = vendor_id;
-			cpu.family = cpu_family;
-			cpu.model = model;
-			cpu.name = model_name;
-			auto& core = [&]() noexcept -> cpuinfo::core& {
-				for (auto& c : cpu.cores) {
-					if (c.id == core_id) {
-						return c;
-					}
-				}
-				return cpu.cores.emplace_back();
-			}();
-			core.id = core_id;
-			auto& proc = [&]() noexcept -> cpuinfo::processor& {
-				for (auto& p : core.processors) {
-					if (p.id == processor_id) {
-						return p;
-					}
+			return core.processors.emplace_back();
+		}();
+		proc.id = section.processor_id;
+		proc.mhz = section.mhz;
+		return true;
+	}
+
+	[[nodiscard]] std::variant<std::string, hwctrl_error> read_cpuinfo() noexcept {
+		return util::file::read_ram_file("/proc/cpuinfo");
+	}
+
+	[[nodiscard]] std::variant<std::string_view, hwctrl_error> read_cpuinfo(std::vector<char>& buffer) noexcept {
+		return util::file::read_ram_file("/proc/cpuinfo", buffer);
+	}
+
+	[[nodiscard]] std::variant<cpuinfo, hwctrl_error> parse_cpuinfo(std::string_view str) noexcept {
+		cpuinfo ci{};
+		cpuinfo_index index{};
+		cpuinfo_section section{};
+		const char* current = str.data();
+		const char* const end = str.data() + str.size();
+		while (current != end) {
+			// memchr is vectorized by libc so whole lines are skipped without a per character loop
+			const auto* newline = static_cast<const char*>(std::memchr(current, '\n', static_cast<size_t>(end - current)));
+			const char* line_end = newline != nullptr ? newline : end;
+			std::string_view line{current, static_cast<size_t>(line_end - current)};
+			current = newline != nullptr ? newline + 1 : end;
+			if (line.empty()) {
+				// blank line ends a processor block
+				if (section.has_processor && !add_cpuinfo_section(ci, index, section)) {
+					return hwctrl_error{"error - cpuinfo id out of range"};
 				}
-				return core.processors.emplace_back();
-			}();
-			proc.id = processor_id;
-			proc.mhz = mhz;
+				section = {};
+				continue;
+			}
+			const auto* colon = static_cast<const char*>(std::memchr(line.data(), ':', line.size()));
+			if (colon == nullptr) {
+				continue;
+			}
+			auto key_length = static_cast<size_t>(colon - line.data());
+			parse_cpuinfo_entry(section, trim_cpuinfo_value(line.substr(0, key_length)), trim_cpuinfo_value(line.substr(key_length + 1)));
+		}
+		if (section.has_processor && !add_cpuinfo_section(ci, index, section)) {
+			return hwctrl_error{"error - cpuinfo id out of range"};
 		}
 		return ci;
 	}
 
-	[[nodiscard]] std::string cpuinfo_string(const cpuinfo& ci) noexcept {
-		std::string str;
-		for (auto& cpu : ci.cpus) {
-			str += "cpu ";
-			str += std::to_string(cpu.physical_id);
-			str += ":\n";
-			str += "\tname: ";
-			str += cpu.name;
-			str += "\t(";
-			str += std::to_string(cpu.model);
-			str += ")\n";
-			str += "\tvendor: ";
-			str += cpu.vendor_id;
-			str += "\n";
-			str += "\tfamily: ";
-			str += std::to_string(cpu.family);
-			str += "\n";
-			for (auto& core : cpu.cores) {
-				str += "\tcore ";
-				str += std::to_string(core.id);
-				str += ": \n";
-				for (auto& proc : core.processors) {
-					str += "\t\tprocessor ";
-					str += std::to_string(proc.id);
-					str += ": ";
-					str += std::to_string(proc.mhz);
-					str += "\n";
+	void write_cpuinfo(util::writer& out, const cpuinfo& ci) noexcept {
+		out.begin_object();
+		out.begin_array("cpus");
+		for (const auto& cpu : ci.cpus) {
+			out.begin_object();
+			out.field("physical_id", cpu.physical_id);
+			out.field("name", cpu.name);
+			out.field("vendor", cpu.vendor_id);
+			out.field("family", cpu.family);
+			out.field("model", cpu.model);
+			out.field("physical_cores", cpu.physical_cores);
+			out.begin_array("features");
+			for (size_t i = 0; i < CPU_FEATURE_COUNT; i++) {
+				if (cpu.features.has(static_cast<cpu_feature>(i))) {
+					out.value(CPU_FEATURE_NAMES[i]);
 				}
 			}
+			out.end_array();
+			out.begin_array("cores");
+			for (const auto& core : cpu.cores) {
+				out.begin_object();
+				out.field("id", core.id);
+				out.begin_array("processors");
+				for (const auto& proc : core.processors) {
+					out.begin_object();
+					out.field("id", proc.id);
+					out.field("mhz", proc.mhz);
+					out.end_object();
+				}
+				out.end_array();
+				out.end_object();
+			}
+			out.end_array();
+			out.end_object();
 		}
+		out.end_array();
+		out.end_object();
+	}
+
+	[[nodiscard]] std::string cpuinfo_string(const cpuinfo& ci) noexcept {
+		std::string str;
+		util::writer out{str, util::output_format::TEXT};
+		write_cpuinfo(out, ci);
 		return str;
 	}
 } // namespace spruce::source
@@ -0,0 +1,533 @@
+#include <source/dimm_map.hpp>
+#include <util/file.hpp>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <map>
+#include <optional>
+#include <tuple>
+
+namespace hwctrl::source {
+	// bus width when neither spd nor smbios report one
+	static constexpr uint32_t DEFAULT_BUS_WIDTH_BITS = 64;
+	// smbios rounds speeds (2666 vs 2667), treat anything within 1% as equal
+	static constexpr uint32_t SPEED_TOLERANCE_DIVISOR = 100;
+
+	[[nodiscard]] std::vector<spd_eeprom> read_spd_eeproms(const std::filesystem::path& sysfs_root) noexcept {
+		std::vector<spd_eeprom> eeproms{};
+		std::vector<char> buffer{};
+		auto driver = sysfs_root / "bus/i2c/drivers/ee1004";
+		for (const auto& device : util::file::list_directory(driver)) {
+			auto read_result = util::file::read_ram_file(driver / device / "eeprom", buffer);
+			if (!std::holds_alternative<std::string_view>(read_result)) {
+				continue;
+			}
+			auto data = std::get<std::string_view>(read_result);
+			auto spd_result = parse_spd({reinterpret_cast<const unsigned char*>(data.data()), data.size()});
+			if (auto* spd_ptr = std::get_if<spd>(&spd_result)) {
+				eeproms.push_back({device, std::move(*spd_ptr)});
+			}
+		}
+		std::sort(eeproms.begin(), eeproms.end(), [](const spd_eeprom& a, const spd_eeprom& b) noexcept {
+			return a.device < b.device;
+		});
+		return eeproms;
+	}
+
+	// returns the rest of token if it starts with prefix
+	[[nodiscard]] static std::optional<std::string_view> strip_prefix(std::string_view token, std::string_view prefix) noexcept {
+		if (token.size() < prefix.size() || token.substr(0, prefix.size()) != prefix) {
+			return std::nullopt;
+		}
+		return token.substr(prefix.size());
+	}
+
+	[[nodiscard]] static std::optional<uint32_t> parse_locator_number(std::string_view str) noexcept {
+		uint32_t value = 0;
+		auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+		if (str.empty() || ec != std::errc{} || end != str.data() + str.size()) {
+			return std::nullopt;
+		}
+		return value;
+	}
+
+	// channels are letters (A = 0) or numbers
+	[[nodiscard]] static std::optional<uint32_t> parse_locator_channel(std::string_view str) noexcept {
+		if (str.size() == 1 && str[0] >= 'A' && str[0] <= 'Z') {
+			return static_cast<uint32_t>(str[0] - 'A');
+		}
+		return parse_locator_number(str);
+	}
+
+	// "A1" - channel letter followed by the slot
+	[[nodiscard]] static bool parse_letter_slot(std::string_view str, dimm& out) noexcept {
+		if (str.size() < 2 || str[0] < 'A' || str[0] > 'Z') {
+			return false;
+		}
+		auto slot = parse_locator_number(str.substr(1));
+		if (slot == std::nullopt) {
+			return false;
+		}
+		if (out.channel == dimm::UNKNOWN_ID) {
+			out.channel = static_cast<uint32_t>(str[0] - 'A');
+		}
+		if (out.slot == dimm::UNKNOWN_ID) {
+			out.slot = slot.value();
+		}
+		return true;
+	}
+
+	void parse_dimm_locator(std::string_view locator, dimm& out) noexcept {
+		std::vector<std::string> tokens{};
+		std::string token{};
+		for (char c : locator) {
+			if (std::isalnum(static_cast<unsigned char>(c))) {
+				token.push_back(static_cast<char>(std::toupper(static_cast<unsigned char>(c))));
+			} else if (!token.empty()) {
+				tokens.push_back(std::move(token));
+				token.clear();
+			}
+		}
+		if (!token.empty()) {
+			tokens.push_back(std::move(token));
+		}
+		auto set = [](uint32_t& field, std::optional<uint32_t> value) noexcept {
+			if (value != std::nullopt && field == dimm::UNKNOWN_ID) {
+				field = value.value();
+			}
+		};
+		for (size_t i = 0; i < tokens.size(); i++) {
+			std::string_view current = tokens[i];
+			std::string_view next = i + 1 < tokens.size() ? std::string_view{tokens[i + 1]} : std::string_view{};
+			if (current == "CHANNEL" || current == "CHAN" || current == "CH") {
+				// "CHANNEL A", "P0 CHANNEL 3"
+				set(out.channel, parse_locator_channel(next));
+				i++;
+			} else if (current == "DIMM" || current == "SLOT") {
+				// "DIMM_A1", "DIMM 0"
+				if (!parse_letter_slot(next, out)) {
+					set(out.slot, parse_locator_number(next));
+				}
+				i++;
+			} else if (auto channel = strip_prefix(current, "CHANNEL"); channel != std::nullopt) {
+				set(out.channel, parse_locator_channel(channel.value()));
+			} else if (auto chan = strip_prefix(current, "CHAN"); chan != std::nullopt) {
+				set(out.channel, parse_locator_channel(chan.value()));
+			} else if (auto slot = strip_prefix(current, "DIMM"); slot != std::nullopt) {
+				if (!parse_letter_slot(slot.value(), out)) {
+					set(out.slot, parse_locator_number(slot.value()));
+				}
+			} else if (auto socket = strip_prefix(current, "SOCKET"); socket != std::nullopt) {
+				set(out.socket, parse_locator_number(socket.value()));
+			} else if (auto cpu = strip_prefix(current, "CPU"); cpu != std::nullopt) {
+				set(out.socket, parse_locator_number(cpu.value()));
+			} else if (auto proc = strip_prefix(current, "PROC"); proc != std::nullopt) {
+				set(out.socket, parse_locator_number(proc.value()));
+			} else if (current.size() > 1 && current[0] == 'P' && parse_locator_number(current.substr(1)) != std::nullopt) {
+				set(out.socket, parse_locator_number(current.substr(1)));
+			} else if (current == "NODE" || current == "BANK" || strip_prefix(current, "NODE") != std::nullopt || strip_prefix(current, "BANK") != std::nullopt) {
+				// numa node / die and bank indices do not identify a channel
+				if (current == "NODE" || current == "BANK") {
+					i++;
+				}
+			} else {
+				static_cast<void>(parse_letter_slot(current, out));
+			}
+		}
+	}
+
+	[[nodiscard]] static bool equals_ignore_case(std::string_view a, std::string_view b) noexcept {
+		return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) noexcept {
+			return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+		});
+	}
+
+	// smbios serials are the spd serial bytes printed in hex, usually in spd byte order
+	[[nodiscard]] static bool serial_matches(std::string_view smbios_serial, uint32_t spd_serial) noexcept {
+		uint32_t value = 0;
+		auto [end, ec] = std::from_chars(smbios_serial.data(), smbios_serial.data() + smbios_serial.size(), value, 16);
+		if (smbios_serial.empty() || ec != std::errc{} || end != smbios_serial.data() + smbios_serial.size() || spd_serial == 0) {
+			return false;
+		}
+		auto swapped = ((spd_serial & 0xffu) << 24u) | ((spd_serial & 0xff00u) << 8u) | ((spd_serial >> 8u) & 0xff00u) | (spd_serial >> 24u);
+		return value == spd_serial || value == swapped;
+	}
+
+	static void apply_edac(const edac_dimm& edac, dimm& out) noexcept {
+		out.has_edac = true;
+		out.corrected_errors = edac.corrected_errors;
+		out.uncorrected_errors = edac.uncorrected_errors;
+		if (!out.populated) {
+			out.populated = edac.size_bytes != 0;
+			out.size_bytes = edac.size_bytes;
+		}
+		// keep the board locator scheme when it placed the dimm so channels of a socket stay comparable
+		if (out.channel != dimm::UNKNOWN_ID) {
+			return;
+		}
+		out.memory_controller = edac.mc;
+		if (edac.socket != edac_dimm::UNKNOWN_ID) {
+			out.socket = edac.socket;
+		}
+		out.channel = edac.channel;
+		if (edac.slot != edac_dimm::UNKNOWN_ID) {
+			out.slot = edac.slot;
+		}
+	}
+
+	static void apply_spd(const spd& spd_parsed, dimm& out) noexcept {
+		out.spd = spd_parsed;
+		if (const auto* ddr4_ptr = std::get_if<spd_ddr4>(&spd_parsed)) {
+			out.rated_mt = ddr4_ptr->clock_max.clock_mt;
+			if (ddr4_ptr->module_memory_bus_width_bits != std::nullopt) {
+				out.data_width_bits = ddr4_ptr->module_memory_bus_width_bits.value();
+			}
+			if (out.ranks == 0) {
+				out.ranks = ddr4_ptr->ranks;
+			}
+			if (out.serial_number.empty()) {
+				out.serial_number = std::to_string(ddr4_ptr->serial_number);
+			}
+		}
+	}
+
+	[[nodiscard]] std::vector<dimm> build_dimms(const smbios_tables& smbios, const std::vector<edac_dimm>& edac, const std::vector<spd_eeprom>& eeproms) noexcept {
+		std::vector<dimm> dimms{};
+		// multi socket boards describe one array per socket in socket order
+		std::vector<uint16_t> system_arrays{};
+		for (const auto& array : smbios.memory_arrays) {
+			if (array.use == smbios_memory_array::SYSTEM_MEMORY) {
+				system_arrays.push_back(array.handle);
+			}
+		}
+		for (const auto& device : smbios.memory_devices) {
+			dimm entry{};
+			entry.locator = device.locator;
+			entry.bank_locator = device.bank_locator;
+			entry.populated = device.size_bytes != 0;
+			entry.size_bytes = device.size_bytes;
+			entry.ranks = device.ranks;
+			entry.data_width_bits = device.data_width_bits;
+			entry.rated_mt = device.speed_mt;
+			entry.configured_mt = device.configured_speed_mt;
+			entry.configured_mv = device.configured_mv;
+			entry.manufacturer = device.manufacturer;
+			entry.part_number = device.part_number;
+			entry.serial_number = device.serial_number;
+			parse_dimm_locator(device.bank_locator, entry);
+			parse_dimm_locator(device.locator, entry);
+			if (entry.socket == dimm::UNKNOWN_ID && system_arrays.size() > 1) {
+				auto array = std::find(system_arrays.begin(), system_arrays.end(), device.array_handle);
+				if (array != system_arrays.end()) {
+					entry.socket = static_cast<uint32_t>(array - system_arrays.begin());
+				}
+			}
+			dimms.push_back(std::move(entry));
+		}
+
+		for (const auto& edac_entry : edac) {
+			auto match = std::find_if(dimms.begin(), dimms.end(), [&](const dimm& entry) noexcept {
+				return !entry.has_edac && !edac_entry.label.empty() && (equals_ignore_case(edac_entry.label, entry.locator) || equals_ignore_case(edac_entry.label, entry.bank_locator + " " + entry.locator));
+			});
+			if (match != dimms.end()) {
+				apply_edac(edac_entry, *match);
+			} else if (smbios.memory_devices.empty()) {
+				dimm entry{};
+				entry.locator = edac_entry.label;
+				parse_dimm_locator(edac_entry.label, entry);
+				apply_edac(edac_entry, entry);
+				dimms.push_back(std::move(entry));
+			}
+		}
+
+		for (const auto& eeprom : eeproms) {
+			const auto* ddr4_ptr = std::get_if<spd_ddr4>(&eeprom.spd_parsed);
+			auto match = dimms.end();
+			if (ddr4_ptr != nullptr) {
+				match = std::find_if(dimms.begin(), dimms.end(), [&](const dimm& entry) noexcept {
+					return entry.populated && entry.spd == std::nullopt && serial_matches(entry.serial_number, ddr4_ptr->serial_number);
+				});
+			}
+			if (match != dimms.end()) {
+				apply_spd(eeprom.spd_parsed, *match);
+			} else if (dimms.empty() || (smbios.memory_devices.empty() && edac.empty())) {
+				dimm entry{};
+				entry.locator = eeprom.device;
+				entry.populated = true;
+				apply_spd(eeprom.spd_parsed, entry);
+				dimms.push_back(std::move(entry));
+			}
+		}
+		for (auto& entry : dimms) {
+			if (entry.populated && entry.data_width_bits == 0) {
+				entry.data_width_bits = DEFAULT_BUS_WIDTH_BITS;
+			}
+		}
+		return dimms;
+	}
+
+	[[nodiscard]] std::vector<dimm> read_dimms(const std::filesystem::path& sysfs_root, const std::filesystem::path& dmi_path) noexcept {
+		auto smbios_result = read_smbios(dmi_path);
+		auto edac_result = read_edac_dimms(sysfs_root);
+		return build_dimms(
+			std::holds_alternative<smbios_tables>(smbios_result) ? std::get<smbios_tables>(smbios_result) : smbios_tables{},
+			std::holds_alternative<std::vector<edac_dimm>>(edac_result) ? std::get<std::vector<edac_dimm>>(edac_result) : std::vector<edac_dimm>{},
+			read_spd_eeproms(sysfs_root));
+	}
+
+	[[nodiscard]] static double channel_peak(uint32_t mt, uint32_t width_bits) noexcept {
+		return static_cast<double>(mt) * 1e6 * static_cast<double>(width_bits) / 8.0;
+	}
+
+	[[nodiscard]] memory_bandwidth compute_memory_bandwidth(const std::vector<dimm>& dimms) noexcept {
+		memory_bandwidth bandwidth{};
+		std::map<std::tuple<uint32_t, uint32_t, uint32_t>, memory_channel> channels{};
+		for (const auto& entry : dimms) {
+			if (entry.channel == dimm::UNKNOWN_ID) {
+				if (entry.populated) {
+					bandwidth.unplaced_dimms++;
+				}
+				continue;
+			}
+			auto& channel = channels[{entry.socket, entry.memory_controller, entry.channel}];
+			channel.socket = entry.socket;
+			channel.memory_controller = entry.memory_controller;
+			channel.channel = entry.channel;
+			channel.slots++;
+			if (!entry.populated) {
+				continue;
+			}
+			channel.populated_slots++;
+			channel.size_bytes += entry.size_bytes;
+			auto mt = entry.configured_mt != 0 ? entry.configured_mt : entry.rated_mt;
+			if (mt != 0) {
+				channel.mt = channel.mt == 0 ? mt : std::min(channel.mt, mt);
+			}
+			channel.width_bits = channel.width_bits == 0 ? entry.data_width_bits : std::min<uint32_t>(channel.width_bits, entry.data_width_bits);
+		}
+
+		std::map<uint32_t, std::vector<const memory_channel*>> sockets{};
+		for (auto& [key, channel] : channels) {
+			channel.peak_bytes_per_second = channel_peak(channel.mt, channel.width_bits);
+			bandwidth.channels.push_back(channel);
+		}
+		for (const auto& channel : bandwidth.channels) {
+			sockets[channel.socket].push_back(&channel);
+		}
+		for (const auto& [socket_id, socket_channels] : sockets) {
+			memory_socket socket{};
+			socket.socket = socket_id;
+			uint32_t max_mt = 0;
+			uint32_t max_width = 0;
+			std::map<uint32_t, size_t> dimms_per_channel{};
+			std::map<uint64_t, size_t> size_per_channel{};
+			std::map<uint32_t, size_t> speed_per_channel{};
+			for (const auto* channel : socket_channels) {
+				socket.channels++;
+				if (channel->populated_slots == 0) {
+					continue;
+				}
+				socket.populated_channels++;
+				socket.peak_bytes_per_second += channel->peak_bytes_per_second;
+				max_mt = std::max(max_mt, channel->mt);
+				max_width = std::max(max_width, channel->width_bits);
+				dimms_per_channel[channel->populated_slots]++;
+				size_per_channel[channel->size_bytes]++;
+				speed_per_channel[channel->mt]++;
+			}
+			socket.balanced_peak_bytes_per_second = socket.channels * channel_peak(max_mt, max_width);
+			if (socket.populated_channels != 0 && socket.populated_channels < socket.channels) {
+				socket.issues.push_back(std::to_string(socket.populated_channels) + " of " + std::to_string(socket.channels) + " channels populated");
+			}
+			if (dimms_per_channel.size() > 1) {
+				socket.issues.push_back("channels hold different numbers of dimms");
+			}
+			if (size_per_channel.size() > 1) {
+				socket.issues.push_back("channels hold different capacities, interleaving is partial");
+			}
+			if (speed_per_channel.size() > 1) {
+				socket.issues.push_back("channels run at different speeds");
+			}
+			bandwidth.peak_bytes_per_second += socket.peak_bytes_per_second;
+			bandwidth.sockets.push_back(std::move(socket));
+		}
+		return bandwidth;
+	}
+
+	[[nodiscard]] static bool speed_at_least(uint32_t mt, uint32_t target) noexcept {
+		return mt + mt / SPEED_TOLERANCE_DIVISOR >= target;
+	}
+
+	[[nodiscard]] dimm_speed_check check_dimm_speed(const dimm& entry) noexcept {
+		dimm_speed_check check{};
+		check.configured_mt = entry.configured_mt;
+		check.configured_mv = entry.configured_mv;
+		check.jedec_mt = entry.rated_mt;
+		if (entry.spd != std::nullopt) {
+			if (const auto* ddr4_ptr = std::get_if<spd_ddr4>(&entry.spd.value())) {
+				check.jedec_mt = ddr4_ptr->clock_max.clock_mt;
+				if (ddr4_ptr->xmp_data != std::nullopt) {
+					for (const auto& profile : ddr4_ptr->xmp_data->profiles) {
+						if (profile.enable && profile.clk.clock_mt > check.xmp_mt) {
+							check.xmp_mt = profile.clk.clock_mt;
+							check.xmp_mv = profile.dimm_voltage.millivolts;
+						}
+					}
+				}
+			}
+		}
+		if (!entry.populated || check.configured_mt == 0 || check.jedec_mt == 0) {
+			return check;
+		}
+		if (check.xmp_mt > check.jedec_mt) {
+			if (speed_at_least(check.configured_mt, check.xmp_mt)) {
+				check.status = dimm_speed_check::XMP;
+			} else if (speed_at_least(check.configured_mt, check.jedec_mt)) {
+				check.status = speed_at_least(check.jedec_mt, check.configured_mt) ? dimm_speed_check::JEDEC_FALLBACK : dimm_speed_check::BELOW_XMP;
+			} else {
+				check.status = dimm_speed_check::BELOW_RATED;
+			}
+		} else {
+			check.status = speed_at_least(check.configured_mt, check.jedec_mt) ? dimm_speed_check::RATED : dimm_speed_check::BELOW_RATED;
+		}
+		return check;
+	}
+
+	[[nodiscard]] std::string_view speed_status_string(dimm_speed_check::speed_status status) noexcept {
+		switch (status) {
+			case dimm_speed_check::RATED:
+				return "rated";
+			case dimm_speed_check::XMP:
+				return "xmp";
+			case dimm_speed_check::JEDEC_FALLBACK:
+				return "jedec_fallback";
+			case dimm_speed_check::BELOW_XMP:
+				return "below_xmp";
+			case dimm_speed_check::BELOW_RATED:
+				return "below_rated";
+			case dimm_speed_check::UNKNOWN_STATUS:
+				//[[fallthrough]]
+			default:
+				return "unknown";
+		}
+	}
+
+	[[nodiscard]] bool is_misconfigured(const dimm_speed_check& check) noexcept {
+		return check.status == dimm_speed_check::JEDEC_FALLBACK || check.status == dimm_speed_check::BELOW_XMP || check.status == dimm_speed_check::BELOW_RATED;
+	}
+
+	static void write_id(util::writer& out, std::string_view key, uint32_t id) noexcept {
+		if (id != dimm::UNKNOWN_ID) {
+			out.field(key, id);
+		}
+	}
+
+	void write_dimms(util::writer& out, const std::vector<dimm>& dimms) noexcept {
+		out.begin_object();
+		out.begin_array("dimms");
+		for (const auto& entry : dimms) {
+			out.begin_object();
+			out.field("locator", entry.locator);
+			if (!entry.bank_locator.empty()) {
+				out.field("bank_locator", entry.bank_locator);
+			}
+			write_id(out, "socket", entry.socket);
+			write_id(out, "memory_controller", entry.memory_controller);
+			write_id(out, "channel", entry.channel);
+			write_id(out, "slot", entry.slot);
+			out.field("populated", entry.populated);
+			if (entry.populated) {
+				out.field("size_bytes", entry.size_bytes);
+				out.field("ranks", entry.ranks);
+				out.field("data_width_bits", entry.data_width_bits);
+				out.field("rated_mt", entry.rated_mt);
+				out.field("configured_mt", entry.configured_mt);
+				if (entry.configured_mv != 0) {
+					out.field("configured_mv", entry.configured_mv);
+				}
+				out.field("manufacturer", entry.manufacturer);
+				out.field("part_number", entry.part_number);
+				out.field("serial_number", entry.serial_number);
+				out.field("spd", entry.spd != std::nullopt);
+				if (entry.has_edac) {
+					out.field("corrected_errors", entry.corrected_errors);
+					out.field("uncorrected_errors", entry.uncorrected_errors);
+				}
+			}
+			out.end_object();
+		}
+		out.end_array();
+		out.end_object();
+	}
+
+	[[nodiscard]] size_t write_dimm_speed_checks(util::writer& out, const std::vector<dimm>& dimms) noexcept {
+		size_t misconfigured = 0;
+		out.begin_object();
+		out.begin_array("speed");
+		for (const auto& entry : dimms) {
+			if (!entry.populated) {
+				continue;
+			}
+			auto check = check_dimm_speed(entry);
+			if (is_misconfigured(check)) {
+				misconfigured++;
+			}
+			out.begin_object();
+			out.field("locator", entry.locator);
+			out.field("status", speed_status_string(check.status));
+			out.field("configured_mt", check.configured_mt);
+			out.field("jedec_mt", check.jedec_mt);
+			if (check.xmp_mt != 0) {
+				out.field("xmp_mt", check.xmp_mt);
+				out.field("xmp_mv", check.xmp_mv);
+			}
+			if (check.configured_mv != 0) {
+				out.field("configured_mv", check.configured_mv);
+			}
+			out.end_object();
+		}
+		out.end_array();
+		out.field("misconfigured_dimms", misconfigured);
+		out.end_object();
+		return misconfigured;
+	}
+
+	void write_memory_bandwidth(util::writer& out, const memory_bandwidth& bandwidth) noexcept {
+		out.begin_object();
+		out.begin_array("channels");
+		for (const auto& channel : bandwidth.channels) {
+			out.begin_object();
+			write_id(out, "socket", channel.socket);
+			write_id(out, "memory_controller", channel.memory_controller);
+			out.field("channel", channel.channel);
+			out.field("slots", channel.slots);
+			out.field("populated_slots", channel.populated_slots);
+			out.field("size_bytes", channel.size_bytes);
+			out.field("mt", channel.mt);
+			out.field("width_bits", channel.width_bits);
+			out.field("peak_bytes_per_second", channel.peak_bytes_per_second);
+			out.end_object();
+		}
+		out.end_array();
+		out.begin_array("sockets");
+		for (const auto& socket : bandwidth.sockets) {
+			out.begin_object();
+			write_id(out, "socket", socket.socket);
+			out.field("channels", socket.channels);
+			out.field("populated_channels", socket.populated_channels);
+			out.field("peak_bytes_per_second", socket.peak_bytes_per_second);
+			out.field("balanced_peak_bytes_per_second", socket.balanced_peak_bytes_per_second);
+			out.field("balanced", socket.issues.empty());
+			out.begin_array("issues");
+			for (const auto& issue : socket.issues) {
+				out.value(std::string_view{issue});
+			}
+			out.end_array();
+			out.end_object();
+		}
+		out.end_array();
+		out.field("unplaced_dimms", bandwidth.unplaced_dimms);
+		out.field("peak_bytes_per_second", bandwidth.peak_bytes_per_second);
+		out.end_object();
+	}
+} // namespace hwctrl::source
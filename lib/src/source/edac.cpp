@@ -0,0 +1,96 @@
+#include <source/edac.hpp>
+#include <util/sysfs.hpp>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+
+namespace hwctrl::source {
+	[[nodiscard]] static bool equals_ignore_case(std::string_view a, std::string_view b) noexcept {
+		return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) noexcept {
+			return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+		});
+	}
+
+	static void set_edac_field(std::string_view name, uint32_t value, edac_dimm& dimm) noexcept {
+		if (equals_ignore_case(name, "srcid") || equals_ignore_case(name, "socket")) {
+			dimm.socket = value;
+		} else if (equals_ignore_case(name, "chan") || equals_ignore_case(name, "channel")) {
+			dimm.channel = value;
+		} else if (equals_ignore_case(name, "slot") || equals_ignore_case(name, "dimm")) {
+			dimm.slot = value;
+		} else if (equals_ignore_case(name, "csrow")) {
+			dimm.csrow = value;
+		}
+	}
+
+	void parse_edac_location(std::string_view str, edac_dimm& dimm) noexcept {
+		// split into names and numbers, "CPU_SrcID#0_MC#1" and "channel 0 slot 1" give the same pairs
+		std::string_view name{};
+		size_t i = 0;
+		while (i < str.size()) {
+			auto c = static_cast<unsigned char>(str[i]);
+			if (std::isalpha(c)) {
+				size_t start = i;
+				while (i < str.size() && std::isalpha(static_cast<unsigned char>(str[i]))) {
+					i++;
+				}
+				name = str.substr(start, i - start);
+			} else if (std::isdigit(c)) {
+				uint32_t value = 0;
+				auto [end, ec] = std::from_chars(str.data() + i, str.data() + str.size(), value);
+				i = static_cast<size_t>(end - str.data());
+				if (ec == std::errc{} && !name.empty()) {
+					set_edac_field(name, value, dimm);
+				}
+				name = {};
+			} else {
+				i++;
+			}
+		}
+	}
+
+	[[nodiscard]] static uint64_t read_edac_uint(const std::filesystem::path& path) noexcept {
+		auto value = util::sysfs::read_uint(path);
+		return std::holds_alternative<uint64_t>(value) ? std::get<uint64_t>(value) : 0;
+	}
+
+	[[nodiscard]] static std::string read_edac_string(const std::filesystem::path& path) noexcept {
+		auto value = util::sysfs::read_string(path);
+		return std::holds_alternative<std::string>(value) ? std::move(std::get<std::string>(value)) : std::string{};
+	}
+
+	[[nodiscard]] std::variant<std::vector<edac_dimm>, hwctrl_error> read_edac_dimms(const std::filesystem::path& sysfs_root) noexcept {
+		std::vector<edac_dimm> dimms{};
+		util::sysfs::for_each_numbered_entry(sysfs_root / "devices/system/edac/mc", "mc", [&](uint32_t mc, const std::filesystem::path& mc_path) noexcept {
+			// older drivers only expose ranks
+			for (std::string_view prefix : {"dimm", "rank"}) {
+				util::sysfs::for_each_numbered_entry(mc_path, prefix, [&](uint32_t index, const std::filesystem::path& path) noexcept {
+					edac_dimm dimm{};
+					dimm.mc = mc;
+					dimm.index = index;
+					dimm.label = read_edac_string(path / "dimm_label");
+					dimm.mem_type = read_edac_string(path / "dimm_mem_type");
+					// size is in MiB
+					dimm.size_bytes = read_edac_uint(path / "size") << 20u;
+					dimm.corrected_errors = read_edac_uint(path / "dimm_ce_count");
+					dimm.uncorrected_errors = read_edac_uint(path / "dimm_ue_count");
+					parse_edac_location(read_edac_string(path / "dimm_location"), dimm);
+					// labels like CPU_SrcID#0_MC#1_Chan#2_DIMM#0 carry the socket, but free form board labels ("DIMM 3")
+					// must not override what the kernel put in dimm_location, so they only fill fields still unknown
+					edac_dimm from_label{};
+					parse_edac_location(dimm.label, from_label);
+					for (auto member : {&edac_dimm::socket, &edac_dimm::channel, &edac_dimm::slot, &edac_dimm::csrow}) {
+						if (dimm.*member == edac_dimm::UNKNOWN_ID) {
+							dimm.*member = from_label.*member;
+						}
+					}
+					dimms.push_back(std::move(dimm));
+				});
+			}
+		});
+		std::sort(dimms.begin(), dimms.end(), [](const edac_dimm& a, const edac_dimm& b) noexcept {
+			return std::pair{a.mc, a.index} < std::pair{b.mc, b.index};
+		});
+		return dimms;
+	}
+} // namespace hwctrl::source
@@ -0,0 +1,101 @@
+#include <source/interrupts.hpp>
+#include <util/file.hpp>
+#include <charconv>
+
+namespace hwctrl::source {
+	// returns the next space separated token and advances str past it
+	[[nodiscard]] static std::string_view next_token(std::string_view& str) noexcept {
+		auto start = str.find_first_not_of(' ');
+		if (start == std::string_view::npos) {
+			str = {};
+			return {};
+		}
+		str.remove_prefix(start);
+		auto end = str.find(' ');
+		auto token = str.substr(0, end);
+		str.remove_prefix(end == std::string_view::npos ? str.size() : end);
+		return token;
+	}
+
+	[[nodiscard]] static std::string_view trim(std::string_view str) noexcept {
+		auto start = str.find_first_not_of(' ');
+		if (start == std::string_view::npos) {
+			return {};
+		}
+		return str.substr(start, str.find_last_not_of(' ') - start + 1);
+	}
+
+	[[nodiscard]] std::variant<interrupts, hwctrl_error> parse_interrupts(std::string_view str) noexcept {
+		interrupts result{};
+		auto header_end = str.find('\n');
+		auto header = str.substr(0, header_end);
+		while (!header.empty()) {
+			auto token = next_token(header);
+			uint32_t cpu = 0;
+			if (token.size() <= 3 || token.substr(0, 3) != "CPU" || std::from_chars(token.data() + 3, token.data() + token.size(), cpu).ec != std::errc{}) {
+				if (token.empty()) {
+					break;
+				}
+				return hwctrl_error{"error - unexpected /proc/interrupts header \"" + std::string(token) + "\""};
+			}
+			result.cpus.push_back(cpu);
+		}
+		if (result.cpus.empty()) {
+			return hwctrl_error{"error - /proc/interrupts has no cpu columns"};
+		}
+		str.remove_prefix(header_end == std::string_view::npos ? str.size() : header_end + 1);
+
+		while (!str.empty()) {
+			auto line_end = str.find('\n');
+			auto line = str.substr(0, line_end);
+			str.remove_prefix(line_end == std::string_view::npos ? str.size() : line_end + 1);
+			auto colon = line.find(':');
+			if (colon == std::string_view::npos) {
+				continue;
+			}
+			interrupt_line entry{};
+			entry.name = trim(line.substr(0, colon));
+			uint32_t irq = 0;
+			if (std::from_chars(entry.name.data(), entry.name.data() + entry.name.size(), irq).ptr == entry.name.data() + entry.name.size()) {
+				entry.irq = irq;
+			}
+			auto rest = line.substr(colon + 1);
+			// architecture lines like ERR and MIS have a single count
+			while (entry.counts.size() < result.cpus.size()) {
+				auto before = rest;
+				auto token = next_token(rest);
+				uint64_t count = 0;
+				auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), count);
+				if (token.empty() || ec != std::errc{} || ptr != token.data() + token.size()) {
+					rest = before;
+					break;
+				}
+				entry.counts.push_back(count);
+			}
+			if (entry.irq != interrupt_line::NOT_A_NUMBER) {
+				entry.chip = next_token(rest);
+				entry.hwirq = next_token(rest);
+				// arm gic prints the trigger type as its own column
+				auto before = rest;
+				auto trigger = next_token(rest);
+				if (trigger == "Level" || trigger == "Edge") {
+					entry.hwirq += "-";
+					entry.hwirq += trigger;
+				} else {
+					rest = before;
+				}
+			}
+			entry.actions = trim(rest);
+			result.lines.push_back(std::move(entry));
+		}
+		return result;
+	}
+
+	[[nodiscard]] std::variant<interrupts, hwctrl_error> read_interrupts(const std::filesystem::path& proc_root) noexcept {
+		auto file_result = util::file::read_ram_file(proc_root / "interrupts");
+		if (auto* err_ptr = std::get_if<hwctrl_error>(&file_result)) {
+			return std::move(*err_ptr);
+		}
+		return parse_interrupts(std::get<std::string>(file_result));
+	}
+} // namespace hwctrl::source
@@ -0,0 +1,205 @@
+#include <source/msr.hpp>
+#include <util/affinity.hpp>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace hwctrl::source {
+	struct msr_sampler::reader_state {
+		std::vector<uint32_t> ids{};
+		std::vector<util::file::unique_fd> files{};
+		// indices into ids per package
+		std::vector<std::vector<size_t>> packages{};
+		uint32_t stride = 1;
+		std::mutex mutex{};
+		std::condition_variable sample_requested{};
+		std::condition_variable sample_done{};
+		// destination of the current sample, only touched by readers while remaining > 0
+		std::span<msr_counters> counters{};
+		uint64_t generation = 0;
+		size_t remaining = 0;
+		bool stop = false;
+		std::vector<std::thread> readers{};
+	};
+
+	[[nodiscard]] static bool read_msr(const util::file::unique_fd& fd, uint64_t offset, uint64_t& value) noexcept {
+		return ::pread(fd.get(), &value, sizeof(value), static_cast<off_t>(offset)) == static_cast<ssize_t>(sizeof(value));
+	}
+
+	static void read_package(const std::vector<util::file::unique_fd>& files, const std::vector<size_t>& package, uint32_t stride, std::span<msr_counters> counters) noexcept {
+		for (auto index : package) {
+			if (index >= counters.size()) {
+				continue;
+			}
+			auto& entry = counters[index];
+			// mperf first and tsc last so the tsc delta never trails the mperf delta
+			entry.valid = read_msr(files[index], uint64_t{msr::IA32_MPERF} * stride, entry.mperf)
+				&& read_msr(files[index], uint64_t{msr::IA32_APERF} * stride, entry.aperf)
+				&& read_msr(files[index], uint64_t{msr::IA32_TIME_STAMP_COUNTER} * stride, entry.tsc);
+		}
+	}
+
+	msr_sampler::msr_sampler(std::vector<uint32_t> cpu_ids, std::vector<util::file::unique_fd> cpu_files, std::vector<std::vector<size_t>> package_cpu_indices, uint32_t register_stride) noexcept : state(std::make_unique<reader_state>()) {
+		state->ids = std::move(cpu_ids);
+		state->files = std::move(cpu_files);
+		state->packages = std::move(package_cpu_indices);
+		state->stride = register_stride;
+		state->readers.reserve(state->packages.size());
+		for (size_t package_index = 0; package_index < state->packages.size(); package_index++) {
+			state->readers.emplace_back([shared = state.get(), package_index]() noexcept {
+				const auto& package = shared->packages[package_index];
+				std::vector<uint32_t> package_cpus{};
+				for (auto index : package) {
+					package_cpus.push_back(shared->ids[index]);
+				}
+				// best effort, unpinned reads are still correct only slower
+				[[maybe_unused]] auto pin_result = util::affinity::pin_current_thread(package_cpus);
+				uint64_t seen = 0;
+				while (true) {
+					std::span<msr_counters> counters{};
+					{
+						std::unique_lock lock(shared->mutex);
+						shared->sample_requested.wait(lock, [&]() noexcept {
+							return shared->stop || shared->generation != seen;
+						});
+						if (shared->stop) {
+							return;
+						}
+						seen = shared->generation;
+						counters = shared->counters;
+					}
+					read_package(shared->files, package, shared->stride, counters);
+					bool last = false;
+					{
+						std::lock_guard lock(shared->mutex);
+						last = --shared->remaining == 0;
+					}
+					if (last) {
+						shared->sample_done.notify_all();
+					}
+				}
+			});
+		}
+	}
+
+	msr_sampler::msr_sampler(msr_sampler&&) noexcept = default;
+
+	msr_sampler::~msr_sampler() noexcept {
+		if (!state) {
+			return;
+		}
+		{
+			std::lock_guard lock(state->mutex);
+			state->stop = true;
+		}
+		state->sample_requested.notify_all();
+		for (auto& reader : state->readers) {
+			reader.join();
+		}
+	}
+
+	[[nodiscard]] const std::vector<uint32_t>& msr_sampler::cpus() const noexcept {
+		return state->ids;
+	}
+
+	void msr_sampler::read(std::span<msr_counters> counters) const noexcept {
+		std::unique_lock lock(state->mutex);
+		// a sample still in flight from another caller finishes first
+		state->sample_done.wait(lock, [this]() noexcept {
+			return state->remaining == 0;
+		});
+		state->counters = counters;
+		state->remaining = state->readers.size();
+		state->generation++;
+		lock.unlock();
+		state->sample_requested.notify_all();
+		lock.lock();
+		state->sample_done.wait(lock, [this]() noexcept {
+			return state->remaining == 0;
+		});
+		state->counters = {};
+	}
+
+	[[nodiscard]] std::variant<msr_sampler, hwctrl_error> open_msr_sampler(const cpu_topology& topology, const std::filesystem::path& msr_root, uint32_t register_stride) noexcept {
+		if (register_stride == 0) {
+			return hwctrl_error{"error - msr register stride must not be 0"};
+		}
+		std::vector<uint32_t> ids{};
+		std::vector<util::file::unique_fd> files{};
+		std::vector<std::vector<size_t>> packages(topology.packages.size());
+		for (uint32_t cpu = 0; cpu < topology.logical_cpu_count(); cpu++) {
+			if (!topology.online(cpu)) {
+				continue;
+			}
+			auto path = msr_root / std::to_string(cpu) / "msr";
+			util::file::unique_fd fd{::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+			if (!fd.valid()) {
+				return hwctrl_error{"error - failed to open \"" + path.string() + "\" (msr module loaded, running as root?)"};
+			}
+			// cpus without a known package get a reader of their own
+			auto package_id = topology.cpus[cpu].package_id;
+			auto package_index = package_id < topology.packages.index_by_id.size() ? topology.packages.index_by_id[package_id] : cpu_topology::UNKNOWN_ID;
+			if (package_index == cpu_topology::UNKNOWN_ID) {
+				packages.emplace_back();
+				package_index = static_cast<uint32_t>(packages.size() - 1);
+			}
+			packages[package_index].push_back(ids.size());
+			ids.push_back(cpu);
+			files.push_back(std::move(fd));
+		}
+		if (ids.empty()) {
+			return hwctrl_error{"error - no online cpus"};
+		}
+		std::erase_if(packages, [](const std::vector<size_t>& package) noexcept {
+			return package.empty();
+		});
+		return msr_sampler{std::move(ids), std::move(files), std::move(packages), register_stride};
+	}
+
+	[[nodiscard]] std::vector<effective_frequency> compute_effective_frequency(std::span<const uint32_t> cpus, std::span<const msr_counters> before, std::span<const msr_counters> after, std::chrono::nanoseconds elapsed) noexcept {
+		std::vector<effective_frequency> frequencies(cpus.size());
+		auto elapsed_us = std::chrono::duration<double, std::micro>(elapsed).count();
+		for (size_t i = 0; i < cpus.size(); i++) {
+			auto& frequency = frequencies[i];
+			frequency.cpu = cpus[i];
+			if (i >= before.size() || i >= after.size() || !before[i].valid || !after[i].valid || elapsed_us <= 0) {
+				continue;
+			}
+			// unsigned subtraction handles a counter wrapping once
+			auto aperf = static_cast<double>(after[i].aperf - before[i].aperf);
+			auto mperf = static_cast<double>(after[i].mperf - before[i].mperf);
+			auto tsc = static_cast<double>(after[i].tsc - before[i].tsc);
+			if (tsc <= 0) {
+				continue;
+			}
+			frequency.tsc_mhz = tsc / elapsed_us;
+			frequency.c0_residency = mperf / tsc;
+			// mperf ticks at the tsc rate while in c0, aperf at the actual clock
+			frequency.busy_mhz = mperf > 0 ? frequency.tsc_mhz * aperf / mperf : 0;
+			frequency.valid = true;
+		}
+		return frequencies;
+	}
+
+	void write_effective_frequency(util::writer& out, std::span<const effective_frequency> frequencies) noexcept {
+		out.begin_object();
+		out.begin_array("cpus");
+		for (const auto& frequency : frequencies) {
+			out.begin_object();
+			out.field("cpu", frequency.cpu);
+			if (frequency.valid) {
+				out.field("busy_mhz", frequency.busy_mhz);
+				out.field("c0_residency", frequency.c0_residency);
+				out.field("tsc_mhz", frequency.tsc_mhz);
+			} else {
+				out.field("error", "counters unavailable");
+			}
+			out.end_object();
+		}
+		out.end_array();
+		out.end_object();
+	}
+} // namespace hwctrl::source
@@ -0,0 +1,187 @@
+#include <source/numa.hpp>
+#include <util/sysfs.hpp>
+#include <util/file.hpp>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <optional>
+#include <set>
+
+namespace hwctrl::source {
+	// node ids above this are rejected like topology ids
+	static constexpr uint32_t MAX_NUMA_NODE_ID = 1u << 16u;
+
+	[[nodiscard]] const numa_node* numa_topology::find(uint32_t id) const noexcept {
+		if (id >= index_by_id.size() || index_by_id[id] == cpu_topology::UNKNOWN_ID) {
+			return nullptr;
+		}
+		return &nodes[index_by_id[id]];
+	}
+
+	[[nodiscard]] uint32_t numa_topology::distance(uint32_t from_id, uint32_t to_id) const noexcept {
+		const auto* from = find(from_id);
+		const auto* to = find(to_id);
+		if (from == nullptr || to == nullptr) {
+			return UNKNOWN_DISTANCE;
+		}
+		auto from_index = static_cast<size_t>(from - nodes.data());
+		auto to_index = static_cast<size_t>(to - nodes.data());
+		return distances[from_index * nodes.size() + to_index];
+	}
+
+	void parse_node_meminfo(std::string_view str, numa_node& node) noexcept {
+		const char* current = str.data();
+		const char* const end = str.data() + str.size();
+		while (current < end) {
+			const auto* newline = static_cast<const char*>(std::memchr(current, '\n', static_cast<size_t>(end - current)));
+			const char* line_end = newline == nullptr ? end : newline;
+			std::string_view line{current, static_cast<size_t>(line_end - current)};
+			current = line_end + 1;
+			// skip "Node N "
+			auto key_start = line.find(' ', line.find(' ') + 1);
+			auto colon = line.find(':');
+			if (key_start == std::string_view::npos || colon == std::string_view::npos || colon < key_start) {
+				continue;
+			}
+			auto key = line.substr(key_start + 1, colon - key_start - 1);
+			auto value_str = line.substr(colon + 1);
+			value_str.remove_prefix(std::min(value_str.find_first_not_of(' '), value_str.size()));
+			uint64_t value = 0;
+			auto [value_end, ec] = std::from_chars(value_str.data(), value_str.data() + value_str.size(), value);
+			if (ec != std::errc{}) {
+				continue;
+			}
+			// everything but the huge page counts is in kB
+			uint64_t bytes = value * 1024u;
+			if (key == "MemTotal") {
+				node.total_bytes = bytes;
+			} else if (key == "MemFree") {
+				node.free_bytes = bytes;
+			} else if (key == "FilePages") {
+				node.file_pages_bytes = bytes;
+			} else if (key == "HugePages_Total") {
+				node.hugepages_total = value;
+			} else if (key == "HugePages_Free") {
+				node.hugepages_free = value;
+			}
+		}
+	}
+
+	[[nodiscard]] static std::vector<uint32_t> parse_distances(std::string_view str) noexcept {
+		std::vector<uint32_t> row{};
+		const char* current = str.data();
+		const char* const end = str.data() + str.size();
+		while (current < end) {
+			if (*current == ' ' || *current == '\n') {
+				current++;
+				continue;
+			}
+			uint32_t value = 0;
+			auto [value_end, ec] = std::from_chars(current, end, value);
+			if (ec != std::errc{}) {
+				break;
+			}
+			row.push_back(value);
+			current = value_end;
+		}
+		return row;
+	}
+
+	[[nodiscard]] std::variant<numa_topology, hwctrl_error> read_numa_topology(const std::filesystem::path& sysfs_root) noexcept {
+		std::vector<std::pair<uint32_t, std::filesystem::path>> node_dirs{};
+		util::sysfs::for_each_numbered_entry(sysfs_root / "devices/system/node", "node", [&](uint32_t id, const std::filesystem::path& path) noexcept {
+			if (id < MAX_NUMA_NODE_ID) {
+				node_dirs.emplace_back(id, path);
+			}
+		});
+		if (node_dirs.empty()) {
+			return hwctrl_error{"error - no numa nodes found in \"" + (sysfs_root / "devices/system/node").string() + "\""};
+		}
+		std::sort(node_dirs.begin(), node_dirs.end());
+
+		numa_topology numa{};
+		numa.index_by_id.assign(node_dirs.back().first + 1u, cpu_topology::UNKNOWN_ID);
+		std::vector<std::vector<uint32_t>> distance_rows{};
+		std::vector<char> buffer{};
+		for (const auto& [id, path] : node_dirs) {
+			numa_node node{};
+			node.id = id;
+			auto cpulist = util::sysfs::read_string(path / "cpulist");
+			if (const auto* cpulist_ptr = std::get_if<std::string>(&cpulist)) {
+				auto cpus = util::sysfs::parse_id_list(*cpulist_ptr);
+				if (auto* err_ptr = std::get_if<hwctrl_error>(&cpus)) {
+					return std::move(*err_ptr);
+				}
+				node.cpus = std::move(std::get<std::vector<uint32_t>>(cpus));
+			}
+			auto meminfo = util::file::read_ram_file(path / "meminfo", buffer);
+			if (const auto* meminfo_ptr = std::get_if<std::string_view>(&meminfo)) {
+				parse_node_meminfo(*meminfo_ptr, node);
+			}
+			auto distance = util::file::read_ram_file(path / "distance", buffer);
+			distance_rows.push_back(std::holds_alternative<std::string_view>(distance) ? parse_distances(std::get<std::string_view>(distance)) : std::vector<uint32_t>{});
+			numa.index_by_id[id] = static_cast<uint32_t>(numa.nodes.size());
+			numa.nodes.push_back(std::move(node));
+		}
+
+		// a distance row lists one entry per online node in ascending id order, which matches nodes
+		const size_t count = numa.nodes.size();
+		numa.distances.assign(count * count, numa_topology::UNKNOWN_DISTANCE);
+		for (size_t from = 0; from < count; from++) {
+			const auto& row = distance_rows[from];
+			if (row.size() != count) {
+				continue;
+			}
+			std::copy(row.begin(), row.end(), numa.distances.begin() + static_cast<ptrdiff_t>(from * count));
+		}
+		return numa;
+	}
+
+	[[nodiscard]] cpu_topology link_numa_topology(const cpu_topology& topology, const numa_topology& numa) noexcept {
+		auto cpus = topology.cpus;
+		for (const auto& node : numa.nodes) {
+			for (auto cpu : node.cpus) {
+				if (cpu < cpus.size()) {
+					cpus[cpu].numa_node_id = node.id;
+				}
+			}
+		}
+		return build_topology(std::move(cpus));
+	}
+
+	void write_numa_topology(util::writer& out, const numa_topology& numa, const cpu_topology& topology) noexcept {
+		out.begin_object();
+		out.begin_array("nodes");
+		for (size_t index = 0; index < numa.nodes.size(); index++) {
+			const auto& node = numa.nodes[index];
+			out.begin_object();
+			out.field("id", node.id);
+			out.field("cpus", util::sysfs::id_list_string(node.cpus));
+			// packages the node's cpus belong to
+			std::set<uint32_t> packages{};
+			for (auto cpu : node.cpus) {
+				if (topology.online(cpu) && topology.cpus[cpu].package_id != cpu_topology::UNKNOWN_ID) {
+					packages.insert(topology.cpus[cpu].package_id);
+				}
+			}
+			out.begin_array("packages");
+			for (auto package : packages) {
+				out.value(package);
+			}
+			out.end_array();
+			out.field("total_bytes", node.total_bytes);
+			out.field("free_bytes", node.free_bytes);
+			out.field("file_pages_bytes", node.file_pages_bytes);
+			out.field("hugepages_total", node.hugepages_total);
+			out.field("hugepages_free", node.hugepages_free);
+			out.begin_array("distances");
+			for (size_t to = 0; to < numa.nodes.size(); to++) {
+				out.value(numa.distances[index * numa.nodes.size() + to]);
+			}
+			out.end_array();
+			out.end_object();
+		}
+		out.end_array();
+		out.end_object();
+	}
+} // namespace hwctrl::source
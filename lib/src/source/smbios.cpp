@@ -0,0 +1,166 @@
+#include <source/smbios.hpp>
+#include <util/file.hpp>
+#include <cstring>
+#include <string_view>
+
+namespace hwctrl::source {
+	smbios_memory_device::smbios_memory_device() noexcept = default;
+	smbios_memory_device::smbios_memory_device(const smbios_memory_device& other) = default;
+	smbios_memory_device::smbios_memory_device(smbios_memory_device&& other) noexcept = default;
+	smbios_memory_device& smbios_memory_device::operator=(const smbios_memory_device& other) = default;
+	smbios_memory_device& smbios_memory_device::operator=(smbios_memory_device&& other) noexcept = default;
+	smbios_memory_device::~smbios_memory_device() noexcept = default;
+
+	smbios_tables::smbios_tables() noexcept = default;
+	smbios_tables::smbios_tables(const smbios_tables& other) = default;
+	smbios_tables::smbios_tables(smbios_tables&& other) noexcept = default;
+	smbios_tables& smbios_tables::operator=(const smbios_tables& other) = default;
+	smbios_tables& smbios_tables::operator=(smbios_tables&& other) noexcept = default;
+	smbios_tables::~smbios_tables() noexcept = default;
+
+	static constexpr uint8_t SMBIOS_MEMORY_ARRAY = 16;
+	static constexpr uint8_t SMBIOS_MEMORY_DEVICE = 17;
+	static constexpr uint8_t SMBIOS_END_OF_TABLE = 127;
+
+	// one structure: formatted area followed by its string set
+	struct smbios_structure {
+		std::span<const unsigned char> formatted{};
+		std::span<const unsigned char> strings{};
+
+		[[nodiscard]] uint8_t byte(size_t offset) const noexcept {
+			return offset < formatted.size() ? formatted[offset] : 0;
+		}
+
+		[[nodiscard]] uint16_t word(size_t offset) const noexcept {
+			return offset + 2 <= formatted.size() ? static_cast<uint16_t>(formatted[offset] | (formatted[offset + 1] << 8u)) : 0;
+		}
+
+		[[nodiscard]] uint32_t dword(size_t offset) const noexcept {
+			return offset + 4 <= formatted.size() ? (word(offset) | (static_cast<uint32_t>(word(offset + 2)) << 16u)) : 0;
+		}
+
+		[[nodiscard]] uint64_t qword(size_t offset) const noexcept {
+			return offset + 8 <= formatted.size() ? (dword(offset) | (uint64_t{dword(offset + 4)} << 32u)) : 0;
+		}
+
+		// strings are referenced by 1 based index, 0 means none
+		[[nodiscard]] std::string string(size_t offset) const noexcept {
+			auto index = byte(offset);
+			if (index == 0) {
+				return {};
+			}
+			size_t start = 0;
+			for (uint8_t current = 1; start < strings.size(); current++) {
+				const auto* end = static_cast<const unsigned char*>(std::memchr(strings.data() + start, 0, strings.size() - start));
+				auto length = end == nullptr ? strings.size() - start : static_cast<size_t>(end - strings.data()) - start;
+				if (length == 0) {
+					break;
+				}
+				if (current == index) {
+					std::string str{reinterpret_cast<const char*>(strings.data() + start), length};
+					// firmware pads strings with spaces
+					str.erase(str.find_last_not_of(' ') + 1);
+					return str;
+				}
+				start += length + 1;
+			}
+			return {};
+		}
+	};
+
+	[[nodiscard]] static smbios_memory_array decode_memory_array(const smbios_structure& structure, uint16_t handle) noexcept {
+		smbios_memory_array array{};
+		array.handle = handle;
+		array.location = structure.byte(0x04);
+		array.use = structure.byte(0x05);
+		array.error_correction = structure.byte(0x06);
+		// capacity is in kB, 0x80000000 moves it to the extended field in bytes
+		auto capacity = structure.dword(0x07);
+		array.max_capacity_bytes = capacity == 0x80000000u ? structure.qword(0x0f) : uint64_t{capacity} << 10u;
+		array.device_count = structure.word(0x0d);
+		return array;
+	}
+
+	[[nodiscard]] static smbios_memory_device decode_memory_device(const smbios_structure& structure, uint16_t handle) noexcept {
+		smbios_memory_device device{};
+		device.handle = handle;
+		device.array_handle = structure.word(0x04);
+		device.total_width_bits = structure.word(0x08);
+		device.data_width_bits = structure.word(0x0a);
+		// 0xffff marks unknown widths
+		if (device.total_width_bits == 0xffff) {
+			device.total_width_bits = 0;
+		}
+		if (device.data_width_bits == 0xffff) {
+			device.data_width_bits = 0;
+		}
+		auto size = structure.word(0x0c);
+		if (size == 0x7fff) {
+			device.size_bytes = uint64_t{structure.dword(0x1c) & 0x7fffffffu} << 20u;
+		} else if (size != 0xffff) {
+			// bit 15 selects kB instead of MB
+			device.size_bytes = (size & 0x8000u) != 0 ? uint64_t{size & 0x7fffu} << 10u : uint64_t{size} << 20u;
+		}
+		device.locator = structure.string(0x10);
+		device.bank_locator = structure.string(0x11);
+		device.memory_type = structure.byte(0x12);
+		device.speed_mt = structure.word(0x15);
+		device.manufacturer = structure.string(0x17);
+		device.serial_number = structure.string(0x18);
+		device.part_number = structure.string(0x1a);
+		device.ranks = structure.byte(0x1b) & 0x0fu;
+		device.configured_speed_mt = structure.word(0x20);
+		device.minimum_mv = structure.word(0x22);
+		device.maximum_mv = structure.word(0x24);
+		device.configured_mv = structure.word(0x26);
+		// smbios 3.3 moved speeds above 65534 MT/s into dwords
+		if (device.speed_mt == 0xffff) {
+			device.speed_mt = structure.dword(0x54) & 0x7fffffffu;
+		}
+		if (device.configured_speed_mt == 0xffff) {
+			device.configured_speed_mt = structure.dword(0x58) & 0x7fffffffu;
+		}
+		return device;
+	}
+
+	[[nodiscard]] std::variant<smbios_tables, hwctrl_error> parse_smbios(std::span<const unsigned char> table) noexcept {
+		smbios_tables tables{};
+		size_t offset = 0;
+		while (offset + 4 <= table.size()) {
+			uint8_t type = table[offset];
+			uint8_t length = table[offset + 1];
+			auto handle = static_cast<uint16_t>(table[offset + 2] | (table[offset + 3] << 8u));
+			if (length < 4 || offset + length > table.size()) {
+				return hwctrl_error{"error - truncated smbios structure at offset " + std::to_string(offset)};
+			}
+			// the string set ends with two zero bytes
+			size_t strings_start = offset + length;
+			size_t strings_end = strings_start;
+			while (strings_end + 1 < table.size() && (table[strings_end] != 0 || table[strings_end + 1] != 0)) {
+				strings_end++;
+			}
+			if (strings_end + 1 >= table.size()) {
+				return hwctrl_error{"error - unterminated smbios string set at offset " + std::to_string(offset)};
+			}
+			smbios_structure structure{table.subspan(offset, length), table.subspan(strings_start, strings_end - strings_start + 1)};
+			if (type == SMBIOS_MEMORY_ARRAY) {
+				tables.memory_arrays.push_back(decode_memory_array(structure, handle));
+			} else if (type == SMBIOS_MEMORY_DEVICE) {
+				tables.memory_devices.push_back(decode_memory_device(structure, handle));
+			} else if (type == SMBIOS_END_OF_TABLE) {
+				break;
+			}
+			offset = strings_end + 2;
+		}
+		return tables;
+	}
+
+	[[nodiscard]] std::variant<smbios_tables, hwctrl_error> read_smbios(const std::filesystem::path& path) noexcept {
+		// the kernel's DMI attribute does not support mmap, copies of the table do
+		auto file_result = util::file::map_or_read_file(path);
+		if (auto* err_ptr = std::get_if<hwctrl_error>(&file_result)) {
+			return std::move(*err_ptr);
+		}
+		return parse_smbios(std::get<util::file::mapped_file>(file_result).data());
+	}
+} // namespace hwctrl::source
@@ -0,0 +1,218 @@
+#include <source/spd_batch.hpp>
+#include <source/spd_view.hpp>
+#include <util/file.hpp>
+#include <mutex>
+#include <vector>
+
+namespace hwctrl::source {
+	// files per task - large enough to amortize scheduling, small enough to balance a skewed tree
+	static constexpr size_t SPD_BATCH_CHUNK_SIZE = 64;
+
+	void spd_batch_summary::add(const spd_batch_record& record) noexcept {
+		files++;
+		if (record.error != std::nullopt) {
+			failures++;
+			return;
+		}
+		types[record.type]++;
+		speeds[record.clock_mt]++;
+		if (record.xmp_clock_mt != 0) {
+			xmp_speeds[record.xmp_clock_mt]++;
+		}
+		vendors[{record.module_manufacturer.name, record.module_manufacturer.id_code}]++;
+	}
+
+	void spd_batch_summary::merge(const spd_batch_summary& other) noexcept {
+		files += other.files;
+		failures += other.failures;
+		for (const auto& [key, count] : other.types) {
+			types[key] += count;
+		}
+		for (const auto& [key, count] : other.speeds) {
+			speeds[key] += count;
+		}
+		for (const auto& [key, count] : other.xmp_speeds) {
+			xmp_speeds[key] += count;
+		}
+		for (const auto& [key, count] : other.vendors) {
+			vendors[key] += count;
+		}
+	}
+
+	[[nodiscard]] spd_batch_record audit_spd_file(const std::filesystem::path& path) noexcept {
+		spd_batch_record record{};
+		record.path = path;
+		auto file_result = util::file::map_or_read_file(path);
+		if (auto* err_ptr = std::get_if<hwctrl_error>(&file_result)) {
+			record.error = std::move(*err_ptr);
+			return record;
+		}
+		auto data = std::get<util::file::mapped_file>(file_result).data();
+		if (data.size() >= 4 && data[2] == 0x0b) {
+			record.type = "ddr3";
+			return record;
+		}
+		auto view_result = make_spd_view(data);
+		if (auto* err_ptr = std::get_if<hwctrl_error>(&view_result)) {
+			record.error = std::move(*err_ptr);
+			return record;
+		}
+		const auto& view = std::get<spd_view>(view_result);
+		record.type = "ddr4";
+		record.clock_mt = view.clock_max().clock_mt;
+		if (auto profile = view.xmp_profile(0); profile != std::nullopt && profile->enable) {
+			record.xmp_clock_mt = profile->clk.clock_mt;
+		}
+		record.module_manufacturer = view.module_manufacturer();
+		record.serial_number = view.serial_number();
+		auto part_number = view.part_number();
+		while (!part_number.empty() && (part_number.back() == ' ' || part_number.back() == '\0')) {
+			part_number.remove_suffix(1);
+		}
+		record.part_number = part_number;
+		return record;
+	}
+
+	// walks the inputs on the calling thread and hands out chunks of paths as they are found
+	// so auditing starts before a large tree has been fully listed
+	class spd_batch_submitter {
+		public:
+			spd_batch_submitter(util::thread_pool& pool_ref, const std::function<void(const spd_batch_record&)>& on_record_ref) noexcept
+				: pool(pool_ref), on_record(on_record_ref), summaries(pool_ref.size() + 1), record_mutex(), chunk() {
+			}
+
+			void add(std::filesystem::path path) noexcept {
+				chunk.push_back(std::move(path));
+				if (chunk.size() == SPD_BATCH_CHUNK_SIZE) {
+					flush();
+				}
+			}
+
+			[[nodiscard]] spd_batch_summary finish() noexcept {
+				flush();
+				pool.wait();
+				spd_batch_summary summary{};
+				for (const auto& worker_summary : summaries) {
+					summary.merge(worker_summary);
+				}
+				return summary;
+			}
+		private:
+			void flush() noexcept {
+				if (chunk.empty()) {
+					return;
+				}
+				pool.submit([this, paths = std::move(chunk)]() noexcept {
+					// each worker owns one summary so only the output callback needs a lock
+					auto& summary = summaries[pool.worker_index()];
+					for (const auto& path : paths) {
+						auto record = audit_spd_file(path);
+						summary.add(record);
+						std::lock_guard lock(record_mutex);
+						on_record(record);
+					}
+				});
+				chunk = {};
+			}
+
+			util::thread_pool& pool;
+			const std::function<void(const spd_batch_record&)>& on_record;
+			std::vector<spd_batch_summary> summaries;
+			std::mutex record_mutex;
+			std::vector<std::filesystem::path> chunk;
+	};
+
+	[[nodiscard]] std::variant<spd_batch_summary, hwctrl_error> audit_spd_files(const std::string& dir_or_glob, util::thread_pool& pool, const std::function<void(const spd_batch_record&)>& on_record) noexcept {
+		spd_batch_submitter submitter(pool, on_record);
+		if (util::file::is_directory(dir_or_glob)) {
+			auto err = util::file::walk_files(dir_or_glob, [&submitter](const std::filesystem::path& path) noexcept {
+				submitter.add(path);
+			});
+			if (err.has_value()) {
+				// tasks already submitted reference the submitter and on_record
+				[[maybe_unused]] auto summary = submitter.finish();
+				return std::move(err.value());
+			}
+		} else {
+			auto matches = util::file::glob(dir_or_glob);
+			if (auto* err_ptr = std::get_if<hwctrl_error>(&matches)) {
+				return std::move(*err_ptr);
+			}
+			auto& paths = std::get<std::vector<std::filesystem::path>>(matches);
+			if (paths.empty()) {
+				return hwctrl_error{"error - no files match \"" + dir_or_glob + "\""};
+			}
+			for (auto& path : paths) {
+				submitter.add(std::move(path));
+			}
+		}
+		return submitter.finish();
+	}
+
+	void write_spd_batch_record(util::writer& out, const spd_batch_record& record) noexcept {
+		out.begin_object();
+		out.field("path", record.path.native());
+		if (record.error != std::nullopt) {
+			out.field("error", record.error->message);
+			out.end_object();
+			return;
+		}
+		out.field("type", record.type);
+		if (record.type == "ddr4") {
+			out.field("clock_mt", record.clock_mt);
+			if (record.xmp_clock_mt != 0) {
+				out.field("xmp_clock_mt", record.xmp_clock_mt);
+			}
+			out.field("module_manufacturer_id", record.module_manufacturer.id_code);
+			out.field("module_manufacturer", get_module_manufacturer_name_string(record.module_manufacturer));
+			out.field("part_number", record.part_number);
+			out.field("serial", record.serial_number);
+		}
+		out.end_object();
+	}
+
+	template <typename K>
+	static void write_counts(util::writer& out, std::string_view key, std::string_view name, const std::map<K, size_t>& counts) noexcept {
+		out.begin_array(key);
+		for (const auto& [value, count] : counts) {
+			out.begin_object();
+			out.field(name, value);
+			out.field("count", count);
+			out.end_object();
+		}
+		out.end_array();
+	}
+
+	void write_spd_batch_summary(util::writer& out, const spd_batch_summary& summary) noexcept {
+		out.begin_object();
+		out.field("files", summary.files);
+		out.field("failures", summary.failures);
+		write_counts(out, "types", "type", summary.types);
+		write_counts(out, "speeds", "clock_mt", summary.speeds);
+		write_counts(out, "xmp_speeds", "clock_mt", summary.xmp_speeds);
+		out.begin_array("vendors");
+		for (const auto& [vendor, count] : summary.vendors) {
+			out.begin_object();
+			out.field("id", vendor.second);
+			out.field("name", get_module_manufacturer_name_string({vendor.first, vendor.second}));
+			out.field("count", count);
+			out.end_object();
+		}
+		out.end_array();
+		out.end_object();
+	}
+
+	[[nodiscard]] std::string spd_batch_record_string(const spd_batch_record& record) noexcept {
+		std::string str;
+		util::writer out{str, util::output_format::TEXT};
+		write_spd_batch_record(out, record);
+		return str;
+	}
+
+	[[nodiscard]] std::string spd_batch_summary_string(const spd_batch_summary& summary) noexcept {
+		std::string str;
+		util::writer out{str, util::output_format::TEXT};
+		write_spd_batch_summary(out, summary);
+		return str;
+	}
+} // namespace hwctrl::source
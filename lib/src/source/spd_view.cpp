@@ -0,0 +1,508 @@
+#include <source/spd_view.hpp>
+#include <source/spd_layout.hpp>
+#include <array>
+#include <cstring>
+
+namespace hwctrl::source {
+	using spd_layout::make_byte_table;
+
+	[[nodiscard]] static constexpr memory_clock round_ddr4_jdec_mem_clk(uint8_t mtb, uint8_t ftb) noexcept {
+		uint16_t cycle_time = static_cast<uint16_t>(mtb * 125 + static_cast<int8_t>(ftb));
+		switch (cycle_time) {
+			case 1500:
+				return memory_clock{cycle_time, 666, 1333, mtb, ftb};
+			case 938:
+				return memory_clock{cycle_time, 1066, 2133, mtb, ftb};
+			case 666:
+				return memory_clock{cycle_time, 1500, 3000, mtb, ftb};
+			default:
+				{
+					uint16_t clk = static_cast<uint16_t>(1e6f / static_cast<float>(cycle_time));
+					return memory_clock{cycle_time, clk, static_cast<uint16_t>(clk * 2u), mtb, ftb};
+				}
+		}
+	}
+
+	// xmp 2.0 profile layout - offsets are relative to the start of a profile (see docs/spec/spd.md)
+	static constexpr uint16_t XMP_20_PROFILE_OFFSET = 393;
+	static constexpr uint16_t XMP_20_PROFILE_SIZE = 47;
+
+	static constexpr auto XMP_20_TIMINGS = std::to_array<spd_layout::timing_field<xmp_20_data::xmp_profile>>({
+		{&xmp_20_data::xmp_profile::tCL, {.low = 8, .ftb = 37, .ftb_mask = 0xff}},
+		{&xmp_20_data::xmp_profile::tRCD, {.low = 9, .ftb = 36, .ftb_mask = 0xff}},
+		{&xmp_20_data::xmp_profile::tRP, {.low = 10, .ftb = 35, .ftb_mask = 0xff}},
+		{&xmp_20_data::xmp_profile::tRAS, {.low = 12, .high = 11, .high_mask = 0x0f, .high_shift = 8}},
+		{&xmp_20_data::xmp_profile::tRC, {.low = 13, .high = 11, .high_mask = 0xf0, .high_shift = 4, .ftb = 34, .ftb_mask = 0xff}},
+		{&xmp_20_data::xmp_profile::tRFC1, {.low = 14, .high = 15, .high_mask = 0xff, .high_shift = 8}},
+		{&xmp_20_data::xmp_profile::tRFC2, {.low = 16, .high = 17, .high_mask = 0xff, .high_shift = 8}},
+		{&xmp_20_data::xmp_profile::tRFC4, {.low = 18, .high = 19, .high_mask = 0xff, .high_shift = 8}},
+		{&xmp_20_data::xmp_profile::tFAW, {.low = 21, .high = 20, .high_mask = 0x0f, .high_shift = 8}},
+		{&xmp_20_data::xmp_profile::tRRD_S, {.low = 22, .ftb = 32, .ftb_mask = 0xff}},
+		{&xmp_20_data::xmp_profile::tRRD_L, {.low = 23, .ftb = 31, .ftb_mask = 0xff}}
+	});
+
+	// ddr4 base configuration layout (jedec 21-C annex l)
+	static constexpr spd_layout::bits DDR4_SPD_REVISION_MAJOR{1, 0xf0, 4};
+	static constexpr spd_layout::bits DDR4_SPD_REVISION_MINOR{1, 0x0f, 0};
+	static constexpr spd_layout::bits DDR4_DIE_SIZE_MB{4, 0x0f, 0};
+	static constexpr spd_layout::bits DDR4_MODULE_THERMAL_SENSOR{14, 0x80, 7};
+	static constexpr spd_layout::bits DDR4_MODULE_HEIGHT{128, 0x1f, 0};
+	static constexpr spd_layout::bits DDR4_MODULE_MAX_THICKNESS{129};
+	static constexpr spd_layout::bits DDR4_REF_RAW_CARD_USED{130};
+	// manufacturing section, only present when the second page was dumped
+	static constexpr spd_layout::bits DDR4_MODULE_MANUFACTURING_LOCATION{322};
+	static constexpr spd_layout::bits DDR4_MODULE_REVISION_CODE{349};
+	static constexpr spd_layout::bits DDR4_DRAM_STEPPING{352};
+
+	static constexpr spd_layout::timing DDR4_TCL_MIN{.low = 24, .ftb = 123, .ftb_mask = 0xff};
+	static constexpr spd_layout::timing DDR4_TRCD_MIN{.low = 25, .ftb = 122, .ftb_mask = 0xff};
+	static constexpr spd_layout::timing DDR4_TRP_MIN{.low = 26, .ftb = 121, .ftb_mask = 0xff};
+	static constexpr spd_layout::timing DDR4_TRAS_MIN{.low = 28, .high = 27, .high_mask = 0x0f, .high_shift = 8};
+	static constexpr spd_layout::timing DDR4_TRC_MIN{.low = 29, .high = 27, .high_mask = 0xf0, .high_shift = 4, .ftb = 120, .ftb_mask = 0xff};
+	static constexpr spd_layout::timing DDR4_TRFC1_MIN{.low = 30, .high = 31, .high_mask = 0xff, .high_shift = 8};
+	static constexpr spd_layout::timing DDR4_TRFC2_MIN{.low = 32, .high = 33, .high_mask = 0xff, .high_shift = 8};
+	static constexpr spd_layout::timing DDR4_TRFC4_MIN{.low = 34, .high = 35, .high_mask = 0xff, .high_shift = 8};
+	// byte 36 bits 4-7 are reserved, only the low nibble extends tFAW_min
+	static constexpr spd_layout::timing DDR4_TFAW_MIN{.low = 37, .high = 36, .high_mask = 0x0f, .high_shift = 8};
+	static constexpr spd_layout::timing DDR4_TRRD_S_MIN{.low = 38, .ftb = 119, .ftb_mask = 0xff};
+	static constexpr spd_layout::timing DDR4_TRRD_L_MIN{.low = 39, .ftb = 118, .ftb_mask = 0xff};
+	static constexpr spd_layout::timing DDR4_TCCD_L_MIN{.low = 40, .ftb = 117, .ftb_mask = 0xff};
+
+	// the same fields as tables for decoding everything at once in to_spd_ddr4
+	static constexpr auto DDR4_BYTES = std::to_array<spd_layout::byte_field<spd_ddr4>>({
+		{&spd_ddr4::spd_revision_major, DDR4_SPD_REVISION_MAJOR},
+		{&spd_ddr4::spd_revision_minor, DDR4_SPD_REVISION_MINOR},
+		{&spd_ddr4::die_size_mb, DDR4_DIE_SIZE_MB},
+		{&spd_ddr4::module_height, DDR4_MODULE_HEIGHT},
+		{&spd_ddr4::module_max_thickness, DDR4_MODULE_MAX_THICKNESS},
+		{&spd_ddr4::ref_raw_card_used, DDR4_REF_RAW_CARD_USED}
+	});
+
+	static constexpr auto DDR4_TIMINGS = std::to_array<spd_layout::timing_field<spd_ddr4>>({
+		{&spd_ddr4::tCL_min, DDR4_TCL_MIN},
+		{&spd_ddr4::tRCD_min, DDR4_TRCD_MIN},
+		{&spd_ddr4::tRP_min, DDR4_TRP_MIN},
+		{&spd_ddr4::tRAS_min, DDR4_TRAS_MIN},
+		{&spd_ddr4::tRC_min, DDR4_TRC_MIN},
+		{&spd_ddr4::tRFC1_min, DDR4_TRFC1_MIN},
+		{&spd_ddr4::tRFC2_min, DDR4_TRFC2_MIN},
+		{&spd_ddr4::tRFC4_min, DDR4_TRFC4_MIN},
+		{&spd_ddr4::tFAW_min, DDR4_TFAW_MIN},
+		{&spd_ddr4::tRRD_S_min, DDR4_TRRD_S_MIN},
+		{&spd_ddr4::tRRD_L_min, DDR4_TRRD_L_MIN},
+		{&spd_ddr4::tCCD_L_min, DDR4_TCCD_L_MIN}
+	});
+
+	static constexpr auto DDR4_DEVICE_TYPE = make_byte_table<std::optional<spd_ddr4::device_type_t>>({
+		{0x00, spd_ddr4::UNKNOWN_DEVICE_TYPE},
+		{0x01, spd_ddr4::RDIMM},
+		{0x02, spd_ddr4::UDIMM},
+		{0x03, spd_ddr4::SODIMM},
+		{0x04, spd_ddr4::LRDIMM}
+	});
+
+	struct ddr4_bank_groups {
+		uint8_t bank_groups = 0;
+		uint8_t internal_banks = 0;
+	};
+
+	static constexpr auto DDR4_BANK_GROUPS = make_byte_table<ddr4_bank_groups>({
+		{0x94, {4, 8}},
+		{0x95, {4, 8}},
+		{0x54, {2, 8}},
+		{0x55, {2, 8}}
+	});
+
+	struct ddr4_row_column {
+		uint8_t row_count = 0;
+		uint8_t column_count = 0;
+	};
+
+	static constexpr auto DDR4_ROW_COLUMN = make_byte_table<std::optional<ddr4_row_column>>({
+		{0x21, ddr4_row_column{16, 10}},
+		{0x19, ddr4_row_column{15, 10}},
+		{0x29, ddr4_row_column{17, 10}}
+	});
+
+	static constexpr auto DDR4_SDRAM_DEVICE_TYPE = make_byte_table<std::optional<spd_ddr4::sdram_device_type_t>>({
+		{0x00, spd_ddr4::MONOLITHIC_SINGLE_DIE},
+		{0x91, spd_ddr4::NON_MONOLITHIC_2_MULTI_LOAD},
+		{0xa1, spd_ddr4::NON_MONOLITHIC_4_MULTI_LOAD},
+		{0xb1, spd_ddr4::NON_MONOLITHIC_8_MULTI_LOAD},
+		{0x92, spd_ddr4::NON_MONOLITHIC_2_3D},
+		{0xa2, spd_ddr4::NON_MONOLITHIC_4_3D},
+		{0xb2, spd_ddr4::NON_MONOLITHIC_8_3D}
+	});
+
+	struct ddr4_tMAW_tRRMAC {
+		uint16_t tMAW_mul = 0;
+		uint16_t tRRMAC_thousands = 0;
+	};
+
+	// byte 7 - bits 4-5 select tMAW 8192/4096/2048 * tREFI, bits 0-3 select tRRMAC 700k-300k
+	static constexpr auto DDR4_TMAW_TRRMAC = make_byte_table<std::optional<ddr4_tMAW_tRRMAC>>({
+		{0x01, ddr4_tMAW_tRRMAC{8192, 700}},
+		{0x02, ddr4_tMAW_tRRMAC{8192, 600}},
+		{0x03, ddr4_tMAW_tRRMAC{8192, 500}},
+		{0x04, ddr4_tMAW_tRRMAC{8192, 400}},
+		{0x05, ddr4_tMAW_tRRMAC{8192, 300}},
+		{0x11, ddr4_tMAW_tRRMAC{4096, 700}},
+		{0x12, ddr4_tMAW_tRRMAC{4096, 600}},
+		{0x13, ddr4_tMAW_tRRMAC{4096, 500}},
+		{0x14, ddr4_tMAW_tRRMAC{4096, 400}},
+		{0x15, ddr4_tMAW_tRRMAC{4096, 300}},
+		{0x21, ddr4_tMAW_tRRMAC{2048, 700}},
+		{0x22, ddr4_tMAW_tRRMAC{2048, 600}},
+		{0x23, ddr4_tMAW_tRRMAC{2048, 500}},
+		{0x24, ddr4_tMAW_tRRMAC{2048, 400}},
+		{0x25, ddr4_tMAW_tRRMAC{2048, 300}}
+	});
+
+	static constexpr auto DDR4_ENDURE_HIGHER_VDD = make_byte_table<std::optional<bool>>({
+		{0x03, false},
+		{0x0b, true}
+	});
+
+	struct ddr4_ranks_chip_size {
+		uint8_t ranks = 0;
+		spd_ddr4::chip_size_t chip_size = spd_ddr4::UNKNOWN_CHIP_SIZE;
+	};
+
+	static constexpr auto DDR4_RANKS_CHIP_SIZE = make_byte_table<ddr4_ranks_chip_size>({
+		{0x00, {1, spd_ddr4::Mb_4}},
+		{0x01, {1, spd_ddr4::Mb_8}},
+		{0x02, {1, spd_ddr4::Mb_16}},
+		{0x08, {2, spd_ddr4::Mb_4}},
+		{0x09, {2, spd_ddr4::Mb_8}},
+		{0x0a, {2, spd_ddr4::Mb_16}},
+		{0x18, {4, spd_ddr4::Mb_4}},
+		{0x19, {4, spd_ddr4::Mb_8}}
+	});
+
+	static constexpr auto DDR4_MEMORY_BUS_WIDTH_BITS = make_byte_table<std::optional<uint8_t>>({
+		{0x01, 16},
+		{0x02, 32},
+		{0x03, 64},
+		{0x0b, 72}
+	});
+
+	[[nodiscard]] static ddr_module_manufacturer parse_spd_ddr4_module_manufacturer(uint16_t code) noexcept {
+		using name_enum = ddr_module_manufacturer::ddr_module_manufacturer_name;
+		return {[&]() noexcept -> name_enum {
+			switch (code) {
+				case 0x0001:
+					return name_enum::KINGSTON;
+				case 0x0004:
+					return name_enum::G_SKILL;
+				case 0x80ce:
+					return name_enum::SAMSUNG;
+				default:
+					return name_enum::UNKNOWN;
+			}
+		}(), code};
+	}
+
+	[[nodiscard]] static ddr_dram_manufacturer parse_spd_ddr4_dram_manufacturer(uint16_t code) noexcept {
+		using name_enum = ddr_dram_manufacturer::ddr_dram_manufacturer_name;
+		return {[&]() noexcept -> name_enum {
+			switch (code) {
+				case 0x0080:
+					return name_enum::SAMSUNG;
+				default:
+					return name_enum::UNKNOWN;
+			}
+		}(), code};
+	}
+
+	spd_view::spd_view(std::span<const unsigned char> data_span) noexcept : data(data_span) {
+	}
+
+	[[nodiscard]] std::span<const unsigned char> spd_view::bytes() const noexcept {
+		return data;
+	}
+
+	[[nodiscard]] uint8_t spd_view::spd_revision_major() const noexcept {
+		return spd_layout::decode_bits(data.data(), DDR4_SPD_REVISION_MAJOR);
+	}
+
+	[[nodiscard]] uint8_t spd_view::spd_revision_minor() const noexcept {
+		return spd_layout::decode_bits(data.data(), DDR4_SPD_REVISION_MINOR);
+	}
+
+	[[nodiscard]] spd_ddr4::device_type_t spd_view::device_type() const noexcept {
+		// validated by make_spd_view
+		return DDR4_DEVICE_TYPE[data[3]].value_or(spd_ddr4::UNKNOWN_DEVICE_TYPE);
+	}
+
+	[[nodiscard]] uint8_t spd_view::bank_groups() const noexcept {
+		return DDR4_BANK_GROUPS[data[4]].bank_groups;
+	}
+
+	[[nodiscard]] uint8_t spd_view::internal_banks() const noexcept {
+		return DDR4_BANK_GROUPS[data[4]].internal_banks;
+	}
+
+	[[nodiscard]] uint8_t spd_view::die_size_mb() const noexcept {
+		return spd_layout::decode_bits(data.data(), DDR4_DIE_SIZE_MB);
+	}
+
+	[[nodiscard]] std::optional<uint8_t> spd_view::row_count() const noexcept {
+		if (const auto& row_column = DDR4_ROW_COLUMN[data[5]]) {
+			return row_column->row_count;
+		}
+		return {};
+	}
+
+	[[nodiscard]] std::optional<uint8_t> spd_view::column_count() const noexcept {
+		if (const auto& row_column = DDR4_ROW_COLUMN[data[5]]) {
+			return row_column->column_count;
+		}
+		return {};
+	}
+
+	[[nodiscard]] std::optional<spd_ddr4::sdram_device_type_t> spd_view::sdram_device_type() const noexcept {
+		return DDR4_SDRAM_DEVICE_TYPE[data[6]];
+	}
+
+	[[nodiscard]] std::optional<uint16_t> spd_view::tMAW_mul() const noexcept {
+		if (const auto& tMAW_tRRMAC = DDR4_TMAW_TRRMAC[data[7]]) {
+			return tMAW_tRRMAC->tMAW_mul;
+		}
+		return {};
+	}
+
+	[[nodiscard]] std::optional<uint16_t> spd_view::tRRMAC_thousands() const noexcept {
+		if (const auto& tMAW_tRRMAC = DDR4_TMAW_TRRMAC[data[7]]) {
+			return tMAW_tRRMAC->tRRMAC_thousands;
+		}
+		return {};
+	}
+
+	[[nodiscard]] std::optional<bool> spd_view::endure_higher_vdd() const noexcept {
+		return DDR4_ENDURE_HIGHER_VDD[data[11]];
+	}
+
+	[[nodiscard]] uint8_t spd_view::ranks() const noexcept {
+		return DDR4_RANKS_CHIP_SIZE[data[12]].ranks;
+	}
+
+	[[nodiscard]] spd_ddr4::chip_size_t spd_view::chip_size() const noexcept {
+		return DDR4_RANKS_CHIP_SIZE[data[12]].chip_size;
+	}
+
+	[[nodiscard]] std::optional<uint8_t> spd_view::module_memory_bus_width_bits() const noexcept {
+		return DDR4_MEMORY_BUS_WIDTH_BITS[data[13]];
+	}
+
+	[[nodiscard]] bool spd_view::module_thermal_sensor() const noexcept {
+		return spd_layout::decode_bits(data.data(), DDR4_MODULE_THERMAL_SENSOR) != 0;
+	}
+
+	[[nodiscard]] memory_clock spd_view::clock_min() const noexcept {
+		return round_ddr4_jdec_mem_clk(data[19], data[124]);
+	}
+
+	[[nodiscard]] memory_clock spd_view::clock_max() const noexcept {
+		return round_ddr4_jdec_mem_clk(data[18], data[125]);
+	}
+
+	[[nodiscard]] bool spd_view::cas_supported(size_t index) const noexcept {
+		// bytes 20-22 - one bit per cas latency starting at 7
+		if (index >= sizeof(spd_ddr4::cas_supported)) {
+			return false;
+		}
+		return ((data[20 + index / 8] >> (index % 8)) & 1u) != 0;
+	}
+
+	[[nodiscard]] memory_timing spd_view::tCL_min() const noexcept {
+		return spd_layout::decode_timing(data.data(), DDR4_TCL_MIN);
+	}
+
+	[[nodiscard]] memory_timing spd_view::tRCD_min() const noexcept {
+		return spd_layout::decode_timing(data.data(), DDR4_TRCD_MIN);
+	}
+
+	[[nodiscard]] memory_timing spd_view::tRP_min() const noexcept {
+		return spd_layout::decode_timing(data.data(), DDR4_TRP_MIN);
+	}
+
+	[[nodiscard]] memory_timing spd_view::tRAS_min() const noexcept {
+		return spd_layout::decode_timing(data.data(), DDR4_TRAS_MIN);
+	}
+
+	[[nodiscard]] memory_timing spd_view::tRC_min() const noexcept {
+		return spd_layout::decode_timing(data.data(), DDR4_TRC_MIN);
+	}
+
+	[[nodiscard]] memory_timing spd_view::tRFC1_min() const noexcept {
+		return spd_layout::decode_timing(data.data(), DDR4_TRFC1_MIN);
+	}
+
+	[[nodiscard]] memory_timing spd_view::tRFC2_min() const noexcept {
+		return spd_layout::decode_timing(data.data(), DDR4_TRFC2_MIN);
+	}
+
+	[[nodiscard]] memory_timing spd_view::tRFC4_min() const noexcept {
+		return spd_layout::decode_timing(data.data(), DDR4_TRFC4_MIN);
+	}
+
+	[[nodiscard]] memory_timing spd_view::tFAW_min() const noexcept {
+		return spd_layout::decode_timing(data.data(), DDR4_TFAW_MIN);
+	}
+
+	[[nodiscard]] memory_timing spd_view::tRRD_S_min() const noexcept {
+		return spd_layout::decode_timing(data.data(), DDR4_TRRD_S_MIN);
+	}
+
+	[[nodiscard]] memory_timing spd_view::tRRD_L_min() const noexcept {
+		return spd_layout::decode_timing(data.data(), DDR4_TRRD_L_MIN);
+	}
+
+	[[nodiscard]] memory_timing spd_view::tCCD_L_min() const noexcept {
+		return spd_layout::decode_timing(data.data(), DDR4_TCCD_L_MIN);
+	}
+
+	[[nodiscard]] uint8_t spd_view::module_height() const noexcept {
+		return spd_layout::decode_bits(data.data(), DDR4_MODULE_HEIGHT);
+	}
+
+	[[nodiscard]] uint8_t spd_view::module_max_thickness() const noexcept {
+		return spd_layout::decode_bits(data.data(), DDR4_MODULE_MAX_THICKNESS);
+	}
+
+	[[nodiscard]] uint8_t spd_view::ref_raw_card_used() const noexcept {
+		return spd_layout::decode_bits(data.data(), DDR4_REF_RAW_CARD_USED);
+	}
+
+	[[nodiscard]] bool spd_view::has_manufacturing_data() const noexcept {
+		return data.size() >= spd_view::MANUFACTURING_SIZE;
+	}
+
+	[[nodiscard]] uint8_t spd_view::manufacturing_byte(size_t offset) const noexcept {
+		return has_manufacturing_data() ? data[offset] : 0;
+	}
+
+	[[nodiscard]] ddr_module_manufacturer spd_view::module_manufacturer() const noexcept {
+		return parse_spd_ddr4_module_manufacturer(manufacturing_byte(320));
+	}
+
+	[[nodiscard]] uint8_t spd_view::module_manufacturing_location() const noexcept {
+		return manufacturing_byte(DDR4_MODULE_MANUFACTURING_LOCATION.offset);
+	}
+
+	[[nodiscard]] uint16_t spd_view::module_manufacturing_year() const noexcept {
+		return manufacturing_byte(323);
+	}
+
+	[[nodiscard]] uint16_t spd_view::module_manufacturing_week() const noexcept {
+		return manufacturing_byte(324);
+	}
+
+	[[nodiscard]] uint32_t spd_view::serial_number() const noexcept {
+		if (!has_manufacturing_data()) {
+			return 0;
+		}
+		return spd_layout::decode_u32(data.data(), 325);
+	}
+
+	[[nodiscard]] std::string_view spd_view::part_number() const noexcept {
+		if (!has_manufacturing_data()) {
+			return {};
+		}
+		return {reinterpret_cast<const char*>(&data[329]), 20};
+	}
+
+	[[nodiscard]] uint8_t spd_view::module_revision_code() const noexcept {
+		return manufacturing_byte(DDR4_MODULE_REVISION_CODE.offset);
+	}
+
+	[[nodiscard]] ddr_dram_manufacturer spd_view::dram_manufacturer() const noexcept {
+		return parse_spd_ddr4_dram_manufacturer(manufacturing_byte(350));
+	}
+
+	[[nodiscard]] uint8_t spd_view::dram_stepping() const noexcept {
+		return manufacturing_byte(DDR4_DRAM_STEPPING.offset);
+	}
+
+	[[nodiscard]] bool spd_view::has_xmp_20() const noexcept {
+		if (data.size() < XMP_20_PROFILE_OFFSET + 2u * XMP_20_PROFILE_SIZE || data[384] != 0x0c || data[385] != 0x4a) {
+			return false;
+		}
+		uint8_t xmp_major = ((data[387] & 0b00111000) >> 4);
+		uint8_t xmp_minor = ((data[387] & 0b00000111) >> 2);
+		return xmp_major == 2 && xmp_minor == 0;
+	}
+
+	[[nodiscard]] std::optional<xmp_20_data::xmp_profile> spd_view::xmp_profile(size_t index) const noexcept {
+		if (index > 1 || !has_xmp_20()) {
+			return {};
+		}
+		xmp_20_data::xmp_profile profile{};
+		const auto* profile_data = &data[XMP_20_PROFILE_OFFSET + index * XMP_20_PROFILE_SIZE];
+		// byte 386 - bit i enables profile i, dimms per channel in bits 2-3 and 4-5
+		profile.enable = spd_layout::decode_bits(data.data(), {386, static_cast<uint8_t>(1u << index), static_cast<uint8_t>(index)}) != 0;
+		profile.dimms_per_channel = spd_layout::decode_bits(data.data(), {386, static_cast<uint8_t>(0b1100u << (index * 2u)), static_cast<uint8_t>(2u + index * 2u)});
+		profile.dimm_voltage = {(profile_data[0] >> 7) * 1000u + (profile_data[0] & 0b01111111) * 10u, 0, 0, 0};
+		profile.clk = round_ddr4_jdec_mem_clk(profile_data[3], profile_data[38]);
+		spd_layout::decode_timing_fields<XMP_20_TIMINGS>(profile, profile_data);
+		return profile;
+	}
+
+	[[nodiscard]] std::variant<spd_view, hwctrl_error> make_spd_view(std::span<const unsigned char> data) noexcept {
+		if (data.size() < spd_view::MIN_SIZE) {
+			return hwctrl_error{"error - spd is too small for ddr4"};
+		}
+		if (data[2] != 0x0c) {
+			return hwctrl_error{"error - spd is not ddr4"};
+		}
+		if (DDR4_DEVICE_TYPE[data[3]] == std::nullopt) {
+			return hwctrl_error{"error - unknown spd device type"};
+		}
+		if (data[17] != 0x00) {
+			return hwctrl_error{"error - unknown mtb and ftb"};
+		}
+		return spd_view{data};
+	}
+
+	[[nodiscard]] spd_ddr4 to_spd_ddr4(const spd_view& view) noexcept {
+		const unsigned char* data = view.bytes().data();
+		spd_ddr4 spd_data{};
+		spd_data.device_type = view.device_type();
+		spd_layout::decode_byte_fields<DDR4_BYTES>(spd_data, data);
+		spd_layout::decode_timing_fields<DDR4_TIMINGS>(spd_data, data);
+		spd_data.bank_groups = view.bank_groups();
+		spd_data.internal_banks = view.internal_banks();
+		spd_data.row_count = view.row_count();
+		spd_data.column_count = view.column_count();
+		spd_data.sdram_device_type = view.sdram_device_type();
+		spd_data.tMAW_mul = view.tMAW_mul();
+		spd_data.tRRMAC_thousands = view.tRRMAC_thousands();
+		spd_data.endure_higher_vdd = view.endure_higher_vdd();
+		spd_data.ranks = view.ranks();
+		spd_data.chip_size = view.chip_size();
+		spd_data.module_memory_bus_width_bits = view.module_memory_bus_width_bits();
+		spd_data.module_thermal_sensor = view.module_thermal_sensor();
+		spd_data.clock_max = view.clock_max();
+		spd_data.clock_min = view.clock_min();
+		uint32_t cas_supported = data[20] | (data[21] << 8u) | (data[22] << 16u);
+		for (uint32_t i = 0; i < sizeof(spd_data.cas_supported); i++) {
+			spd_data.cas_supported[i] = ((cas_supported >> i) & 1u) != 0;
+		}
+		spd_data.module_manufacturer = view.module_manufacturer();
+		spd_data.module_manufacturing_location = view.module_manufacturing_location();
+		spd_data.module_manufacturing_year = view.module_manufacturing_year();
+		spd_data.module_manufacturing_week = view.module_manufacturing_week();
+		spd_data.serial_number = view.serial_number();
+		auto part_number = view.part_number();
+		std::memcpy(spd_data.part_number, part_number.data(), part_number.size());
+		spd_data.module_revision_code = view.module_revision_code();
+		spd_data.dram_manufacturer = view.dram_manufacturer();
+		spd_data.dram_stepping = view.dram_stepping();
+		if (view.has_xmp_20()) {
+			auto& xmp_data = spd_data.xmp_data.emplace();
+			xmp_data.profiles[0] = view.xmp_profile(0).value();
+			xmp_data.profiles[1] = view.xmp_profile(1).value();
+		}
+		return spd_data;
+	}
+} // namespace hwctrl::source
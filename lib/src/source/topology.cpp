@@ -0,0 +1,404 @@
+#include <source/topology.hpp>
+#include <util/affinity.hpp>
+#include <util/sysfs.hpp>
+#include <algorithm>
+#include <charconv>
+#include <tuple>
+#include <optional>
+
+namespace hwctrl::source {
+	using logical_cpu = cpu_topology::logical_cpu;
+
+	// ids above this are rejected so a corrupt file cannot make us allocate gigabytes of lookup table
+	static constexpr uint32_t MAX_TOPOLOGY_ID = 1u << 20u;
+
+	[[nodiscard]] size_t cpu_topology::cpu_groups::size() const noexcept {
+		return ids.size();
+	}
+
+	[[nodiscard]] std::span<const uint32_t> cpu_topology::cpu_groups::group(size_t index) const noexcept {
+		if (index >= ids.size()) {
+			return {};
+		}
+		return std::span<const uint32_t>{cpus}.subspan(offsets[index], offsets[index + 1] - offsets[index]);
+	}
+
+	[[nodiscard]] std::span<const uint32_t> cpu_topology::cpu_groups::find(uint32_t id) const noexcept {
+		if (id >= index_by_id.size()) {
+			return {};
+		}
+		return group(index_by_id[id]);
+	}
+
+	[[nodiscard]] uint32_t cpu_topology::logical_cpu_count() const noexcept {
+		return static_cast<uint32_t>(cpus.size());
+	}
+
+	[[nodiscard]] bool cpu_topology::online(uint32_t cpu) const noexcept {
+		return cpu < cpus.size() && cpus[cpu].online;
+	}
+
+	[[nodiscard]] std::span<const uint32_t> cpu_topology::smt_siblings(uint32_t cpu) const noexcept {
+		if (cpu >= cpus.size()) {
+			return {};
+		}
+		return cores.group(cpus[cpu].core_index);
+	}
+
+	[[nodiscard]] std::span<const uint32_t> cpu_topology::die_cpus(uint32_t cpu) const noexcept {
+		if (cpu >= cpus.size()) {
+			return {};
+		}
+		return dies.group(cpus[cpu].die_index);
+	}
+
+	[[nodiscard]] std::span<const uint32_t> cpu_topology::package_cpus(uint32_t package_id) const noexcept {
+		return packages.find(package_id);
+	}
+
+	[[nodiscard]] std::span<const uint32_t> cpu_topology::numa_node_cpus(uint32_t numa_node_id) const noexcept {
+		return numa_nodes.find(numa_node_id);
+	}
+
+	// counting sort of online cpus by member, cpus stay in ascending order within a group
+	[[nodiscard]] static cpu_topology::cpu_groups group_cpus(const std::vector<logical_cpu>& cpus, uint32_t logical_cpu::* member) noexcept {
+		cpu_topology::cpu_groups groups{};
+		uint32_t max_id = 0;
+		bool any = false;
+		for (const auto& cpu : cpus) {
+			if (cpu.online && cpu.*member < MAX_TOPOLOGY_ID) {
+				max_id = std::max(max_id, cpu.*member);
+				any = true;
+			}
+		}
+		if (!any) {
+			return groups;
+		}
+		std::vector<uint32_t> counts(max_id + 1u, 0);
+		for (const auto& cpu : cpus) {
+			if (cpu.online && cpu.*member < MAX_TOPOLOGY_ID) {
+				counts[cpu.*member]++;
+			}
+		}
+		groups.index_by_id.assign(max_id + 1u, cpu_topology::UNKNOWN_ID);
+		groups.offsets.push_back(0);
+		for (uint32_t id = 0; id <= max_id; id++) {
+			if (counts[id] != 0) {
+				groups.index_by_id[id] = static_cast<uint32_t>(groups.ids.size());
+				groups.ids.push_back(id);
+				groups.offsets.push_back(groups.offsets.back() + counts[id]);
+			}
+		}
+		groups.cpus.resize(groups.offsets.back());
+		std::vector<uint32_t> next(groups.offsets.begin(), groups.offsets.end() - 1);
+		for (uint32_t cpu = 0; cpu < cpus.size(); cpu++) {
+			const auto& entry = cpus[cpu];
+			if (entry.online && entry.*member < MAX_TOPOLOGY_ID) {
+				groups.cpus[next[groups.index_by_id[entry.*member]]++] = cpu;
+			}
+		}
+		return groups;
+	}
+
+	// assigns dense indices to the distinct (package, die[, core]) tuples of the online cpus
+	template <typename Key>
+	static void assign_dense_indices(std::vector<logical_cpu>& cpus, Key key, uint32_t logical_cpu::* member) noexcept {
+		using key_t = decltype(key(std::declval<const logical_cpu&>()));
+		std::vector<key_t> keys{};
+		keys.reserve(cpus.size());
+		for (const auto& cpu : cpus) {
+			if (cpu.online) {
+				keys.push_back(key(cpu));
+			}
+		}
+		std::sort(keys.begin(), keys.end());
+		keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+		for (auto& cpu : cpus) {
+			if (cpu.online) {
+				cpu.*member = static_cast<uint32_t>(std::lower_bound(keys.begin(), keys.end(), key(cpu)) - keys.begin());
+			}
+		}
+	}
+
+	[[nodiscard]] cpu_topology build_topology(std::vector<logical_cpu> cpus) noexcept {
+		assign_dense_indices(cpus, [](const logical_cpu& cpu) noexcept {
+			return std::tuple{cpu.package_id, cpu.die_id};
+		}, &logical_cpu::die_index);
+		assign_dense_indices(cpus, [](const logical_cpu& cpu) noexcept {
+			return std::tuple{cpu.package_id, cpu.die_id, cpu.core_id};
+		}, &logical_cpu::core_index);
+		cpu_topology topology{};
+		topology.packages = group_cpus(cpus, &logical_cpu::package_id);
+		topology.dies = group_cpus(cpus, &logical_cpu::die_index);
+		topology.cores = group_cpus(cpus, &logical_cpu::core_index);
+		topology.numa_nodes = group_cpus(cpus, &logical_cpu::numa_node_id);
+		topology.cpus = std::move(cpus);
+		return topology;
+	}
+
+	[[nodiscard]] std::vector<uint32_t> spread_cpus(const cpu_topology& topology) noexcept {
+		// core indices per package, cores are sorted by package so packages appear in order
+		std::vector<std::vector<size_t>> package_cores{};
+		std::vector<uint32_t> package_ids{};
+		size_t max_siblings = 0;
+		for (size_t core = 0; core < topology.cores.size(); core++) {
+			auto cpus = topology.cores.group(core);
+			if (cpus.empty()) {
+				continue;
+			}
+			auto package_id = topology.cpus[cpus.front()].package_id;
+			auto it = std::find(package_ids.begin(), package_ids.end(), package_id);
+			if (it == package_ids.end()) {
+				package_ids.push_back(package_id);
+				package_cores.emplace_back();
+				it = package_ids.end() - 1;
+			}
+			package_cores[static_cast<size_t>(it - package_ids.begin())].push_back(core);
+			max_siblings = std::max(max_siblings, cpus.size());
+		}
+		size_t max_cores = 0;
+		for (const auto& cores : package_cores) {
+			max_cores = std::max(max_cores, cores.size());
+		}
+		std::vector<uint32_t> order{};
+		for (size_t sibling = 0; sibling < max_siblings; sibling++) {
+			for (size_t position = 0; position < max_cores; position++) {
+				for (const auto& cores : package_cores) {
+					if (position >= cores.size()) {
+						continue;
+					}
+					auto cpus = topology.cores.group(cores[position]);
+					if (sibling < cpus.size()) {
+						order.push_back(cpus[sibling]);
+					}
+				}
+			}
+		}
+		// cpus without core information go last
+		for (uint32_t cpu = 0; cpu < topology.cpus.size(); cpu++) {
+			if (topology.cpus[cpu].online && topology.cpus[cpu].core_index == cpu_topology::UNKNOWN_ID) {
+				order.push_back(cpu);
+			}
+		}
+		return order;
+	}
+
+	[[nodiscard]] static std::variant<std::vector<uint32_t>, hwctrl_error> resolve_cpu_term(const cpu_topology& topology, std::string_view term) noexcept {
+		auto id_list = [&](std::string_view prefix) noexcept -> std::variant<std::vector<uint32_t>, hwctrl_error> {
+			auto list = term.substr(prefix.size());
+			if (list.empty()) {
+				return hwctrl_error{"error - expected an id list after \"" + std::string(prefix) + "\""};
+			}
+			return util::sysfs::parse_id_list(list);
+		};
+		auto collect = [&](std::string_view prefix, auto&& group_of) noexcept -> std::variant<std::vector<uint32_t>, hwctrl_error> {
+			auto ids = id_list(prefix);
+			if (auto* err_ptr = std::get_if<hwctrl_error>(&ids)) {
+				return std::move(*err_ptr);
+			}
+			std::vector<uint32_t> cpus{};
+			for (auto id : std::get<std::vector<uint32_t>>(ids)) {
+				auto group = group_of(id);
+				if (group.empty()) {
+					return hwctrl_error{"error - no online cpus in \"" + std::string(prefix) + std::to_string(id) + "\""};
+				}
+				cpus.insert(cpus.end(), group.begin(), group.end());
+			}
+			return cpus;
+		};
+
+		if (term == "all") {
+			std::vector<uint32_t> cpus{};
+			for (uint32_t cpu = 0; cpu < topology.cpus.size(); cpu++) {
+				if (topology.online(cpu)) {
+					cpus.push_back(cpu);
+				}
+			}
+			return cpus;
+		} else if (term.starts_with("package:")) {
+			return collect("package:", [&](uint32_t id) noexcept {
+				return topology.package_cpus(id);
+			});
+		} else if (term.starts_with("node:")) {
+			return collect("node:", [&](uint32_t id) noexcept {
+				return topology.numa_node_cpus(id);
+			});
+		} else if (term.starts_with("pid:")) {
+			auto pid_str = term.substr(4);
+			pid_t pid = 0;
+			auto [ptr, ec] = std::from_chars(pid_str.data(), pid_str.data() + pid_str.size(), pid);
+			if (ec != std::errc{} || ptr != pid_str.data() + pid_str.size() || pid <= 0) {
+				return hwctrl_error{"error - invalid pid in \"" + std::string(term) + "\""};
+			}
+			return util::affinity::process_cpus(pid);
+		} else if (term.starts_with("smt:")) {
+			auto inner = resolve_cpu_term(topology, term.substr(4));
+			if (auto* err_ptr = std::get_if<hwctrl_error>(&inner)) {
+				return std::move(*err_ptr);
+			}
+			std::vector<uint32_t> cpus{};
+			for (auto cpu : std::get<std::vector<uint32_t>>(inner)) {
+				auto siblings = topology.smt_siblings(cpu);
+				if (siblings.empty()) {
+					// no core information, the cpu is its own core
+					cpus.push_back(cpu);
+				}
+				cpus.insert(cpus.end(), siblings.begin(), siblings.end());
+			}
+			return cpus;
+		}
+		return util::sysfs::parse_id_list(term);
+	}
+
+	[[nodiscard]] std::variant<std::vector<uint32_t>, hwctrl_error> resolve_cpu_set(const cpu_topology& topology, std::string_view expression) noexcept {
+		std::vector<bool> selected(topology.cpus.size(), false);
+		bool subtract = false;
+		while (true) {
+			auto end = expression.find_first_of("+~");
+			auto term = expression.substr(0, end);
+			if (term.empty()) {
+				return hwctrl_error{"error - empty term in cpu set"};
+			}
+			auto cpus = resolve_cpu_term(topology, term);
+			if (auto* err_ptr = std::get_if<hwctrl_error>(&cpus)) {
+				return std::move(*err_ptr);
+			}
+			for (auto cpu : std::get<std::vector<uint32_t>>(cpus)) {
+				if (cpu >= selected.size()) {
+					if (subtract) {
+						continue;
+					}
+					return hwctrl_error{"error - cpu " + std::to_string(cpu) + " does not exist"};
+				}
+				selected[cpu] = !subtract;
+			}
+			if (end == std::string_view::npos) {
+				break;
+			}
+			subtract = expression[end] == '~';
+			expression.remove_prefix(end + 1);
+		}
+		std::vector<uint32_t> result{};
+		for (uint32_t cpu = 0; cpu < selected.size(); cpu++) {
+			// offline cpus named explicitly are dropped, sysfs has no controls for them
+			if (selected[cpu] && topology.online(cpu)) {
+				result.push_back(cpu);
+			}
+		}
+		if (result.empty()) {
+			return hwctrl_error{"error - cpu set selects no online cpus"};
+		}
+		return result;
+	}
+
+	[[nodiscard]] cpu_topology make_topology(const cpuinfo& ci) noexcept {
+		std::vector<logical_cpu> cpus{};
+		for (const auto& cpu : ci.cpus) {
+			for (const auto& core : cpu.cores) {
+				for (const auto& proc : core.processors) {
+					if (proc.id >= MAX_TOPOLOGY_ID) {
+						continue;
+					}
+					if (proc.id >= cpus.size()) {
+						cpus.resize(proc.id + 1u);
+					}
+					auto& entry = cpus[proc.id];
+					entry.online = true;
+					entry.package_id = cpu.physical_id;
+					entry.core_id = core.id;
+				}
+			}
+		}
+		return build_topology(std::move(cpus));
+	}
+
+	[[nodiscard]] std::variant<cpu_topology, hwctrl_error> read_topology(const std::filesystem::path& sysfs_root) noexcept {
+		std::vector<logical_cpu> cpus{};
+		std::optional<hwctrl_error> error{};
+		util::sysfs::for_each_numbered_entry(sysfs_root / "devices/system/cpu", "cpu", [&](uint32_t id, const std::filesystem::path& path) noexcept {
+			if (id >= MAX_TOPOLOGY_ID) {
+				return;
+			}
+			if (id >= cpus.size()) {
+				cpus.resize(id + 1u);
+			}
+			// the topology directory only exists while a cpu is online
+			auto package_id = util::sysfs::read_uint(path / "topology/physical_package_id");
+			auto core_id = util::sysfs::read_uint(path / "topology/core_id");
+			if (!std::holds_alternative<uint64_t>(package_id) || !std::holds_alternative<uint64_t>(core_id)) {
+				return;
+			}
+			auto& entry = cpus[id];
+			entry.online = true;
+			entry.package_id = static_cast<uint32_t>(std::get<uint64_t>(package_id));
+			entry.core_id = static_cast<uint32_t>(std::get<uint64_t>(core_id));
+			// die_id is missing before linux 5.2, treat everything as die 0 then
+			auto die_id = util::sysfs::read_uint(path / "topology/die_id");
+			entry.die_id = static_cast<uint32_t>(std::holds_alternative<uint64_t>(die_id) ? std::get<uint64_t>(die_id) : 0u);
+		});
+		if (cpus.empty()) {
+			return hwctrl_error{"error - no cpus found in \"" + (sysfs_root / "devices/system/cpu").string() + "\""};
+		}
+		util::sysfs::for_each_numbered_entry(sysfs_root / "devices/system/node", "node", [&](uint32_t node_id, const std::filesystem::path& path) noexcept {
+			auto cpulist = util::sysfs::read_string(path / "cpulist");
+			if (!std::holds_alternative<std::string>(cpulist)) {
+				return;
+			}
+			auto node_cpus = util::sysfs::parse_id_list(std::get<std::string>(cpulist));
+			if (auto* err_ptr = std::get_if<hwctrl_error>(&node_cpus)) {
+				error = std::move(*err_ptr);
+				return;
+			}
+			for (auto cpu : std::get<std::vector<uint32_t>>(node_cpus)) {
+				if (cpu < cpus.size()) {
+					cpus[cpu].numa_node_id = node_id;
+				}
+			}
+		});
+		if (error != std::nullopt) {
+			return std::move(error.value());
+		}
+		return build_topology(std::move(cpus));
+	}
+
+	static void write_cpu_groups(util::writer& out, std::string_view key, const cpu_topology::cpu_groups& groups) noexcept {
+		out.begin_array(key);
+		for (size_t index = 0; index < groups.size(); index++) {
+			auto cpus = groups.group(index);
+			out.begin_object();
+			out.field("id", groups.ids[index]);
+			out.field("cpus", util::sysfs::id_list_string({cpus.begin(), cpus.end()}));
+			out.end_object();
+		}
+		out.end_array();
+	}
+
+	void write_cpu_topology(util::writer& out, const cpu_topology& topology) noexcept {
+		out.begin_object();
+		write_cpu_groups(out, "packages", topology.packages);
+		write_cpu_groups(out, "numa_nodes", topology.numa_nodes);
+		out.begin_array("cpus");
+		for (uint32_t cpu = 0; cpu < topology.logical_cpu_count(); cpu++) {
+			const auto& entry = topology.cpus[cpu];
+			if (!entry.online) {
+				continue;
+			}
+			auto siblings = topology.smt_siblings(cpu);
+			out.begin_object();
+			out.field("id", cpu);
+			out.field("package", entry.package_id);
+			out.field("core", entry.core_id);
+			out.field("siblings", util::sysfs::id_list_string({siblings.begin(), siblings.end()}));
+			out.end_object();
+		}
+		out.end_array();
+		out.end_object();
+	}
+
+	[[nodiscard]] std::string cpu_topology_string(const cpu_topology& topology) noexcept {
+		std::string str;
+		util::writer out{str, util::output_format::TEXT};
+		write_cpu_topology(out, topology);
+		return str;
+	}
+} // namespace hwctrl::source
@@ -0,0 +1,153 @@
+#include <util/affinity.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace hwctrl::util::affinity {
+	// frees a cpu set allocated with CPU_ALLOC
+	struct cpu_set_deleter {
+		void operator()(cpu_set_t* set) const noexcept {
+			CPU_FREE(set);
+		}
+	};
+
+	using cpu_set_ptr = std::unique_ptr<cpu_set_t, cpu_set_deleter>;
+
+	[[nodiscard]] static cpu_set_ptr make_cpu_set(std::span<const uint32_t> cpus, size_t& set_size) noexcept {
+		uint32_t max_cpu = cpus.empty() ? 0 : *std::max_element(cpus.begin(), cpus.end());
+		size_t count = size_t{max_cpu} + 1;
+		cpu_set_ptr set{CPU_ALLOC(count)};
+		set_size = CPU_ALLOC_SIZE(count);
+		if (set != nullptr) {
+			CPU_ZERO_S(set_size, set.get());
+			for (auto cpu : cpus) {
+				CPU_SET_S(cpu, set_size, set.get());
+			}
+		}
+		return set;
+	}
+
+	[[nodiscard]] std::optional<hwctrl_error> pin_current_thread(std::span<const uint32_t> cpus) noexcept {
+		if (cpus.empty()) {
+			return hwctrl_error{"error - no cpus to pin to"};
+		}
+		size_t set_size = 0;
+		auto set = make_cpu_set(cpus, set_size);
+		if (set == nullptr) {
+			return hwctrl_error{"error - failed to allocate cpu set"};
+		}
+		if (int err = ::pthread_setaffinity_np(::pthread_self(), set_size, set.get()); err != 0) {
+			return hwctrl_error{"error - failed to set thread affinity: " + std::string(std::strerror(err))};
+		}
+		return std::nullopt;
+	}
+
+	[[nodiscard]] std::optional<hwctrl_error> set_process_affinity(pid_t pid, std::span<const uint32_t> cpus) noexcept {
+		if (cpus.empty()) {
+			return hwctrl_error{"error - no cpus to pin to"};
+		}
+		size_t set_size = 0;
+		auto set = make_cpu_set(cpus, set_size);
+		if (set == nullptr) {
+			return hwctrl_error{"error - failed to allocate cpu set"};
+		}
+		if (::sched_setaffinity(pid, set_size, set.get()) != 0) {
+			return hwctrl_error{"error - failed to set process affinity: " + std::string(std::strerror(errno))};
+		}
+		return std::nullopt;
+	}
+
+	[[nodiscard]] std::variant<std::vector<uint32_t>, hwctrl_error> current_thread_cpus() noexcept {
+		// grow the set until the kernel mask fits
+		for (size_t count = 1024; count <= (size_t{1} << 20u); count *= 2) {
+			cpu_set_ptr set{CPU_ALLOC(count)};
+			size_t set_size = CPU_ALLOC_SIZE(count);
+			if (set == nullptr) {
+				break;
+			}
+			CPU_ZERO_S(set_size, set.get());
+			if (int err = ::pthread_getaffinity_np(::pthread_self(), set_size, set.get()); err != 0) {
+				if (err == EINVAL) {
+					continue;
+				}
+				return hwctrl_error{"error - failed to get thread affinity: " + std::string(std::strerror(err))};
+			}
+			std::vector<uint32_t> cpus{};
+			for (size_t cpu = 0; cpu < count; cpu++) {
+				if (CPU_ISSET_S(cpu, set_size, set.get())) {
+					cpus.push_back(static_cast<uint32_t>(cpu));
+				}
+			}
+			return cpus;
+		}
+		return hwctrl_error{"error - failed to get thread affinity"};
+	}
+
+	[[nodiscard]] std::variant<std::vector<uint32_t>, hwctrl_error> process_cpus(pid_t pid) noexcept {
+		for (size_t count = 1024; count <= (size_t{1} << 20u); count *= 2) {
+			cpu_set_ptr set{CPU_ALLOC(count)};
+			size_t set_size = CPU_ALLOC_SIZE(count);
+			if (set == nullptr) {
+				break;
+			}
+			CPU_ZERO_S(set_size, set.get());
+			if (::sched_getaffinity(pid, set_size, set.get()) != 0) {
+				if (errno == EINVAL) {
+					continue;
+				}
+				return hwctrl_error{"error - failed to get affinity of process " + std::to_string(pid) + ": " + std::string(std::strerror(errno))};
+			}
+			std::vector<uint32_t> cpus{};
+			for (size_t cpu = 0; cpu < count; cpu++) {
+				if (CPU_ISSET_S(cpu, set_size, set.get())) {
+					cpus.push_back(static_cast<uint32_t>(cpu));
+				}
+			}
+			return cpus;
+		}
+		return hwctrl_error{"error - failed to get affinity of process " + std::to_string(pid)};
+	}
+
+	[[nodiscard]] std::optional<hwctrl_error> set_memory_policy(memory_policy policy, std::span<const uint32_t> nodes) noexcept {
+		int mode = MPOL_DEFAULT;
+		switch (policy) {
+			case memory_policy::BIND:
+				mode = MPOL_BIND;
+				break;
+			case memory_policy::INTERLEAVE:
+				mode = MPOL_INTERLEAVE;
+				break;
+			case memory_policy::PREFERRED:
+				// MPOL_PREFERRED_MANY needs linux 5.15, a single node works everywhere
+				mode = nodes.size() == 1 ? MPOL_PREFERRED : MPOL_PREFERRED_MANY;
+				break;
+			case memory_policy::DEFAULT:
+				//[[fallthrough]]
+			default:
+				break;
+		}
+		if (mode != MPOL_DEFAULT && nodes.empty()) {
+			return hwctrl_error{"error - no numa nodes for the memory policy"};
+		}
+		// no libnuma, the mask is a plain array of unsigned long like the kernel expects
+		constexpr size_t BITS = sizeof(unsigned long) * 8;
+		uint32_t max_node = nodes.empty() ? 0 : *std::max_element(nodes.begin(), nodes.end());
+		// maxnode counts one past the highest bit and older kernels drop the last bit, hence + 2
+		auto maxnode = size_t{max_node} + 2;
+		std::vector<unsigned long> mask((maxnode + BITS - 1) / BITS, 0);
+		for (auto node : nodes) {
+			mask[node / BITS] |= 1ul << (node % BITS);
+		}
+		if (::syscall(SYS_set_mempolicy, mode, mode == MPOL_DEFAULT ? nullptr : mask.data(), mode == MPOL_DEFAULT ? size_t{0} : maxnode) != 0) {
+			return hwctrl_error{"error - failed to set memory policy: " + std::string(std::strerror(errno))};
+		}
+		return std::nullopt;
+	}
+} // namespace hwctrl::util::affinity
@@ -1,26 +1,331 @@
 #include <util/file.hpp>
-#include <iomanip>
-#include <fstream>
-#include <iterator>
+#include <util/snapshot.hpp>
+#include <algorithm>
+#include <utility>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <glob.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 namespace hwctrl::util::file {
-	[[nodiscard]] std::variant<std::vector<char>, hwctrl_error> read_binary_file(const std::filesystem::path& path) noexcept {
-		std::ifstream input(path, std::ios::binary);
+	unique_fd::unique_fd(int fd_value) noexcept : fd(fd_value) {
+	}
+
+	unique_fd::unique_fd(unique_fd&& other) noexcept : fd(std::exchange(other.fd, -1)) {
+	}
+
+	unique_fd& unique_fd::operator=(unique_fd&& other) noexcept {
+		if (this != &other) {
+			if (fd >= 0) {
+				::close(fd);
+			}
+			fd = std::exchange(other.fd, -1);
+		}
+		return *this;
+	}
+
+	unique_fd::~unique_fd() noexcept {
+		if (fd >= 0) {
+			::close(fd);
+		}
+	}
+
+	[[nodiscard]] int unique_fd::get() const noexcept {
+		return fd;
+	}
+
+	[[nodiscard]] bool unique_fd::valid() const noexcept {
+		return fd >= 0;
+	}
+
+	mapped_file::mapped_file(void* address_value, size_t size_value) noexcept : address(address_value), size(size_value) {
+	}
+
+	mapped_file::mapped_file(mapped_file&& other) noexcept : address(std::exchange(other.address, nullptr)), size(std::exchange(other.size, 0)) {
+	}
+
+	mapped_file& mapped_file::operator=(mapped_file&& other) noexcept {
+		if (this != &other) {
+			if (address != nullptr) {
+				::munmap(address, size);
+			}
+			address = std::exchange(other.address, nullptr);
+			size = std::exchange(other.size, 0);
+		}
+		return *this;
+	}
+
+	mapped_file::~mapped_file() noexcept {
+		if (address != nullptr) {
+			::munmap(address, size);
+		}
+	}
+
+	[[nodiscard]] std::span<const unsigned char> mapped_file::data() const noexcept {
+		return {static_cast<const unsigned char*>(address), size};
+	}
+
+	[[nodiscard]] std::variant<unique_fd, hwctrl_error> open_file(const std::filesystem::path& path) noexcept {
+		unique_fd fd{::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+		if (!fd.valid()) {
+			return hwctrl_error{"could not read file - \"" + path.string() + "\""};
+		}
+		return fd;
+	}
+
+	// an anonymous read only copy, so replayed files unmap like real ones
+	[[nodiscard]] static std::variant<mapped_file, hwctrl_error> map_contents(std::string_view contents) noexcept {
+		if (contents.empty()) {
+			return mapped_file{};
+		}
+		void* address = ::mmap(nullptr, contents.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (address == MAP_FAILED) {
+			return hwctrl_error{"could not map " + std::to_string(contents.size()) + " bytes"};
+		}
+		std::memcpy(address, contents.data(), contents.size());
+		::mprotect(address, contents.size(), PROT_READ);
+		return mapped_file{address, contents.size()};
+	}
+
+	[[nodiscard]] std::variant<mapped_file, hwctrl_error> map_file(const std::filesystem::path& path) noexcept {
+		if (const auto* replay = snapshot::active_archive(); replay != nullptr) {
+			auto contents = replay->read_file(snapshot::normalize_path(path));
+			if (auto* err_ptr = std::get_if<hwctrl_error>(&contents)) {
+				return std::move(*err_ptr);
+			}
+			return map_contents(std::get<std::string_view>(contents));
+		}
+		auto fd_result = open_file(path);
+		if (auto* err_ptr = std::get_if<hwctrl_error>(&fd_result)) {
+			return std::move(*err_ptr);
+		}
+		const auto& fd = std::get<unique_fd>(fd_result);
+		struct stat file_stat{};
+		if (::fstat(fd.get(), &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) {
+			return hwctrl_error{"could not map file - \"" + path.string() + "\""};
+		}
+		auto size = static_cast<size_t>(file_stat.st_size);
+		if (size == 0) {
+			// mmap rejects empty mappings
+			return mapped_file{};
+		}
+		void* address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+		if (address == MAP_FAILED) {
+			return hwctrl_error{"could not map file - \"" + path.string() + "\""};
+		}
+		mapped_file mapped{address, size};
+		if (auto* record = snapshot::active_recorder(); record != nullptr) {
+			auto data = mapped.data();
+			record->add_file(snapshot::normalize_path(path), {reinterpret_cast<const char*>(data.data()), data.size()});
+		}
+		return mapped;
+	}
 
-		if (input.is_open()) {
-			return std::vector<char>(std::istreambuf_iterator<char>(input), {});
+	[[nodiscard]] std::variant<mapped_file, hwctrl_error> map_or_read_file(const std::filesystem::path& path) noexcept {
+		auto map_result = map_file(path);
+		if (std::holds_alternative<mapped_file>(map_result)) {
+			return map_result;
 		}
+		// pread works where mmap does not, the copy is recorded and replayed like any other read
+		std::vector<char> buffer{};
+		auto read_result = read_ram_file(path, buffer);
+		if (std::holds_alternative<hwctrl_error>(read_result)) {
+			return map_result;
+		}
+		return map_contents(std::get<std::string_view>(read_result));
+	}
 
-		return hwctrl_error{"could not read file - \"" + path.string() + "\""};
+	[[nodiscard]] std::variant<std::string_view, hwctrl_error> read_ram_file(const unique_fd& fd, std::vector<char>& buffer) noexcept {
+		if (buffer.size() < 4096) {
+			buffer.resize(4096);
+		}
+		size_t length = 0;
+		while (true) {
+			if (length == buffer.size()) {
+				buffer.resize(buffer.size() * 2);
+			}
+			ssize_t count = ::pread(fd.get(), buffer.data() + length, buffer.size() - length, static_cast<off_t>(length));
+			if (count < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				return hwctrl_error{"could not read file descriptor " + std::to_string(fd.get())};
+			}
+			if (count == 0) {
+				break;
+			}
+			length += static_cast<size_t>(count);
+		}
+		return std::string_view{buffer.data(), length};
+	}
+
+	[[nodiscard]] std::variant<std::string_view, hwctrl_error> read_ram_file(const std::filesystem::path& path, std::vector<char>& buffer) noexcept {
+		if (const auto* replay = snapshot::active_archive(); replay != nullptr) {
+			auto contents = replay->read_file(snapshot::normalize_path(path));
+			if (auto* err_ptr = std::get_if<hwctrl_error>(&contents)) {
+				return std::move(*err_ptr);
+			}
+			auto view = std::get<std::string_view>(contents);
+			if (buffer.size() < view.size()) {
+				buffer.resize(view.size());
+			}
+			std::copy(view.begin(), view.end(), buffer.begin());
+			return std::string_view{buffer.data(), view.size()};
+		}
+		auto fd_result = open_file(path);
+		if (auto* err_ptr = std::get_if<hwctrl_error>(&fd_result)) {
+			return std::move(*err_ptr);
+		}
+		auto read_result = read_ram_file(std::get<unique_fd>(fd_result), buffer);
+		if (std::holds_alternative<hwctrl_error>(read_result)) {
+			return hwctrl_error{"could not read file - \"" + path.string() + "\""};
+		}
+		if (auto* record = snapshot::active_recorder(); record != nullptr) {
+			record->add_file(snapshot::normalize_path(path), std::get<std::string_view>(read_result));
+		}
+		return read_result;
+	}
+
+	[[nodiscard]] std::variant<std::vector<char>, hwctrl_error> read_binary_file(const std::filesystem::path& path) noexcept {
+		std::vector<char> buffer{};
+		auto read_result = read_ram_file(path, buffer);
+		if (auto* err_ptr = std::get_if<hwctrl_error>(&read_result)) {
+			return std::move(*err_ptr);
+		}
+		buffer.resize(std::get<std::string_view>(read_result).size());
+		return buffer;
 	}
 
 	[[nodiscard]] std::variant<std::string, hwctrl_error> read_ram_file(const std::filesystem::path& path) noexcept {
-		std::ifstream input(path);
+		thread_local std::vector<char> buffer{};
+		auto read_result = read_ram_file(path, buffer);
+		if (auto* err_ptr = std::get_if<hwctrl_error>(&read_result)) {
+			return std::move(*err_ptr);
+		}
+		return std::string{std::get<std::string_view>(read_result)};
+	}
 
-		if (input.is_open()) {
-			return std::string(std::istreambuf_iterator<char>(input), {});
+	[[nodiscard]] std::vector<std::string> list_directory(const std::filesystem::path& dir) noexcept {
+		if (const auto* replay = snapshot::active_archive(); replay != nullptr) {
+			return replay->list_directory(snapshot::normalize_path(dir));
 		}
+		std::vector<std::string> names{};
+		std::error_code ec;
+		auto it = std::filesystem::directory_iterator(dir, ec);
+		if (ec) {
+			return names;
+		}
+		for (; !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+			names.push_back(it->path().filename().string());
+		}
+		std::sort(names.begin(), names.end());
+		if (auto* record = snapshot::active_recorder(); record != nullptr) {
+			record->add_directory(snapshot::normalize_path(dir), names);
+		}
+		return names;
+	}
 
-		return hwctrl_error{"could not read file - \"" + path.string() + "\""};
+	[[nodiscard]] bool exists(const std::filesystem::path& path) noexcept {
+		auto normalized = std::filesystem::path{snapshot::normalize_path(path)};
+		auto parent = normalized.has_parent_path() ? normalized.parent_path() : std::filesystem::path{"."};
+		if (const auto* replay = snapshot::active_archive(); replay != nullptr) {
+			if (replay->kind_of(normalized.string()).has_value()) {
+				return true;
+			}
+			auto names = replay->list_directory(snapshot::normalize_path(parent));
+			return std::binary_search(names.begin(), names.end(), normalized.filename().string());
+		}
+		if (snapshot::active_recorder() != nullptr) {
+			// the listing of the parent answers the same question during a replay
+			[[maybe_unused]] auto names = list_directory(parent);
+		}
+		std::error_code ec;
+		return std::filesystem::exists(path, ec);
+	}
+
+	[[nodiscard]] std::optional<std::filesystem::path> resolve(const std::filesystem::path& path) noexcept {
+		if (const auto* replay = snapshot::active_archive(); replay != nullptr) {
+			auto target = replay->read_link(snapshot::normalize_path(path));
+			if (!target.has_value()) {
+				return std::nullopt;
+			}
+			return std::filesystem::path{std::move(*target)};
+		}
+		std::error_code ec;
+		auto canonical = std::filesystem::canonical(path, ec);
+		if (ec) {
+			return std::nullopt;
+		}
+		if (auto* record = snapshot::active_recorder(); record != nullptr) {
+			record->add_link(snapshot::normalize_path(path), canonical.string());
+		}
+		return canonical;
+	}
+
+	[[nodiscard]] bool is_directory(const std::filesystem::path& path) noexcept {
+		if (const auto* replay = snapshot::active_archive(); replay != nullptr) {
+			auto normalized = snapshot::normalize_path(path);
+			return replay->kind_of(normalized) == snapshot::entry_kind::DIRECTORY || !replay->files_under(normalized).empty();
+		}
+		std::error_code ec;
+		bool directory = std::filesystem::is_directory(path, ec);
+		if (directory && snapshot::active_recorder() != nullptr) {
+			// an empty directory has no files below it to tell a replay it is one
+			[[maybe_unused]] auto names = list_directory(path);
+		}
+		return directory;
+	}
+
+	[[nodiscard]] std::optional<hwctrl_error> walk_files(const std::filesystem::path& dir, const std::function<void(const std::filesystem::path&)>& on_file) noexcept {
+		if (const auto* replay = snapshot::active_archive(); replay != nullptr) {
+			for (const auto& path : replay->files_under(snapshot::normalize_path(dir))) {
+				on_file(path);
+			}
+			return std::nullopt;
+		}
+		std::error_code ec;
+		auto options = std::filesystem::directory_options::skip_permission_denied;
+		for (auto it = std::filesystem::recursive_directory_iterator(dir, options, ec); !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+			if (it->is_regular_file(ec)) {
+				on_file(it->path());
+			}
+		}
+		if (ec) {
+			return hwctrl_error{"error - could not walk \"" + dir.string() + "\" - " + ec.message()};
+		}
+		return std::nullopt;
+	}
+
+	[[nodiscard]] std::variant<std::vector<std::filesystem::path>, hwctrl_error> glob(const std::string& pattern) noexcept {
+		std::vector<std::filesystem::path> paths{};
+		if (const auto* replay = snapshot::active_archive(); replay != nullptr) {
+			// recorded paths are normalized, so is the pattern, FNM_PATHNAME and FNM_PERIOD match like glob(3)
+			auto normalized = snapshot::normalize_path(pattern);
+			for (const auto& entry : replay->entries()) {
+				if (entry.kind == snapshot::entry_kind::FILE && ::fnmatch(normalized.c_str(), entry.path.c_str(), FNM_PATHNAME | FNM_PERIOD) == 0) {
+					paths.emplace_back(entry.path);
+				}
+			}
+			return paths;
+		}
+		glob_t matches{};
+		// GLOB_MARK appends a slash to directories, which are left out like in a replay
+		int result = ::glob(pattern.c_str(), GLOB_MARK, nullptr, &matches);
+		if (result != 0 && result != GLOB_NOMATCH) {
+			::globfree(&matches);
+			return hwctrl_error{"error - invalid pattern \"" + pattern + "\""};
+		}
+		for (size_t i = 0; i < matches.gl_pathc; i++) {
+			std::string_view match{matches.gl_pathv[i]};
+			if (!match.empty() && match.back() != '/') {
+				paths.emplace_back(match);
+			}
+		}
+		::globfree(&matches);
+		return paths;
 	}
 } // namespace hwctrl::util::file
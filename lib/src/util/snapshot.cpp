@@ -0,0 +1,416 @@
+#include <util/snapshot.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace hwctrl::util::snapshot {
+	static constexpr std::string_view MAGIC = "HWCSNAP1";
+	static constexpr uint32_t VERSION = 1;
+	static constexpr size_t HEADER_SIZE = 32;
+	static constexpr size_t BLOCK_RECORD_SIZE = 16;
+	static constexpr size_t INDEX_RECORD_SIZE = 24;
+	// a corrupt raw size must not make a replay allocate gigabytes
+	static constexpr uint64_t MAX_BLOCK_RAW_SIZE = uint64_t{1} << 30u;
+
+	static void append_u32(std::string& out, uint32_t value) noexcept {
+		for (uint32_t shift = 0; shift < 32; shift += 8) {
+			out.push_back(static_cast<char>((value >> shift) & 0xffu));
+		}
+	}
+
+	static void append_u64(std::string& out, uint64_t value) noexcept {
+		append_u32(out, static_cast<uint32_t>(value));
+		append_u32(out, static_cast<uint32_t>(value >> 32u));
+	}
+
+	[[nodiscard]] static uint32_t load_u32(const unsigned char* data) noexcept {
+		return uint32_t{data[0]} | uint32_t{data[1]} << 8u | uint32_t{data[2]} << 16u | uint32_t{data[3]} << 24u;
+	}
+
+	[[nodiscard]] static uint64_t load_u64(const unsigned char* data) noexcept {
+		return uint64_t{load_u32(data)} | uint64_t{load_u32(data + 4)} << 32u;
+	}
+
+	void recorder::add_file(std::string path, std::string_view contents) noexcept {
+		std::lock_guard lock(mutex);
+		entries.insert_or_assign(std::move(path), std::pair{entry_kind::FILE, std::string{contents}});
+	}
+
+	void recorder::add_directory(std::string path, std::span<const std::string> names) noexcept {
+		std::string contents{};
+		for (const auto& name : names) {
+			contents += name;
+			contents += '\n';
+		}
+		std::lock_guard lock(mutex);
+		entries.insert_or_assign(std::move(path), std::pair{entry_kind::DIRECTORY, std::move(contents)});
+	}
+
+	void recorder::add_link(std::string path, std::string target) noexcept {
+		std::lock_guard lock(mutex);
+		entries.insert_or_assign(std::move(path), std::pair{entry_kind::LINK, std::move(target)});
+	}
+
+	// compresses raw onto blocks and appends its record to block_table
+	[[nodiscard]] static std::optional<hwctrl_error> compress_block(const std::string& raw, std::string& blocks, std::string& block_table, uint64_t data_offset) noexcept {
+		auto bound = ::compressBound(raw.size());
+		std::string compressed(bound, '\0');
+		uLongf compressed_size = bound;
+		if (::compress2(reinterpret_cast<Bytef*>(compressed.data()), &compressed_size, reinterpret_cast<const Bytef*>(raw.data()), raw.size(), Z_BEST_COMPRESSION) != Z_OK) {
+			return hwctrl_error{"error - could not compress a snapshot block"};
+		}
+		append_u64(block_table, data_offset + blocks.size());
+		append_u32(block_table, static_cast<uint32_t>(compressed_size));
+		append_u32(block_table, static_cast<uint32_t>(raw.size()));
+		blocks.append(compressed.data(), compressed_size);
+		return std::nullopt;
+	}
+
+	[[nodiscard]] std::optional<hwctrl_error> recorder::save(const std::filesystem::path& path) const noexcept {
+		std::lock_guard lock(mutex);
+		std::string paths{};
+		std::string index{};
+		// block offsets are absolute, so blocks are compressed once the size of the tables is known
+		std::vector<std::string> raw_blocks{};
+		std::string raw{};
+		for (const auto& [entry_path, entry] : entries) {
+			const auto& [kind, contents] = entry;
+			if (contents.size() > UINT32_MAX || paths.size() + entry_path.size() > UINT32_MAX) {
+				return hwctrl_error{"error - \"" + entry_path + "\" is too large for a snapshot"};
+			}
+			if (!raw.empty() && raw.size() + contents.size() > archive::BLOCK_SIZE) {
+				raw_blocks.push_back(std::move(raw));
+				raw = {};
+			}
+			append_u32(index, static_cast<uint32_t>(paths.size()));
+			append_u32(index, static_cast<uint32_t>(entry_path.size()));
+			append_u32(index, static_cast<uint32_t>(raw_blocks.size()));
+			append_u32(index, static_cast<uint32_t>(raw.size()));
+			append_u32(index, static_cast<uint32_t>(contents.size()));
+			append_u32(index, static_cast<uint32_t>(kind));
+			paths += entry_path;
+			raw += contents;
+		}
+		if (!raw.empty()) {
+			raw_blocks.push_back(std::move(raw));
+		}
+
+		std::string header{MAGIC};
+		append_u32(header, VERSION);
+		append_u32(header, static_cast<uint32_t>(raw_blocks.size()));
+		append_u32(header, static_cast<uint32_t>(entries.size()));
+		append_u32(header, 0);
+		append_u64(header, paths.size());
+		uint64_t data_offset = HEADER_SIZE + raw_blocks.size() * BLOCK_RECORD_SIZE + index.size() + paths.size();
+		std::string block_table{};
+		std::string blocks{};
+		for (const auto& block : raw_blocks) {
+			if (auto err = compress_block(block, blocks, block_table, data_offset)) {
+				return err;
+			}
+		}
+
+		util::file::unique_fd fd{::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)};
+		if (!fd.valid()) {
+			return hwctrl_error{"error - could not create \"" + path.string() + "\": " + std::string(std::strerror(errno))};
+		}
+		for (const auto* part : {&header, &block_table, &index, &paths, &blocks}) {
+			size_t written = 0;
+			while (written < part->size()) {
+				ssize_t count = ::write(fd.get(), part->data() + written, part->size() - written);
+				if (count < 0) {
+					if (errno == EINTR) {
+						continue;
+					}
+					return hwctrl_error{"error - could not write \"" + path.string() + "\": " + std::string(std::strerror(errno))};
+				}
+				written += static_cast<size_t>(count);
+			}
+		}
+		return std::nullopt;
+	}
+
+	archive::archive(file::mapped_file mapped, size_t blocks, size_t entries_in_index) noexcept : file(std::move(mapped)), block_count(blocks), entry_count(entries_in_index), cache(std::make_unique<block_cache>()) {
+		cache->blocks.resize(block_count);
+	}
+
+	// table pointers, only valid after open_archive checked the sizes
+	struct archive_tables {
+		const unsigned char* blocks = nullptr;
+		const unsigned char* index = nullptr;
+		const unsigned char* paths = nullptr;
+	};
+
+	[[nodiscard]] static archive_tables tables(std::span<const unsigned char> data, size_t block_count, size_t entry_count) noexcept {
+		archive_tables result{};
+		result.blocks = data.data() + HEADER_SIZE;
+		result.index = result.blocks + block_count * BLOCK_RECORD_SIZE;
+		result.paths = result.index + entry_count * INDEX_RECORD_SIZE;
+		return result;
+	}
+
+	[[nodiscard]] static std::string_view entry_path(const archive_tables& table, size_t index) noexcept {
+		const auto* record = table.index + index * INDEX_RECORD_SIZE;
+		return {reinterpret_cast<const char*>(table.paths + load_u32(record)), load_u32(record + 4)};
+	}
+
+	[[nodiscard]] size_t archive::lower_bound(std::string_view path) const noexcept {
+		auto table = tables(file.data(), block_count, entry_count);
+		size_t low = 0;
+		size_t high = entry_count;
+		while (low < high) {
+			size_t middle = low + (high - low) / 2;
+			if (entry_path(table, middle) < path) {
+				low = middle + 1;
+			} else {
+				high = middle;
+			}
+		}
+		return low;
+	}
+
+	[[nodiscard]] std::optional<size_t> archive::find(std::string_view path, entry_kind kind) const noexcept {
+		auto table = tables(file.data(), block_count, entry_count);
+		auto low = lower_bound(path);
+		if (low == entry_count || entry_path(table, low) != path || load_u32(table.index + low * INDEX_RECORD_SIZE + 20) != static_cast<uint32_t>(kind)) {
+			return std::nullopt;
+		}
+		return low;
+	}
+
+	[[nodiscard]] std::variant<std::string_view, hwctrl_error> archive::contents(size_t index) const noexcept {
+		auto table = tables(file.data(), block_count, entry_count);
+		const auto* record = table.index + index * INDEX_RECORD_SIZE;
+		uint32_t block = load_u32(record + 8);
+		uint32_t offset = load_u32(record + 12);
+		uint32_t size = load_u32(record + 16);
+		if (size == 0) {
+			return std::string_view{};
+		}
+		std::lock_guard lock(cache->mutex);
+		auto& raw = cache->blocks[block];
+		if (!raw.has_value()) {
+			const auto* block_record = table.blocks + size_t{block} * BLOCK_RECORD_SIZE;
+			auto raw_size = load_u32(block_record + 12);
+			std::string decompressed(raw_size, '\0');
+			auto decompressed_size = static_cast<uLongf>(raw_size);
+			if (::uncompress(reinterpret_cast<Bytef*>(decompressed.data()), &decompressed_size, file.data().data() + load_u64(block_record), load_u32(block_record + 8)) != Z_OK || decompressed_size != raw_size) {
+				return hwctrl_error{"error - snapshot block " + std::to_string(block) + " is corrupt"};
+			}
+			raw = std::move(decompressed);
+		}
+		return std::string_view{*raw}.substr(offset, size);
+	}
+
+	[[nodiscard]] std::variant<std::string_view, hwctrl_error> archive::read_file(std::string_view path) const noexcept {
+		auto index = find(path, entry_kind::FILE);
+		if (!index.has_value()) {
+			return hwctrl_error{"could not read file - \"" + std::string(path) + "\" is not in the snapshot"};
+		}
+		return contents(*index);
+	}
+
+	[[nodiscard]] std::vector<std::string> archive::list_directory(std::string_view path) const noexcept {
+		auto index = find(path, entry_kind::DIRECTORY);
+		if (!index.has_value()) {
+			return {};
+		}
+		auto contents_result = contents(*index);
+		if (!std::holds_alternative<std::string_view>(contents_result)) {
+			return {};
+		}
+		auto names_str = std::get<std::string_view>(contents_result);
+		std::vector<std::string> names{};
+		while (!names_str.empty()) {
+			auto end = names_str.find('\n');
+			names.emplace_back(names_str.substr(0, end));
+			names_str.remove_prefix(end == std::string_view::npos ? names_str.size() : end + 1);
+		}
+		return names;
+	}
+
+	[[nodiscard]] std::optional<std::string> archive::read_link(std::string_view path) const noexcept {
+		auto index = find(path, entry_kind::LINK);
+		if (!index.has_value()) {
+			return std::nullopt;
+		}
+		auto contents_result = contents(*index);
+		if (!std::holds_alternative<std::string_view>(contents_result)) {
+			return std::nullopt;
+		}
+		return std::string(std::get<std::string_view>(contents_result));
+	}
+
+	[[nodiscard]] std::optional<entry_kind> archive::kind_of(std::string_view path) const noexcept {
+		auto table = tables(file.data(), block_count, entry_count);
+		auto index = lower_bound(path);
+		if (index == entry_count || entry_path(table, index) != path) {
+			return std::nullopt;
+		}
+		return static_cast<entry_kind>(load_u32(table.index + index * INDEX_RECORD_SIZE + 20));
+	}
+
+	[[nodiscard]] std::vector<std::string> archive::files_under(std::string_view dir) const noexcept {
+		std::string prefix{dir};
+		if (prefix.empty() || prefix.back() != '/') {
+			prefix += '/';
+		}
+		// everything below dir sorts in one run right after the prefix
+		auto table = tables(file.data(), block_count, entry_count);
+		std::vector<std::string> paths{};
+		for (auto index = lower_bound(prefix); index < entry_count; index++) {
+			auto path = entry_path(table, index);
+			if (path.substr(0, prefix.size()) != prefix) {
+				break;
+			}
+			if (load_u32(table.index + index * INDEX_RECORD_SIZE + 20) == static_cast<uint32_t>(entry_kind::FILE)) {
+				paths.emplace_back(path);
+			}
+		}
+		return paths;
+	}
+
+	[[nodiscard]] std::vector<entry_info> archive::entries() const noexcept {
+		auto table = tables(file.data(), block_count, entry_count);
+		std::vector<entry_info> result{};
+		result.reserve(entry_count);
+		for (size_t i = 0; i < entry_count; i++) {
+			const auto* record = table.index + i * INDEX_RECORD_SIZE;
+			result.push_back({std::string(entry_path(table, i)), static_cast<entry_kind>(load_u32(record + 20)), load_u32(record + 16)});
+		}
+		return result;
+	}
+
+	[[nodiscard]] size_t archive::archive_size() const noexcept {
+		return file.data().size();
+	}
+
+	[[nodiscard]] std::variant<archive, hwctrl_error> open_archive(const std::filesystem::path& path) noexcept {
+		auto file_result = file::map_file(path);
+		if (auto* err_ptr = std::get_if<hwctrl_error>(&file_result)) {
+			return std::move(*err_ptr);
+		}
+		auto data = std::get<file::mapped_file>(file_result).data();
+		auto corrupt = [&](std::string_view reason) noexcept {
+			return hwctrl_error{"error - \"" + path.string() + "\" is not a valid snapshot: " + std::string(reason)};
+		};
+		if (data.size() < HEADER_SIZE || std::string_view(reinterpret_cast<const char*>(data.data()), MAGIC.size()) != MAGIC) {
+			return corrupt("bad magic");
+		}
+		if (load_u32(data.data() + 8) != VERSION) {
+			return corrupt("unsupported version " + std::to_string(load_u32(data.data() + 8)));
+		}
+		size_t block_count = load_u32(data.data() + 12);
+		size_t entry_count = load_u32(data.data() + 16);
+		uint64_t paths_size = load_u64(data.data() + 24);
+		uint64_t tables_end = HEADER_SIZE + block_count * BLOCK_RECORD_SIZE + entry_count * INDEX_RECORD_SIZE;
+		if (paths_size > data.size() || tables_end + paths_size > data.size()) {
+			return corrupt("truncated tables");
+		}
+		auto table = tables(data, block_count, entry_count);
+		std::vector<uint64_t> raw_sizes(block_count);
+		for (size_t i = 0; i < block_count; i++) {
+			const auto* record = table.blocks + i * BLOCK_RECORD_SIZE;
+			uint64_t offset = load_u64(record);
+			raw_sizes[i] = load_u32(record + 12);
+			if (offset > data.size() || load_u32(record + 8) > data.size() - offset || raw_sizes[i] > MAX_BLOCK_RAW_SIZE) {
+				return corrupt("block " + std::to_string(i) + " out of bounds");
+			}
+		}
+		for (size_t i = 0; i < entry_count; i++) {
+			const auto* record = table.index + i * INDEX_RECORD_SIZE;
+			uint64_t path_end = uint64_t{load_u32(record)} + load_u32(record + 4);
+			uint32_t block = load_u32(record + 8);
+			uint64_t contents_end = uint64_t{load_u32(record + 12)} + load_u32(record + 16);
+			uint32_t kind = load_u32(record + 20);
+			if (path_end > paths_size || kind > static_cast<uint32_t>(entry_kind::LINK)) {
+				return corrupt("entry " + std::to_string(i) + " out of bounds");
+			}
+			if (load_u32(record + 16) != 0 && (block >= block_count || contents_end > raw_sizes[block])) {
+				return corrupt("entry " + std::to_string(i) + " out of bounds");
+			}
+			// lookups binary search the index
+			if (i > 0 && !(entry_path(table, i - 1) < entry_path(table, i))) {
+				return corrupt("index not sorted");
+			}
+		}
+		return archive{std::move(std::get<file::mapped_file>(file_result)), block_count, entry_count};
+	}
+
+	[[nodiscard]] std::string normalize_path(const std::filesystem::path& path) noexcept {
+		auto str = path.lexically_normal().string();
+		while (str.size() > 1 && str.back() == '/') {
+			str.pop_back();
+		}
+		return str;
+	}
+
+	static std::unique_ptr<recorder> global_recorder{};
+	static std::unique_ptr<archive> global_archive{};
+
+	void start_recording() noexcept {
+		global_recorder = std::make_unique<recorder>();
+	}
+
+	[[nodiscard]] std::optional<hwctrl_error> save_recording(const std::filesystem::path& path) noexcept {
+		if (global_recorder == nullptr) {
+			return hwctrl_error{"error - nothing was recorded"};
+		}
+		return global_recorder->save(path);
+	}
+
+	void start_replay(archive replay_archive) noexcept {
+		global_archive = std::make_unique<archive>(std::move(replay_archive));
+	}
+
+	[[nodiscard]] recorder* active_recorder() noexcept {
+		return global_recorder.get();
+	}
+
+	[[nodiscard]] const archive* active_archive() noexcept {
+		return global_archive.get();
+	}
+
+	[[nodiscard]] std::optional<hwctrl_error> check_replay_write(const std::filesystem::path& path) noexcept {
+		if (global_archive != nullptr) {
+			return hwctrl_error{"error - not writing \"" + path.string() + "\" while a snapshot is replayed"};
+		}
+		return std::nullopt;
+	}
+
+	[[nodiscard]] static std::string_view kind_name(entry_kind kind) noexcept {
+		switch (kind) {
+			case entry_kind::FILE:
+				return "file";
+			case entry_kind::DIRECTORY:
+				return "directory";
+			case entry_kind::LINK:
+				return "link";
+		}
+		return "unknown";
+	}
+
+	void write_archive_entries(util::writer& out, const archive& snapshot) noexcept {
+		auto entries = snapshot.entries();
+		uint64_t raw_bytes = 0;
+		for (const auto& entry : entries) {
+			raw_bytes += entry.size;
+		}
+		out.begin_object();
+		out.field("archive_bytes", snapshot.archive_size());
+		out.field("raw_bytes", raw_bytes);
+		out.begin_array("entries");
+		for (const auto& entry : entries) {
+			out.begin_object();
+			out.field("path", entry.path);
+			out.field("kind", kind_name(entry.kind));
+			out.field("size", entry.size);
+			out.end_object();
+		}
+		out.end_array();
+		out.end_object();
+	}
+} // namespace hwctrl::util::snapshot
@@ -0,0 +1,126 @@
+#include <util/sysfs.hpp>
+#include <util/file.hpp>
+#include <util/snapshot.hpp>
+#include <charconv>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace hwctrl::util::sysfs {
+	[[nodiscard]] std::variant<uint64_t, hwctrl_error> read_uint(const std::filesystem::path& path) noexcept {
+		thread_local std::vector<char> buffer{};
+		auto file_result = file::read_ram_file(path, buffer);
+		if (auto* err_ptr = std::get_if<hwctrl_error>(&file_result)) {
+			return std::move(*err_ptr);
+		}
+		auto str = std::get<std::string_view>(file_result);
+		uint64_t value = 0;
+		auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+		if (ec != std::errc{}) {
+			return hwctrl_error{"error - expected an integer in \"" + path.string() + "\""};
+		}
+		return value;
+	}
+
+	[[nodiscard]] std::variant<std::string, hwctrl_error> read_string(const std::filesystem::path& path) noexcept {
+		auto file_result = file::read_ram_file(path);
+		if (auto* str_ptr = std::get_if<std::string>(&file_result)) {
+			while (!str_ptr->empty() && (str_ptr->back() == '\n' || str_ptr->back() == ' ')) {
+				str_ptr->pop_back();
+			}
+		}
+		return file_result;
+	}
+
+	[[nodiscard]] std::optional<hwctrl_error> write_string(const std::filesystem::path& path, std::string_view value) noexcept {
+		if (auto err = snapshot::check_replay_write(path)) {
+			return err;
+		}
+		file::unique_fd fd{::open(path.c_str(), O_WRONLY | O_TRUNC | O_CLOEXEC)};
+		if (!fd.valid()) {
+			return hwctrl_error{"error - could not open \"" + path.string() + "\" for writing: " + std::string(std::strerror(errno))};
+		}
+		ssize_t count = 0;
+		do {
+			count = ::write(fd.get(), value.data(), value.size());
+		} while (count < 0 && errno == EINTR);
+		// the kernel rejects invalid values in write, e.g. EINVAL for an unknown governor or EBUSY for epp under the performance governor
+		if (count < 0) {
+			return hwctrl_error{"error - writing \"" + std::string(value) + "\" to \"" + path.string() + "\" failed: " + std::string(std::strerror(errno))};
+		}
+		if (static_cast<size_t>(count) != value.size()) {
+			return hwctrl_error{"error - short write to \"" + path.string() + "\""};
+		}
+		return std::nullopt;
+	}
+
+	[[nodiscard]] std::variant<std::vector<uint32_t>, hwctrl_error> parse_id_list(std::string_view str) noexcept {
+		// ids above this are not produced by the kernel and would make callers size huge tables
+		static constexpr uint32_t MAX_ID = 1u << 20u;
+		std::vector<uint32_t> ids{};
+		const char* current = str.data();
+		const char* const end = str.data() + str.size();
+		while (current != end && *current != '\n') {
+			uint32_t first = 0;
+			auto [first_end, first_ec] = std::from_chars(current, end, first);
+			if (first_ec != std::errc{}) {
+				return hwctrl_error{"error - invalid id list \"" + std::string(str) + "\""};
+			}
+			uint32_t last = first;
+			current = first_end;
+			if (current != end && *current == '-') {
+				auto [last_end, last_ec] = std::from_chars(current + 1, end, last);
+				if (last_ec != std::errc{} || last < first) {
+					return hwctrl_error{"error - invalid id range in \"" + std::string(str) + "\""};
+				}
+				current = last_end;
+			}
+			if (last >= MAX_ID) {
+				return hwctrl_error{"error - id out of range in \"" + std::string(str) + "\""};
+			}
+			for (uint32_t id = first; id <= last; id++) {
+				ids.push_back(id);
+			}
+			if (current != end && *current == ',') {
+				current++;
+			}
+		}
+		std::sort(ids.begin(), ids.end());
+		ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+		return ids;
+	}
+
+	[[nodiscard]] std::string id_list_string(const std::vector<uint32_t>& ids) noexcept {
+		std::string str{};
+		for (size_t i = 0; i < ids.size();) {
+			size_t j = i;
+			while (j + 1 < ids.size() && ids[j + 1] == ids[j] + 1) {
+				j++;
+			}
+			if (!str.empty()) {
+				str += ",";
+			}
+			str += std::to_string(ids[i]);
+			if (j != i) {
+				str += "-";
+				str += std::to_string(ids[j]);
+			}
+			i = j + 1;
+		}
+		return str;
+	}
+
+	[[nodiscard]] std::variant<uint32_t, hwctrl_error> parse_numbered_entry(std::string_view name, std::string_view prefix) noexcept {
+		if (name.size() <= prefix.size() || name.substr(0, prefix.size()) != prefix) {
+			return hwctrl_error{"error - not a numbered entry"};
+		}
+		uint32_t id = 0;
+		auto [ptr, ec] = std::from_chars(name.data() + prefix.size(), name.data() + name.size(), id);
+		if (ec != std::errc{} || ptr != name.data() + name.size()) {
+			return hwctrl_error{"error - not a numbered entry"};
+		}
+		return id;
+	}
+} // namespace hwctrl::util::sysfs
@@ -0,0 +1,112 @@
+#include <util/thread_pool.hpp>
+#include <algorithm>
+
+namespace hwctrl::util {
+	static thread_local const thread_pool* current_pool = nullptr;
+	static thread_local size_t current_worker = 0;
+
+	thread_pool::thread_pool(size_t thread_count) noexcept : queues(), workers(), state_mutex(), work_available(), all_done() {
+		thread_count = std::max<size_t>(thread_count, 1);
+		queues.reserve(thread_count);
+		for (size_t i = 0; i < thread_count; i++) {
+			queues.push_back(std::make_unique<worker_queue>());
+		}
+		workers.reserve(thread_count);
+		for (size_t i = 0; i < thread_count; i++) {
+			workers.emplace_back([this, i]() noexcept {
+				run(i);
+			});
+		}
+	}
+
+	thread_pool::~thread_pool() noexcept {
+		{
+			std::lock_guard lock(state_mutex);
+			stop = true;
+		}
+		work_available.notify_all();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+	}
+
+	void thread_pool::submit(std::function<void()> task) noexcept {
+		size_t index = 0;
+		{
+			// count the task before it is visible so a worker that pops it never sees queued == 0
+			std::lock_guard lock(state_mutex);
+			queued++;
+			unfinished++;
+			index = current_pool == this ? current_worker : next_queue++ % queues.size();
+		}
+		{
+			std::lock_guard lock(queues[index]->mutex);
+			queues[index]->tasks.push_back(std::move(task));
+		}
+		work_available.notify_one();
+	}
+
+	void thread_pool::wait() noexcept {
+		std::unique_lock lock(state_mutex);
+		all_done.wait(lock, [this]() noexcept {
+			return unfinished == 0;
+		});
+	}
+
+	[[nodiscard]] size_t thread_pool::size() const noexcept {
+		return workers.size();
+	}
+
+	[[nodiscard]] size_t thread_pool::worker_index() const noexcept {
+		return current_pool == this ? current_worker : workers.size();
+	}
+
+	[[nodiscard]] bool thread_pool::try_pop(size_t index, std::function<void()>& task) noexcept {
+		{
+			auto& own = *queues[index];
+			std::lock_guard lock(own.mutex);
+			if (!own.tasks.empty()) {
+				task = std::move(own.tasks.back());
+				own.tasks.pop_back();
+				return true;
+			}
+		}
+		for (size_t offset = 1; offset < queues.size(); offset++) {
+			auto& victim = *queues[(index + offset) % queues.size()];
+			std::lock_guard lock(victim.mutex);
+			if (!victim.tasks.empty()) {
+				task = std::move(victim.tasks.front());
+				victim.tasks.pop_front();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void thread_pool::run(size_t index) noexcept {
+		current_pool = this;
+		current_worker = index;
+		while (true) {
+			std::function<void()> task{};
+			if (try_pop(index, task)) {
+				{
+					std::lock_guard lock(state_mutex);
+					queued--;
+				}
+				task();
+				std::lock_guard lock(state_mutex);
+				if (--unfinished == 0) {
+					all_done.notify_all();
+				}
+				continue;
+			}
+			std::unique_lock lock(state_mutex);
+			work_available.wait(lock, [this]() noexcept {
+				return stop || queued != 0;
+			});
+			if (stop && queued == 0) {
+				return;
+			}
+		}
+	}
+} // namespace hwctrl::util
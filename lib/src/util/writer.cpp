@@ -0,0 +1,373 @@
+#include <util/writer.hpp>
+#include <bit>
+#include <charconv>
+#include <cerrno>
+#include <cmath>
+#include <unistd.h>
+
+namespace hwctrl::util {
+	static constexpr auto JSON_ESCAPE = []() noexcept {
+		std::array<bool, 256> table{};
+		for (size_t c = 0; c < 0x20; c++) {
+			table[c] = true;
+		}
+		table['"'] = true;
+		table['\\'] = true;
+		// non ascii bytes are checked for valid utf-8
+		for (size_t c = 0x80; c < 0x100; c++) {
+			table[c] = true;
+		}
+		return table;
+	}();
+
+	// length of the well formed utf-8 sequence at str[i] (rfc 3629, no overlongs or surrogates), 0 when it is not one
+	[[nodiscard]] static size_t utf8_sequence_length(std::string_view str, size_t i) noexcept {
+		auto c = static_cast<unsigned char>(str[i]);
+		if (c < 0x80) {
+			return 1;
+		}
+		size_t length = 0;
+		// bounds of the second byte, which exclude overlong forms, surrogates and code points past U+10FFFF
+		unsigned char low = 0x80;
+		unsigned char high = 0xbf;
+		if (c >= 0xc2 && c <= 0xdf) {
+			length = 2;
+		} else if (c >= 0xe0 && c <= 0xef) {
+			length = 3;
+			low = c == 0xe0 ? 0xa0 : 0x80;
+			high = c == 0xed ? 0x9f : 0xbf;
+		} else if (c >= 0xf0 && c <= 0xf4) {
+			length = 4;
+			low = c == 0xf0 ? 0x90 : 0x80;
+			high = c == 0xf4 ? 0x8f : 0xbf;
+		} else {
+			return 0;
+		}
+		if (str.size() - i < length) {
+			return 0;
+		}
+		auto second = static_cast<unsigned char>(str[i + 1]);
+		if (second < low || second > high) {
+			return 0;
+		}
+		for (size_t j = 2; j < length; j++) {
+			if ((static_cast<unsigned char>(str[i + j]) & 0xc0u) != 0x80) {
+				return 0;
+			}
+		}
+		return length;
+	}
+
+	[[nodiscard]] static bool valid_utf8(std::string_view str) noexcept {
+		for (size_t i = 0; i < str.size();) {
+			auto length = utf8_sequence_length(str, i);
+			if (length == 0) {
+				return false;
+			}
+			i += length;
+		}
+		return true;
+	}
+
+	[[nodiscard]] std::optional<output_format> parse_output_format(std::string_view str) noexcept {
+		if (str == "text") {
+			return output_format::TEXT;
+		} else if (str == "json") {
+			return output_format::JSON;
+		} else if (str == "cbor") {
+			return output_format::CBOR;
+		}
+		return {};
+	}
+
+	writer::writer(int fd_value, output_format format_value) noexcept : fd(fd_value), output(format_value), buffer(), frames() {
+		buffer.reserve(FLUSH_SIZE + 256);
+	}
+
+	writer::writer(std::string& out_ref, output_format format_value) noexcept : out(&out_ref), output(format_value), buffer(), frames() {
+		out->reserve(out->size() + STRING_RESERVE_SIZE);
+	}
+
+	writer::~writer() noexcept {
+		flush();
+	}
+
+	void writer::begin_object(std::string_view key) noexcept {
+		begin_container(key, false);
+	}
+
+	void writer::end_object() noexcept {
+		end_container();
+	}
+
+	void writer::begin_array(std::string_view key) noexcept {
+		begin_container(key, true);
+	}
+
+	void writer::end_array() noexcept {
+		end_container();
+	}
+
+	void writer::field(std::string_view key, std::string_view value) noexcept {
+		if (overflow_depth != 0) {
+			return;
+		}
+		write_key(key);
+		write_string(value);
+		end_value();
+	}
+
+	void writer::field(std::string_view key, const char* value) noexcept {
+		field(key, std::string_view{value});
+	}
+
+	void writer::flush() noexcept {
+		if (out != nullptr || buffer.empty()) {
+			return;
+		}
+		size_t written = 0;
+		while (!write_failed && written < buffer.size()) {
+			ssize_t count = ::write(fd, buffer.data() + written, buffer.size() - written);
+			if (count < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				write_failed = true;
+				break;
+			}
+			written += static_cast<size_t>(count);
+		}
+		buffer.clear();
+	}
+
+	void writer::flush_each_value(bool enable) noexcept {
+		flush_values = enable;
+	}
+
+	[[nodiscard]] output_format writer::format() const noexcept {
+		return output;
+	}
+
+	[[nodiscard]] bool writer::failed() const noexcept {
+		return write_failed;
+	}
+
+	void writer::write_key(std::string_view key) noexcept {
+		bool in_object = depth != 0 && !frames[depth - 1].array;
+		switch (output) {
+			case output_format::TEXT:
+				write_indent();
+				if (in_object) {
+					put(key);
+					put(" = ");
+				}
+				break;
+			case output_format::JSON:
+				if (depth != 0) {
+					if (!frames[depth - 1].first) {
+						put(',');
+					}
+					frames[depth - 1].first = false;
+				}
+				if (in_object) {
+					put('"');
+					put(key);
+					put("\":");
+				}
+				break;
+			case output_format::CBOR:
+				if (in_object) {
+					write_cbor_head(3, key.size());
+					put(key);
+				}
+				break;
+		}
+	}
+
+	void writer::end_value() noexcept {
+		if (output == output_format::TEXT) {
+			put('\n');
+		} else if (output == output_format::JSON && depth == 0) {
+			put('\n');
+		}
+		if ((depth == 0 && flush_values) || buffer.size() >= FLUSH_SIZE) {
+			flush();
+		}
+	}
+
+	void writer::begin_container(std::string_view key, bool array) noexcept {
+		if (depth == MAX_DEPTH || overflow_depth != 0) {
+			overflow_depth++;
+			return;
+		}
+		bool in_object = depth != 0 && !frames[depth - 1].array;
+		switch (output) {
+			case output_format::TEXT:
+				// the top level container is implied, nested ones get a header line
+				if (depth != 0) {
+					write_indent();
+					put(in_object ? key : std::string_view{"-"});
+					put(in_object ? ":\n" : "\n");
+				}
+				break;
+			case output_format::JSON:
+				write_key(key);
+				put(array ? '[' : '{');
+				break;
+			case output_format::CBOR:
+				write_key(key);
+				put(static_cast<char>(array ? 0x9f : 0xbf));
+				break;
+		}
+		frames[depth++] = {array, true};
+	}
+
+	void writer::end_container() noexcept {
+		if (overflow_depth != 0) {
+			overflow_depth--;
+			return;
+		}
+		if (depth == 0) {
+			return;
+		}
+		bool array = frames[--depth].array;
+		switch (output) {
+			case output_format::TEXT:
+				// separates top level values
+				if (depth == 0) {
+					put('\n');
+				}
+				break;
+			case output_format::JSON:
+				put(array ? ']' : '}');
+				if (depth == 0) {
+					put('\n');
+				}
+				break;
+			case output_format::CBOR:
+				put(static_cast<char>(0xff));
+				break;
+		}
+		if ((depth == 0 && flush_values) || buffer.size() >= FLUSH_SIZE) {
+			flush();
+		}
+	}
+
+	void writer::write_string(std::string_view str) noexcept {
+		switch (output) {
+			case output_format::TEXT:
+				put(str);
+				break;
+			case output_format::JSON:
+				{
+					static constexpr std::string_view HEX = "0123456789abcdef";
+					put('"');
+					size_t start = 0;
+					for (size_t i = 0; i < str.size(); i++) {
+						auto c = static_cast<unsigned char>(str[i]);
+						if (!JSON_ESCAPE[c]) {
+							continue;
+						}
+						if (c >= 0x80) {
+							if (auto length = utf8_sequence_length(str, i); length != 0) {
+								i += length - 1;
+								continue;
+							}
+						}
+						put(str.substr(start, i - start));
+						start = i + 1;
+						if (c == '"' || c == '\\') {
+							put('\\');
+							put(static_cast<char>(c));
+						} else if (c >= 0x80) {
+							// eeprom, dmi and edac strings are not always utf-8, a stray byte must not break the document
+							put("\\ufffd");
+						} else {
+							put("\\u00");
+							put(HEX[c >> 4u]);
+							put(HEX[c & 0xfu]);
+						}
+					}
+					put(str.substr(start));
+					put('"');
+				}
+				break;
+			case output_format::CBOR:
+				// text strings must be valid utf-8, anything else goes out as a byte string
+				write_cbor_head(valid_utf8(str) ? 3 : 2, str.size());
+				put(str);
+				break;
+		}
+	}
+
+	void writer::write_uint(uint64_t value) noexcept {
+		if (output == output_format::CBOR) {
+			write_cbor_head(0, value);
+			return;
+		}
+		char digits[24];
+		auto [end, ec] = std::to_chars(std::begin(digits), std::end(digits), value);
+		put(std::string_view{digits, static_cast<size_t>(end - digits)});
+	}
+
+	void writer::write_int(int64_t value) noexcept {
+		if (output == output_format::CBOR) {
+			if (value < 0) {
+				write_cbor_head(1, static_cast<uint64_t>(-(value + 1)));
+			} else {
+				write_cbor_head(0, static_cast<uint64_t>(value));
+			}
+			return;
+		}
+		char digits[24];
+		auto [end, ec] = std::to_chars(std::begin(digits), std::end(digits), value);
+		put(std::string_view{digits, static_cast<size_t>(end - digits)});
+	}
+
+	void writer::write_double(double value) noexcept {
+		if (output == output_format::CBOR) {
+			put(static_cast<char>(0xfb));
+			auto bits = std::bit_cast<uint64_t>(value);
+			for (int shift = 56; shift >= 0; shift -= 8) {
+				put(static_cast<char>((bits >> shift) & 0xffu));
+			}
+			return;
+		}
+		if (output == output_format::JSON && !std::isfinite(value)) {
+			put("null");
+			return;
+		}
+		char digits[32];
+		auto [end, ec] = std::to_chars(std::begin(digits), std::end(digits), value);
+		put(std::string_view{digits, static_cast<size_t>(end - digits)});
+	}
+
+	void writer::write_bool(bool value) noexcept {
+		if (output == output_format::CBOR) {
+			put(static_cast<char>(value ? 0xf5 : 0xf4));
+			return;
+		}
+		put(value ? "true" : "false");
+	}
+
+	void writer::write_cbor_head(uint8_t major, uint64_t value) noexcept {
+		auto type = static_cast<uint8_t>(major << 5u);
+		if (value < 24) {
+			put(static_cast<char>(type | value));
+			return;
+		}
+		int bytes = value <= 0xff ? 1 : value <= 0xffff ? 2 : value <= 0xffffffff ? 4 : 8;
+		// additional information 24-27 selects a 1, 2, 4 or 8 byte big endian argument
+		put(static_cast<char>(type | (24 + std::countr_zero(static_cast<unsigned>(bytes)))));
+		for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8) {
+			put(static_cast<char>((value >> shift) & 0xffu));
+		}
+	}
+
+	void writer::write_indent() noexcept {
+		for (size_t i = 1; i < depth; i++) {
+			put('\t');
+		}
+	}
+
+} // namespace hwctrl::util